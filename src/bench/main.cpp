@@ -0,0 +1,482 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Engine benchmark.
+ *
+ * Plays synthetic songs through the fake audio driver, which runs the
+ * audio engine callback back to back in this thread, and prints one JSON
+ * object per scenario on stdout:
+ *
+ * {"scenario":"voices_64","sample_rate":48000,"buffer_size":256,"cycles":2000,
+ *  "frames_per_sec":1.2e+07,"p50_us":18.1,"p99_us":25.3,"max_us":91.0,
+ *  "tail_ratio":1.02,"allocations":0}
+ *
+ * allocations counts the calls to operator new while the scenario plays,
+ * and with glibc the calls to malloc, calloc and realloc as well, in any
+ * thread of the process.
+ *
+ * tail_ratio is the mean cycle of the second half of the bars over the one
+ * of the first half, the notes start on the bar so it stays close to 1 as
+ * long as decaying voices cost no more than loud ones.
+ *
+ * The song_io scenario saves and loads a big song without samples instead:
+ *
+ * {"scenario":"song_io","notes":131072,"save_ms":410.2,"dom_ms":520.7,"load_ms":380.4}
+ *
+ * dom_ms is the time building the DOM tree of the file alone takes, what the
+ * former reader spent before reading any note.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <new>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+
+#include <hydrogen/object.h>
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/LocalFileMng.h>
+#include <hydrogen/IO/FakeDriver.h>
+#include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/LadspaFX.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/drumkit_component.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/instrument_component.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/helpers/filesystem.h>
+#include "song_helper.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+
+using namespace H2Core;
+
+// every allocation of the process is counted, the engine runs in this thread while it is measured
+static std::atomic<unsigned long> __allocations( 0 );
+
+#if defined(__GLIBC__)
+// Qt containers and C libraries call malloc directly, with glibc it can be replaced too
+#define H2BENCH_COUNT_MALLOC
+
+extern "C" {
+void* __libc_malloc( size_t nSize );
+void* __libc_calloc( size_t nCount, size_t nSize );
+void* __libc_realloc( void* p, size_t nSize );
+
+void* malloc( size_t nSize )
+{
+	__allocations++;
+	return __libc_malloc( nSize );
+}
+
+void* calloc( size_t nCount, size_t nSize )
+{
+	__allocations++;
+	return __libc_calloc( nCount, nSize );
+}
+
+void* realloc( void* p, size_t nSize )
+{
+	__allocations++;
+	return __libc_realloc( p, nSize );
+}
+}
+#endif
+
+void* operator new( size_t nSize )
+{
+#ifndef H2BENCH_COUNT_MALLOC
+	__allocations++;
+#endif
+	void* p = malloc( nSize ? nSize : 1 );
+	if ( p == NULL ) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[]( size_t nSize )
+{
+	return operator new( nSize );
+}
+
+void operator delete( void* p ) noexcept
+{
+	free( p );
+}
+
+void operator delete[]( void* p ) noexcept
+{
+	free( p );
+}
+
+void operator delete( void* p, size_t ) noexcept
+{
+	free( p );
+}
+
+void operator delete[]( void* p, size_t ) noexcept
+{
+	free( p );
+}
+
+
+struct Scenario {
+	QString sName;
+	int nInstruments;		///< one sample per instrument
+	int nNoteStep;			///< ticks between the notes of an instrument
+	bool bResample;			///< samples are not at the output rate
+	bool bLadspa;			///< instruments are sent to the first usable LADSPA plugin
+	bool bTail;				///< samples fade into the denormal range through the resonant filter
+};
+
+struct Result {
+	unsigned nCycles;
+	double fSeconds;
+	double fP50;
+	double fP99;
+	double fMax;
+	double fTailRatio;
+	unsigned long nAllocations;
+};
+
+
+/**
+ * Create a song playing each instrument every nNoteStep ticks.
+ * The samples last one bar so that notes once a bar keep one voice per instrument.
+ */
+Song* createSong( const Scenario& scenario, unsigned nSampleRate, unsigned nFrames )
+{
+	Song* pSong = new Song( scenario.sName, "h2bench", 120, 0.5 );
+	pSong->set_mode( Song::SONG_MODE );
+	pSong->get_components()->push_back( new DrumkitComponent( 0, "Main" ) );
+
+	// the sampler resamples whenever the rates differ
+	int nSampleRateOfSample = scenario.bResample ? nSampleRate * 2 / 3 : nSampleRate;
+	int nSampleFrames = nSampleRateOfSample * 2;
+
+	InstrumentList* pInstruments = new InstrumentList();
+	for ( int i = 0; i < scenario.nInstruments; i++ ) {
+		float* pData_L = new float[ nSampleFrames ];
+		float* pData_R = new float[ nSampleFrames ];
+		float fStep = 2 * M_PI * ( 110.0 + 10 * i ) / nSampleRateOfSample;
+		for ( int n = 0; n < nSampleFrames; n++ ) {
+			pData_L[ n ] = pData_R[ n ] = 0.1 * sin( fStep * n );
+		}
+		if ( scenario.bTail ) {
+			// a long release: below 1e-38 after a quarter of the bar, the last denormal at its end
+			for ( int n = 0; n < nSampleFrames; n++ ) {
+				double fTime = (double)n / nSampleRateOfSample;
+				double fLevel = fTime < 0.5 ? exp( -170 * fTime ) : exp( -85 - 10.5 * ( fTime - 0.5 ) );
+				pData_L[ n ] = pData_R[ n ] = pData_L[ n ] * fLevel;
+			}
+		}
+		// never read from disk, samples just need an absolute path
+		Sample* pSample = new Sample( Filesystem::tmp_dir() + QString( "sine_%1.wav" ).arg( i ), nSampleFrames, nSampleRateOfSample, pData_L, pData_R );
+
+		Instrument* pInstr = new Instrument( i, QString( "Sine %1" ).arg( i ) );
+		InstrumentComponent* pCompo = new InstrumentComponent( 0 );
+		pCompo->set_layer( new InstrumentLayer( pSample ), 0 );
+		pInstr->get_components()->push_back( pCompo );
+		if ( scenario.bLadspa ) {
+			pInstr->set_fx_level( 1.0, 0 );
+		}
+		if ( scenario.bTail ) {
+			pInstr->set_filter_active( true );
+			pInstr->set_filter_cutoff( 0.3 );
+			pInstr->set_filter_resonance( 0.95 );
+		}
+		pInstruments->add( pInstr );
+	}
+	pSong->set_instrument_list( pInstruments );
+
+	Pattern* pPattern = new Pattern( "bench", "", "not_categorized", MAX_NOTES );
+	for ( int i = 0; i < scenario.nInstruments; i++ ) {
+		for ( int nPos = 0; nPos < MAX_NOTES; nPos += scenario.nNoteStep ) {
+			pPattern->insert_note( new Note( pInstruments->get( i ), nPos, 0.8f, 0.5f, 0.5f, -1, 0.0f ) );
+		}
+	}
+	PatternList* pPatterns = new PatternList();
+	pPatterns->add( pPattern );
+	pSong->set_pattern_list( pPatterns );
+
+	// enough bars for the run, 120 BPM plays a bar in 2 seconds
+	unsigned nBars = nFrames / ( nSampleRate * 2 ) + 2;
+	std::vector<PatternList*>* pColumns = new std::vector<PatternList*>;
+	for ( unsigned i = 0; i < nBars; i++ ) {
+		PatternList* pColumn = new PatternList();
+		pColumn->add( pPattern );
+		pColumns->push_back( pColumn );
+	}
+	pSong->set_pattern_group_vector( pColumns );
+
+	return pSong;
+}
+
+
+/** load the first stereo LADSPA plugin in the first FX slot */
+bool setupLadspa( unsigned nSampleRate )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	std::vector<LadspaFXInfo*> plugins = Effects::get_instance()->getPluginList();
+	for ( unsigned i = 0; i < plugins.size(); i++ ) {
+		LadspaFXInfo* pInfo = plugins[ i ];
+		if ( pInfo->m_nIAPorts != 2 || pInfo->m_nOAPorts != 2 ) {
+			continue;
+		}
+		LadspaFX* pFX = LadspaFX::load( pInfo->m_sFilename, pInfo->m_sLabel, nSampleRate );
+		if ( pFX == NULL ) {
+			continue;
+		}
+		pFX->setEnabled( true );
+		Effects::get_instance()->setLadspaFX( pFX, 0 );
+		Hydrogen::get_instance()->restartLadspaFX();
+		return true;
+	}
+#endif
+	return false;
+}
+
+
+void clearLadspa()
+{
+#ifdef H2CORE_HAVE_LADSPA
+	Effects::get_instance()->setLadspaFX( NULL, 0 );
+	Hydrogen::get_instance()->restartLadspaFX();
+#endif
+}
+
+
+double percentile( const std::vector<uint64_t>& sorted, double fRatio )
+{
+	size_t nIdx = std::min( sorted.size() - 1, (size_t)( fRatio * ( sorted.size() - 1 ) + 0.5 ) );
+	return sorted[ nIdx ] / 1000.0;
+}
+
+
+Result run( const Scenario& scenario, unsigned nCycles )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	FakeDriver* pDriver = dynamic_cast<FakeDriver*>( pHydrogen->getAudioOutput() );
+	unsigned nSampleRate = pDriver->getSampleRate();
+
+	pHydrogen->setSong( createSong( scenario, nSampleRate, nCycles * pDriver->getBufferSize() ) );
+	pDriver->locate( 0 );
+	pDriver->setMaxCycles( nCycles );
+
+	unsigned long nAllocations = __allocations;
+	pHydrogen->sequencer_play();
+	nAllocations = __allocations - nAllocations;
+	pHydrogen->sequencer_stop();
+
+	std::vector<uint64_t> times = pDriver->getCycleTimes();
+
+	// 120 BPM plays a bar in 2 seconds
+	unsigned nBarFrames = nSampleRate * 2;
+	double fEarly = 0, fLate = 0;
+	unsigned nEarly = 0, nLate = 0;
+	for ( unsigned i = 0; i < times.size(); i++ ) {
+		if ( ( (unsigned long)i * pDriver->getBufferSize() ) % nBarFrames < nBarFrames / 2 ) {
+			fEarly += times[ i ];
+			nEarly++;
+		} else {
+			fLate += times[ i ];
+			nLate++;
+		}
+	}
+
+	std::sort( times.begin(), times.end() );
+
+	Result result;
+	result.nCycles = times.size();
+	result.fSeconds = 0;
+	for ( unsigned i = 0; i < times.size(); i++ ) {
+		result.fSeconds += times[ i ] / 1e9;
+	}
+	result.fP50 = times.empty() ? 0 : percentile( times, 0.5 );
+	result.fP99 = times.empty() ? 0 : percentile( times, 0.99 );
+	result.fMax = times.empty() ? 0 : times.back() / 1000.0;
+	result.fTailRatio = ( nEarly && nLate && fEarly > 0 ) ? ( fLate / nLate ) / ( fEarly / nEarly ) : 0.0;
+	result.nAllocations = nAllocations;
+	return result;
+}
+
+
+double elapsedMs( std::chrono::steady_clock::time_point start )
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
+
+
+/** save a big song, parse it into a DOM tree and load it */
+bool runSongIo()
+{
+	QString sFilename = Filesystem::tmp_file_path( "h2bench.h2song" );
+	Song* pSong = H2Test::createBigSong( 128, 32 );
+	int nNotes = H2Test::countNotes( pSong );
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool bSaved = pSong->save( sFilename );
+	double fSaveMs = elapsedMs( start );
+	delete pSong;
+	if ( !bSaved ) {
+		std::cerr << "Can't save " << sFilename.toLocal8Bit().constData() << std::endl;
+		return false;
+	}
+
+	start = std::chrono::steady_clock::now();
+	QDomDocument doc = LocalFileMng::openXmlDocument( sFilename );
+	double fDomMs = elapsedMs( start );
+	bool bParsed = !doc.isNull();
+	doc.clear();
+
+	start = std::chrono::steady_clock::now();
+	Song* pLoaded = Song::load( sFilename );
+	double fLoadMs = elapsedMs( start );
+	bool bLoaded = pLoaded != NULL;
+	delete pLoaded;
+	Filesystem::rm( sFilename );
+	if ( !bParsed || !bLoaded ) {
+		std::cerr << "Can't read " << sFilename.toLocal8Bit().constData() << std::endl;
+		return false;
+	}
+
+	printf( "{\"scenario\":\"song_io\",\"notes\":%d,\"save_ms\":%.3f,\"dom_ms\":%.3f,\"load_ms\":%.3f}\n",
+			nNotes, fSaveMs, fDomMs, fLoadMs );
+	fflush( stdout );
+	return true;
+}
+
+
+int main( int argc, char** argv )
+{
+	QCoreApplication app( argc, argv );
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription( "Hydrogen engine benchmark, prints one JSON object per scenario" );
+	QCommandLineOption rateOption( QStringList() << "r" << "rate", "Output sample rate", "Hz", "48000" );
+	QCommandLineOption bufferOption( QStringList() << "b" << "buffer", "Frames per callback", "frames", "256" );
+	QCommandLineOption cyclesOption( QStringList() << "c" << "cycles", "Callbacks per scenario", "count", "2000" );
+	QCommandLineOption voicesOption( QStringList() << "n" << "voices", "Comma separated numbers of simultaneous voices", "list", "8,32,128" );
+	QCommandLineOption scenarioOption( QStringList() << "s" << "scenario", "Run only the scenarios whose name starts with this", "name" );
+	parser.addHelpOption();
+	parser.addOption( rateOption );
+	parser.addOption( bufferOption );
+	parser.addOption( cyclesOption );
+	parser.addOption( voicesOption );
+	parser.addOption( scenarioOption );
+	parser.process( app );
+
+	Logger::create_instance();
+	Logger::set_bit_mask( Logger::Error );
+	Logger* pLogger = Logger::get_instance();
+	Object::bootstrap( pLogger, false );
+	Filesystem::bootstrap( pLogger );
+
+	Preferences::create_instance();
+	Preferences* pPref = Preferences::get_instance();
+	pPref->m_sAudioDriver = "Fake";
+	pPref->m_nSampleRate = parser.value( rateOption ).toUInt();
+	pPref->m_nBufferSize = parser.value( bufferOption ).toUInt();
+	unsigned nCycles = parser.value( cyclesOption ).toUInt();
+	if ( pPref->m_nSampleRate == 0 || pPref->m_nBufferSize == 0 || nCycles == 0 ) {
+		std::cerr << "rate, buffer and cycles must be positive" << std::endl;
+		return 1;
+	}
+
+	std::vector<Scenario> scenarios;
+	QStringList voices = parser.value( voicesOption ).split( ",", QString::SkipEmptyParts );
+	foreach ( const QString& sVoices, voices ) {
+		int nVoices = sVoices.toInt();
+		if ( nVoices <= 0 ) {
+			continue;
+		}
+		pPref->m_nMaxNotes = std::max( pPref->m_nMaxNotes, (unsigned)nVoices * 2 );
+		Scenario voicesScenario = { QString( "voices_%1" ).arg( nVoices ), nVoices, MAX_NOTES, false, false, false };
+		Scenario resampleScenario = { QString( "resample_%1" ).arg( nVoices ), nVoices, MAX_NOTES, true, false, false };
+		Scenario ladspaScenario = { QString( "ladspa_%1" ).arg( nVoices ), nVoices, MAX_NOTES, false, true, false };
+		Scenario tailScenario = { QString( "tail_%1" ).arg( nVoices ), nVoices, MAX_NOTES, false, false, true };
+		scenarios.push_back( voicesScenario );
+		scenarios.push_back( resampleScenario );
+		scenarios.push_back( ladspaScenario );
+		scenarios.push_back( tailScenario );
+	}
+	// a note on every 1/32 of 16 instruments
+	Scenario denseScenario = { "dense_16", 16, MAX_NOTES / 32, false, false, false };
+	scenarios.push_back( denseScenario );
+
+	Hydrogen::create_instance();
+	FakeDriver* pDriver = dynamic_cast<FakeDriver*>( Hydrogen::get_instance()->getAudioOutput() );
+	if ( pDriver == NULL ) {
+		std::cerr << "The fake audio driver could not be started" << std::endl;
+		return 1;
+	}
+
+	QString sFilter = parser.value( scenarioOption );
+	for ( unsigned i = 0; i < scenarios.size(); i++ ) {
+		const Scenario& scenario = scenarios[ i ];
+		if ( !scenario.sName.startsWith( sFilter ) ) {
+			continue;
+		}
+		if ( scenario.bLadspa && !setupLadspa( pDriver->getSampleRate() ) ) {
+			printf( "{\"scenario\":\"%s\",\"skipped\":\"no stereo LADSPA plugin\"}\n", scenario.sName.toLocal8Bit().constData() );
+			continue;
+		}
+
+		Result result = run( scenario, nCycles );
+		if ( scenario.bLadspa ) {
+			clearLadspa();
+		}
+
+		double fFrames = (double)result.nCycles * pDriver->getBufferSize();
+		printf( "{\"scenario\":\"%s\",\"sample_rate\":%u,\"buffer_size\":%u,\"cycles\":%u,"
+				"\"frames_per_sec\":%.6g,\"p50_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,"
+				"\"tail_ratio\":%.3f,\"allocations\":%lu}\n",
+				scenario.sName.toLocal8Bit().constData(), pDriver->getSampleRate(), pDriver->getBufferSize(),
+				result.nCycles, result.fSeconds > 0 ? fFrames / result.fSeconds : 0.0,
+				result.fP50, result.fP99, result.fMax, result.fTailRatio, result.nAllocations );
+		fflush( stdout );
+	}
+
+	int nRet = 0;
+	if ( QString( "song_io" ).startsWith( sFilter ) && !runSongIo() ) {
+		nRet = 1;
+	}
+
+	delete Hydrogen::get_instance();
+	delete Preferences::get_instance();
+	delete Logger::get_instance();
+	return nRet;
+}
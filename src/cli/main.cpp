@@ -22,6 +22,7 @@
 
 #include <QLibraryInfo>
 #include <QThread>
+#include <QElapsedTimer>
 #include <hydrogen/config.h>
 #include <hydrogen/version.h>
 #include <getopt.h>
@@ -38,12 +39,15 @@
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/globals.h>
 #include <hydrogen/event_queue.h>
+#include <hydrogen/meter_bus.h>
+#include <hydrogen/engine_profiler.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/h2_exception.h>
 #include <hydrogen/basics/playlist.h>
 #include <hydrogen/helpers/filesystem.h>
 
 #include <iostream>
+#include <iomanip>
 #include <signal.h>
 
 using namespace std;
@@ -69,6 +73,7 @@ static struct option long_opts[] = {
 	{"help", 0, NULL, 'h'},
 	{"install", required_argument, NULL, 'i'},
 	{"drumkit", required_argument, NULL, 'k'},
+	{"profile", optional_argument, NULL, 'P'},
 	{0, 0, 0, 0},
 };
 
@@ -103,6 +108,25 @@ void show_playlist (Hydrogen *pHydrogen, uint active )
 	cout << endl;
 }
 
+void show_profile()
+{
+	/* Display the engine timings, in microseconds */
+	ProfileSnapshot snapshot;
+	EngineProfiler::get_instance()->get_snapshot( snapshot );
+	cout << "Engine profile over " << snapshot.cycles << " cycles of " << snapshot.budget_us << " us" << endl;
+	cout << "  stage         p50       p99       max      mean" << endl;
+	for ( int i = 0; i < EngineProfiler::STAGES; ++i ) {
+		const StageStats& stats = snapshot.stage[ i ];
+		cout << "  " << left << setw( 12 ) << EngineProfiler::stage_name( ( EngineProfiler::Stage )i ) << right
+			 << fixed << setprecision( 1 )
+			 << setw( 8 ) << stats.p50 << "  " << setw( 8 ) << stats.p99 << "  "
+			 << setw( 8 ) << stats.max << "  " << setw( 8 ) << stats.mean << endl;
+	}
+	cout << "  xruns: " << snapshot.xruns << " engine, " << snapshot.driver_xruns << " driver"
+		 << ", worst callback: " << snapshot.worst_us << " us" << endl;
+	cout << endl;
+}
+
 #define NELEM(a) ( sizeof(a)/sizeof((a)[0]) )
 
 int main(int argc, char *argv[])
@@ -136,6 +160,7 @@ int main(int argc, char *argv[])
 		short bits = 16;
 		int rate = 44100;
 		short interpolation = 0;
+		int profilePeriod = -1;
 #ifdef H2CORE_HAVE_JACKSESSION
 		QString sessionId;
 #endif
@@ -171,6 +196,9 @@ int main(int argc, char *argv[])
 			case 'b':
 				bits = strtol(optarg, NULL, 10);
 				break;
+			case 'P':
+				profilePeriod = (optarg) ? strtol(optarg, NULL, 10) : 0;
+				break;
 			case 'v':
 				showVersionOpt = true;
 				break;
@@ -369,6 +397,9 @@ int main(int argc, char *argv[])
 			ExportMode = true;
 		}
 
+		QElapsedTimer profileTimer;
+		profileTimer.start();
+
 		// Interactive mode
 		while ( ! quit ) {
 			/* FIXME: Someday here will be The Real CLI ;-) */
@@ -390,21 +421,36 @@ int main(int argc, char *argv[])
 				break;
 			case EVENT_PLAYLIST_LOADSONG: /* Load new song on MIDI event */
 				if( pPlaylist ){
-					if ( pPlaylist->loadSong ( event.value ) ) {
-						pSong = pHydrogen->getSong();
-						show_playlist ( pHydrogen, pPlaylist->getActiveSongNumber() );
-					}
+					pPlaylist->loadSong ( event.value );
 				}
 				break;
-			case EVENT_NONE: /* Sleep if there is no more events */
-				Sleeper::msleep ( 100 );
+			case EVENT_SONG_SWITCHED: /* The song loaded is current */
+				pHydrogen->finishSongSwitch();
+				pSong = pHydrogen->getSong();
+				if( pPlaylist ){
+					show_playlist ( pHydrogen, pPlaylist->getActiveSongNumber() );
+				}
+				break;
+			case EVENT_NONE: /* Wait for the next event */
+				pQueue->wait_event( 100 );
 				break;
 			}
+
+			if ( profilePeriod > 0 && profileTimer.elapsed() >= profilePeriod * 1000 ) {
+				show_profile();
+				profileTimer.restart();
+			}
+		}
+
+		if ( profilePeriod >= 0 ) {
+			show_profile();
 		}
 
 		if ( pHydrogen->getState() == STATE_PLAYING )
 			pHydrogen->sequencer_stop();
 
+		pHydrogen->finishSongSwitch();
+		pSong = pHydrogen->getSong();
 		delete pSong;
 		delete pPlaylist;
 
@@ -412,6 +458,8 @@ int main(int argc, char *argv[])
 		delete pHydrogen;
 		delete preferences;
 		delete AudioEngine;
+		delete MeterBus::get_instance();
+		delete EngineProfiler::get_instance();
 
 		delete MidiMap::get_instance();
 		delete MidiActionManager::get_instance();
@@ -466,6 +514,8 @@ void showUsage()
 	cout << "   -i, --install FILE - install a drumkit (*.h2drumkit)" << endl;
 	cout << "   -I, --interpolate INT - Interpolation" << endl;
 	cout << "       (0:linear [default],1:cosine,2:third,3:cubic,4:hermite)" << endl;
+	cout << "   -P[Seconds], --profile[=Seconds] - Print the engine stage timings and xruns on exit" << endl;
+	cout << "                 and every Seconds, if present" << endl;
 
 #ifdef H2CORE_HAVE_JACKSESSION
 	cout << "   -S, --jacksessionid ID - Start a JackSessionHandler session" << endl;
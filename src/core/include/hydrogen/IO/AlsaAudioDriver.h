@@ -41,7 +41,12 @@ class AlsaAudioDriver : public AudioOutput
 public:
 	snd_pcm_t *m_pPlayback_handle;
 	bool m_bIsRunning;
-	unsigned long m_nBufferSize;
+	unsigned long m_nBufferSize;        ///< period size, the frames processed by each engine cycle
+	unsigned m_nPeriods;                ///< number of periods of the ALSA buffer
+	snd_pcm_format_t m_format;          ///< sample format negotiated with the device
+	bool m_bMmap;                       ///< transfer through mmap, else snd_pcm_writei
+	char* m_pBuffer;                    ///< interleaved period for snd_pcm_writei
+	uint32_t m_nDitherSeed;             ///< TPDF dither generator of the S16 format
 	float* m_pOut_L;
 	float* m_pOut_R;
 	int m_nXRuns;
@@ -55,6 +60,8 @@ public:
 	virtual int connect();
 	virtual void disconnect();
 	virtual unsigned getBufferSize();
+	/** returns the number of periods of the ALSA buffer */
+	unsigned getPeriods() { return m_nPeriods; }
 	virtual unsigned getSampleRate();
 	virtual float* getOut_L();
 	virtual float* getOut_R();
@@ -65,9 +72,22 @@ public:
 	virtual void locate( unsigned long nFrame );
 	virtual void setBpm( float fBPM );
 
+	/**
+	 * convert the engine output and give a period to the device, retrying after an xrun
+	 * \return false if the device can't be recovered
+	 */
+	bool writePeriod();
+
 private:
 
 	unsigned int m_nSampleRate;
+
+	/** transfer a period through the mmap areas of the device */
+	bool writeMmap( unsigned nFrames );
+	/** transfer a period through the interleaved buffer */
+	bool writeRW( unsigned nFrames );
+	/** recover from an xrun or a suspend and count it */
+	bool recover( int err );
 };
 
 #else
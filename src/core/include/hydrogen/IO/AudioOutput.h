@@ -51,6 +51,8 @@ public:
 	virtual unsigned getSampleRate() = 0;
 	virtual float* getOut_L() = 0;
 	virtual float* getOut_R() = 0;
+	/** returns the latency between the engine and the speakers in frames, 0 if unknown */
+	virtual unsigned getLatency() { return 0; }
 
 	virtual void updateTransportInfo() = 0;
 	virtual void play() = 0;
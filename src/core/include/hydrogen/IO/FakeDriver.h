@@ -25,6 +25,7 @@
 
 #include <hydrogen/IO/AudioOutput.h>
 #include <inttypes.h>
+#include <vector>
 
 namespace H2Core
 {
@@ -33,6 +34,9 @@ typedef int  ( *audioProcessCallback )( uint32_t, void * );
 
 /**
  * Fake audio driver. Used only for profiling.
+ * play() runs the process callback in the calling thread, back to back,
+ * until the end of the song or until the maximum number of cycles.
+ * The sample rate is the one of the preferences.
  */
 class FakeDriver : public AudioOutput
 {
@@ -58,11 +62,23 @@ public:
 	virtual void updateTransportInfo();
 	virtual void setBpm( float fBPM );
 
+	/** stop playing after nCycles calls of the callback, 0 plays until the end of the song */
+	void setMaxCycles( unsigned nCycles ) {
+		m_nMaxCycles = nCycles;
+	}
+	/** durations of the callbacks of the last play(), in nanoseconds */
+	const std::vector<uint64_t>& getCycleTimes() const {
+		return m_cycleTimes;
+	}
+
 private:
 	audioProcessCallback m_processCallback;
 	unsigned m_nBufferSize;
+	unsigned m_nSampleRate;
+	unsigned m_nMaxCycles;
 	float* m_pOut_L;
 	float* m_pOut_R;
+	std::vector<uint64_t> m_cycleTimes;
 
 };
 
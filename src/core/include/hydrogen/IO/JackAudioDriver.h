@@ -29,6 +29,7 @@
 // check if jack support is enabled
 #ifdef H2CORE_HAVE_JACK
 
+#include <atomic>
 #include <map>
 #include <pthread.h>
 #include <jack/jack.h>
@@ -41,6 +42,8 @@
 
 #include <hydrogen/globals.h>
 #include <hydrogen/hydrogen.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_component.h>
 
 
 
@@ -79,6 +82,16 @@ public:
 
 
 	void makeTrackOutputs( Song * );
+	/**
+	 * Set up the track outputs of a song which replaces the current one
+	 * while playing, without locking the engine. Missing ports are
+	 * registered, the ports are named after the song and its track map is
+	 * filled aside until swapTrackOutputs(). Unused ports are kept until
+	 * the next makeTrackOutputs().
+	 */
+	void prepareTrackOutputs( Song * );
+	/** make the track map set up by prepareTrackOutputs() the current one, audio thread only */
+	void swapTrackOutputs();
 	void setTrackOutput( int, Instrument *, InstrumentComponent *, Song * );
 
 	void setConnectDefaults( bool flag ) {
@@ -92,6 +105,19 @@ public:
 	float* getOut_R();
 	float* getTrackOut_L( unsigned nTrack );
 	float* getTrackOut_R( unsigned nTrack );
+
+	/**
+	 * Resolve the buffers of all the track output ports for the current
+	 * cycle and zero them. Must be called once per cycle, before any
+	 * voice is rendered.
+	 * \param nFrames number of frames of the cycle
+	 */
+	void clearPerTrackAudioBuffers( uint32_t nFrames );
+	/**
+	 * Get the track output buffer of an instrument component, as resolved
+	 * by clearPerTrackAudioBuffers() for the current cycle.
+	 * \return NULL if the component has no track output
+	 */
 	float* getTrackOut_L( Instrument *, InstrumentComponent * );
 	float* getTrackOut_R( Instrument *, InstrumentComponent * );
 
@@ -141,10 +167,14 @@ private:
 	jack_port_t *			output_port_2;
 	QString					output_port_name_1;
 	QString					output_port_name_2;
-	int						track_map[MAX_INSTRUMENTS][MAX_COMPONENTS];
-	int						track_port_count;
+	int						track_maps[2][MAX_INSTRUMENTS][MAX_COMPONENTS];
+	int						(*track_map)[MAX_COMPONENTS];	///< track of each instrument component, -1 if none, one of track_maps
+	bool					next_track_map_ready;			///< the other one of track_maps was set up by prepareTrackOutputs()
+	std::atomic<int>		track_port_count;
 	jack_port_t *			track_output_ports_L[MAX_INSTRUMENTS];
 	jack_port_t *			track_output_ports_R[MAX_INSTRUMENTS];
+	float *					track_buffers_L[MAX_INSTRUMENTS];		///< port buffers of the current cycle
+	float *					track_buffers_R[MAX_INSTRUMENTS];
 
 	jack_transport_state_t	m_JackTransportState;
 	jack_position_t			m_JackTransportPos;
@@ -155,8 +185,23 @@ private:
 	bool					m_bCond;
 //~ jack timebase callback
 
+	/** name the track outputs after a song and fill a track map, return the number of tracks */
+	int mapTrackOutputs( Song * pSong, int (*map)[MAX_COMPONENTS] );
+
 };
 
+inline float* JackAudioDriver::getTrackOut_L( Instrument * instr, InstrumentComponent * pCompo )
+{
+	int nTrack = track_map[instr->get_id()][pCompo->get_drumkit_componentID()];
+	return nTrack < 0 ? nullptr : track_buffers_L[nTrack];
+}
+
+inline float* JackAudioDriver::getTrackOut_R( Instrument * instr, InstrumentComponent * pCompo )
+{
+	int nTrack = track_map[instr->get_id()][pCompo->get_drumkit_componentID()];
+	return nTrack < 0 ? nullptr : track_buffers_R[nTrack];
+}
+
 #else
 
 namespace H2Core {
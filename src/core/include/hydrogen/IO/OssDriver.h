@@ -85,16 +85,34 @@ public:
 	virtual void updateTransportInfo();
 	virtual void setBpm( float fBPM );
 
+	/** returns the number of underruns reported by the device */
+	unsigned getUnderruns() { return m_nUnderruns; }
+
 private:
 	/** file descriptor, for writing to /dev/dsp */
 	int fd;
 
-	short* audioBuffer;
+	char* audioBuffer;              ///< interleaved samples in the device format
 	float* out_L;
 	float* out_R;
 
+	int m_nFormat;                  ///< AFMT_* format negotiated with the device
+	int m_nSampleBytes;             ///< bytes of a sample in m_nFormat
+	unsigned m_nSampleRate;         ///< rate accepted by the device
+	unsigned m_nUnderruns;
+	uint32_t m_nDitherSeed;         ///< TPDF dither generator of the S16 format
+
 	audioProcessCallback processCallback;
 	int log2( int n );
+	/** choose the most accurate format supported by the device, returns its AFMT_* value */
+	int chooseFormat();
+	/**
+	 * convert a channel to the device format
+	 * \param pIn the engine output
+	 * \param pOut the first sample of the channel in audioBuffer
+	 * \param nFrames number of frames
+	 */
+	void convert( const float* pIn, char* pOut, unsigned nFrames );
 
 };
 
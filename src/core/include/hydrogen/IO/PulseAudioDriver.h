@@ -29,6 +29,7 @@
 
 #include <pthread.h>
 #include <inttypes.h>
+#include <atomic>
 #include <pulse/pulseaudio.h>
 
 namespace H2Core
@@ -54,6 +55,7 @@ public:
 	virtual unsigned getSampleRate();
 	virtual float* getOut_L();
 	virtual float* getOut_R();
+	virtual unsigned getLatency();
 
 	virtual void updateTransportInfo();
 	virtual void play();
@@ -74,6 +76,9 @@ private:
 	int						m_ready;
 	unsigned				m_sample_rate;
 	unsigned				m_buffer_size;
+	int						m_latency_mode;		///< Preferences::PulseAudioLatencyMode
+	unsigned				m_target_latency;	///< in ms, 0 for one engine buffer
+	std::atomic<unsigned>	m_latency;			///< last measured playback latency, in frames
 	float*					m_outL;
 	float*					m_outR;
 
@@ -31,6 +31,7 @@
 #include <hydrogen/object.h>
 
 #include <QDomDocument>
+#include <QXmlStreamWriter>
 
 
 namespace H2Core
@@ -58,6 +59,8 @@ public:
 
 	static void writeXmlString( QDomNode parent, const QString& name, const QString& text );
 	static void writeXmlBool( QDomNode parent, const QString& name, bool value );
+	static void writeXmlString( QXmlStreamWriter& writer, const QString& name, const QString& text );
+	static void writeXmlBool( QXmlStreamWriter& writer, const QString& name, bool value );
 
 	static QString	readXmlString( QDomNode , const QString& nodeName, const QString& defaultValue, bool bCanBeEmpty = false, bool bShouldExists = true , bool tinyXmlCompatMode = false);
 	static float	readXmlFloat( QDomNode , const QString& nodeName, float defaultValue, bool bCanBeEmpty = false, bool bShouldExists = true , bool tinyXmlCompatMode = false);
@@ -65,6 +68,8 @@ public:
 	static bool		readXmlBool( QDomNode , const QString& nodeName, bool defaultValue, bool bShouldExists = true , bool tinyXmlCompatMode = false );
 	static void		convertFromTinyXMLString( QByteArray* str );
 	static bool		checkTinyXMLCompatMode( const QString& filename );
+	/// read a file written by TinyXML, converted to be parsed by QtXml
+	static QByteArray	readTinyXMLCompat( QFile& file );
 	static QDomDocument openXmlDocument( const QString& filename );
 
 private:
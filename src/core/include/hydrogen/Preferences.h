@@ -26,6 +26,7 @@
 #include <list>
 #include <vector>
 #include <cassert>
+#include <pthread.h>
 
 #include <hydrogen/midi_action.h>
 #include <hydrogen/globals.h>
@@ -67,6 +68,30 @@ public:
 };
 
 
+/**
+\ingroup H2CORE
+\brief	Scheduling and CPU affinity of a thread
+*/
+class ThreadPolicy : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	QString scheduling;	///< "default" keeps the settings of the thread, else "other", "fifo", "rr", "batch" or "idle"
+	int priority;		///< realtime priority, used by "fifo" and "rr"
+	QString cpus;		///< CPUs the thread may run on, like "2,3" or "0-3", empty for all of them
+
+	ThreadPolicy();
+	~ThreadPolicy();
+
+	void set( const QString& _scheduling, int _priority, const QString& _cpus ) {
+		scheduling = _scheduling;
+		priority = _priority;
+		cpus = _cpus;
+	}
+
+};
+
+
 /**
 \ingroup H2CORE
 */
@@ -157,6 +182,23 @@ public:
 			UI_LAYOUT_TABBED
 	};
 
+	/** how the PulseAudio stream buffer follows the target latency */
+	enum PulseAudioLatencyMode {
+			PULSE_DEFAULT_LATENCY,	///< the target is the stream buffer, the sink keeps its own buffer
+			PULSE_ADJUST_LATENCY,	///< the target is the whole latency, the sink buffer shrinks
+			PULSE_EARLY_REQUESTS	///< the data is requested one engine buffer at a time
+	};
+
+	/** threads which scheduling and CPU affinity are configurable */
+	enum ThreadRole {
+			THREAD_AUDIO,		///< audio driver thread, only the CPU affinity of the JACK thread is set
+			THREAD_MIDI_IN,		///< ALSA and PortMidi input threads
+			THREAD_DISK_WRITER,	///< export thread
+			THREAD_HELPER,		///< logger thread
+			THREAD_FX,			///< FX graph workers, running the insert chains and send FX with the audio thread
+			THREAD_ROLES
+	};
+
 	QString				__lastspatternDirectory;
 	QString				__lastsampleDirectory; // audio file browser
 	bool				__playsamplesonclicking; // audio file browser
@@ -197,6 +239,7 @@ public:
 
 	//	OSS driver properties ___
 	QString				m_sOSSDevice;		///< Device used for output
+	unsigned			m_nOSSFragments;	///< number of fragments, a fragment holds m_nBufferSize frames
 
 	//	MIDI Driver properties
 	QString				m_sMidiDriver;
@@ -214,6 +257,11 @@ public:
 
 	//	alsa audio driver properties ___
 	QString				m_sAlsaAudioDevice;
+	unsigned			m_nAlsaPeriods;		///< number of periods of the ALSA buffer, the period size is m_nBufferSize
+
+	//	PulseAudio driver properties ___
+	int					m_nPulseAudioLatencyMode;	///< a PulseAudioLatencyMode
+	unsigned			m_nPulseAudioLatency;		///< target latency in ms, 0 for one engine buffer
 
 	//	jack driver properties ___
 	QString				m_sJackPortName1;
@@ -226,6 +274,9 @@ public:
 	int					m_bJackMasterMode ;
 	//~ jack driver properties
 
+	///Scheduling and CPU affinity of the threads, indexed by ThreadRole
+	ThreadPolicy		m_threadPolicies[ THREAD_ROLES ];
+
 	///Default text editor (used by Playlisteditor)
 	QString				m_sDefaultEditor;
 
@@ -244,6 +295,16 @@ public:
 	/// Save the preferences file
 	void				savePreferences();
 
+	/**
+	 * apply the policy of a role to a thread and log the settings it ends up with
+	 * \param role the role of the thread
+	 * \param thread the thread, usually the calling one
+	 * \param bScheduling false to set the CPU affinity only, for threads which priority is managed elsewhere
+	 */
+	void				applyThreadPolicy( ThreadRole role, pthread_t thread, bool bScheduling = true );
+	/// Returns the name of a thread role, as used in the preferences file
+	static const char*	threadRoleName( ThreadRole role );
+
 	const QString&		getDataDirectory();
 
 	const QString&		getDefaultEditor();
@@ -29,7 +29,10 @@
 #include <hydrogen/synth/Synth.h>
 
 #include <pthread.h>
+#include <atomic>
 #include <string>
+#include <utility>
+#include <vector>
 #include <cassert>
 
 #ifndef RIGHT_HERE
@@ -39,6 +42,10 @@
 namespace H2Core
 {
 
+class Song;
+class Pattern;
+class SongSnapshot;
+
 ///
 /// Audio Engine main class (Singleton).
 ///
@@ -74,6 +81,61 @@ public:
 	bool try_lock( const char* file, unsigned int line, const char* function ); /// Return true on success (locked).
 	void unlock();
 
+	/* Editing notes and sequence without holding the engine
+	 *
+	 * The sequencer reads a SongSnapshot of the song instead of the
+	 * song itself. Changes to the notes of the patterns and to the
+	 * sequence can be made holding the edit lock only, the audio
+	 * thread keeps playing the previous snapshot until unlock_edit()
+	 * publishes a new one. lock() takes the edit lock too and
+	 * unlock() publishes as well, structural changes (instruments,
+	 * patterns added or removed, a song set while stopped) still use
+	 * them. A song switched to while playing is swapped in by the audio
+	 * thread with swap_song().
+	 */
+	void lock_edit( const char* file, unsigned int line, const char* function );
+	void unlock_edit();
+	/**
+	 * Tell the next publish that the notes of pattern changed, called
+	 * with the edit lock held. When patterns are marked, the notes of
+	 * the others are not compared and their previous copies are shared.
+	 * NULL marks that no notes changed, only the sequence or nothing.
+	 * Without marks or after lock(), the whole song is compared.
+	 */
+	void mark_edited( Pattern* pattern );
+
+	/// Set the song the snapshots are taken from, called with the engine locked.
+	void set_song( Song* song );
+	/**
+	 * Replace the song and its snapshot at once, without locking. Audio
+	 * thread only, from within the process cycle. The snapshot replaced
+	 * is handed back, it is freed by retire_snapshot().
+	 * \param song the song switched to, set to the song replaced
+	 * \param snapshot a snapshot of the song switched to, set to the snapshot replaced
+	 */
+	void swap_song( Song** song, SongSnapshot** snapshot );
+	/// Free a snapshot replaced by swap_song() once no cycle reads it, called with the edit lock held.
+	void retire_snapshot( SongSnapshot* snapshot );
+	/// Return the snapshot of the current process cycle, NULL outside of it. Audio thread only.
+	const SongSnapshot* get_song_snapshot() const { return __cycle_snapshot; }
+	/**
+	 * Return the last published snapshot to another thread than the
+	 * audio thread, NULL if none. It is not freed before
+	 * release_song_snapshot() is called.
+	 */
+	const SongSnapshot* acquire_song_snapshot();
+	void release_song_snapshot();
+	/**
+	 * Wait for the process cycles running on a replaced snapshot to end,
+	 * called after unlock() before deleting what the snapshot refers to
+	 * (instruments, the song). Returns at once when the engine is locked.
+	 */
+	void wait_for_cycles();
+	/// Called by the audio thread after locking, before reading the snapshot.
+	void begin_snapshot_cycle();
+	/// Called by the audio thread before unlocking.
+	void end_snapshot_cycle();
+
 	Sampler* get_sampler();
 	Synth* get_synth();
 
@@ -85,6 +147,24 @@ private:
 
 	/// Mutex for syncronized access to the Song object and the AudioEngine.
 	pthread_mutex_t __engine_mutex;
+	/// Recursive mutex serializing the editors, taken before __engine_mutex.
+	pthread_mutex_t __edit_mutex;
+	/// True while the engine mutex is held through lock().
+	bool __edit_locked;
+
+	std::atomic<Song*> __song;                                  ///< the song the snapshots are taken from
+	std::vector<const Pattern*> __edited;                      ///< see mark_edited()
+	bool __edited_all;                                         ///< true to compare the whole song on the next publish
+	std::atomic<SongSnapshot*> __snapshot;                      ///< the last published snapshot
+	SongSnapshot* __cycle_snapshot;                             ///< the snapshot read by the running cycle
+	std::atomic<unsigned long long> __cycles_started;
+	std::atomic<unsigned long long> __cycles_done;
+	std::atomic<int> __snapshot_readers;                       ///< threads holding an acquired snapshot
+	/// replaced snapshots, with the number of cycles which may still read them
+	std::vector< std::pair<SongSnapshot*, unsigned long long> > __retired;
+
+	/// Build and publish a snapshot of the song if it changed, called with the edit lock held.
+	void publish_snapshot();
 
 	struct _locker_struct {
 		const char* file;
@@ -26,10 +26,13 @@
 #include <hydrogen/basics/automation_path.h>
 
 #include <QDomDocument>
+#include <QXmlStreamWriter>
 
 namespace H2Core
 {
 
+class Song;
+
 class AutomationPathSerializer : private Object
 {
 	H2_OBJECT
@@ -39,6 +42,12 @@ public:
 
 	void read_automation_path(const QDomNode &node, AutomationPath &path);
 	void write_automation_path(QDomNode &node, const AutomationPath &path);
+	void write_automation_path(QXmlStreamWriter &writer, const AutomationPath &path);
+
+	/** read the <path> children of an automationPaths node into the song and its instruments */
+	void read_automation_paths(const QDomNode &node, Song *song);
+	/** write the velocity path of the song and the non empty paths of its instruments */
+	void write_automation_paths(QXmlStreamWriter &writer, Song *song);
 
 };
 
@@ -96,6 +96,8 @@ class ADSR : private Object
 		 * set state to RELEASE, save __release_value and return it.
 		 * */
 		float release();
+		/** returns true once the release is over */
+		bool is_idle() const;
 
 	private:
 		unsigned int __attack;		///< Attack tick count
@@ -159,6 +161,11 @@ inline unsigned int ADSR::get_release()
 	return __release;
 }
 
+inline bool ADSR::is_idle() const
+{
+	return __state == IDLE;
+}
+
 };
 
 #endif // H2C_ADRS_H
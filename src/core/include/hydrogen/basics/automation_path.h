@@ -25,6 +25,7 @@
 #include <hydrogen/object.h>
 
 #include <map>
+#include <vector>
 
 #if __cplusplus <= 199711L
 #  define noexcept
@@ -49,6 +50,12 @@ class AutomationPath : private Object
 
 	std::map<float,float> _points;
 
+	/* the points as flat sorted arrays, read by get_value() */
+	std::vector<float> _x;
+	std::vector<float> _y;
+
+	void compile();
+
 	public:
 	
 	AutomationPath(float min, float max, float def);
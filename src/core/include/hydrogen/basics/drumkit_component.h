@@ -34,6 +34,7 @@ namespace H2Core
 class XMLNode;
 class ADSR;
 class Drumkit;
+class FxChain;
 class InstrumentLayer;
 
 class DrumkitComponent : public H2Core::Object
@@ -64,15 +65,21 @@ class DrumkitComponent : public H2Core::Object
 		void						set_soloed( bool soloed );
 		bool						is_soloed() const;
 
-		void						set_peak_l( float val );
-		float						get_peak_l() const;
-		void						set_peak_r( float val );
-		float						get_peak_r() const;
-
 		void						reset_outs( uint32_t nFrames );
 		void						set_outs( int nBufferPos, float valL, float valR );
 		float						get_out_L( int nBufferPos );
 		float						get_out_R( int nBufferPos );
+		const float*				get_out_L_buffer() const;
+		const float*				get_out_R_buffer() const;
+		float*						get_out_L_buffer();
+		float*						get_out_R_buffer();
+
+		/** set the insert fx chain of the component, the previous one is deleted */
+		void						set_insert_fx( FxChain* chain );
+		/** set the insert fx chain of a component which has none, see Instrument::attach_insert_fx() */
+		void						attach_insert_fx( FxChain* chain );
+		/** get the insert fx chain of the component, NULL if none */
+		FxChain*					get_insert_fx() const;
 
 	private:
 		int			__id;
@@ -81,11 +88,10 @@ class DrumkitComponent : public H2Core::Object
 		bool		__muted;
 		bool		__soloed;
 
-		float		__peak_l;
-		float		__peak_r;
-
 		float *		__out_L;
 		float *		__out_R;
+
+		FxChain*	__insert_fx;		///< insert fx chain, owned by the component
 };
 
 // DEFINITIONS
@@ -140,24 +146,29 @@ inline bool DrumkitComponent::is_soloed() const
 	return __soloed;
 }
 
-inline void DrumkitComponent::set_peak_l( float val )
+inline const float* DrumkitComponent::get_out_L_buffer() const
+{
+	return __out_L;
+}
+
+inline float* DrumkitComponent::get_out_L_buffer()
 {
-	__peak_l = val;
+	return __out_L;
 }
 
-inline float DrumkitComponent::get_peak_l() const
+inline float* DrumkitComponent::get_out_R_buffer()
 {
-	return __peak_l;
+	return __out_R;
 }
 
-inline void DrumkitComponent::set_peak_r( float val )
+inline FxChain* DrumkitComponent::get_insert_fx() const
 {
-	__peak_r = val;
+	return __insert_fx;
 }
 
-inline float DrumkitComponent::get_peak_r() const
+inline const float* DrumkitComponent::get_out_R_buffer() const
 {
-	return __peak_r;
+	return __out_R;
 }
 
 };
@@ -23,10 +23,13 @@
 #ifndef H2C_INSTRUMENT_H
 #define H2C_INSTRUMENT_H
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 
 #include <hydrogen/object.h>
 #include <hydrogen/basics/adsr.h>
+#include <hydrogen/meter_bus.h>
 
 #define EMPTY_INSTR_ID          -1
 #define METRONOME_INSTR_ID      -2
@@ -37,14 +40,19 @@ namespace H2Core
 
 class XMLNode;
 class ADSR;
+class AutomationPath;
 class Drumkit;
 class DrumkitComponent;
+class FxChain;
 class InstrumentLayer;
 class InstrumentComponent;
 
 
 /**
 Instrument class
+
+The mixing parameters (gain, volume, pan, filter, FX levels, mute and
+solo) are atomics, the editors set them without the engine lock.
 */
 class Instrument : public H2Core::Object
 {
@@ -56,6 +64,35 @@ class Instrument : public H2Core::Object
 			RANDOM
 		};
 
+		/** oscillator of the synth, the notes of an instrument using one are not played by the sampler */
+		enum SynthWaveform {
+			SYNTH_OFF,
+			SYNTH_SINE,
+			SYNTH_TRIANGLE,
+			SYNTH_SAW,
+			SYNTH_SQUARE
+		};
+
+		/** parameters the song automation can drive */
+		enum AutomationTarget {
+			AUTOMATION_VOLUME,
+			AUTOMATION_PAN,					///< 0 is left, 0.5 center and 1 right
+			AUTOMATION_FILTER_CUTOFF,
+			AUTOMATION_FILTER_RESONANCE,
+			AUTOMATION_FX_LEVEL,			///< first of the MAX_FX send levels
+			AUTOMATION_TARGETS = AUTOMATION_FX_LEVEL + MAX_FX
+		};
+
+		/** the mixing parameters of the instrument at a point of a block, automation applied */
+		struct BlockParams {
+			float volume;
+			float pan_l;
+			float pan_r;
+			float filter_cutoff;
+			float filter_resonance;
+			float fx_level[MAX_FX];
+		};
+
 		/**
 		 * constructor
 		 * \param id the id of this instrument
@@ -186,14 +223,36 @@ class Instrument : public H2Core::Object
 		/** get the filter cutoff of the instrument */
 		float get_filter_cutoff() const;
 
-		/** set the left peak of the instrument */
-		void set_peak_l( float val );
-		/** get the left peak of the instrument */
-		float get_peak_l() const;
-		/** set the right peak of the instrument */
-		void set_peak_r( float val );
-		/** get the right peak of the instrument */
-		float get_peak_r() const;
+		/** get the level accumulator of the instrument, audio thread only */
+		MeterAccumulator& get_meter();
+
+		/** get the automation path of a parameter, the parameter follows it while the song plays unless it is empty */
+		AutomationPath* get_automation_path( AutomationTarget target ) const;
+		/**
+		 * evaluate the automation paths for a block, audio thread only.
+		 * Done once per block, further calls for the same block return at once.
+		 * The parameters glide from where the previous block ended towards their
+		 * values, so that control changes don't step. They jump if the previous
+		 * block wasn't evaluated, no voice could hear the step then.
+		 * \param nBlock the number of the block
+		 * \param fStart song position of the first frame in columns, -1 outside song playback
+		 * \param fEnd song position after the last frame of the block
+		 * \param fSmoothing part of the distance to the value covered in the block, 1 to jump
+		 */
+		void update_block_params( uint64_t nBlock, float fStart, float fEnd, float fSmoothing );
+		/** get the parameters at the start or at the end of the current block, voices ramp between them */
+		const BlockParams& get_block_params( bool bEnd ) const;
+
+		/** set the insert fx chain of the instrument, the previous one is deleted */
+		void set_insert_fx( FxChain* chain );
+		/**
+		 * set the insert fx chain of an instrument which has none, without
+		 * locking the audio engine: the instrument isn't played yet or the
+		 * caller holds the lock
+		 */
+		void attach_insert_fx( FxChain* chain );
+		/** get the insert fx chain of the instrument, NULL if none */
+		FxChain* get_insert_fx() const;
 
 		/** set the fx level of the instrument */
 		void set_fx_level( float level, int index );
@@ -261,32 +320,48 @@ class Instrument : public H2Core::Object
 		bool is_currently_exported() const;
 		void set_currently_exported( bool isCurrentlyExported );
 
+		/** set the synth oscillator, SYNTH_OFF for a sampled instrument */
+		void set_synth_waveform( SynthWaveform waveform );
+		/** get the synth oscillator */
+		SynthWaveform get_synth_waveform() const;
+		/** set the frequency in Hz played by a synth note of pitch 0 */
+		void set_synth_frequency( float frequency );
+		/** get the frequency played by a synth note of pitch 0 */
+		float get_synth_frequency() const;
+		/** returns the name of a synth waveform as written in drumkits and songs */
+		static QString synth_waveform_to_string( SynthWaveform waveform );
+		/** returns the synth waveform of a name, SYNTH_OFF if unknown */
+		static SynthWaveform synth_waveform_from_string( const QString& sName );
+
 
 	private:
 		int						__id;					///< instrument id, should be unique
 		QString					__name;					///< instrument name
 		QString					__drumkit_name;			///< the name of the drumkit this instrument belongs to
-		float					__gain;					///< gain of the instrument
-		float					__volume;				///< volume of the instrument
-		float					__pan_l;				///< left pan of the instrument
-		float					__pan_r;				///< right pan of the instrument
-		float					__peak_l;				///< left current peak value
-		float					__peak_r;				///< right current peak value
+		std::atomic<float>		__gain;					///< gain of the instrument
+		std::atomic<float>		__volume;				///< volume of the instrument
+		std::atomic<float>		__pan_l;				///< left pan of the instrument
+		std::atomic<float>		__pan_r;				///< right pan of the instrument
+		MeterAccumulator		__meter;				///< levels accumulated by the sampler voices
+		AutomationPath*			__automation[AUTOMATION_TARGETS];	///< song automation of the parameters
+		BlockParams				__block_params[2];		///< parameters at the start and at the end of the current block
+		uint64_t				__block;				///< block the parameters were evaluated for
+		FxChain*				__insert_fx;			///< insert fx chain, owned by the instrument
 		ADSR*					__adsr;					///< attack delay sustain release instance
-		bool					__filter_active;		///< is filter active?
-		float					__filter_cutoff;		///< filter cutoff (0..1)
-		float					__filter_resonance;		///< filter resonant frequency (0..1)
-		float					__random_pitch_factor;	///< random pitch factor
+		std::atomic<bool>		__filter_active;		///< is filter active?
+		std::atomic<float>		__filter_cutoff;		///< filter cutoff (0..1)
+		std::atomic<float>		__filter_resonance;		///< filter resonant frequency (0..1)
+		std::atomic<float>		__random_pitch_factor;	///< random pitch factor
 		int						__midi_out_note;		///< midi out note
 		int						__midi_out_channel;		///< midi out channel
 		bool					__stop_notes;			///< will the note automatically generate a note off after beeing on
 		SampleSelectionAlgo		__sample_selection_alg;	///< how Hydrogen will chose the sample to use
 		bool					__active;				///< is the instrument active?
-		bool					__soloed;				///< is the instrument in solo mode?
-		bool					__muted;				///< is the instrument muted?
+		std::atomic<bool>		__soloed;				///< is the instrument in solo mode?
+		std::atomic<bool>		__muted;				///< is the instrument muted?
 		int						__mute_group;			///< mute group of the instrument
-		int						__queued;				///< count the number of notes queued within Sampler::__playing_notes_queue or std::priority_queue m_songNoteQueue
-		float					__fx_level[MAX_FX];		///< Ladspa FX level array
+		std::atomic<int>		__queued;				///< count the number of notes queued within Sampler::__playing_notes_queue or std::priority_queue m_songNoteQueue
+		std::atomic<float>		__fx_level[MAX_FX];		///< Ladspa FX level array
 		int						__hihat_grp;			///< the instrument is part of a hihat
 		int						__lower_cc;				///< lower cc level
 		int						__higher_cc;			///< higher cc level
@@ -295,6 +370,8 @@ class Instrument : public H2Core::Object
 		std::vector<InstrumentComponent*>* __components;		///< InstrumentLayer array
 		bool					__apply_velocity;				///< change the sample gain based on velocity
 		bool					__current_instr_for_export;		///< is the instrument currently beeing exported?
+		SynthWaveform			__synth_waveform;		///< synth oscillator, SYNTH_OFF when the layers are played
+		float					__synth_frequency;		///< frequency of a synth note of pitch 0
 };
 // DEFINITIONS
 
@@ -368,122 +445,122 @@ inline void Instrument::set_midi_out_note( int note )
 
 inline void Instrument::set_muted( bool muted )
 {
-	__muted = muted;
+	__muted.store( muted, std::memory_order_relaxed );
 }
 
 inline bool Instrument::is_muted() const
 {
-	return __muted;
+	return __muted.load( std::memory_order_relaxed );
 }
 
 inline void Instrument::set_pan_l( float val )
 {
-	__pan_l = val;
+	__pan_l.store( val, std::memory_order_relaxed );
 }
 
 inline float Instrument::get_pan_l() const
 {
-	return __pan_l;
+	return __pan_l.load( std::memory_order_relaxed );
 }
 
 inline void Instrument::set_pan_r( float val )
 {
-	__pan_r = val;
+	__pan_r.store( val, std::memory_order_relaxed );
 }
 
 inline float Instrument::get_pan_r() const
 {
-	return __pan_r;
+	return __pan_r.load( std::memory_order_relaxed );
 }
 
 inline void Instrument::set_gain( float gain )
 {
-	__gain = gain;
+	__gain.store( gain, std::memory_order_relaxed );
 }
 
 inline float Instrument::get_gain() const
 {
-	return __gain;
+	return __gain.load( std::memory_order_relaxed );
 }
 
 inline void Instrument::set_volume( float volume )
 {
-	__volume = volume;
+	__volume.store( volume, std::memory_order_relaxed );
 }
 
 inline float Instrument::get_volume() const
 {
-	return __volume;
+	return __volume.load( std::memory_order_relaxed );
 }
 
 inline void Instrument::set_filter_active( bool active )
 {
-	__filter_active = active;
+	__filter_active.store( active, std::memory_order_relaxed );
 }
 
 inline bool Instrument::is_filter_active() const
 {
-	return __filter_active;
+	return __filter_active.load( std::memory_order_relaxed );
 }
 
 inline void Instrument::set_filter_resonance( float val )
 {
-	__filter_resonance = val;
+	__filter_resonance.store( val, std::memory_order_relaxed );
 }
 
 inline float Instrument::get_filter_resonance() const
 {
-	return __filter_resonance;
+	return __filter_resonance.load( std::memory_order_relaxed );
 }
 
 inline void Instrument::set_filter_cutoff( float val )
 {
-	__filter_cutoff = val;
+	__filter_cutoff.store( val, std::memory_order_relaxed );
 }
 
 inline float Instrument::get_filter_cutoff() const
 {
-	return __filter_cutoff;
+	return __filter_cutoff.load( std::memory_order_relaxed );
 }
 
-inline void Instrument::set_peak_l( float val )
+inline MeterAccumulator& Instrument::get_meter()
 {
-	__peak_l = val;
+	return __meter;
 }
 
-inline float Instrument::get_peak_l() const
+inline AutomationPath* Instrument::get_automation_path( AutomationTarget target ) const
 {
-	return __peak_l;
+	return __automation[ target ];
 }
 
-inline void Instrument::set_peak_r( float val )
+inline const Instrument::BlockParams& Instrument::get_block_params( bool bEnd ) const
 {
-	__peak_r = val;
+	return __block_params[ bEnd ? 1 : 0 ];
 }
 
-inline float Instrument::get_peak_r() const
+inline FxChain* Instrument::get_insert_fx() const
 {
-	return __peak_r;
+	return __insert_fx;
 }
 
 inline void Instrument::set_fx_level( float level, int index )
 {
-	__fx_level[index] = level;
+	__fx_level[index].store( level, std::memory_order_relaxed );
 }
 
 inline float Instrument::get_fx_level( int index ) const
 {
-	return __fx_level[index];
+	return __fx_level[index].load( std::memory_order_relaxed );
 }
 
 inline void Instrument::set_random_pitch_factor( float val )
 {
-	__random_pitch_factor = val;
+	__random_pitch_factor.store( val, std::memory_order_relaxed );
 }
 
 inline float Instrument::get_random_pitch_factor() const
 {
-	return __random_pitch_factor;
+	return __random_pitch_factor.load( std::memory_order_relaxed );
 }
 
 inline void Instrument::set_active( bool active )
@@ -498,12 +575,12 @@ inline bool Instrument::is_active() const
 
 inline void Instrument::set_soloed( bool soloed )
 {
-	__soloed = soloed;
+	__soloed.store( soloed, std::memory_order_relaxed );
 }
 
 inline bool Instrument::is_soloed() const
 {
-	return __soloed;
+	return __soloed.load( std::memory_order_relaxed );
 }
 
 inline void Instrument::enqueue()
@@ -519,7 +596,7 @@ inline void Instrument::dequeue()
 
 inline bool Instrument::is_queued() const
 {
-	return ( __queued > 0 );
+	return ( __queued.load() > 0 );
 }
 
 inline void Instrument::set_stop_notes( bool stopnotes )
@@ -627,6 +704,26 @@ inline void Instrument::set_currently_exported( bool isCurrentlyExported )
 	__current_instr_for_export = isCurrentlyExported;
 }
 
+inline void Instrument::set_synth_waveform( SynthWaveform waveform )
+{
+	__synth_waveform = waveform;
+}
+
+inline Instrument::SynthWaveform Instrument::get_synth_waveform() const
+{
+	return __synth_waveform;
+}
+
+inline void Instrument::set_synth_frequency( float frequency )
+{
+	__synth_frequency = frequency;
+}
+
+inline float Instrument::get_synth_frequency() const
+{
+	return __synth_frequency;
+}
+
 };
 
 
@@ -23,8 +23,11 @@
 #ifndef H2C_NOTE_H
 #define H2C_NOTE_H
 
+#include <atomic>
+
 #include <hydrogen/object.h>
 #include <hydrogen/basics/instrument.h>
+#include <hydrogen/helpers/denormals.h>
 
 #define KEY_MIN                 0
 #define KEY_MAX                 11
@@ -282,6 +285,14 @@ class Note : public H2Core::Object
 		 * \param val_r the right channel value
 		 */
 		void compute_lr_values( float* val_l, float* val_r );
+		/**
+		 * compute left and right output based on filters, with automated settings
+		 * \param val_l the left channel value
+		 * \param val_r the right channel value
+		 * \param cut_off the filter cutoff
+		 * \param resonance the filter resonance
+		 */
+		void compute_lr_values( float* val_l, float* val_r, float cut_off, float resonance );
 
 	private:
 		Instrument*		__instrument;   ///< the instrument to be played by this note
@@ -308,7 +319,7 @@ class Note : public H2Core::Object
 		int				__pattern_idx;          ///< index of the pattern holding this note for undo actions
 		int				__midi_msg;             ///< TODO
 		bool			__note_off;            ///< note type on|off
-		bool			__just_recorded;       ///< used in record+delete
+		std::atomic<bool>	__just_recorded;   ///< used in record+delete, cleared by the audio thread on snapshot copies
 		float			__probability;        ///< note probability
 		static const char* __key_str[]; ///< used to build QString from __key an __octave
 };
@@ -427,12 +438,12 @@ inline int Note::get_pattern_idx() const
 
 inline void Note::set_just_recorded( bool value )
 {
-	__just_recorded = value;
+	__just_recorded.store( value, std::memory_order_relaxed );
 }
 
 inline bool Note::get_just_recorded() const
 {
-	return __just_recorded;
+	return __just_recorded.load( std::memory_order_relaxed );
 }
 
 inline float Note::get_probability() const
@@ -550,12 +561,16 @@ inline void Note::compute_lr_values( float* val_l, float* val_r )
 		return;
 	}
 	*/
-	float cut_off = __instrument->get_filter_cutoff();
-	float resonance = __instrument->get_filter_resonance();
-	__bpfb_l  =  resonance * __bpfb_l  + cut_off * ( *val_l - __lpfb_l );
-	__lpfb_l +=  cut_off   * __bpfb_l;
-	__bpfb_r  =  resonance * __bpfb_r  + cut_off * ( *val_r - __lpfb_r );
-	__lpfb_r +=  cut_off   * __bpfb_r;
+	compute_lr_values( val_l, val_r, __instrument->get_filter_cutoff(), __instrument->get_filter_resonance() );
+}
+
+inline void Note::compute_lr_values( float* val_l, float* val_r, float cut_off, float resonance )
+{
+	// the states ring down to zero after the sample, keep them out of the denormal range
+	__bpfb_l  =  flush_denormal( resonance * __bpfb_l  + cut_off * ( *val_l - __lpfb_l ) );
+	__lpfb_l  =  flush_denormal( __lpfb_l + cut_off * __bpfb_l );
+	__bpfb_r  =  flush_denormal( resonance * __bpfb_r  + cut_off * ( *val_r - __lpfb_r ) );
+	__lpfb_r  =  flush_denormal( __lpfb_r + cut_off * __bpfb_r );
 	*val_l = __lpfb_l;
 	*val_r = __lpfb_r;
 }
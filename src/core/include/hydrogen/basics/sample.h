@@ -109,14 +109,16 @@ class Sample : public H2Core::Object
 				float divider;          ///< TODO should be ratio : desired time ratio
 				float pitch;            ///< desired pitch
 				int c_settings;        ///< TODO should be crispness, see rubberband -h
+				float bpm;              ///< tempo to stretch to, 0 for the tempo of the engine, not saved nor kept by the sample
 				/** constructor */
-				Rubberband() : use( false ), divider ( 1.0 ), pitch( 1.0 ), c_settings( 4 ) { };
+				Rubberband() : use( false ), divider ( 1.0 ), pitch( 1.0 ), c_settings( 4 ), bpm( 0 ) { };
 				/** copy constructor */
 				Rubberband( const Rubberband* other ) :
 					use( other->use ),
 					divider ( other->divider ),
 					c_settings( other->c_settings ),
-					pitch( other->pitch ) { };
+					pitch( other->pitch ),
+					bpm( other->bpm ) { };
 				/** equal to operator */
 				bool operator ==( const Rubberband& b ) const
 				{
@@ -25,11 +25,16 @@
 
 
 #include <QString>
+#include <QStringList>
 #include <QDomNode>
+#include <QXmlStreamReader>
+#include <atomic>
 #include <vector>
 #include <map>
 
+#include <hydrogen/config.h>
 #include <hydrogen/object.h>
+#include <hydrogen/timeline.h>
 
 class TiXmlNode;
 
@@ -44,8 +49,10 @@ class InstrumentList;
 class Pattern;
 class Song;
 class DrumkitComponent;
+class FxChain;
 class PatternList;
 class AutomationPath;
+class LadspaFX;
 
 /**
 \ingroup H2CORE
@@ -60,7 +67,7 @@ class Song : public H2Core::Object
 			SONG_MODE
 		};
 
-		bool __is_muted;
+		std::atomic<bool> __is_muted;	///< set without the engine lock
 		unsigned __resolution;		///< Resolution of the song (number of ticks per quarter)
 		float __bpm;			///< Beats per minute
 
@@ -82,20 +89,20 @@ class Song : public H2Core::Object
 
 		void set_volume( float volume )
 		{
-			__volume = volume;
+			__volume.store( volume, std::memory_order_relaxed );
 		}
 		float get_volume()
 		{
-			return __volume;
+			return __volume.load( std::memory_order_relaxed );
 		}
 
 		void set_metronome_volume( float volume )
 		{
-			__metronome_volume = volume;
+			__metronome_volume.store( volume, std::memory_order_relaxed );
 		}
 		float get_metronome_volume()
 		{
-			return __metronome_volume;
+			return __metronome_volume.load( std::memory_order_relaxed );
 		}
 
 		PatternList* get_pattern_list()
@@ -178,25 +185,25 @@ class Song : public H2Core::Object
 
 		float get_humanize_time_value()
 		{
-			return __humanize_time_value;
+			return __humanize_time_value.load( std::memory_order_relaxed );
 		}
 		void set_humanize_time_value( float value )
 		{
-			__humanize_time_value = value;
+			__humanize_time_value.store( value, std::memory_order_relaxed );
 		}
 
 		float get_humanize_velocity_value()
 		{
-			return __humanize_velocity_value;
+			return __humanize_velocity_value.load( std::memory_order_relaxed );
 		}
 		void set_humanize_velocity_value( float value )
 		{
-			__humanize_velocity_value = value;
+			__humanize_velocity_value.store( value, std::memory_order_relaxed );
 		}
 
 		float get_swing_factor()
 		{
-			return __swing_factor;
+			return __swing_factor.load( std::memory_order_relaxed );
 		}
 		void set_swing_factor( float factor );
 
@@ -279,8 +286,8 @@ class Song : public H2Core::Object
 
 
 	private:
-		float								__volume;					///< volume of the song (0.0..1.0)
-		float								__metronome_volume;			///< Metronome volume
+		std::atomic<float>					__volume;					///< volume of the song (0.0..1.0)
+		std::atomic<float>					__metronome_volume;			///< Metronome volume
 		QString								__notes;
 		PatternList*						__pattern_list;				///< Pattern list
 		std::vector<PatternList*>*			__pattern_group_sequence;	///< Sequence of pattern groups
@@ -288,9 +295,9 @@ class Song : public H2Core::Object
 		std::vector<DrumkitComponent*>*		__components;				///< list of drumkit component
 		QString								__filename;
 		bool								__is_loop_enabled;
-		float								__humanize_time_value;
-		float								__humanize_velocity_value;
-		float								__swing_factor;
+		std::atomic<float>					__humanize_time_value;
+		std::atomic<float>					__humanize_velocity_value;
+		std::atomic<float>					__swing_factor;
 		bool								__is_modified;
 		std::map< float, int> 				__latest_round_robins;
 		SongMode							__song_mode;
@@ -310,16 +317,92 @@ class SongReader : public H2Core::Object
 {
 		H2_OBJECT
 	public:
+		/**
+		 * The settings stored in a song file which live outside of the
+		 * song: the tempo of the engine, the LADSPA FX and the timeline.
+		 * A song read in the background keeps them here until it replaces
+		 * the current song.
+		 */
+		struct Globals {
+			float fBpm;
+			bool bPatternModePlaysSelected;
+			QString sDrumkitName;
+			LadspaFX* ladspaFX[ MAX_FX ];		///< owned until applied
+			std::vector<Timeline::HTimelineVector> timeline;
+			std::vector<Timeline::HTimelineTagVector> timelineTags;
+			/// insert FX read, owned until attached with attachInsertFx()
+			std::vector< std::pair<Instrument*, FxChain*> > instrumentFx;
+			std::vector< std::pair<DrumkitComponent*, FxChain*> > componentFx;
+			Globals();
+			~Globals();
+		};
+
 		SongReader();
 		~SongReader();
 		const QString getPath( const QString& filename );
-		Song* readSong( const QString& filename );
+		/**
+		 * Read a song file
+		 * \param filename the file to read
+		 * \param pGlobals receives the global settings of the song, NULL
+		 * to apply them right away
+		 * \return the song, NULL on error
+		 */
+		Song* readSong( const QString& filename, Globals* pGlobals = NULL );
+		/**
+		 * apply the global settings of a song to the engine
+		 * \param pGlobals the settings
+		 * \param bLadspaFX false to leave the LADSPA FX alone, else they are taken over
+		 */
+		static void applyGlobals( Globals* pGlobals, bool bLadspaFX = true );
+		/**
+		 * attach the insert FX read to the instruments and components of
+		 * the song, before it is played or with the audio engine locked
+		 */
+		static void attachInsertFx( Globals* pGlobals );
 
 	private:
+		/// a note as read from the song file
+		struct NoteRecord {
+			int nPosition;
+			float fLeadLag;
+			float fVelocity;
+			float fPan_L;
+			float fPan_R;
+			int nLength;
+			float fPitch;
+			float fProbability;
+			QString sKey;
+			bool bNoteOff;
+			int nInstrument;
+		};
+
+		/// a pattern as read from the song file, its notes refer to their instrument by ID
+		struct PatternRecord {
+			QString sName;
+			QString sInfo;
+			QString sCategory;
+			int nSize;
+			std::vector<NoteRecord> notes;
+		};
+
 		QString m_sSongVersion;
+		std::vector<PatternRecord> m_patterns;
+		std::vector< std::pair<QString, QStringList> > m_virtualPatterns;	///< pattern name and its virtual patterns
+		std::vector<QStringList> m_patternSequence;		///< pattern names of each group
 
-		/// Dato un XmlNode restituisce un oggetto Pattern
-		Pattern* getPattern( QDomNode pattern, InstrumentList* instrList );
+		/**
+		 * Parse a song document. The patterns, the virtual patterns and the
+		 * pattern sequence are read into the records, the other nodes of the
+		 * song are copied into doc.
+		 */
+		bool readStream( QXmlStreamReader& reader, QDomDocument& doc );
+		void readPattern( QXmlStreamReader& reader );
+		void readNoteList( QXmlStreamReader& reader, std::vector<NoteRecord>& notes );
+		void readVirtualPattern( QXmlStreamReader& reader );
+		void readPatternSequence( QXmlStreamReader& reader );
+
+		/// Dato un PatternRecord restituisce un oggetto Pattern
+		Pattern* getPattern( const PatternRecord& record, InstrumentList* instrList );
 };
 
 };
@@ -0,0 +1,177 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SONG_SNAPSHOT_H
+#define H2C_SONG_SNAPSHOT_H
+
+#include <memory>
+#include <vector>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class Song;
+class Pattern;
+class Note;
+
+/**
+ * SongSnapshot is a frozen copy of what the sequencer reads from a song:
+ * the patterns with their notes and the sequence of columns.
+ *
+ * The editors build a new snapshot after each change and the audio thread
+ * only reads the snapshot, so that notes and sequence can be edited without
+ * holding the engine lock. Patterns left unchanged are shared with the
+ * previous snapshot. A snapshot is never modified once built, but for the
+ * just recorded flag of its notes which the audio thread clears, an atomic
+ * read by the next snapshot.
+*/
+class SongSnapshot : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** the notes of a pattern, sorted by position */
+		struct PatternData {
+			Pattern* pattern;                   ///< the pattern, never dereferenced by the audio thread
+			int length;                         ///< length of the pattern in ticks
+			std::vector<Note*> notes;           ///< copies of the notes, owned
+			std::vector<Note*> sources;         ///< the notes they are copied from, compared only
+			~PatternData();
+		};
+
+		/** a column of the sequence */
+		struct Column {
+			int start;                          ///< first tick of the column
+			int length;                         ///< length of the column in ticks
+			std::vector<int> patterns;          ///< indices of the patterns played, virtual ones included
+		};
+
+		/**
+		 * take a snapshot of a song, from the thread editing it
+		 * \param song the song, NULL for an empty snapshot
+		 * \param previous the snapshot in use, its unchanged patterns are shared
+		 * \param edited the patterns whose notes may have changed, the other
+		 * patterns of previous are shared without comparing their notes. NULL
+		 * to compare all of them.
+		 */
+		SongSnapshot( Song* song, const SongSnapshot* previous, const std::vector<const Pattern*>* edited = NULL );
+		/** destructor */
+		~SongSnapshot();
+
+		/** returns false if the song didn't change since the previous snapshot */
+		bool has_changes() const;
+
+		/** returns the number of patterns, in the order of the pattern list of the song */
+		int get_patterns_count() const;
+		/** returns the data of a pattern */
+		const PatternData* get_pattern( int idx ) const;
+		/**
+		 * find a pattern by its address
+		 * \param pattern the pattern to find
+		 * \return its index, -1 if it isn't in the snapshot
+		 */
+		int find_pattern( const Pattern* pattern ) const;
+		/** returns the indices of a pattern and of its flattened virtual patterns, played together */
+		const std::vector<int>& get_playing( int idx ) const;
+		/**
+		 * returns the index of the first note of a pattern at a tick, the
+		 * other notes at this tick follow it
+		 */
+		static unsigned first_note_at( const PatternData* pattern, int tick );
+
+		/** returns the number of columns of the sequence */
+		int get_columns_count() const;
+		/** returns a column of the sequence */
+		const Column& get_column( int idx ) const;
+		/** returns the length of the sequence in ticks */
+		int get_length() const;
+		/**
+		 * find the column playing at a tick, without looping
+		 * \param tick the tick
+		 * \param column_start set to the first tick of the column
+		 * \return the index of the column, -1 past the end
+		 */
+		int find_column( int tick, int* column_start ) const;
+		/**
+		 * returns the position of a tick in columns, as column index plus the
+		 * part of the column already played, -1 past the end
+		 * \param tick the tick, fractional
+		 * \param loop true to wrap around the end of the sequence
+		 */
+		float get_column_position( double tick, bool loop ) const;
+
+	private:
+		std::vector< std::shared_ptr<PatternData> > __patterns;    ///< in the order of the pattern list
+		std::vector< std::pair<const Pattern*, int> > __index;      ///< pattern indices sorted by address
+		std::vector< std::vector<int> > __playing;                  ///< see get_playing()
+		std::vector<Column> __columns;
+		int __length;
+		bool __changes;
+
+		/** copy a pattern, or share it with the previous snapshot if equal */
+		std::shared_ptr<PatternData> take_pattern( Pattern* pattern, const SongSnapshot* previous,
+												   const std::vector<const Pattern*>* edited );
+};
+
+// DEFINITIONS
+
+inline bool SongSnapshot::has_changes() const
+{
+	return __changes;
+}
+
+inline int SongSnapshot::get_patterns_count() const
+{
+	return __patterns.size();
+}
+
+inline const SongSnapshot::PatternData* SongSnapshot::get_pattern( int idx ) const
+{
+	return __patterns[ idx ].get();
+}
+
+inline const std::vector<int>& SongSnapshot::get_playing( int idx ) const
+{
+	return __playing[ idx ];
+}
+
+inline int SongSnapshot::get_columns_count() const
+{
+	return __columns.size();
+}
+
+inline const SongSnapshot::Column& SongSnapshot::get_column( int idx ) const
+{
+	return __columns[ idx ];
+}
+
+inline int SongSnapshot::get_length() const
+{
+	return __length;
+}
+
+};
+
+#endif // H2C_SONG_SNAPSHOT_H
+
+/* vim: set softtabstop=4 noexpandtab: */
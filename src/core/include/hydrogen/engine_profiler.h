@@ -0,0 +1,146 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_ENGINE_PROFILER_H
+#define H2C_ENGINE_PROFILER_H
+
+#include <hydrogen/object.h>
+#include <atomic>
+#include <cstdint>
+
+/* histogram buckets, 4 per octave from 256 ns, the last one gets everything above 268 ms */
+#define PROFILER_BUCKETS 82
+
+namespace H2Core
+{
+
+struct ProfileSnapshot;
+
+/**
+ * Engine profiler, times each stage of the audio process with a monotonic
+ * clock and keeps a log-linear histogram per stage.
+ *
+ * Always compiled in, a stage costs a clock read and a few relaxed atomic
+ * stores. The audio thread is the only writer, any thread can read the
+ * histograms without blocking it.
+ */
+class EngineProfiler : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	enum Stage {
+		NOTE_QUEUE,             ///< audioEngine_updateNoteQueue
+		PLAY_NOTES,             ///< audioEngine_process_playNotes
+		SAMPLER,                ///< sampler rendering and mixdown
+		SYNTH,                  ///< synth rendering and mixdown
+		LADSPA,                 ///< insert chains and send FX
+		METERING,               ///< MeterBus
+		PROCESS,                ///< the whole process callback
+		STAGES
+	};
+
+	static void create_instance();
+	static EngineProfiler* get_instance() { assert( __instance ); return __instance; }
+	~EngineProfiler();
+
+	/** returns the name of a stage, as used by OSC and h2cli */
+	static const char* stage_name( Stage stage );
+	/** returns the monotonic clock in nanoseconds */
+	static uint64_t now();
+
+	/** apply a pending reset, audio thread only, at the start of a cycle */
+	void begin_cycle();
+	/**
+	 * add a measure to a stage, audio thread only
+	 * \param stage the stage
+	 * \param nNs its duration in nanoseconds
+	 */
+	void add( Stage stage, uint64_t nNs );
+	/**
+	 * add the whole callback duration, audio thread only
+	 * \param nNs the duration of the callback in nanoseconds
+	 * \param nBudgetNs the duration of the period in nanoseconds
+	 * \return true if the callback took longer than the period
+	 */
+	bool end_cycle( uint64_t nNs, uint64_t nBudgetNs );
+	/** count an xrun detected by the audio driver, any thread */
+	void report_xrun();
+
+	/** drop all measures, any thread, applied at the start of the next cycle */
+	void reset();
+	/**
+	 * compute the statistics of the current measures, any thread but the audio one
+	 * \param out the snapshot to fill
+	 */
+	void get_snapshot( ProfileSnapshot& out ) const;
+
+private:
+	EngineProfiler();
+	static EngineProfiler* __instance;
+
+	/** returns the bucket of a duration */
+	static int bucket_of( uint64_t nNs );
+	/** returns the duration in the middle of a bucket */
+	static uint64_t bucket_value( int nBucket );
+
+	/** measures of a stage, written by the audio thread only */
+	struct Histogram {
+		std::atomic<uint32_t> buckets[ PROFILER_BUCKETS ];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> total;        ///< sum of the durations in nanoseconds
+		std::atomic<uint64_t> max;
+		void clear();
+	};
+
+	Histogram __stages[ STAGES ];
+	std::atomic<uint64_t> __xruns;
+	std::atomic<uint64_t> __driver_xruns;
+	std::atomic<uint64_t> __budget;         ///< last period in nanoseconds
+	std::atomic<bool> __reset_requested;
+};
+
+/** timing statistics of a stage as published to the clients, in microseconds */
+struct StageStats
+{
+	uint64_t count;             ///< number of measures
+	float mean;
+	float p50;                  ///< median, resolution of a quarter of octave
+	float p99;
+	float max;                  ///< exact worst measure
+};
+
+/** a view of all the engine timings */
+struct ProfileSnapshot
+{
+	StageStats stage[ EngineProfiler::STAGES ];
+	uint64_t cycles;            ///< process cycles measured
+	uint64_t xruns;             ///< cycles longer than the period
+	uint64_t driver_xruns;      ///< xruns reported by the audio driver
+	float worst_us;             ///< longest process cycle
+	float budget_us;            ///< duration of the last period
+};
+
+};
+
+#endif // H2C_ENGINE_PROFILER_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -26,6 +26,7 @@
 #include <hydrogen/object.h>
 #include <hydrogen/basics/note.h>
 #include <cassert>
+#include <atomic>
 
 #define MAX_EVENTS 1024
 
@@ -51,7 +52,8 @@ enum EventType {
 	EVENT_PLAYLIST_LOADSONG,
 	EVENT_UNDO_REDO,
 	EVENT_SONG_MODIFIED,
-	EVENT_TEMPO_CHANGED
+	EVENT_TEMPO_CHANGED,
+	EVENT_SONG_SWITCHED
 };
 
 
@@ -65,6 +67,14 @@ public:
 ///
 /// Event queue: is the way the engine talks to the GUI
 ///
+/// push_event() can be called concurrently from any thread (audio, MIDI,
+/// GUI), it never locks nor allocates. pop_event() must only be called from
+/// a single consumer thread.
+/// EVENT_NOTEON (per instrument) and EVENT_MIDI_ACTIVITY are coalesced: an
+/// event which is still pending in the queue is not pushed twice.
+/// If the queue is full, the new event is dropped and accounted in
+/// dropped_events().
+///
 class EventQueue : public H2Core::Object
 {
 	H2_OBJECT
@@ -76,6 +86,25 @@ public:
 	void push_event( EventType type, int nValue );
 	Event pop_event();
 
+	/// number of events dropped because the queue was full
+	unsigned dropped_events() const { return __dropped.load( std::memory_order_relaxed ); }
+	/// number of events merged into a pending event of the same kind
+	unsigned coalesced_events() const { return __coalesced.load( std::memory_order_relaxed ); }
+
+	/**
+	 * file descriptor becoming readable when events are pushed,
+	 * -1 if not supported on this platform. Call acknowledge_wakeup()
+	 * before draining the queue with pop_event().
+	 */
+	int get_wakeup_fd() const { return __wakeup_fd; }
+	/// reset the wakeup file descriptor
+	void acknowledge_wakeup();
+	/**
+	 * block until an event is pushed or the timeout expires.
+	 * \param nTimeoutMs the timeout in milliseconds
+	 */
+	void wait_event( int nTimeoutMs );
+
 		struct AddMidiNoteVector
 		{
 				int m_column;       //position
@@ -97,9 +126,27 @@ private:
 	EventQueue();
 	static EventQueue *__instance;
 
-	int __read_index;
-	int __write_index;
-	Event __events_buffer[ MAX_EVENTS ];
+	/// a queue slot, seq tells whether it is free or holds an event
+	struct Slot {
+		std::atomic<unsigned> seq;
+		Event event;
+	};
+
+	/// return the coalescing flag of an event, NULL if this kind of event is never coalesced
+	std::atomic<bool>* pending_flag( EventType type, int nValue );
+	/// wake the consumer up if it has been acknowledged since the last wakeup
+	void wakeup();
+
+	std::atomic<unsigned> __write_index;
+	unsigned __read_index;
+	Slot __events_buffer[ MAX_EVENTS ];
+
+	std::atomic<bool> __pending_note_on[ MAX_INSTRUMENTS ];
+	std::atomic<bool> __pending_midi_activity;
+	std::atomic<bool> __signaled;
+	std::atomic<unsigned> __dropped;
+	std::atomic<unsigned> __coalesced;
+	int __wakeup_fd;
 };
 
 };
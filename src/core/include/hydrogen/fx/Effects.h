@@ -29,6 +29,7 @@
 #include <hydrogen/globals.h>
 #include <hydrogen/object.h>
 #include <hydrogen/fx/LadspaFX.h>
+#include <hydrogen/fx/FxChain.h>
 
 #include <vector>
 #include <cassert>
@@ -45,11 +46,29 @@ class Effects : public H2Core::Object
 public:
 	static void create_instance();
 	static Effects* get_instance() { assert(__instance); return __instance; }
+	static bool has_instance() { return __instance != NULL; }
 	~Effects();
 
 	LadspaFX* getLadspaFX( int nFX );
+	/**
+	 * set the send FX of slot nFX, the previous one is deleted.
+	 * The FX gets its send buffers from the buffer pool.
+	 */
 	void  setLadspaFX( LadspaFX* pFX, int nFX );
 
+	/**
+	 * set up a send FX to be swapped in by swapLadspaFX(), it gets its
+	 * send buffers and is activated without locking the engine
+	 */
+	void prepareLadspaFX( LadspaFX* pFX );
+	/** exchange the send FX of all the slots with pFX, audio thread only */
+	void swapLadspaFX( LadspaFX** pFX );
+	/** deactivate and delete a send FX swapped out, NULL is ignored */
+	void releaseLadspaFX( LadspaFX* pFX );
+
+	/** the buffers of the send FX and the insert chains */
+	FxBufferPool* getBufferPool() { return &m_bufferPool; }
+
 	std::vector<LadspaFXInfo*> getPluginList();
 	LadspaFXGroup* getLadspaFXGroup();
 
@@ -63,9 +82,22 @@ private:
 	void updateRecentGroup();
 
 	LadspaFX* m_FXList[ MAX_FX ];
+	FxBufferPool m_bufferPool;
 
 	Effects();
 
+	/** a plugin library as stored in the plugin cache */
+	struct PluginLibrary {
+		qint64 nModified;						///< modification time of the file, in ms
+		qint64 nSize;							///< size of the file
+		std::vector<LadspaFXInfo*> plugins;		///< usable plugins of the library
+	};
+	/** open a library and return its usable plugins */
+	std::vector<LadspaFXInfo*> scanLibrary( const QString& sAbsPath );
+	/** read the libraries scanned by a previous run, the caller owns their plugins */
+	QMap<QString, PluginLibrary> loadPluginCache();
+	void savePluginCache( const QMap<QString, PluginLibrary>& libraries );
+
 	void RDFDescend( const QString& sBase, LadspaFXGroup *pGroup, std::vector<LadspaFXInfo*> pluginList );
 	void getRDF( LadspaFXGroup *pGroup, std::vector<LadspaFXInfo*> pluginList );
 
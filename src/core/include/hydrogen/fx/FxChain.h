@@ -0,0 +1,150 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_FX_CHAIN_H
+#define H2C_FX_CHAIN_H
+
+#include "hydrogen/config.h"
+#ifdef H2CORE_HAVE_LADSPA
+
+#include <hydrogen/object.h>
+
+#include <vector>
+#include <pthread.h>
+#include <QDomNode>
+#include <QDomDocument>
+#include <QXmlStreamWriter>
+
+namespace H2Core
+{
+
+class LadspaFX;
+
+/**
+ * Pool of MAX_BUFFER_SIZE audio buffers shared by the FX sends and the
+ * insert chains. Released buffers are kept and handed out again, the pool
+ * only allocates when it runs dry.
+ *
+ * Not realtime safe. Thread safe, chains are built by the song preloader too.
+ */
+class FxBufferPool : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	FxBufferPool();
+	~FxBufferPool();
+
+	/** get a zeroed buffer of MAX_BUFFER_SIZE frames */
+	float* acquire();
+	/** give a buffer back to the pool, NULL is ignored */
+	void release( float* pBuffer );
+
+private:
+	std::vector<float*> __free;         ///< buffers ready to be handed out
+	int __allocated;                    ///< number of buffers allocated so far
+	pthread_mutex_t __mutex;
+};
+
+/**
+ * An ordered list of LADSPA plugins processing a stereo bus in place.
+ *
+ * Instruments and drumkit components own one to insert effects on their
+ * signal. The chain owns its plugins and a pair of pooled buffers, the
+ * plugins are connected to them once when they are added.
+ */
+class FxChain : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	FxChain();
+	/**
+	 * copy constructor, the plugins are instantiated again with the
+	 * settings of the other chain
+	 * \param other the chain to copy
+	 * \param nSampleRate the sample rate to instantiate the plugins with
+	 */
+	FxChain( FxChain* other, long nSampleRate );
+	~FxChain();
+
+	/** number of plugins of the chain */
+	int size() const { return __fx.size(); }
+	/** get the plugin at position nIdx, NULL if out of range */
+	LadspaFX* get( int nIdx ) const;
+	/**
+	 * set the plugin at position nIdx, the previous one is deleted.
+	 * nIdx == size() appends, a NULL plugin removes the position.
+	 * The audio engine is locked while the chain is modified.
+	 * \param pFX the plugin, owned by the chain from now on
+	 * \param nIdx the position
+	 */
+	void set( LadspaFX* pFX, int nIdx );
+
+	/** true if at least one plugin is enabled */
+	bool is_active() const;
+
+	/** the left channel of the bus */
+	float* get_buffer_L() { return __buffer_L; }
+	/** the right channel of the bus */
+	float* get_buffer_R() { return __buffer_R; }
+
+	/** true if the voices have been routed to the bus in the current cycle, audio thread only */
+	bool is_routed() const { return __routed; }
+	/** set by FxGraph at the start of each cycle, audio thread only */
+	void set_routed( bool bRouted ) { __routed = bRouted; }
+
+	/**
+	 * run the enabled plugins on the bus, in order
+	 * \param nFrames number of frames
+	 */
+	void process( unsigned nFrames );
+
+	/**
+	 * write the chain as an insertFX child of the current element
+	 * \param writer the writer of the document
+	 */
+	void save_to( QXmlStreamWriter& writer );
+	/**
+	 * load the insertFX child of node, the audio engine isn't locked
+	 * as the chain is not in use yet
+	 * \param node the parent node
+	 * \param nSampleRate the sample rate to instantiate the plugins with
+	 * \return a new chain, NULL if node has no plugin
+	 */
+	static FxChain* load_from( const QDomNode& node, long nSampleRate );
+
+private:
+	/** connect a plugin to the bus and activate it */
+	void connect( LadspaFX* pFX );
+
+	std::vector<LadspaFX*> __fx;
+	float* __buffer_L;
+	float* __buffer_R;
+	bool __routed;
+};
+
+};
+
+#endif // H2CORE_HAVE_LADSPA
+
+#endif // H2C_FX_CHAIN_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -0,0 +1,166 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_FX_GRAPH_H
+#define H2C_FX_GRAPH_H
+
+#include "hydrogen/config.h"
+#ifdef H2CORE_HAVE_LADSPA
+
+#include <hydrogen/object.h>
+#include <hydrogen/globals.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+#ifdef __linux__
+#define FX_GRAPH_HAVE_WORKERS
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+#define FX_GRAPH_MAX_NODES ( MAX_INSTRUMENTS + MAX_COMPONENTS + MAX_FX )
+#define FX_GRAPH_MAX_WORKERS 3
+/// below this number of nodes the audio thread runs the graph alone, waking the workers costs more
+#define FX_GRAPH_MIN_PARALLEL_NODES 4
+/// part of the cycle period the audio thread waits at most for the nodes run by the workers
+#define FX_GRAPH_MAX_WAIT 0.5
+
+namespace H2Core
+{
+
+class Song;
+class FxChain;
+class Instrument;
+class DrumkitComponent;
+
+/**
+ * Schedules the insert chains and the send FX of a cycle.
+ *
+ * Each instrument insert, component insert and send FX is a node of a
+ * graph, instrument inserts feeding a send come before it. Ready nodes
+ * are run by the audio thread and a small pool of worker threads, the
+ * outputs are then summed into the main mix by the audio thread in a
+ * fixed order.
+ *
+ * The audio thread never sleeps on the workers. It runs the ready nodes
+ * itself and spins on the nodes the workers are running until a deadline.
+ * Past it the nodes not done are left out of the mix, and the graph is
+ * bypassed until the late worker has returned.
+ *
+ * Everything but the constructor and the destructor runs in the audio
+ * thread, with the audio engine locked.
+ */
+class FxGraph : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	static void create_instance();
+	static FxGraph* get_instance() { assert( __instance ); return __instance; }
+	~FxGraph();
+
+	/**
+	 * build the nodes of the cycle and route the voices of the instruments
+	 * and components with an active insert chain to their bus.
+	 * Called by the sampler before it renders the voices.
+	 * \param pSong the current song
+	 * \param nFrames number of frames
+	 */
+	void prepare( Song* pSong, unsigned nFrames );
+	/**
+	 * run the nodes and add their outputs to the main buffers
+	 * \param nFrames number of frames
+	 * \param nSampleRate sample rate of the driver, sets the deadline of the workers
+	 * \param pMain_L left main buffer
+	 * \param pMain_R right main buffer
+	 */
+	void process( unsigned nFrames, unsigned nSampleRate, float* pMain_L, float* pMain_R );
+
+	/** number of worker threads helping the audio thread */
+	int get_workers() const { return __workers; }
+
+private:
+	FxGraph();
+	static FxGraph* __instance;
+
+	enum NodeType {
+		INSTRUMENT_INSERT,
+		COMPONENT_INSERT,
+		SEND
+	};
+
+	struct Node {
+		NodeType type;
+		FxChain* chain;						///< insert nodes only
+		Instrument* instrument;				///< instrument insert nodes only
+		DrumkitComponent* component;		///< component insert nodes only
+		int fx;								///< send nodes only, the FX slot
+		int dependents[ MAX_FX ];			///< nodes to notify once done
+		int n_dependents;
+		int n_sources;						///< nodes to wait for
+		std::atomic<int> pending;			///< sources not done yet in this cycle
+		std::atomic<bool> done;				///< its output is ready in this cycle
+	};
+
+	/** run a node and release its dependents */
+	void run_node( int nNode );
+	/**
+	 * run ready nodes until the whole graph is done
+	 * \param nDeadline monotonic time to give up at, 0 to stop only when
+	 * the graph is done or closed
+	 * \return true if the graph is done
+	 */
+	bool run_ready( uint64_t nDeadline );
+	void push_ready( int nNode );
+	bool pop_ready( int& nNode );
+
+	Song* __song;
+	unsigned __frames;
+	Node __nodes[ FX_GRAPH_MAX_NODES ];
+	int __n_nodes;
+	int __n_instrument_nodes;				///< instrument nodes come first
+	bool __bypass;							///< a worker is still in the graph of a former cycle, it is left alone
+
+	std::atomic<int> __ready[ FX_GRAPH_MAX_NODES ];
+	std::atomic<int> __ready_read;
+	std::atomic<int> __ready_write;
+	std::atomic<int> __remaining;			///< nodes not done yet in this cycle
+
+	int __workers;
+#ifdef FX_GRAPH_HAVE_WORKERS
+	static void* worker_thread( void* pArg );
+	pthread_t __threads[ FX_GRAPH_MAX_WORKERS ];
+	sem_t __wakeup;
+	std::atomic<bool> __quit;
+	std::atomic<bool> __open;				///< workers may join the graph of the cycle
+	std::atomic<int> __busy;				///< workers in the graph
+#endif
+};
+
+};
+
+#endif // H2CORE_HAVE_LADSPA
+
+#endif // H2C_FX_GRAPH_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -27,6 +27,7 @@
 
 #include <QLibrary>
 
+#include <atomic>
 #include <vector>
 #include <list>
 #include "ladspa.h"
@@ -124,6 +125,7 @@ public:
 
 	//unsigned m_nBufferSize;
 
+	/** send buffers, lent by the Effects buffer pool while the FX sits in a send slot */
 	float* m_pBuffer_L;
 	float* m_pBuffer_R;
 
@@ -154,10 +156,11 @@ public:
 	}
 
 	bool isEnabled() {
-		return m_bEnabled;
+		return m_bEnabled.load( std::memory_order_relaxed );
 	}
+	/// set from the editors without the engine lock
 	void setEnabled( bool value ) {
-		m_bEnabled = value;
+		m_bEnabled.store( value, std::memory_order_relaxed );
 	}
 
 	static LadspaFX* load( const QString& sLibraryPath, const QString& sPluginLabel, long nSampleRate );
@@ -168,13 +171,13 @@ public:
 
 	void setVolume( float fValue );
 	float getVolume() {
-		return m_fVolume;
+		return m_fVolume.load( std::memory_order_relaxed );
 	}
 
 
 private:
 	bool m_pluginType;
-	bool m_bEnabled;
+	std::atomic<bool> m_bEnabled;
 	bool m_bActivated;	// Guard against plugins that can't be deactivated before being activated (
 	QString m_sLabel;
 	QString m_sName;
@@ -184,7 +187,7 @@ private:
 
 	const LADSPA_Descriptor * m_d;
 	LADSPA_Handle m_handle;
-	float m_fVolume;
+	std::atomic<float> m_fVolume;
 
 	unsigned m_nICPorts;	///< input control port
 	unsigned m_nOCPorts;	///< output control port
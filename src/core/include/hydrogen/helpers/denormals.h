@@ -0,0 +1,78 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_DENORMALS_H
+#define H2C_DENORMALS_H
+
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define H2CORE_HAVE_MXCSR
+#endif
+
+namespace H2Core
+{
+
+/**
+ * added then subtracted to a decaying state, anything below 1e-25 ends up
+ * at zero before reaching the denormal range, larger values are unchanged
+ */
+const float DENORMAL_GUARD = 1e-18f;
+
+/** flush a value too small to be heard to zero, without branching */
+inline float flush_denormal( float fValue )
+{
+	fValue += DENORMAL_GUARD;
+	return fValue - DENORMAL_GUARD;
+}
+
+/**
+ * have the FPU of the calling thread flush denormal results to zero (FTZ)
+ * and read denormal operands as zero (DAZ), it is cheap enough to be done
+ * at every process cycle, for threads the engine doesn't create
+ * \return false if the platform has no such mode
+ */
+inline bool enable_flush_to_zero()
+{
+#if defined(H2CORE_HAVE_MXCSR)
+#  if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+	_mm_setcsr( _mm_getcsr() | 0x8040 );    // FTZ | DAZ
+#  else
+	_mm_setcsr( _mm_getcsr() | 0x8000 );    // the first SSE CPUs have no DAZ
+#  endif
+	return true;
+#elif defined(__aarch64__)
+	uint64_t nFpcr;
+	__asm__ __volatile__( "mrs %0, fpcr" : "=r"( nFpcr ) );
+	__asm__ __volatile__( "msr fpcr, %0" : : "r"( nFpcr | ( 1ULL << 24 ) ) );    // FZ
+	return true;
+#else
+	return false;
+#endif
+}
+
+};
+
+#endif // H2C_DENORMALS_H
+
+/* vim: set softtabstop=4 noexpandtab: */
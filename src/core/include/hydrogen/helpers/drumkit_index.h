@@ -0,0 +1,75 @@
+#ifndef H2C_DRUMKIT_INDEX_H
+#define H2C_DRUMKIT_INDEX_H
+
+#include <hydrogen/object.h>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+
+#include <vector>
+
+namespace H2Core
+{
+
+/**
+ * DrumkitIndex keeps the metadata of the installed drumkits in a file of
+ * the user cache directory.
+ * A drumkit.xml is parsed again only if its directory or itself changed
+ * since it was indexed, listing the drumkits costs a stat per drumkit.
+ */
+class DrumkitIndex : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** metadata of an indexed drumkit */
+		struct Entry {
+			QString path;               ///< absolute path of the drumkit directory
+			QString name;
+			QString author;
+			QString info;
+			QString license;
+			QStringList instruments;    ///< instrument names, in drumkit order
+			qint64 dir_mtime;           ///< modification time of the directory, in ms
+			qint64 xml_mtime;           ///< modification time of drumkit.xml, in ms
+			qint64 xml_size;            ///< size of drumkit.xml
+			bool valid;                 ///< false if drumkit.xml could not be loaded
+		};
+
+		/** returns the usable system drumkits, refreshing the changed ones */
+		static std::vector<Entry> sys_drumkits();
+		/** returns the usable user drumkits, refreshing the changed ones */
+		static std::vector<Entry> usr_drumkits();
+		/**
+		 * returns the path of the directory of a drumkit, user drumkits first
+		 * \param dk_name the name of the drumkit as written in drumkit.xml
+		 * \return an empty string if no indexed drumkit has this name
+		 */
+		static QString path_of( const QString& dk_name );
+		/** returns the path of the index file */
+		static QString index_path();
+
+	private:
+		/**
+		 * returns the usable drumkits of a directory
+		 * \param path the path to search in for drumkits, with a trailing slash
+		 */
+		static std::vector<Entry> drumkits( const QString& path );
+		/** fill the metadata of an entry from its drumkit.xml */
+		static void parse( Entry& entry );
+		/** read the index file, once */
+		static void load();
+		/** write the index file if it changed */
+		static void save();
+
+		static QMap<QString, Entry> __entries;      ///< indexed drumkits, keyed by path
+		static bool __loaded;                       ///< the index file has been read
+		static bool __modified;                     ///< entries differ from the index file
+		static QMutex __mutex;                      ///< protects the entries
+};
+
+};
+
+#endif  // H2C_DRUMKIT_INDEX_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -82,6 +82,19 @@ public:
 	/// Set/Get current song
 	Song*			getSong()	{ return __song; }
 	void			setSong	( Song *newSong );
+	/**
+	 * Replace the song without stopping the transport. While playing, the
+	 * new song is set up right away and swapped in by the audio thread at
+	 * the next bar, EVENT_SONG_SWITCHED is raised once it is current.
+	 * \param newSong the song
+	 * \param pGlobals its global settings, taken over, NULL if none
+	 */
+	void			switchSong( Song *newSong, SongReader::Globals* pGlobals = NULL );
+	/**
+	 * Clean up after the song swapped in by switchSong(): free the song
+	 * replaced and apply the settings of the new one, on EVENT_SONG_SWITCHED
+	 */
+	void			finishSongSwitch();
 
 	void			removeSong();
 
@@ -94,15 +107,6 @@ public:
 									  bool forcePlay=false,
 									  int msg1=0 );
 
-	float			getMasterPeak_L();
-	void			setMasterPeak_L( float value );
-
-	float			getMasterPeak_R();
-	void			setMasterPeak_R( float value );
-
-	void			getLadspaFXPeak( int nFX, float *fL, float *fR );
-	void			setLadspaFXPeak( int nFX, float fL, float fR );
-
 	unsigned long	getTickPosition();
 	unsigned long	getRealtimeTickPosition();
 	unsigned long	getTotalFrames();
@@ -239,6 +243,8 @@ private:
 	static Hydrogen* __instance;
 
 	Song*	__song; /// < Current song
+	/// swaps the current song at a bar
+	friend bool audioEngine_switchSong( int nTick );
 
 	void initBeatcounter(void);
 
@@ -24,7 +24,7 @@
 #define H2C_LOGGER_H
 
 #include <cassert>
-#include <list>
+#include <atomic>
 #include <pthread.h>
 
 #include "hydrogen/config.h"
@@ -36,6 +36,11 @@ namespace H2Core {
 
 /**
  * Class for writing logs to the console
+ *
+ * Messages are stored as fixed size records into a preallocated ring buffer,
+ * which can be written from any thread without locking nor allocating.
+ * Formatting and output are done by the logger thread only.
+ * If the ring is full, the message is dropped and accounted in dropped().
  */
 class Logger {
 	public:
@@ -50,8 +55,43 @@ class Logger {
 			AELockTracing   = 0x20
 		};
 
-		/** mesage queue type */
-		typedef std::list<QString> queue_t;
+		static const unsigned ring_size = 4096; ///< number of records of the ring, must be a power of 2
+		static const unsigned msg_size = 256;   ///< size of the inline message buffer of a record
+		static const unsigned max_args = 4;     ///< max number of arguments of a deferred message
+
+		/** an argument of a deferred message, formatted by the logger thread */
+		struct arg_t {
+			enum { Int, UInt, Double, String } type;
+			union {
+				long long i;
+				unsigned long long u;
+				double d;
+				const char* s;          ///< must point to static storage
+			};
+			arg_t()                         : type( Int ), i( 0 ) {}
+			arg_t( int v )                  : type( Int ), i( v ) {}
+			arg_t( long v )                 : type( Int ), i( v ) {}
+			arg_t( long long v )            : type( Int ), i( v ) {}
+			arg_t( unsigned v )             : type( UInt ), u( v ) {}
+			arg_t( unsigned long v )        : type( UInt ), u( v ) {}
+			arg_t( unsigned long long v )   : type( UInt ), u( v ) {}
+			arg_t( float v )                : type( Double ), d( v ) {}
+			arg_t( double v )               : type( Double ), d( v ) {}
+			arg_t( const char* v )          : type( String ), s( v ) {}
+		};
+
+		/** a log record slot of the ring buffer */
+		struct record_t {
+			std::atomic<unsigned> seq;      ///< sequence number used to hand the slot over between producers and consumer
+			unsigned level;                 ///< the log level
+			const char* class_name;         ///< the calling class name, static storage
+			const char* func_name;          ///< the calling function name, static storage
+			const char* fmt;                ///< deferred format string ( "%1 %2" ), static storage, 0 if msg is used
+			unsigned nargs;                 ///< number of arguments of the deferred format string
+			arg_t args[max_args];           ///< arguments of the deferred format string
+			char* long_msg;                 ///< heap copy of a message exceeding msg_size, 0 otherwise
+			char msg[msg_size];             ///< utf8 message
+		};
 
 		/**
 		 * create the logger instance if not exists, set the log level and return the instance
@@ -71,6 +111,11 @@ class Logger {
 		 * \param lvl the level to check
 		 */
 		bool should_log( unsigned lvl ) const       { return (lvl&__bit_msk); }
+		/**
+		 * return true if the level is set in the bitmask, usable without an instance
+		 * \param lvl the level to check
+		 */
+		static bool should_log_static( unsigned lvl ) { return (lvl&__bit_msk); }
 		/**
 		 * set the bitmask
 		 * \param msk the new bitmask to set
@@ -99,7 +144,26 @@ class Logger {
 		 * \param func_name the name of the calling function/method
 		 * \param msg the message to log
 		 */
-		void log( unsigned level, const QString& class_name, const char* func_name, const QString& msg );
+		void log( unsigned level, const char* class_name, const char* func_name, const QString& msg );
+		/**
+		 * the realtime safe log function, neither locks nor allocates.
+		 * the message is built by the logger thread using QString::arg().
+		 * \param level used to output the corresponding level string
+		 * \param class_name the name of the calling class
+		 * \param func_name the name of the calling function/method
+		 * \param fmt a string literal using %1 .. %4 placeholders
+		 * \param args up to max_args integers, floating point numbers or string literals
+		 */
+		template<typename... Args>
+		void log_fmt( unsigned level, const char* class_name, const char* func_name, const char* fmt, Args... args ) {
+			static_assert( sizeof...( Args ) <= max_args, "too many log arguments" );
+			const arg_t a[ sizeof...( Args ) + 1 ] = { arg_t( args )..., arg_t() };
+			push_fmt( level, class_name, func_name, fmt, sizeof...( Args ), a );
+		}
+		/** return the logger thread */
+		pthread_t thread() const;
+		/** return the number of messages dropped because the ring was full */
+		unsigned dropped() const                    { return __dropped.load( std::memory_order_relaxed ); }
 		/**
 		 * needed for beeing able to access logger internal
 		 * \param param is a pointer to the logger instance
@@ -109,15 +173,42 @@ class Logger {
 	private:
 		static Logger* __instance;      ///< logger private static instance
 		bool __use_file;                ///< write log to file if set to true
-		bool __running;                 ///< set to true when the logger thread is running
-		pthread_mutex_t __mutex;        ///< lock for adding or removing elements only
-		queue_t __msg_queue;            ///< the message queue
+		std::atomic<bool> __running;    ///< set to true when the logger thread is running
+		std::atomic<bool> __waiting;    ///< set to true when the logger thread waits for records
+		std::atomic<unsigned> __dropped;        ///< number of messages dropped because the ring was full
+		std::atomic<unsigned> __write_pos;      ///< next ring position to be claimed by a producer
+		unsigned __read_pos;            ///< next ring position to be read by the logger thread
+		record_t* __ring;               ///< the preallocated records
+		int __wakeup_fd;                ///< eventfd used to wake up the logger thread, -1 if not available
+		pthread_mutex_t __mutex;        ///< condition variable mutex, used when no eventfd is available
+		pthread_cond_t __cond;          ///< condition variable, used when no eventfd is available
 		static unsigned __bit_msk;      ///< the bitmask of log_level_t
 		static const char* __levels[];  ///< levels strings
 
 		/** constructor */
 		Logger();
 
+		/**
+		 * claim a free record of the ring, return 0 if the ring is full
+		 * \param pos will be set to the claimed position
+		 */
+		record_t* claim( unsigned& pos );
+		/**
+		 * hand a filled record over to the logger thread
+		 * \param rec the record returned by claim()
+		 * \param pos the position returned by claim()
+		 */
+		void commit( record_t* rec, unsigned pos );
+		/** wake the logger thread up if it waits for records */
+		void wakeup();
+		/** push a deferred message, see log_fmt() */
+		void push_fmt( unsigned level, const char* class_name, const char* func_name, const char* fmt, unsigned nargs, const arg_t* args );
+		/**
+		 * pop the next committed record and format it, return false if the ring is empty
+		 * \param out the formatted line
+		 */
+		bool pop( QString& out );
+
 #ifndef HAVE_SSCANF
 		/**
 		 * convert an hex string to an integer.
@@ -0,0 +1,187 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_METER_BUS_H
+#define H2C_METER_BUS_H
+
+#include <hydrogen/object.h>
+#include <atomic>
+
+#define METER_HISTORY_SIZE 64
+
+namespace H2Core
+{
+
+class Song;
+
+/**
+ * Accumulated levels of a stereo signal, owned by the audio thread.
+ * Peaks are absolute sample values, rms is accumulated as a sum of squares.
+ */
+struct MeterAccumulator
+{
+	float peak_l;
+	float peak_r;
+	float true_peak_l;
+	float true_peak_r;
+	double sum_sq_l;
+	double sum_sq_r;
+	unsigned frames;
+
+	MeterAccumulator() { reset(); }
+	void reset();
+	/** merge the levels of another accumulator into this one */
+	void merge( const MeterAccumulator& other );
+	/**
+	 * add a voice to the levels. Voices are metered separately and
+	 * summed up, the rms ignores the correlation between them.
+	 * frames is left untouched, the block length is set by the bus.
+	 */
+	void add_voice( float fPeak_L, float fPeak_R, double fSumSq_L, double fSumSq_R );
+};
+
+/** levels of a stereo signal as published to the clients, linear values */
+struct Meter
+{
+	float peak_l;
+	float peak_r;
+	float rms_l;
+	float rms_r;
+	float true_peak_l;          ///< inter-sample peak estimate, 4x oversampled
+	float true_peak_r;
+};
+
+/** a consistent view of all the engine levels */
+struct MeterSnapshot
+{
+	unsigned serial;                                        ///< increased on each publication
+	Meter master;
+	Meter fx[ MAX_FX ];                                     ///< LADSPA FX returns
+	Meter playback_track;
+	int instruments;                                        ///< number of valid instrument meters
+	Meter instrument[ MAX_INSTRUMENTS ];                    ///< indexed as the song instrument list
+	int components;                                         ///< number of valid component meters
+	int component_id[ MAX_COMPONENTS ];                     ///< drumkit component ids
+	Meter component[ MAX_COMPONENTS ];                      ///< indexed as the song component list
+	int history_pos;                                        ///< position of the current entry of the histories
+	float component_history[ MAX_COMPONENTS ][ METER_HISTORY_SIZE ];   ///< peaks of each component, one entry every 50 ms
+	float master_history[ METER_HISTORY_SIZE ];             ///< peaks of the master, one entry every 50 ms
+};
+
+/**
+ * Metering bus, computes block-wise peak, rms and true peak levels in the
+ * audio thread and publishes them through a triple buffer.
+ *
+ * The audio thread never locks, clients never touch engine objects.
+ * Levels keep on accumulating until a client has read them, so no peak
+ * is lost between two reads of the busiest client.
+ */
+class MeterBus : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	static void create_instance();
+	static MeterBus* get_instance() { assert( __instance ); return __instance; }
+	~MeterBus();
+
+	/**
+	 * meter the output of a LADSPA FX, audio thread only
+	 * \param nFX the FX slot
+	 * \param pBuf_L left buffer
+	 * \param pBuf_R right buffer
+	 * \param nFrames number of frames
+	 */
+	void process_fx( int nFX, const float* pBuf_L, const float* pBuf_R, unsigned nFrames );
+	/**
+	 * meter the master, components and instruments, then publish, audio thread only
+	 * \param pSong the current song
+	 * \param pMain_L left master buffer
+	 * \param pMain_R right master buffer
+	 * \param nFrames number of frames
+	 * \param nSampleRate the sample rate, used to pace the histories
+	 */
+	void process( Song* pSong, const float* pMain_L, const float* pMain_R, unsigned nFrames, unsigned nSampleRate );
+	/** drop all accumulated levels, audio thread only (or with the audio engine locked) */
+	void reset();
+
+	/**
+	 * copy the latest published levels, any thread but the audio one.
+	 * Each client keeps its own snapshot, it is left untouched if it
+	 * already holds the latest levels.
+	 * \param out the snapshot to fill, zero its serial before the first call
+	 * \return false if nothing has been published since out was filled
+	 */
+	bool get_snapshot( MeterSnapshot& out );
+
+	/**
+	 * compute the peak and the sum of squares of a buffer
+	 * \param pBuf the buffer
+	 * \param nFrames number of frames
+	 * \param fPeak will be set to the absolute peak value
+	 * \param fSumSq will be set to the sum of squares
+	 */
+	static void reduce( const float* pBuf, unsigned nFrames, float& fPeak, double& fSumSq );
+
+private:
+	MeterBus();
+	static MeterBus* __instance;
+
+	/** 4x oversampled inter-sample peak detector state of a channel */
+	struct TruePeak {
+		float x[3];             ///< last samples of the previous block
+		TruePeak() { x[0] = x[1] = x[2] = 0.0f; }
+		float process( const float* pBuf, unsigned nFrames );
+	};
+
+	/** meter a stereo buffer into an accumulator, return the peak of the buffer */
+	static float meter( MeterAccumulator& acc, TruePeak* pTruePeak, const float* pBuf_L, const float* pBuf_R, unsigned nFrames );
+	/** convert an accumulator to published levels */
+	static void to_meter( const MeterAccumulator& acc, Meter& out );
+
+	MeterAccumulator __master;
+	TruePeak __master_tp[2];
+	MeterAccumulator __fx[ MAX_FX ];
+	TruePeak __fx_tp[ MAX_FX ][2];
+	MeterAccumulator __playback;
+	MeterAccumulator* __instruments;                    ///< MAX_INSTRUMENTS accumulators
+	MeterAccumulator __components[ MAX_COMPONENTS ];
+	TruePeak __components_tp[ MAX_COMPONENTS ][2];
+	float __component_history[ MAX_COMPONENTS ][ METER_HISTORY_SIZE ];
+	float __master_history[ METER_HISTORY_SIZE ];
+	unsigned __history_frames;              ///< frames accumulated in the current history entry
+
+	/** triple buffer: the writer owns one buffer, the reader one, the third is exchanged */
+	MeterSnapshot* __buffers[3];
+	int __back;                             ///< buffer owned by the audio thread
+	int __front;                            ///< buffer owned by the readers
+	std::atomic<int> __middle;              ///< exchanged buffer index, __new_data bit set when published
+	static const int __new_data = 4;
+	unsigned __serial;
+	int __history_pos;
+	QMutex __reader_mutex;                  ///< serializes the readers only
+};
+
+};
+
+#endif // H2C_METER_BUS_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -109,9 +109,13 @@ class Object {
 #define __LOG_METHOD(   lvl, msg )  if( __logger->should_log( (lvl) ) )                 { __logger->log( (lvl), class_name(), __FUNCTION__, msg ); }
 #define __LOG_CLASS(    lvl, msg )  if( logger()->should_log( (lvl) ) )                 { logger()->log( (lvl), class_name(), __FUNCTION__, msg ); }
 #define __LOG_OBJ(      lvl, msg )  if( __object->logger()->should_log( (lvl) ) )       { __object->logger()->log( (lvl), 0, __PRETTY_FUNCTION__, msg ); }
-#define __LOG_STATIC(   lvl, msg )  if( H2Core::Logger::get_instance()->should_log( (lvl) ) )   { H2Core::Logger::get_instance()->log( (lvl), 0, __PRETTY_FUNCTION__, msg ); }
+#define __LOG_STATIC(   lvl, msg )  if( H2Core::Logger::should_log_static( (lvl) ) )    { H2Core::Logger::get_instance()->log( (lvl), 0, __PRETTY_FUNCTION__, msg ); }
 #define __LOG( logger,  lvl, msg )  if( (logger)->should_log( (lvl) ) )                 { (logger)->log( (lvl), 0, 0, msg ); }
 
+// realtime safe LOG MACROS, the message is formatted by the logger thread : INFOLOG_RT( "value %1", nValue )
+#define __LOG_METHOD_RT( lvl, ... ) if( __logger->should_log( (lvl) ) )                { __logger->log_fmt( (lvl), class_name(), __FUNCTION__, __VA_ARGS__ ); }
+#define __LOG_STATIC_RT( lvl, ... ) if( H2Core::Logger::should_log_static( (lvl) ) )   { H2Core::Logger::get_instance()->log_fmt( (lvl), 0, __PRETTY_FUNCTION__, __VA_ARGS__ ); }
+
 // Object instance method logging macros
 #define DEBUGLOG(x)     __LOG_METHOD( H2Core::Logger::Debug,   (x) );
 #define INFOLOG(x)      __LOG_METHOD( H2Core::Logger::Info,    (x) );
@@ -136,6 +140,18 @@ class Object {
 #define ___WARNINGLOG(x) __LOG_STATIC(H2Core::Logger::Warning,  (x) );
 #define ___ERRORLOG(x)  __LOG_STATIC( H2Core::Logger::Error,    (x) );
 
+// realtime safe Object instance method logging macros
+#define DEBUGLOG_RT(...)    __LOG_METHOD_RT( H2Core::Logger::Debug,   __VA_ARGS__ );
+#define INFOLOG_RT(...)     __LOG_METHOD_RT( H2Core::Logger::Info,    __VA_ARGS__ );
+#define WARNINGLOG_RT(...)  __LOG_METHOD_RT( H2Core::Logger::Warning, __VA_ARGS__ );
+#define ERRORLOG_RT(...)    __LOG_METHOD_RT( H2Core::Logger::Error,   __VA_ARGS__ );
+
+// realtime safe static logging macros
+#define ___DEBUGLOG_RT(...)   __LOG_STATIC_RT( H2Core::Logger::Debug,   __VA_ARGS__ );
+#define ___INFOLOG_RT(...)    __LOG_STATIC_RT( H2Core::Logger::Info,    __VA_ARGS__ );
+#define ___WARNINGLOG_RT(...) __LOG_STATIC_RT( H2Core::Logger::Warning, __VA_ARGS__ );
+#define ___ERRORLOG_RT(...)   __LOG_STATIC_RT( H2Core::Logger::Error,   __VA_ARGS__ );
+
 };
 
 #endif // H2C_OBJECT_H
@@ -114,6 +114,8 @@ class OscServer : public H2Core::Object
 		static void SELECT_INSTRUMENT_Handler(lo_arg **argv, int i);
 		static void UNDO_ACTION_Handler(lo_arg **argv, int i);
 		static void REDO_ACTION_Handler(lo_arg **argv, int i);
+		static void ENGINE_PROFILE_Handler(lo_address source);
+		static void ENGINE_PROFILE_RESET_Handler(lo_arg **argv, int i);
 		static int  generic_handler(const char *path, const char *types, lo_arg ** argv,
 								int argc, void *data, void *user_data);
 
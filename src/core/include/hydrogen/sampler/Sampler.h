@@ -27,9 +27,14 @@
 #include <hydrogen/object.h>
 #include <hydrogen/globals.h>
 
+#include <atomic>
 #include <inttypes.h>
 #include <vector>
 
+/* time constant of the smoothing of the control changes, in seconds */
+#define SAMPLER_SMOOTHING_TIME 0.01f
+/* notes queue_note_on() can hold between two process cycles */
+#define SAMPLER_MAX_QUEUED_NOTES 64
 
 namespace H2Core
 {
@@ -60,6 +65,12 @@ public:
 
 	/// Start playing a note
 	void note_on( Note *note );
+	/**
+	 * Start playing a note from another thread than the audio thread,
+	 * without the engine lock. The note starts with the next process
+	 * cycle, it is deleted if SAMPLER_MAX_QUEUED_NOTES are waiting.
+	 */
+	void queue_note_on( Note *note );
 
 	/// Stop playing a note.
 	void note_off( Note *note );
@@ -77,6 +88,14 @@ public:
 	void setPlayingNotelength( Instrument* instrument, unsigned long ticks, unsigned long noteOnTick );
 	bool is_instrument_playing( Instrument* pInstr );
 
+	/// Evaluate the automation of an instrument for the current block, the first call of the block does it
+	void update_block_params( Instrument* pInstr );
+
+	/// Song volume at the start or at the end of the current block, smoothed as the instrument parameters
+	float get_song_volume( bool bEnd ) const {
+		return __song_volume[ bEnd ? 1 : 0 ];
+	}
+
 		enum InterpolateMode { LINEAR,
 							   COSINE,
 							   THIRD,
@@ -102,15 +121,48 @@ private:
 	std::vector<Note*> __playing_notes_queue;
 	std::vector<Note*> __queuedNoteOffs;
 
+	/// a slot of the queue_note_on() queue, seq tells whether it is free or holds a note
+	struct QueuedNote {
+		std::atomic<unsigned> seq;
+		Note* note;
+	};
+	QueuedNote __queued_notes[ SAMPLER_MAX_QUEUED_NOTES ];
+	std::atomic<unsigned> __queued_notes_write;
+	unsigned __queued_notes_read;				///< audio thread only
+
+	/// start the notes of queue_note_on(), called by process()
+	void start_queued_notes();
+
 
 	int __maxLayers;
 
+	uint64_t __block;				///< number of the current block, counted from 1
+	float __block_start;			///< song position of the block in columns, -1 outside song playback
+	float __block_end;				///< song position after the block
+	float __block_smoothing;		///< part of a control change applied per block
+	float __song_volume[2];			///< smoothed song volume at the start and at the end of the block
+
 	bool processPlaybackTrack(int nBufferSize);
 
 	int __playBackSamplePosition;
 
 	bool __render_note( Note* pNote, unsigned nBufferSize, Song* pSong );
 
+	/** where a voice is mixed to in the current cycle */
+	struct VoiceRouting {
+		float* out_L;					///< main out or instrument insert bus
+		float* out_R;
+		float* compo_L;					///< drumkit component buffer, NULL if the voice feeds an instrument insert
+		float* compo_R;
+		int sends;						///< number of valid send entries
+		float* send_L[ MAX_FX ];		///< send FX buffers
+		float* send_R[ MAX_FX ];
+		float send_cost[ MAX_FX ];		///< send level * FX volume * song volume, at the start of the block
+		float send_step[ MAX_FX ];		///< send cost increment per frame, ramping the automated levels
+	};
+	/** fill the routing of a voice of pNote playing on pDrumCompo */
+	void __route_voice( Note* pNote, DrumkitComponent* pDrumCompo, unsigned nBufferSize, Song* pSong, VoiceRouting& routing );
+
 		InterpolateMode __interpolateMode;
 
 		/*
@@ -223,6 +275,8 @@ private:
 		int nInitialSilence,
 		float cost_L,
 		float cost_R,
+		float cost_step_L,
+		float cost_step_R,
 		float cost_track_L,
 			float cost_track_R,
 		Song* pSong
@@ -238,6 +292,8 @@ private:
 		int nInitialSilence,
 		float cost_L,
 		float cost_R,
+		float cost_step_L,
+		float cost_step_R,
 		float cost_track_L,
 		float cost_track_R,
 			float fLayerPitch,
@@ -73,7 +73,7 @@ class SMF : public SMFBase, public H2Core::Object
 {
 	H2_OBJECT
 public:
-	SMF();
+	SMF( int nFormat = 1 );
 	~SMF();
 
 	void addTrack( SMFTrack *pTrack );
@@ -95,13 +95,64 @@ public:
 	SMFWriter();
 	~SMFWriter();
 
-	void save( const QString& sFilename, Song *pSong );
+	/**
+	 * Export the pattern sequence of a song
+	 * \param sFilename the file to write
+	 * \param pSong the song to export
+	 * \param nFormat 1 writes the tempo map and the notes in two tracks,
+	 * 0 writes everything in a single track
+	 * \return false if the file could not be written
+	 */
+	bool save( const QString& sFilename, Song *pSong, int nFormat = 1 );
 
 private:
 	FILE *m_file;
 
 };
 
+
+
+class SMFReader : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	SMFReader();
+	~SMFReader();
+
+	/**
+	 * Import a standard MIDI file, type 0 or 1, into a song.
+	 * Each track is cut in bars, the distinct bars of a track become
+	 * patterns which are appended to the pattern list and the bars are
+	 * appended to the pattern sequence, one column per bar.
+	 * Notes are mapped on the instruments by their MIDI out note.
+	 * \param sFilename the file to read
+	 * \param pSong the song receiving the patterns
+	 * \return false if the file is not a usable standard MIDI file
+	 */
+	bool load( const QString& sFilename, Song *pSong );
+
+private:
+	/// a note read from a track, in Hydrogen ticks
+	struct NoteEvent {
+		int nTick;
+		int nLength;
+		int nPitch;
+		int nVelocity;
+	};
+
+	/// a track read from the file
+	struct Track {
+		QString sName;
+		std::vector<NoteEvent> notes;
+	};
+
+	int m_nTPQN;			///< ticks per quarter note of the file
+	int m_nBarTicks;		///< length of a bar in Hydrogen ticks, from the first time signature
+
+	bool readTrack( const unsigned char *pData, int nSize, Track& track );
+	int toTicks( long nMidiTicks ) const;
+};
+
 };
 
 #endif
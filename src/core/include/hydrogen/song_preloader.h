@@ -0,0 +1,105 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SONG_PRELOADER_H
+#define H2C_SONG_PRELOADER_H
+
+#include <hydrogen/object.h>
+#include <hydrogen/basics/song.h>
+
+#include <pthread.h>
+
+namespace H2Core
+{
+
+/**
+ * SongPreloader reads the songs of the playlist in a thread of its own,
+ * samples included, so that switching to the next song while playing
+ * doesn't wait for the disk.
+ *
+ * A song asked for with preload() is read in the background and kept until
+ * the playlist takes it. When the song is asked for as the next one to play,
+ * the preloader raises EVENT_PLAYLIST_LOADSONG once it is read. While
+ * playing, Hydrogen::switchSong() then lets the audio thread swap it in at
+ * the next bar.
+ */
+class SongPreloader : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		static void create_instance();
+		static SongPreloader* get_instance() { assert( __instance ); return __instance; }
+		~SongPreloader();
+
+		/**
+		 * read a song of the playlist in the background, the song
+		 * preloaded before is dropped if it is another one
+		 * \param nSongNumber the playlist entry
+		 * \param sFilename the song file of the entry
+		 * \param bSwitch true to switch to the song once read
+		 */
+		void preload( int nSongNumber, const QString& sFilename, bool bSwitch );
+		/**
+		 * take the preloaded song of an entry, never waits for the reading
+		 * \param nSongNumber the playlist entry
+		 * \param sFilename the song file of the entry
+		 * \param ppGlobals set to the global settings of the song, owned by
+		 * the caller
+		 * \param pPending set to true if the caller drops the entry: the
+		 * switch to it was raised but another entry has been asked for
+		 * since, or it is still being read and its switch is raised once it is
+		 * \return the song, owned by the caller, NULL if the entry isn't preloaded
+		 */
+		Song* take( int nSongNumber, const QString& sFilename, SongReader::Globals** ppGlobals, bool* pPending );
+
+	private:
+		static SongPreloader* __instance;
+
+		pthread_t __worker;
+		pthread_mutex_t __mutex;
+		pthread_cond_t __cond;              ///< signaled when a request comes
+		bool __quit;
+
+		int __number;                       ///< the entry requested, -1 if none
+		QString __filename;                 ///< its song file
+		bool __switch;                      ///< switch to it once read
+		Song* __song;                       ///< the song read, NULL while reading
+		SongReader::Globals* __globals;     ///< its global settings
+
+		int __raised;                       ///< the entry the switch was raised for, -1 if none
+		int __superseded;                   ///< an entry whose raised switch was replaced by a new request, -1 if none
+
+		SongPreloader();
+
+		/** drop the song read, the mutex must be held */
+		void drop();
+		/** raise the switch to a song read, the mutex must be held */
+		void switch_to( int nSongNumber );
+		static void* thread_func( void* param );
+		void run();
+};
+
+};
+
+#endif // H2C_SONG_PRELOADER_H
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -27,20 +27,33 @@
 #include <stdint.h> // For uint32_t et al
 
 #include <hydrogen/object.h>
-#include <hydrogen/basics/note.h>
-#include <hydrogen/basics/song.h>
-#include <hydrogen/IO/AudioOutput.h>
 #include <hydrogen/globals.h>
+#include <hydrogen/basics/instrument.h>
+
+/* voices played at once, the oldest one is stolen when they are all busy */
+#define SYNTH_VOICES 64
+/* frames of a wavetable, a power of two */
+#define SYNTH_TABLE_BITS 11
+#define SYNTH_TABLE_SIZE ( 1 << SYNTH_TABLE_BITS )
+/* wavetables per waveform, each one holds half the harmonics of the previous */
+#define SYNTH_TABLE_LEVELS ( SYNTH_TABLE_BITS )
 
 
 namespace H2Core
 {
 
-
-
+class Note;
+class Song;
+class AudioOutput;
 
 ///
-/// A simple synthetizer...
+/// Polyphonic wavetable synthesizer, plays the notes of the instruments
+/// having a synth waveform.
+///
+/// The waveforms are stored as band-limited tables, one per octave of the
+/// phase increment, so that no harmonic of a voice goes above Nyquist.
+/// Each voice has the envelope and the filter of its note, notes without a
+/// length are released at the end of their decay.
 ///
 class Synth : public H2Core::Object
 {
@@ -52,31 +65,53 @@ public:
 	Synth();
 	~Synth();
 
-	/// Start playing a note
-	void noteOn( Note* pNote );
+	/// Start playing a note, the synth owns it unless it is a note off
+	void note_on( Note* pNote );
+
+	/// Release the notes of the instrument of pNote, and delete it
+	void note_off( Note* pNote );
+	void midi_keyboard_note_off( int key );
 
-	/// Stop playing a note.
-	void noteOff( Note* pNote );
+	void stop_playing_notes( Instrument* pInstr = NULL );
 
-	void process( uint32_t nFrames );
-	void setAudioOutput( AudioOutput* pAudioOutput );
+	void process( uint32_t nFrames, Song* pSong );
 
 	int getPlayingNotesNumber() {
-		return m_playingNotesQueue.size();
+		return m_nVoices;
 	}
 
-
 private:
-	std::vector<Note*> m_playingNotesQueue;
-
-	float m_fTheta;
-	AudioOutput *m_pAudioOutput;
-
-
+	struct Voice {
+		Note* pNote;
+		const float* pTable;		///< wavetable of the waveform and the pitch
+		uint32_t nPhase;			///< position in the table, the table index in the upper bits
+		uint32_t nStep;				///< phase increment per frame, 0 until the voice starts
+		int nPlayed;				///< frames rendered
+		int nLength;				///< frames played before the release
+		float fBpfb;				///< band pass filter buffer
+		float fLpfb;				///< low pass filter buffer
+	};
+
+	/// voices are kept packed, in the order they started
+	Voice m_voices[ SYNTH_VOICES ];
+	int m_nVoices;
+
+	/// band-limited tables, [waveform][level][SYNTH_TABLE_SIZE + 1]
+	float* m_pTables;
+	/// per block scratch buffers, oscillator and envelope
+	float* m_pOsc;
+	float* m_pEnv;
+
+	void build_tables();
+	const float* get_table( Instrument::SynthWaveform waveform, float fIncrement ) const;
+	void start_voice( Voice* pVoice, unsigned nSampleRate );
+	void remove_voice( int nVoice );
+
+	/// Render a voice, return true once it is over
+	bool render_voice( Voice* pVoice, uint32_t nFrames, uint32_t nFramepos, AudioOutput* pAudioOutput, Song* pSong );
 };
 
 } // namespace H2Core
 
 #endif
 
-
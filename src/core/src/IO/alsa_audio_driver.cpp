@@ -26,7 +26,10 @@
 
 #include <pthread.h>
 #include <iostream>
+#include <cmath>
+#include <cstring>
 #include <hydrogen/Preferences.h>
+#include <hydrogen/engine_profiler.h>
 
 namespace H2Core
 {
@@ -55,15 +58,7 @@ void* alsaAudioDriver_processCaller( void* param )
 	Object *__object = (Object*)param;
 	AlsaAudioDriver *pDriver = ( AlsaAudioDriver* )param;
 
-	// stolen from amSynth
-	struct sched_param sched;
-	sched.sched_priority = 50;
-	int res = sched_setscheduler( 0, SCHED_FIFO, &sched );
-	sched_getparam( 0, &sched );
-	if ( res ) {
-		__ERRORLOG( "Can't set realtime scheduling for ALSA Driver" );
-	}
-	__INFOLOG( QString( "Scheduling priority = %1" ).arg( sched.sched_priority ) );
+	Preferences::get_instance()->applyThreadPolicy( Preferences::THREAD_AUDIO, pthread_self() );
 
 	sleep( 1 );
 
@@ -72,40 +67,66 @@ void* alsaAudioDriver_processCaller( void* param )
 		__ERRORLOG( QString( "Cannot prepare audio interface for use: %1" ).arg( snd_strerror ( err ) ) );
 	}
 
-	int nFrames = pDriver->m_nBufferSize;
-// 	_INFOLOG( "nFrames: " + to_string( nFrames ) );
-	short pBuffer[ nFrames * 2 ];
-
-	float *pOut_L = pDriver->m_pOut_L;
-	float *pOut_R = pDriver->m_pOut_R;
-
 	while ( pDriver->m_bIsRunning ) {
 		// prepare the audio data
-		pDriver->m_processCallback( nFrames, NULL );
+		pDriver->m_processCallback( pDriver->m_nBufferSize, NULL );
 
-		for ( int i = 0; i < nFrames; ++i ) {
-			pBuffer[ i * 2 ] = ( short )( pOut_L[ i ] * 32768.0 );
-			pBuffer[ i * 2 + 1 ] = ( short )( pOut_R[ i ] * 32768.0 );
+		if ( !pDriver->writePeriod() ) {
+			__ERRORLOG( "Can't recovery from XRUN" );
 		}
+	}
+	return 0;
+}
 
-		if ( ( err = snd_pcm_writei( pDriver->m_pPlayback_handle, pBuffer, nFrames ) ) < 0 ) {
-			__ERRORLOG( "XRUN" );
-
-			if ( alsa_xrun_recovery( pDriver->m_pPlayback_handle, err ) < 0 ) {
-				__ERRORLOG( "Can't recovery from XRUN" );
-			}
-			// retry
-			if ( ( err = snd_pcm_writei( pDriver->m_pPlayback_handle, pBuffer, nFrames ) ) < 0 ) {
-				__ERRORLOG( "XRUN 2" );
-				if ( alsa_xrun_recovery( pDriver->m_pPlayback_handle, err ) < 0 ) {
-					__ERRORLOG( "Can't recovery from XRUN" );
-				}
-			}
+static inline float alsa_clip( float fValue )
+{
+	return fValue > 1.0f ? 1.0f : ( fValue < -1.0f ? -1.0f : fValue );
+}
 
-			pDriver->m_nXRuns++;
+/**
+ * convert a channel to the device format
+ * \param format the sample format
+ * \param pIn the engine output
+ * \param pOut the first sample of the channel in the device buffer
+ * \param nStep bytes between two samples of the channel
+ * \param nFrames number of frames
+ * \param nSeed state of the dither generator
+ */
+static void alsa_convert( snd_pcm_format_t format, const float* pIn, char* pOut, unsigned nStep, unsigned nFrames, uint32_t& nSeed )
+{
+	switch ( format ) {
+	case SND_PCM_FORMAT_FLOAT:
+		for ( unsigned i = 0; i < nFrames; ++i, pOut += nStep ) {
+			memcpy( pOut, &pIn[ i ], sizeof( float ) );
+		}
+		break;
+	case SND_PCM_FORMAT_S32:
+		for ( unsigned i = 0; i < nFrames; ++i, pOut += nStep ) {
+			int32_t nValue = ( int32_t )( alsa_clip( pIn[ i ] ) * 2147483647.0 );
+			memcpy( pOut, &nValue, sizeof( int32_t ) );
+		}
+		break;
+	case SND_PCM_FORMAT_S24_3LE:
+		for ( unsigned i = 0; i < nFrames; ++i, pOut += nStep ) {
+			int32_t nValue = ( int32_t )( alsa_clip( pIn[ i ] ) * 8388607.0f );
+			pOut[ 0 ] = nValue & 0xff;
+			pOut[ 1 ] = ( nValue >> 8 ) & 0xff;
+			pOut[ 2 ] = ( nValue >> 16 ) & 0xff;
+		}
+		break;
+	default:
+		// S16, with a triangular dither of one LSB
+		for ( unsigned i = 0; i < nFrames; ++i, pOut += nStep ) {
+			nSeed = nSeed * 1664525 + 1013904223;
+			float fDither = ( nSeed >> 8 ) * ( 1.0f / 16777216.0f );
+			nSeed = nSeed * 1664525 + 1013904223;
+			fDither -= ( nSeed >> 8 ) * ( 1.0f / 16777216.0f );
+			int nValue = ( int )lrintf( pIn[ i ] * 32767.0f + fDither );
+			int16_t nSample = nValue > 32767 ? 32767 : ( nValue < -32768 ? -32768 : nValue );
+			memcpy( pOut, &nSample, sizeof( int16_t ) );
 		}
+		break;
 	}
-	return 0;
 }
 
 
@@ -118,18 +139,24 @@ AlsaAudioDriver::AlsaAudioDriver( audioProcessCallback processCallback )
 		, m_pOut_R( NULL )
 		, m_nXRuns( 0 )
 		, m_nBufferSize( 0 )
+		, m_nPeriods( 2 )
+		, m_format( SND_PCM_FORMAT_S16 )
+		, m_bMmap( false )
+		, m_pBuffer( NULL )
+		, m_nDitherSeed( 22222 )
 		, m_pPlayback_handle( NULL )
 		, m_processCallback( processCallback )
 {
 	INFOLOG( "INIT" );
 	m_nSampleRate = Preferences::get_instance()->m_nSampleRate;
 	m_sAlsaAudioDevice = Preferences::get_instance()->m_sAlsaAudioDevice;
+	m_nPeriods = Preferences::get_instance()->m_nAlsaPeriods;
 }
 
 AlsaAudioDriver::~AlsaAudioDriver()
 {
 	if ( m_nXRuns > 0 ) {
-		WARNINGLOG( QString( "%1 xruns" ).arg( m_nXRuns ) );
+		WARNINGLOG( QString( "%1 xruns with %2 periods of %3 frames" ).arg( m_nXRuns ).arg( m_nPeriods ).arg( m_nBufferSize ) );
 	}
 	INFOLOG( "DESTROY" );
 }
@@ -148,7 +175,7 @@ int AlsaAudioDriver::connect()
 {
 	INFOLOG( "alsa device: " + m_sAlsaAudioDevice );
 	int nChannels = 2;
-	int period_size = m_nBufferSize / 2;
+	snd_pcm_uframes_t period_size = m_nBufferSize;
 
 	int err;
 
@@ -183,14 +210,26 @@ int AlsaAudioDriver::connect()
 		ERRORLOG( QString( "error in snd_pcm_hw_params_any: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
 		return 1;
 	}
-//	snd_pcm_hw_params_set_access( m_pPlayback_handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED  );
-
-	if ( ( err = snd_pcm_hw_params_set_access( m_pPlayback_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED ) ) < 0 ) {
-		ERRORLOG( QString( "error in snd_pcm_hw_params_set_access: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
-		return 1;
+	// mmap saves a copy, fall back to snd_pcm_writei for the devices without it
+	m_bMmap = true;
+	if ( ( err = snd_pcm_hw_params_set_access( m_pPlayback_handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED ) ) < 0 ) {
+		m_bMmap = false;
+		if ( ( err = snd_pcm_hw_params_set_access( m_pPlayback_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED ) ) < 0 ) {
+			ERRORLOG( QString( "error in snd_pcm_hw_params_set_access: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
+			return 1;
+		}
 	}
 
-	if ( ( err = snd_pcm_hw_params_set_format( m_pPlayback_handle, hw_params, SND_PCM_FORMAT_S16_LE ) ) < 0 ) {
+	// the native format of the card, from the most to the least accurate one
+	const snd_pcm_format_t formats[] = { SND_PCM_FORMAT_FLOAT, SND_PCM_FORMAT_S32, SND_PCM_FORMAT_S24_3LE, SND_PCM_FORMAT_S16 };
+	err = -EINVAL;
+	for ( unsigned i = 0; i < sizeof( formats ) / sizeof( formats[0] ) && err < 0; ++i ) {
+		if ( snd_pcm_hw_params_test_format( m_pPlayback_handle, hw_params, formats[ i ] ) == 0 ) {
+			m_format = formats[ i ];
+			err = snd_pcm_hw_params_set_format( m_pPlayback_handle, hw_params, m_format );
+		}
+	}
+	if ( err < 0 ) {
 		ERRORLOG( QString( "error in snd_pcm_hw_params_set_format: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
 		return 1;
 	}
@@ -202,42 +241,45 @@ int AlsaAudioDriver::connect()
 		return 1;
 	}
 
-	unsigned nPeriods = 2;
-	if ( ( err = snd_pcm_hw_params_set_periods_near( m_pPlayback_handle, hw_params, &nPeriods, 0 ) ) < 0 ) {
-		ERRORLOG( QString( "error in snd_pcm_hw_params_set_periods: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
-		return 1;
-	}
-	INFOLOG( QString( "nPeriods: %1" ).arg( nPeriods ) );
-
-	// Set buffer size (in frames). The resulting latency is given by
-	// latency = periodsize * periods / (rate * bytes_per_frame)
-//	m_nBufferSize = period_size * 2;
-//	infoLog( "buffer size preferita:" + to_string( m_nBufferSize ) );
-
-//	if ( ( err = snd_pcm_hw_params_set_buffer_size_near( m_pPlayback_handle, hw_params, &m_nBufferSize ) ) < 0 ) {
-//		errorLog( "[connect] error in snd_pcm_hw_params_set_buffer_size: " + string( QString::fromLocal8Bit(snd_strerror(err)) ) );
-//		return 1;
-//	}
-//	infoLog( "buffer size scelta:" + to_string( m_nBufferSize ) );
-
-	if ( ( err = snd_pcm_hw_params_set_period_size( m_pPlayback_handle, hw_params, period_size, 0 ) ) < 0 ) {
+	// The resulting latency is given by
+	// latency = periodsize * periods / rate
+	if ( ( err = snd_pcm_hw_params_set_period_size_near( m_pPlayback_handle, hw_params, &period_size, 0 ) ) < 0 ) {
 		ERRORLOG( QString( "error in snd_pcm_hw_params_set_period_size: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
 	}
 
+	if ( ( err = snd_pcm_hw_params_set_periods_near( m_pPlayback_handle, hw_params, &m_nPeriods, 0 ) ) < 0 ) {
+		ERRORLOG( QString( "error in snd_pcm_hw_params_set_periods: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
+		return 1;
+	}
 
 	if ( ( err = snd_pcm_hw_params( m_pPlayback_handle, hw_params ) ) < 0 ) {
 		ERRORLOG( QString( "error in snd_pcm_hw_params: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
 		return 1;
 	}
 
+	snd_pcm_uframes_t buffer_size;
 	snd_pcm_hw_params_get_rate( hw_params, &m_nSampleRate, 0 );
-	snd_pcm_hw_params_get_buffer_size( hw_params, &m_nBufferSize );
+	snd_pcm_hw_params_get_period_size( hw_params, &period_size, 0 );
+	snd_pcm_hw_params_get_periods( hw_params, &m_nPeriods, 0 );
+	snd_pcm_hw_params_get_buffer_size( hw_params, &buffer_size );
+	m_nBufferSize = period_size;
+
+	// start once the whole buffer is filled, wake up for each period
+	snd_pcm_sw_params_t *sw_params;
+	snd_pcm_sw_params_alloca( &sw_params );
+	if ( ( err = snd_pcm_sw_params_current( m_pPlayback_handle, sw_params ) ) < 0
+		 || ( err = snd_pcm_sw_params_set_start_threshold( m_pPlayback_handle, sw_params, buffer_size ) ) < 0
+		 || ( err = snd_pcm_sw_params_set_avail_min( m_pPlayback_handle, sw_params, period_size ) ) < 0
+		 || ( err = snd_pcm_sw_params( m_pPlayback_handle, sw_params ) ) < 0 ) {
+		ERRORLOG( QString( "error in snd_pcm_sw_params: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
+		return 1;
+	}
 
-	INFOLOG( QString( "*** PERIOD SIZE: %1" ).arg( period_size ) );
+	INFOLOG( QString( "*** FORMAT: %1 (%2)" ).arg( snd_pcm_format_name( m_format ) ).arg( m_bMmap ? "mmap" : "rw" ) );
+	INFOLOG( QString( "*** PERIOD SIZE: %1" ).arg( m_nBufferSize ) );
+	INFOLOG( QString( "*** PERIODS: %1" ).arg( m_nPeriods ) );
 	INFOLOG( QString( "*** SAMPLE RATE: %1" ).arg( m_nSampleRate ) );
-	INFOLOG( QString( "*** BUFFER SIZE: %1" ).arg( m_nBufferSize ) );
-
-	//snd_pcm_hw_params_free( hw_params );
+	INFOLOG( QString( "*** BUFFER SIZE: %1" ).arg( buffer_size ) );
 
 	m_pOut_L = new float[ m_nBufferSize ];
 	m_pOut_R = new float[ m_nBufferSize ];
@@ -245,6 +287,10 @@ int AlsaAudioDriver::connect()
 	memset( m_pOut_L, 0, m_nBufferSize * sizeof( float ) );
 	memset( m_pOut_R, 0, m_nBufferSize * sizeof( float ) );
 
+	if ( !m_bMmap ) {
+		m_pBuffer = new char[ snd_pcm_frames_to_bytes( m_pPlayback_handle, m_nBufferSize ) ];
+	}
+
 	m_bIsRunning = true;
 
 	// start the main thread
@@ -273,6 +319,88 @@ void AlsaAudioDriver::disconnect()
 
 	delete[] m_pOut_R;
 	m_pOut_R = NULL;
+
+	delete[] m_pBuffer;
+	m_pBuffer = NULL;
+}
+
+bool AlsaAudioDriver::writePeriod()
+{
+	return m_bMmap ? writeMmap( m_nBufferSize ) : writeRW( m_nBufferSize );
+}
+
+bool AlsaAudioDriver::writeMmap( unsigned nFrames )
+{
+	unsigned nDone = 0;
+	while ( nDone < nFrames && m_bIsRunning ) {
+		snd_pcm_sframes_t nAvail = snd_pcm_avail_update( m_pPlayback_handle );
+		if ( nAvail < 0 ) {
+			if ( !recover( nAvail ) ) return false;
+			continue;
+		}
+		if ( ( snd_pcm_uframes_t )nAvail < nFrames - nDone ) {
+			if ( snd_pcm_state( m_pPlayback_handle ) == SND_PCM_STATE_PREPARED ) {
+				snd_pcm_start( m_pPlayback_handle );
+			}
+			int err = snd_pcm_wait( m_pPlayback_handle, 1000 );
+			if ( err < 0 && !recover( err ) ) return false;
+			continue;
+		}
+
+		const snd_pcm_channel_area_t *areas;
+		snd_pcm_uframes_t offset;
+		snd_pcm_uframes_t frames = nFrames - nDone;
+		int err = snd_pcm_mmap_begin( m_pPlayback_handle, &areas, &offset, &frames );
+		if ( err < 0 ) {
+			if ( !recover( err ) ) return false;
+			continue;
+		}
+
+		// the engine output is converted straight into the device buffer
+		const float* pOut[2] = { m_pOut_L + nDone, m_pOut_R + nDone };
+		for ( int nChannel = 0; nChannel < 2; ++nChannel ) {
+			char* pDest = ( char* )areas[ nChannel ].addr
+					+ ( areas[ nChannel ].first + offset * areas[ nChannel ].step ) / 8;
+			alsa_convert( m_format, pOut[ nChannel ], pDest, areas[ nChannel ].step / 8, frames, m_nDitherSeed );
+		}
+
+		snd_pcm_sframes_t nCommitted = snd_pcm_mmap_commit( m_pPlayback_handle, offset, frames );
+		if ( nCommitted < 0 || ( snd_pcm_uframes_t )nCommitted != frames ) {
+			if ( !recover( nCommitted >= 0 ? -EPIPE : nCommitted ) ) return false;
+			continue;
+		}
+		nDone += frames;
+	}
+	return true;
+}
+
+bool AlsaAudioDriver::writeRW( unsigned nFrames )
+{
+	int nSampleBytes = snd_pcm_format_physical_width( m_format ) / 8;
+	alsa_convert( m_format, m_pOut_L, m_pBuffer, nSampleBytes * 2, nFrames, m_nDitherSeed );
+	alsa_convert( m_format, m_pOut_R, m_pBuffer + nSampleBytes, nSampleBytes * 2, nFrames, m_nDitherSeed );
+
+	unsigned nDone = 0;
+	while ( nDone < nFrames && m_bIsRunning ) {
+		snd_pcm_sframes_t nWritten = snd_pcm_writei( m_pPlayback_handle, m_pBuffer + nDone * nSampleBytes * 2, nFrames - nDone );
+		if ( nWritten < 0 ) {
+			if ( !recover( nWritten ) ) return false;
+			continue;
+		}
+		nDone += nWritten;
+	}
+	return true;
+}
+
+bool AlsaAudioDriver::recover( int err )
+{
+	if ( err == -EAGAIN ) {
+		return true;
+	}
+	ERRORLOG( QString( "XRUN: %1" ).arg( snd_strerror( err ) ) );
+	m_nXRuns++;
+	EngineProfiler::get_instance()->report_xrun();
+	return alsa_xrun_recovery( m_pPlayback_handle, err ) >= 0;
 }
 
 unsigned AlsaAudioDriver::getBufferSize()
@@ -61,6 +61,7 @@ void* alsaMidiDriver_thread( void* param )
 	Object* __object = ( Object* )param;
 	AlsaMidiDriver *pDriver = ( AlsaMidiDriver* )param;
 	__INFOLOG( "starting" );
+	Preferences::get_instance()->applyThreadPolicy( Preferences::THREAD_MIDI_IN, pthread_self() );
 
 	if ( seq_handle != NULL ) {
 		__ERRORLOG( "seq_handle != NULL" );
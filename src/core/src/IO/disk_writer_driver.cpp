@@ -54,6 +54,7 @@ void* diskWriterDriver_thread( void* param )
 {
 	Object* __object = ( Object* )param;	
 	DiskWriterDriver *pDriver = ( DiskWriterDriver* )param;
+	Preferences::get_instance()->applyThreadPolicy( Preferences::THREAD_DISK_WRITER, pthread_self() );
 
 	EventQueue::get_instance()->push_event( EVENT_PROGRESS, 0 );
 	
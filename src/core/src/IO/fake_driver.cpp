@@ -21,6 +21,9 @@
  */
 
 #include <hydrogen/IO/FakeDriver.h>
+#include <hydrogen/Preferences.h>
+
+#include <chrono>
 
 namespace H2Core
 {
@@ -30,9 +33,11 @@ const char* FakeDriver::__class_name = "FakeDiskDriver";
 FakeDriver::FakeDriver( audioProcessCallback processCallback )
 		: AudioOutput( __class_name )
 		, m_processCallback( processCallback )
+		, m_nBufferSize( 0 )
+		, m_nSampleRate( Preferences::get_instance()->m_nSampleRate )
+		, m_nMaxCycles( 0 )
 		, m_pOut_L( NULL )
 		, m_pOut_R( NULL )
-		, m_nBufferSize( 0 )
 {
 	INFOLOG( "INIT" );
 }
@@ -81,7 +86,7 @@ void FakeDriver::disconnect()
 
 unsigned FakeDriver::getSampleRate()
 {
-	return 44100;
+	return m_nSampleRate;
 }
 
 float* FakeDriver::getOut_L()
@@ -100,8 +105,17 @@ void FakeDriver::play()
 {
 	m_transport.m_status = TransportInfo::ROLLING;
 
-	while ( m_processCallback( m_nBufferSize, NULL ) == 0 ) {
-		// process...
+	m_cycleTimes.clear();
+	if ( m_nMaxCycles > 0 ) {
+		m_cycleTimes.reserve( m_nMaxCycles );
+	}
+
+	int nRes = 0;
+	while ( nRes == 0 && ( m_nMaxCycles == 0 || m_cycleTimes.size() < m_nMaxCycles ) ) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		nRes = m_processCallback( m_nBufferSize, NULL );
+		std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+		m_cycleTimes.push_back( std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() );
 	}
 }
 
@@ -39,6 +39,7 @@
 #include <hydrogen/Preferences.h>
 #include <hydrogen/globals.h>
 #include <hydrogen/event_queue.h>
+#include <hydrogen/engine_profiler.h>
 
 #ifdef H2CORE_HAVE_LASH
 #include <hydrogen/LashClient.h>
@@ -71,6 +72,18 @@ int jackDriverBufferSize( jack_nframes_t nframes, void * /*arg*/ )
 	return 0;
 }
 
+int jackDriverXRun( void * /*arg*/ )
+{
+	EngineProfiler::get_instance()->report_xrun();
+	return 0;
+}
+
+void jackDriverThreadInit( void * /*arg*/ )
+{
+	// JACK owns the priority of its threads, only pin it
+	Preferences::get_instance()->applyThreadPolicy( Preferences::THREAD_AUDIO, pthread_self(), false );
+}
+
 void jackDriverShutdown( void *arg )
 {
 	UNUSED( arg );
@@ -96,8 +109,13 @@ JackAudioDriver::JackAudioDriver( JackProcessCallback processCallback )
 	bbt_frame_offset = 0;
 	track_port_count = 0;
 
+	memset( track_maps, -1, sizeof(track_maps) );
+	track_map = track_maps[0];
+	next_track_map_ready = false;
 	memset( track_output_ports_L, 0, sizeof(track_output_ports_L) );
 	memset( track_output_ports_R, 0, sizeof(track_output_ports_R) );
+	memset( track_buffers_L, 0, sizeof(track_buffers_L) );
+	memset( track_buffers_R, 0, sizeof(track_buffers_R) );
 }
 
 JackAudioDriver::~JackAudioDriver()
@@ -125,6 +143,8 @@ int JackAudioDriver::connect()
 
 	memset( track_output_ports_L, 0, sizeof(track_output_ports_L) );
 	memset( track_output_ports_R, 0, sizeof(track_output_ports_R) );
+	memset( track_buffers_L, 0, sizeof(track_buffers_L) );
+	memset( track_buffers_R, 0, sizeof(track_buffers_R) );
 
 #ifdef H2CORE_HAVE_LASH
 	if ( Preferences::get_instance()->useLash() ){
@@ -198,6 +218,8 @@ void JackAudioDriver::deactivate()
 	}
 	memset( track_output_ports_L, 0, sizeof(track_output_ports_L) );
 	memset( track_output_ports_R, 0, sizeof(track_output_ports_R) );
+	memset( track_buffers_L, 0, sizeof(track_buffers_L) );
+	memset( track_buffers_R, 0, sizeof(track_buffers_R) );
 }
 
 unsigned JackAudioDriver::getBufferSize()
@@ -420,7 +442,7 @@ float* JackAudioDriver::getOut_R()
 
 float* JackAudioDriver::getTrackOut_L( unsigned nTrack )
 {
-	if(nTrack > (unsigned)track_port_count ) return 0;
+	if(nTrack >= (unsigned)track_port_count ) return 0;
 	jack_port_t *p = track_output_ports_L[nTrack];
 	jack_default_audio_sample_t* out = 0;
 	if( p ) {
@@ -431,7 +453,7 @@ float* JackAudioDriver::getTrackOut_L( unsigned nTrack )
 
 float* JackAudioDriver::getTrackOut_R( unsigned nTrack )
 {
-	if(nTrack > (unsigned)track_port_count ) return 0;
+	if(nTrack >= (unsigned)track_port_count ) return 0;
 	jack_port_t *p = track_output_ports_R[nTrack];
 	jack_default_audio_sample_t* out = 0;
 	if( p ) {
@@ -440,14 +462,20 @@ float* JackAudioDriver::getTrackOut_R( unsigned nTrack )
 	return out;
 }
 
-float* JackAudioDriver::getTrackOut_L( Instrument * instr, InstrumentComponent * pCompo)
+void JackAudioDriver::clearPerTrackAudioBuffers( uint32_t nFrames )
 {
-	return getTrackOut_L(track_map[instr->get_id()][pCompo->get_drumkit_componentID()]);
-}
-
-float* JackAudioDriver::getTrackOut_R( Instrument * instr, InstrumentComponent * pCompo)
-{
-	return getTrackOut_R(track_map[instr->get_id()][pCompo->get_drumkit_componentID()]);
+	for ( int nTrack = 0; nTrack < track_port_count; ++nTrack ) {
+		float* buf_L = getTrackOut_L( nTrack );
+		float* buf_R = getTrackOut_R( nTrack );
+		if ( buf_L ) {
+			memset( buf_L, 0, nFrames * sizeof( float ) );
+		}
+		if ( buf_R ) {
+			memset( buf_R, 0, nFrames * sizeof( float ) );
+		}
+		track_buffers_L[nTrack] = buf_L;
+		track_buffers_R[nTrack] = buf_R;
+	}
 }
 
 
@@ -585,6 +613,15 @@ int JackAudioDriver::init( unsigned /*nBufferSize*/ )
 	*/
 	jack_set_buffer_size_callback ( m_pClient, jackDriverBufferSize, 0 );
 
+	/* count the xruns of the JACK graph along the engine ones.
+	*/
+	jack_set_xrun_callback ( m_pClient, jackDriverXRun, 0 );
+
+	/* the process thread is created on activation, set its CPU
+	   affinity from inside.
+	*/
+	jack_set_thread_init_callback ( m_pClient, jackDriverThreadInit, 0 );
+
 	/* tell the JACK server to call `jack_shutdown()' if
 	   it ever shuts down, either entirely, or if it
 	   just decides to stop calling us.
@@ -631,6 +668,46 @@ void JackAudioDriver::makeTrackOutputs( Song * pSong )
 		return;
 	///
 
+	next_track_map_ready = false;
+	int nTrackCount = mapTrackOutputs( pSong, track_map );
+
+	// clean up unused ports
+	jack_port_t *p_L, *p_R;
+	for ( int n = nTrackCount; n < track_port_count; n++ ) {
+		p_L = track_output_ports_L[n];
+		p_R = track_output_ports_R[n];
+		track_buffers_L[n] = 0;
+		track_buffers_R[n] = 0;
+		track_output_ports_L[n] = 0;
+		jack_port_unregister( m_pClient, p_L );
+		track_output_ports_R[n] = 0;
+		jack_port_unregister( m_pClient, p_R );
+	}
+
+	track_port_count = nTrackCount;
+}
+
+void JackAudioDriver::prepareTrackOutputs( Song * pSong )
+{
+	if( Preferences::get_instance()->m_bJackTrackOuts == false )
+		return;
+
+	// the audio thread reads the current map until the swap
+	mapTrackOutputs( pSong, track_map == track_maps[0] ? track_maps[1] : track_maps[0] );
+	next_track_map_ready = true;
+}
+
+void JackAudioDriver::swapTrackOutputs()
+{
+	if ( !next_track_map_ready ) {
+		return;
+	}
+	track_map = track_map == track_maps[0] ? track_maps[1] : track_maps[0];
+	next_track_map_ready = false;
+}
+
+int JackAudioDriver::mapTrackOutputs( Song * pSong, int (*map)[MAX_COMPONENTS] )
+{
 	InstrumentList * pInstruments = pSong->get_instrument_list();
 	Instrument * pInstr;
 	int nInstruments = ( int ) pInstruments->size();
@@ -642,7 +719,7 @@ void JackAudioDriver::makeTrackOutputs( Song * pSong )
 
 	for( int i = 0 ; i < MAX_INSTRUMENTS ; i++ ){
 		for ( int j = 0 ; j < MAX_COMPONENTS ; j++ ){
-			track_map[i][j] = 0;
+			map[i][j] = -1;
 		}
 	}
 	
@@ -651,22 +728,12 @@ void JackAudioDriver::makeTrackOutputs( Song * pSong )
 		for (std::vector<InstrumentComponent*>::iterator it = pInstr->get_components()->begin() ; it != pInstr->get_components()->end(); ++it) {
 			InstrumentComponent* pCompo = *it;
 			setTrackOutput( nTrackCount, pInstr , pCompo, pSong);
-			track_map[pInstr->get_id()][pCompo->get_drumkit_componentID()] = nTrackCount;
+			map[pInstr->get_id()][pCompo->get_drumkit_componentID()] = nTrackCount;
 			nTrackCount++;
 		}
 	}
-	// clean up unused ports
-	jack_port_t *p_L, *p_R;
-	for ( int n = nTrackCount; n < track_port_count; n++ ) {
-		p_L = track_output_ports_L[n];
-		p_R = track_output_ports_R[n];
-		track_output_ports_L[n] = 0;
-		jack_port_unregister( m_pClient, p_L );
-		track_output_ports_R[n] = 0;
-		jack_port_unregister( m_pClient, p_R );
-	}
 
-	track_port_count = nTrackCount;
+	return nTrackCount;
 }
 
 /**
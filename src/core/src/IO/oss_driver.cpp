@@ -26,8 +26,13 @@
 #ifdef H2CORE_HAVE_OSS
 
 #include <hydrogen/Preferences.h>
+#include <hydrogen/engine_profiler.h>
 
 #include <pthread.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
 
 namespace H2Core
 {
@@ -43,15 +48,7 @@ unsigned nNextFrames = 0;
 void* ossDriver_processCaller( void* param )
 {
 	Object* __object = ( Object* )param;
-	// stolen from amSynth
-	struct sched_param sched;
-	sched.sched_priority = 50;
-	int res = sched_setscheduler( 0, SCHED_FIFO, &sched );
-	sched_getparam( 0, &sched );
-	if ( res ) {
-		__WARNINGLOG( "Can't set realtime scheduling for OSS Driver" );
-	}
-	__INFOLOG( QString( "Scheduling priority = %1" ).arg( sched.sched_priority ) );
+	Preferences::get_instance()->applyThreadPolicy( Preferences::THREAD_AUDIO, pthread_self() );
 
 	OssDriver *ossDriver = ( OssDriver* )param;
 
@@ -75,6 +72,11 @@ OssDriver::OssDriver( audioProcessCallback processCallback )
 {
 	INFOLOG( "INIT" );
 	audioBuffer = NULL;
+	m_nFormat = AFMT_S16_LE;
+	m_nSampleBytes = 2;
+	m_nSampleRate = Preferences::get_instance()->m_nSampleRate;
+	m_nUnderruns = 0;
+	m_nDitherSeed = 22222;
 	ossDriver_running = false;
 	this->processCallback = processCallback;
 	ossDriver_audioProcessCallback = processCallback;
@@ -88,6 +90,9 @@ OssDriver::OssDriver( audioProcessCallback processCallback )
 
 OssDriver::~OssDriver()
 {
+	if ( m_nUnderruns > 0 ) {
+		WARNINGLOG( QString( "%1 underruns" ).arg( m_nUnderruns ) );
+	}
 	INFOLOG( "DESTROY" );
 }
 
@@ -100,7 +105,8 @@ int OssDriver::init( unsigned nBufferSize )
 	delete[] audioBuffer;
 	audioBuffer = NULL;
 
-	audioBuffer = new short[nBufferSize * 2];
+	// room for the widest format, the device one is only known once connected
+	audioBuffer = new char[nBufferSize * 2 * sizeof( int32_t )];
 
 	out_L = new float[nBufferSize];
 	out_R = new float[nBufferSize];
@@ -124,9 +130,8 @@ int OssDriver::connect()
 	Preferences *preferencesMng = Preferences::get_instance();
 
 	// initialize OSS
-	int bits = 16;
 	int speed = preferencesMng->m_nSampleRate;
-	int stereo = 1;
+	int channels = 2;
 	int bs;
 
 	QString audioDevice;
@@ -152,26 +157,41 @@ int OssDriver::connect()
 		close( fd );
 		return 1;
 	}
-	if ( ioctl( fd, SNDCTL_DSP_SAMPLESIZE, &bits ) < 0 ) {
-		ERRORLOG( "ERROR_IOCTL" );
+
+	// the fragments have to be set before the format, the format is only queried here
+	int format = chooseFormat();
+	m_nSampleBytes = ( format == AFMT_S16_LE ) ? 2 : sizeof( int32_t );
+#ifdef AFMT_S24_PACKED
+	if ( format == AFMT_S24_PACKED ) {
+		m_nSampleBytes = 3;
+	}
+#endif
+
+	// one fragment per engine cycle, rounded up to a power of two
+	unsigned fragmentBits = log2( oss_driver_bufferSize * 2 * m_nSampleBytes - 1 ) + 1;
+	unsigned fragments = std::max( 2u, preferencesMng->m_nOSSFragments );
+	int fragSize = ( fragments << 16 ) | fragmentBits;
+	if ( ioctl( fd, SNDCTL_DSP_SETFRAGMENT, &fragSize ) < 0 ) {
+		WARNINGLOG( "unable to set the fragments" );
+	}
+
+	m_nFormat = format;
+	if ( ioctl( fd, SNDCTL_DSP_SETFMT, &m_nFormat ) == -1 || m_nFormat != format ) {
+		ERRORLOG( "ERROR_IOCTL unable to set format" );
 		close( fd );
 		return 1;
 	}
-	if ( ioctl( fd, SNDCTL_DSP_SPEED, &speed ) < 0 ) {
-		ERRORLOG( "ERROR_IOCTL" );
+	if ( ioctl( fd, SNDCTL_DSP_CHANNELS, &channels ) < 0 || channels != 2 ) {
+		ERRORLOG( "ERROR_IOCTL unable to set stereo" );
 		close( fd );
 		return 1;
 	}
-	if ( ioctl( fd, SNDCTL_DSP_STEREO, &stereo ) < 0 ) {
+	if ( ioctl( fd, SNDCTL_DSP_SPEED, &speed ) < 0 ) {
 		ERRORLOG( "ERROR_IOCTL" );
 		close( fd );
 		return 1;
 	}
-
-	unsigned bufferBits = log2( speed / 60 );
-	int fragSize = 0x00200000 | bufferBits;
-
-	ioctl( fd, SNDCTL_DSP_SETFRAGMENT, &fragSize );
+	m_nSampleRate = speed;
 
 	if ( ioctl( fd, SNDCTL_DSP_GETBLKSIZE, &bs ) < 0 ) {
 		ERRORLOG( "ERROR_IOCTL" );
@@ -179,22 +199,9 @@ int OssDriver::connect()
 		return 1;
 	}
 
-	INFOLOG( QString( "Blocksize audio = %1" ).arg( bs ) );
-
-		/* commenting this is a fix against buffersize problems described in ticket 119
-	if ( bs != ( 1 << bufferBits ) ) {
-		ERRORLOG( "ERROR_IOCTL: unable to set BlockSize" );
-		close( fd );
-		return 1;
-	}
-		*/// end comment
-
-	int format = AFMT_S16_LE;
-	if ( ioctl( fd, SNDCTL_DSP_SETFMT, &format ) == -1 ) {
-		ERRORLOG( "ERROR_IOCTL unable to set format" );
-		close( fd );
-		return 1;
-	}
+	INFOLOG( QString( "Format = 0x%1, rate = %2, %3 fragments of %4 bytes, blocksize = %5" )
+			 .arg( m_nFormat, 0, 16 ).arg( m_nSampleRate )
+			 .arg( fragSize >> 16 ).arg( 1 << ( fragSize & 0xffff ) ).arg( bs ) );
 
 	// start main thread
 	ossDriver_running = true;
@@ -237,24 +244,120 @@ void OssDriver::disconnect()
 
 
 
-/// Write the audio data
-void OssDriver::write()
+int OssDriver::chooseFormat()
 {
-//	infoLog("write");
-	unsigned size = oss_driver_bufferSize * 2;
+	int formats = 0;
+	if ( ioctl( fd, SNDCTL_DSP_GETFMTS, &formats ) < 0 ) {
+		return AFMT_S16_LE;
+	}
+#ifdef AFMT_FLOAT
+	if ( formats & AFMT_FLOAT ) return AFMT_FLOAT;
+#endif
+#ifdef AFMT_S32_LE
+	if ( formats & AFMT_S32_LE ) return AFMT_S32_LE;
+#endif
+#ifdef AFMT_S24_LE
+	if ( formats & AFMT_S24_LE ) return AFMT_S24_LE;
+#endif
+#ifdef AFMT_S24_PACKED
+	if ( formats & AFMT_S24_PACKED ) return AFMT_S24_PACKED;
+#endif
+	return AFMT_S16_LE;
+}
+
+
+static inline float oss_clip( float fValue )
+{
+	return fValue > 1.0f ? 1.0f : ( fValue < -1.0f ? -1.0f : fValue );
+}
 
-	// prepare the 2-channel array of short
-	for ( unsigned i = 0; i < ( unsigned )oss_driver_bufferSize; ++i ) {
-		audioBuffer[i * 2] = ( short )( out_L[i] * 32768.0 );
-		audioBuffer[i * 2 + 1] = ( short )( out_R[i] * 32768.0 );
+
+void OssDriver::convert( const float* pIn, char* pOut, unsigned nFrames )
+{
+	const unsigned nStep = m_nSampleBytes * 2;
+	// the integer formats are little endian, as is any host OSSv4 runs on here
+	switch ( m_nFormat ) {
+#ifdef AFMT_FLOAT
+	case AFMT_FLOAT:
+		for ( unsigned i = 0; i < nFrames; ++i, pOut += nStep ) {
+			memcpy( pOut, &pIn[ i ], sizeof( float ) );
+		}
+		return;
+#endif
+#ifdef AFMT_S32_LE
+	case AFMT_S32_LE:
+		for ( unsigned i = 0; i < nFrames; ++i, pOut += nStep ) {
+			int32_t nValue = ( int32_t )( oss_clip( pIn[ i ] ) * 2147483647.0 );
+			memcpy( pOut, &nValue, sizeof( int32_t ) );
+		}
+		return;
+#endif
+#ifdef AFMT_S24_LE
+	case AFMT_S24_LE:
+		// 24 bits in the low bytes of a 32 bits word
+		for ( unsigned i = 0; i < nFrames; ++i, pOut += nStep ) {
+			int32_t nValue = ( int32_t )( oss_clip( pIn[ i ] ) * 8388607.0f );
+			memcpy( pOut, &nValue, sizeof( int32_t ) );
+		}
+		return;
+#endif
+#ifdef AFMT_S24_PACKED
+	case AFMT_S24_PACKED:
+		for ( unsigned i = 0; i < nFrames; ++i, pOut += nStep ) {
+			int32_t nValue = ( int32_t )( oss_clip( pIn[ i ] ) * 8388607.0f );
+			pOut[ 0 ] = nValue & 0xff;
+			pOut[ 1 ] = ( nValue >> 8 ) & 0xff;
+			pOut[ 2 ] = ( nValue >> 16 ) & 0xff;
+		}
+		return;
+#endif
+	default:
+		// S16, with a triangular dither of one LSB
+		for ( unsigned i = 0; i < nFrames; ++i, pOut += nStep ) {
+			m_nDitherSeed = m_nDitherSeed * 1664525 + 1013904223;
+			float fDither = ( m_nDitherSeed >> 8 ) * ( 1.0f / 16777216.0f );
+			m_nDitherSeed = m_nDitherSeed * 1664525 + 1013904223;
+			fDither -= ( m_nDitherSeed >> 8 ) * ( 1.0f / 16777216.0f );
+			int nValue = ( int )lrintf( pIn[ i ] * 32767.0f + fDither );
+			int16_t nSample = nValue > 32767 ? 32767 : ( nValue < -32768 ? -32768 : nValue );
+			memcpy( pOut, &nSample, sizeof( int16_t ) );
+		}
+		return;
 	}
+}
+
 
-	unsigned long written = ::write( fd, audioBuffer, size * 2 );
+/// Write the audio data
+void OssDriver::write()
+{
+	convert( out_L, audioBuffer, oss_driver_bufferSize );
+	convert( out_R, audioBuffer + m_nSampleBytes, oss_driver_bufferSize );
+
+	// a signal or a full buffer may cut the write short, the rest is written again
+	size_t size = oss_driver_bufferSize * 2 * m_nSampleBytes;
+	size_t done = 0;
+	while ( done < size && ossDriver_running ) {
+		ssize_t written = ::write( fd, audioBuffer + done, size - done );
+		if ( written < 0 ) {
+			if ( errno == EINTR || errno == EAGAIN ) {
+				continue;
+			}
+			ERRORLOG( "OssDriver: Error writing samples to audio device." );
+			break;
+		}
+		done += written;
+	}
 
-	if ( written != ( size * 2 ) ) {
-		ERRORLOG( "OssDriver: Error writing samples to audio device." );
-//		std::cerr << "written = " << written << " of " << (size*2) << endl;
+#ifdef SNDCTL_DSP_GETERROR
+	// OSSv4 counts the underruns since the previous call
+	audio_errinfo errinfo;
+	if ( ioctl( fd, SNDCTL_DSP_GETERROR, &errinfo ) == 0 && errinfo.play_underruns > 0 ) {
+		m_nUnderruns += errinfo.play_underruns;
+		for ( int i = 0; i < errinfo.play_underruns; ++i ) {
+			EngineProfiler::get_instance()->report_xrun();
+		}
 	}
+#endif
 }
 
 
@@ -280,8 +383,7 @@ unsigned OssDriver::getBufferSize()
 
 unsigned OssDriver::getSampleRate()
 {
-	Preferences *preferencesMng = Preferences::get_instance();
-	return preferencesMng->m_nSampleRate;
+	return m_nSampleRate;
 }
 
 
@@ -52,6 +52,7 @@ void* PortMidiDriver_thread( void* param )
 	Object *__object = (Object*)param;
 	PortMidiDriver *instance = ( PortMidiDriver* )param;
 	__INFOLOG( "PortMidiDriver_thread starting" );
+	Preferences::get_instance()->applyThreadPolicy( Preferences::THREAD_MIDI_IN, pthread_self() );
 
 	PmError status;
 	int length;
@@ -31,13 +31,16 @@
 namespace H2Core
 {
 
+const char* PulseAudioDriver::__class_name = "PulseAudioDriver";
+
 PulseAudioDriver::PulseAudioDriver(audioProcessCallback processCallback)
-	:	AudioOutput("PulseAudioDriver"),
+	:	AudioOutput(__class_name),
 		m_callback(processCallback),
 		m_main_loop(0),
 		m_ctx(0),
 		m_stream(0),
 		m_connected(false),
+		m_latency(0),
 		m_outL(0),
 		m_outR(0)
 {
@@ -61,6 +64,8 @@ int PulseAudioDriver::init( unsigned nBufferSize )
 	delete []m_outR;
 	m_buffer_size = nBufferSize;
 	m_sample_rate = Preferences::get_instance()->m_nSampleRate;
+	m_latency_mode = Preferences::get_instance()->m_nPulseAudioLatencyMode;
+	m_target_latency = Preferences::get_instance()->m_nPulseAudioLatency;
 	m_outL = new float[m_buffer_size];
 	m_outR = new float[m_buffer_size];
 	return 0;
@@ -141,6 +146,12 @@ float* PulseAudioDriver::getOut_R()
 }
 
 
+unsigned PulseAudioDriver::getLatency()
+{
+	return m_latency.load(std::memory_order_relaxed);
+}
+
+
 void PulseAudioDriver::updateTransportInfo()
 {
 }
@@ -188,6 +199,7 @@ void* PulseAudioDriver::s_thread_body(void* arg)
 
 int PulseAudioDriver::thread_body()
 {
+	Preferences::get_instance()->applyThreadPolicy( Preferences::THREAD_AUDIO, pthread_self() );
 	m_main_loop = pa_mainloop_new();
 	pa_mainloop_api* api = pa_mainloop_get_api(m_main_loop);
 	pa_io_event* ioev = api->io_new(api, m_pipe[0], PA_IO_EVENT_INPUT,
@@ -222,20 +234,39 @@ void PulseAudioDriver::ctx_state_callback(pa_context* ctx, void* udata)
 
 	if (s == PA_CONTEXT_READY)
 	{
+		// the engine output is handed over without conversion
 		pa_sample_spec spec;
-		spec.format = PA_SAMPLE_S16LE;
+		spec.format = PA_SAMPLE_FLOAT32NE;
 		spec.rate = self->m_sample_rate;
 		spec.channels = 2;
 		self->m_stream = pa_stream_new(ctx, "Hydrogen", &spec, 0);
 		pa_stream_set_state_callback(self->m_stream, stream_state_callback, self);
 		pa_stream_set_write_callback(self->m_stream, stream_write_callback, self);
+
+		size_t buffer_bytes = self->m_buffer_size * pa_frame_size(&spec);
 		pa_buffer_attr bufattr;
 		bufattr.fragsize = (uint32_t)-1;
-		bufattr.maxlength = self->m_buffer_size * 4;
-		bufattr.minreq = 0;
+		bufattr.maxlength = (uint32_t)-1;
 		bufattr.prebuf = (uint32_t)-1;
-		bufattr.tlength = self->m_buffer_size * 4;
-		pa_stream_connect_playback(self->m_stream, 0, &bufattr, pa_stream_flags_t(0), 0, 0);
+		bufattr.tlength = self->m_target_latency
+				? pa_usec_to_bytes(self->m_target_latency * PA_USEC_PER_MSEC, &spec)
+				: buffer_bytes;
+		bufattr.minreq = (uint32_t)-1;
+
+		int flags = PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE;
+		if (self->m_latency_mode == Preferences::PULSE_ADJUST_LATENCY)
+		{
+			// tlength is the whole latency, the server shrinks the sink buffer to match it
+			flags |= PA_STREAM_ADJUST_LATENCY;
+			bufattr.minreq = std::min(buffer_bytes, (size_t)bufattr.tlength / 2);
+		}
+		else if (self->m_latency_mode == Preferences::PULSE_EARLY_REQUESTS)
+		{
+			// ask for data in fragments of one engine buffer, as a classic sound card would
+			flags |= PA_STREAM_EARLY_REQUESTS;
+			bufattr.minreq = buffer_bytes;
+		}
+		pa_stream_connect_playback(self->m_stream, 0, &bufattr, pa_stream_flags_t(flags), 0, 0);
 	}
 	else if (s == PA_CONTEXT_FAILED)
 		pa_mainloop_quit(self->m_main_loop, 1);
@@ -251,6 +282,15 @@ void PulseAudioDriver::stream_state_callback(pa_stream* stream, void* udata)
 		pa_mainloop_quit(self->m_main_loop, 1);
 	else if (s == PA_STREAM_READY)
 	{
+		const pa_buffer_attr* attr = pa_stream_get_buffer_attr(stream);
+		const pa_sample_spec* spec = pa_stream_get_sample_spec(stream);
+		if (attr && spec)
+		{
+			INFOLOG(QString("target latency %1 us, request size %2 us")
+					.arg(pa_bytes_to_usec(attr->tlength, spec))
+					.arg(pa_bytes_to_usec(attr->minreq, spec)));
+		}
+
 		pthread_mutex_lock(&self->m_mutex);
 		self->m_ready = 1;
 		pthread_cond_signal(&self->m_cond);
@@ -258,8 +298,6 @@ void PulseAudioDriver::stream_state_callback(pa_stream* stream, void* udata)
 	}
 }
 
-#define FLOAT_TO_SHORT(x) short(round((std::min(std::max((x), -1.0f), 1.0f)) * 32767.0f))
-
 void PulseAudioDriver::stream_write_callback(pa_stream* stream, size_t bytes, void* udata)
 {
 	PulseAudioDriver* self = (PulseAudioDriver*)udata;
@@ -268,24 +306,34 @@ void PulseAudioDriver::stream_write_callback(pa_stream* stream, size_t bytes, vo
 	pa_stream_begin_write(stream, &vdata, &bytes);
 	if (!vdata) return;
 
-	short* out = (short*)vdata;
+	float* out = (float*)vdata;
 
-	unsigned num_samples = bytes / 4;
+	unsigned num_frames = bytes / (2 * sizeof(float));
+	unsigned frames_left = num_frames;
 
-	while (num_samples)
+	while (frames_left)
 	{
-		int n = std::min(self->m_buffer_size, num_samples);
+		int n = std::min(self->m_buffer_size, frames_left);
 		self->m_callback(n, 0);
 		for (int i = 0; i < n; ++i)
 		{
-			*out++ = FLOAT_TO_SHORT(self->m_outL[i]);
-			*out++ = FLOAT_TO_SHORT(self->m_outR[i]);
+			*out++ = self->m_outL[i];
+			*out++ = self->m_outR[i];
 		}
 
-		num_samples -= n;
+		frames_left -= n;
 	}
 
-	pa_stream_write(stream, vdata, (bytes / 4) * 4, 0, 0, PA_SEEK_RELATIVE);
+	pa_stream_write(stream, vdata, num_frames * 2 * sizeof(float), 0, 0, PA_SEEK_RELATIVE);
+
+	// interpolated from the timing updates, no round trip to the server
+	pa_usec_t latency;
+	int negative;
+	if (pa_stream_get_latency(stream, &latency, &negative) == 0)
+	{
+		self->m_latency.store(negative ? 0 : (unsigned)(latency * self->m_sample_rate / PA_USEC_PER_SEC),
+							  std::memory_order_relaxed);
+	}
 }
 
 
@@ -23,10 +23,14 @@
 #include <hydrogen/audio_engine.h>
 
 #include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/FxGraph.h>
 #include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/basics/song_snapshot.h>
 
 #include <hydrogen/hydrogen.h>	// TODO: remove this line as soon as possible
+#include <algorithm>
 #include <cassert>
+#include <unistd.h>
 
 namespace H2Core
 {
@@ -47,17 +51,33 @@ AudioEngine::AudioEngine()
 		: Object( __class_name )
 		, __sampler( NULL )
 		, __synth( NULL )
+		, __edit_locked( false )
+		, __song( NULL )
+		, __edited_all( false )
+		, __snapshot( NULL )
+		, __cycle_snapshot( NULL )
+		, __cycles_started( 0 )
+		, __cycles_done( 0 )
+		, __snapshot_readers( 0 )
 {
 	__instance = this;
 	INFOLOG( "INIT" );
 
 	pthread_mutex_init( &__engine_mutex, NULL );
 
+	// the editors may lock again from within an edit
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init( &attr );
+	pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+	pthread_mutex_init( &__edit_mutex, &attr );
+	pthread_mutexattr_destroy( &attr );
+
 	__sampler = new Sampler;
 	__synth = new Synth;
 
 #ifdef H2CORE_HAVE_LADSPA
 	Effects::create_instance();
+	FxGraph::create_instance();
 #endif
 
 }
@@ -68,12 +88,20 @@ AudioEngine::~AudioEngine()
 {
 	INFOLOG( "DESTROY" );
 #ifdef H2CORE_HAVE_LADSPA
+	delete FxGraph::get_instance();
 	delete Effects::get_instance();
 #endif
 
 //	delete Sequencer::get_instance();
 	delete __sampler;
 	delete __synth;
+
+	delete __snapshot.load();
+	for ( unsigned i = 0; i < __retired.size(); i++ ) {
+		delete __retired[i].first;
+	}
+	pthread_mutex_destroy( &__edit_mutex );
+	pthread_mutex_destroy( &__engine_mutex );
 }
 
 
@@ -95,10 +123,14 @@ Synth* AudioEngine::get_synth()
 
 void AudioEngine::lock( const char* file, unsigned int line, const char* function )
 {
+	pthread_mutex_lock( &__edit_mutex );
 	pthread_mutex_lock( &__engine_mutex );
 	__locker.file = file;
 	__locker.line = line;
 	__locker.function = function;
+	__edit_locked = true;
+	// anything may change under the engine lock
+	__edited_all = true;
 }
 
 
@@ -121,7 +153,145 @@ bool AudioEngine::try_lock( const char* file, unsigned int line, const char* fun
 void AudioEngine::unlock()
 {
 	// Leave "__locker" dirty.
+	if ( !__edit_locked ) {
+		// the audio thread, through try_lock()
+		pthread_mutex_unlock( &__engine_mutex );
+		return;
+	}
+	__edit_locked = false;
 	pthread_mutex_unlock( &__engine_mutex );
+	// the audio thread may play the previous snapshot until it is published
+	publish_snapshot();
+	pthread_mutex_unlock( &__edit_mutex );
+}
+
+
+
+void AudioEngine::lock_edit( const char* file, unsigned int line, const char* function )
+{
+	pthread_mutex_lock( &__edit_mutex );
+	__locker.file = file;
+	__locker.line = line;
+	__locker.function = function;
+}
+
+
+
+void AudioEngine::unlock_edit()
+{
+	publish_snapshot();
+	pthread_mutex_unlock( &__edit_mutex );
+}
+
+
+
+void AudioEngine::mark_edited( Pattern* pattern )
+{
+	if ( std::find( __edited.begin(), __edited.end(), pattern ) == __edited.end() ) {
+		__edited.push_back( pattern );
+	}
+}
+
+
+
+void AudioEngine::set_song( Song* song )
+{
+	__song = song;
+}
+
+
+
+void AudioEngine::swap_song( Song** song, SongSnapshot** snapshot )
+{
+	SongSnapshot* next = *snapshot;
+	// the song first, a publish which read the previous snapshot before fails
+	*song = __song.exchange( *song );
+	*snapshot = __snapshot.exchange( next );
+	__cycle_snapshot = next;
+}
+
+
+
+void AudioEngine::retire_snapshot( SongSnapshot* snapshot )
+{
+	// the cycles started so far may have read it
+	__retired.push_back( std::make_pair( snapshot, __cycles_started.load() ) );
+}
+
+
+
+void AudioEngine::publish_snapshot()
+{
+	// the snapshot before the song, see swap_song()
+	SongSnapshot* previous = __snapshot.load();
+	bool all = __edited_all || __edited.empty();
+	SongSnapshot* snapshot = new SongSnapshot( __song.load(), previous, all ? NULL : &__edited );
+	__edited.clear();
+	__edited_all = false;
+	if ( !snapshot->has_changes() || !__snapshot.compare_exchange_strong( previous, snapshot ) ) {
+		// unchanged, or the audio thread switched to another song meanwhile
+		delete snapshot;
+	} else if ( previous != NULL ) {
+		// the cycles started so far may have read the previous snapshot
+		__retired.push_back( std::make_pair( previous, __cycles_started.load() ) );
+	}
+
+	// free the snapshots no cycle can read anymore
+	if ( __snapshot_readers.load() != 0 ) {
+		// another thread may hold one of them, try again next time
+		return;
+	}
+	unsigned long long done = __cycles_done.load();
+	unsigned kept = 0;
+	for ( unsigned i = 0; i < __retired.size(); i++ ) {
+		if ( __retired[i].second <= done ) {
+			delete __retired[i].first;
+		} else {
+			__retired[ kept++ ] = __retired[i];
+		}
+	}
+	__retired.resize( kept );
+}
+
+
+
+const SongSnapshot* AudioEngine::acquire_song_snapshot()
+{
+	__snapshot_readers.fetch_add( 1 );
+	return __snapshot.load();
+}
+
+
+
+void AudioEngine::release_song_snapshot()
+{
+	__snapshot_readers.fetch_sub( 1 );
+}
+
+
+
+void AudioEngine::wait_for_cycles()
+{
+	unsigned long long started = __cycles_started.load();
+	while ( __cycles_done.load() < started ) {
+		usleep( 100 );
+	}
+}
+
+
+
+void AudioEngine::begin_snapshot_cycle()
+{
+	__cycles_started.fetch_add( 1 );
+	__cycle_snapshot = __snapshot.load();
+}
+
+
+
+void AudioEngine::end_snapshot_cycle()
+{
+	__cycle_snapshot = NULL;
+	__cycles_done.fetch_add( 1 );
 }
 
 
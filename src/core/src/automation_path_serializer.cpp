@@ -20,6 +20,17 @@
  *
  */
 #include <hydrogen/automation_path_serializer.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+
+namespace
+{
+
+/* values of the adjust attribute of the instrument paths, by target */
+const char* adjustNames[] = { "volume", "pan", "filter_cutoff", "filter_resonance", "fx_level" };
+
+}
 
 namespace H2Core
 {
@@ -63,4 +74,88 @@ void AutomationPathSerializer::write_automation_path(QDomNode &node, const Autom
 }
 
 
+void AutomationPathSerializer::write_automation_path(QXmlStreamWriter &writer, const AutomationPath &path)
+{
+	for (auto point : path) {
+		writer.writeEmptyElement("point");
+		writer.writeAttribute("x", QString::number(point.first));
+		writer.writeAttribute("y", QString::number(point.second));
+	}
+}
+
+
+void AutomationPathSerializer::read_automation_paths(const QDomNode &node, Song *song)
+{
+	QDomElement pathNode = node.firstChildElement("path");
+	while (! pathNode.isNull()) {
+		QString adjust = pathNode.attribute("adjust");
+
+		// Select automation path to be read based on "adjust" attribute
+		AutomationPath *path = NULL;
+		if (adjust == "velocity") {
+			path = song->get_velocity_automation_path();
+		} else {
+			bool hasId = false;
+			int id = pathNode.attribute("instrument").toInt(&hasId);
+			Instrument *instrument = hasId ? song->get_instrument_list()->find(id) : NULL;
+			for (int target = Instrument::AUTOMATION_VOLUME; instrument && target <= Instrument::AUTOMATION_FX_LEVEL; ++target) {
+				if (adjust != adjustNames[target]) {
+					continue;
+				}
+				if (target == Instrument::AUTOMATION_FX_LEVEL) {
+					int fx = pathNode.attribute("fx").toInt();
+					if (fx >= 0 && fx < MAX_FX) {
+						path = instrument->get_automation_path((Instrument::AutomationTarget)(Instrument::AUTOMATION_FX_LEVEL + fx));
+					}
+				} else {
+					path = instrument->get_automation_path((Instrument::AutomationTarget)target);
+				}
+			}
+		}
+
+		if (path) {
+			read_automation_path(pathNode, *path);
+		} else {
+			WARNINGLOG(QString("Ignoring automation path '%1'").arg(adjust));
+		}
+
+		pathNode = pathNode.nextSiblingElement("path");
+	}
+}
+
+
+void AutomationPathSerializer::write_automation_paths(QXmlStreamWriter &writer, Song *song)
+{
+	AutomationPath *path = song->get_velocity_automation_path();
+	if (path) {
+		writer.writeStartElement("path");
+		writer.writeAttribute("adjust", "velocity");
+		write_automation_path(writer, *path);
+		writer.writeEndElement();
+	}
+
+	InstrumentList *instruments = song->get_instrument_list();
+	for (int i = 0; i < instruments->size(); ++i) {
+		Instrument *instrument = instruments->get(i);
+		for (int target = 0; target < Instrument::AUTOMATION_TARGETS; ++target) {
+			path = instrument->get_automation_path((Instrument::AutomationTarget)target);
+			if (path->empty()) {
+				continue;
+			}
+			writer.writeStartElement("path");
+			if (target >= Instrument::AUTOMATION_FX_LEVEL) {
+				writer.writeAttribute("adjust", adjustNames[Instrument::AUTOMATION_FX_LEVEL]);
+				writer.writeAttribute("instrument", QString::number(instrument->get_id()));
+				writer.writeAttribute("fx", QString::number(target - Instrument::AUTOMATION_FX_LEVEL));
+			} else {
+				writer.writeAttribute("adjust", adjustNames[target]);
+				writer.writeAttribute("instrument", QString::number(instrument->get_id()));
+			}
+			write_automation_path(writer, *path);
+			writer.writeEndElement();
+		}
+	}
+}
+
+
 }
@@ -21,6 +21,7 @@
  */
 
 #include <hydrogen/basics/adsr.h>
+#include <hydrogen/helpers/denormals.h>
 
 #include "exponential_tables.h"
 
@@ -132,7 +133,8 @@ float ADSR::get_value( float step )
 		if ( __release < 256 ) {
 			__release = 256;
 		}
-		__value = concave_exponant( linear_interpolation( 1.0, 0.0, ( __ticks * 1.0 / __release ) ) ) * __release_value;
+		// a note released in a quiet decay ends its tail in the denormal range
+		__value = flush_denormal( concave_exponant( linear_interpolation( 1.0, 0.0, ( __ticks * 1.0 / __release ) ) ) * __release_value );
 		__ticks += step;
 		if ( __ticks > __release ) {
 			__state = IDLE;
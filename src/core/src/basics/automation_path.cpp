@@ -21,6 +21,8 @@
  */
 #include <hydrogen/basics/automation_path.h>
 
+#include <algorithm>
+
 namespace H2Core
 {
 
@@ -35,6 +37,25 @@ AutomationPath::AutomationPath(float min, float max, float def)
 }
 
 
+/**
+ * \brief Copy the points to the flat arrays
+ *
+ * Called after each edit, the engine evaluates paths at every block
+ * and a binary search over contiguous floats beats walking the map.
+ **/
+void AutomationPath::compile()
+{
+	_x.clear();
+	_y.clear();
+	_x.reserve(_points.size());
+	_y.reserve(_points.size());
+	for (auto point : _points) {
+		_x.push_back(point.first);
+		_y.push_back(point.second);
+	}
+}
+
+
 /**
  * \brief Get value at given location
  * \param x Location
@@ -43,24 +64,21 @@ AutomationPath::AutomationPath(float min, float max, float def)
  **/
 float AutomationPath::get_value(float x) const noexcept
 {
-	if (_points.empty())
+	if (_x.empty())
 		return _def;
 
-	auto f = _points.begin();
-	if(x <= f->first)
-		return f->second;
+	if(x <= _x.front())
+		return _y.front();
 
-	auto l = _points.rbegin();
-	if(x >= l->first)
-		return l->second;
+	if(x >= _x.back())
+		return _y.back();
 
-	auto i = _points.lower_bound(x);
-	auto p1 = *i;
-	auto p0 = *(--i);
-	float x1 = p0.first;
-	float y1 = p0.second;
-	float x2 = p1.first;
-	float y2 = p1.second;
+	/* first point after x, there is one before it */
+	size_t i = std::upper_bound(_x.begin(), _x.end(), x) - _x.begin();
+	float x1 = _x[i-1];
+	float y1 = _y[i-1];
+	float x2 = _x[i];
+	float y2 = _y[i];
 
 	float d = (x-x1)/(x2 - x1);
 
@@ -76,6 +94,7 @@ float AutomationPath::get_value(float x) const noexcept
 void AutomationPath::add_point(float x, float y)
 {
 	_points[x] = y;
+	compile();
 }
 
 
@@ -152,6 +171,7 @@ AutomationPath::iterator AutomationPath::move(iterator &in, float x, float y)
 {
 	_points.erase(in);
 	auto rv = _points.insert(std::make_pair(x,y));
+	compile();
 	return rv.first;
 }
 
@@ -165,6 +185,7 @@ void AutomationPath::remove_point(float x)
 	auto it = find(x);
 	if (it != _points.end()) {
 		_points.erase(it);
+		compile();
 	}
 }
 
@@ -34,6 +34,7 @@
 #include <hydrogen/basics/drumkit.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/fx/FxChain.h>
 
 namespace H2Core
 {
@@ -49,8 +50,7 @@ DrumkitComponent::DrumkitComponent( const int id, const QString& name )
 	, __soloed( false )
 	, __out_L( nullptr )
 	, __out_R( nullptr )
-	, __peak_l( 0.0 )
-	, __peak_r( 0.0 )
+	, __insert_fx( nullptr )
 {
 	__out_L = new float[ MAX_BUFFER_SIZE ];
 	__out_R = new float[ MAX_BUFFER_SIZE ];
@@ -65,8 +65,7 @@ DrumkitComponent::DrumkitComponent( DrumkitComponent* other )
 	, __soloed( other->__soloed )
 	, __out_L( nullptr )
 	, __out_R( nullptr )
-	, __peak_l( 0.0 )
-	, __peak_r( 0.0 )
+	, __insert_fx( nullptr )
 {
 	__out_L = new float[ MAX_BUFFER_SIZE ];
 	__out_R = new float[ MAX_BUFFER_SIZE ];
@@ -76,6 +75,36 @@ DrumkitComponent::~DrumkitComponent()
 {
 	delete[] __out_L;
 	delete[] __out_R;
+
+#ifdef H2CORE_HAVE_LADSPA
+	delete __insert_fx;
+#endif
+}
+
+void DrumkitComponent::set_insert_fx( FxChain* chain )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	if ( __insert_fx == chain ) {
+		return;
+	}
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	FxChain* pOld = __insert_fx;
+	__insert_fx = chain;
+	AudioEngine::get_instance()->unlock();
+	delete pOld;
+#else
+	assert( chain == nullptr );
+#endif
+}
+
+void DrumkitComponent::attach_insert_fx( FxChain* chain )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	assert( __insert_fx == nullptr );
+	__insert_fx = chain;
+#else
+	assert( chain == nullptr );
+#endif
 }
 
 void DrumkitComponent::reset_outs( uint32_t nFrames )
@@ -25,17 +25,20 @@
 #include <cassert>
 
 #include <hydrogen/audio_engine.h>
+#include <hydrogen/hydrogen.h>
 
 #include <hydrogen/helpers/xml.h>
 #include <hydrogen/helpers/filesystem.h>
 
 #include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/automation_path.h>
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/drumkit.h>
 #include <hydrogen/basics/drumkit_component.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_component.h>
 #include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/fx/FxChain.h>
 
 namespace H2Core
 {
@@ -50,8 +53,7 @@ Instrument::Instrument( const int id, const QString& name, ADSR* adsr )
 	, __volume( 1.0 )
 	, __pan_l( 1.0 )
 	, __pan_r( 1.0 )
-	, __peak_l( 0.0 )
-	, __peak_r( 0.0 )
+	, __insert_fx( NULL )
 	, __adsr( adsr )
 	, __filter_active( false )
 	, __filter_cutoff( 1.0 )
@@ -74,6 +76,8 @@ Instrument::Instrument( const int id, const QString& name, ADSR* adsr )
 	, __is_metronome_instrument(false)
 	, __apply_velocity( true )
 	, __current_instr_for_export(false)
+	, __synth_waveform( SYNTH_OFF )
+	, __synth_frequency( 65.406f )
 {
 	if ( __adsr == nullptr ) {
 		__adsr = new ADSR();
@@ -83,18 +87,27 @@ Instrument::Instrument( const int id, const QString& name, ADSR* adsr )
 		__fx_level[i] = 0.0;
 	}
 	__components = new std::vector<InstrumentComponent*> ();
+
+	__automation[ AUTOMATION_VOLUME ] = new AutomationPath( 0.0f, 1.5f, 1.0f );
+	__automation[ AUTOMATION_PAN ] = new AutomationPath( 0.0f, 1.0f, 0.5f );
+	__automation[ AUTOMATION_FILTER_CUTOFF ] = new AutomationPath( 0.0f, 1.0f, 1.0f );
+	__automation[ AUTOMATION_FILTER_RESONANCE ] = new AutomationPath( 0.0f, 1.0f, 0.0f );
+	for ( int i=0; i<MAX_FX; i++ ) {
+		__automation[ AUTOMATION_FX_LEVEL + i ] = new AutomationPath( 0.0f, 1.0f, 0.0f );
+	}
+	__block = 0;
+	update_block_params( 0, -1.0f, -1.0f, 1.0f );
 }
 
 Instrument::Instrument( Instrument* other )
 	: Object( __class_name )
 	, __id( other->get_id() )
 	, __name( other->get_name() )
-	, __gain( other->__gain )
+	, __gain( other->get_gain() )
 	, __volume( other->get_volume() )
 	, __pan_l( other->get_pan_l() )
 	, __pan_r( other->get_pan_r() )
-	, __peak_l( other->get_peak_l() )
-	, __peak_r( other->get_peak_r() )
+	, __insert_fx( NULL )
 	, __adsr( new ADSR( *( other->get_adsr() ) ) )
 	, __filter_active( other->is_filter_active() )
 	, __filter_cutoff( other->get_filter_cutoff() )
@@ -117,13 +130,29 @@ Instrument::Instrument( Instrument* other )
 	, __is_metronome_instrument(false)
 	, __apply_velocity( other->get_apply_velocity() )
 	, __current_instr_for_export(false)
+	, __synth_waveform( other->get_synth_waveform() )
+	, __synth_frequency( other->get_synth_frequency() )
 {
 	for ( int i=0; i<MAX_FX; i++ ) {
 		__fx_level[i] = other->get_fx_level( i );
 	}
 
+#ifdef H2CORE_HAVE_LADSPA
+	if ( other->get_insert_fx() ) {
+		// instantiated at the rate of the running driver, as when a song is read
+		AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
+		__insert_fx = new FxChain( other->get_insert_fx(), pAudioOutput ? pAudioOutput->getSampleRate() : 44100 );
+	}
+#endif
+
 	__components = new std::vector<InstrumentComponent*> ();
 	__components->assign( other->get_components()->begin(), other->get_components()->end() );
+
+	for ( int i=0; i<AUTOMATION_TARGETS; i++ ) {
+		__automation[i] = new AutomationPath( *other->get_automation_path( ( AutomationTarget )i ) );
+	}
+	__block = 0;
+	update_block_params( 0, -1.0f, -1.0f, 1.0f );
 }
 
 Instrument::~Instrument()
@@ -136,6 +165,104 @@ Instrument::~Instrument()
 
 	delete __adsr;
 	__adsr = nullptr;
+
+	for ( int i=0; i<AUTOMATION_TARGETS; i++ ) {
+		delete __automation[i];
+	}
+
+#ifdef H2CORE_HAVE_LADSPA
+	delete __insert_fx;
+#endif
+}
+
+/** value of an automated parameter at a song position */
+static inline float automated_value( const AutomationPath* pPath, float fPos, float fValue )
+{
+	return ( fPos < 0 || pPath->empty() ) ? fValue : pPath->get_value( fPos );
+}
+
+/** move a smoothed parameter towards its value */
+static inline void glide( float& fState, float fTarget, float fSmoothing )
+{
+	fState += ( fTarget - fState ) * fSmoothing;
+}
+
+void Instrument::update_block_params( uint64_t nBlock, float fStart, float fEnd, float fSmoothing )
+{
+	if ( nBlock == __block && nBlock != 0 ) {
+		return;
+	}
+	bool bFollows = nBlock != 0 && nBlock == __block + 1;
+	__block = nBlock;
+
+	BlockParams targets[2];
+	float fPositions[2] = { fStart, fEnd };
+	// a gliding block starts where the previous one ended
+	for ( int i = bFollows ? 1 : 0; i < 2; i++ ) {
+		float fPos = fPositions[i];
+		BlockParams& params = targets[i];
+
+		params.volume = automated_value( __automation[ AUTOMATION_VOLUME ], fPos, __volume );
+		if ( fPos < 0 || __automation[ AUTOMATION_PAN ]->empty() ) {
+			params.pan_l = __pan_l;
+			params.pan_r = __pan_r;
+		} else {
+			// same law as the mixer, the center leaves both sides at full level
+			float fPan = __automation[ AUTOMATION_PAN ]->get_value( fPos );
+			params.pan_l = fPan >= 0.5f ? ( 1.0f - fPan ) * 2 : 1.0f;
+			params.pan_r = fPan >= 0.5f ? 1.0f : fPan * 2;
+		}
+		params.filter_cutoff = automated_value( __automation[ AUTOMATION_FILTER_CUTOFF ], fPos, __filter_cutoff );
+		params.filter_resonance = automated_value( __automation[ AUTOMATION_FILTER_RESONANCE ], fPos, __filter_resonance );
+		for ( int nFX = 0; nFX < MAX_FX; nFX++ ) {
+			params.fx_level[ nFX ] = automated_value( __automation[ AUTOMATION_FX_LEVEL + nFX ], fPos, __fx_level[ nFX ] );
+		}
+	}
+
+	if ( !bFollows ) {
+		__block_params[0] = targets[0];
+		__block_params[1] = targets[1];
+		return;
+	}
+
+	// one pole smoothing evaluated at the block boundaries, the voices ramp in between
+	BlockParams& start = __block_params[0];
+	BlockParams& end = __block_params[1];
+	start = end;
+	glide( end.volume, targets[1].volume, fSmoothing );
+	glide( end.pan_l, targets[1].pan_l, fSmoothing );
+	glide( end.pan_r, targets[1].pan_r, fSmoothing );
+	glide( end.filter_cutoff, targets[1].filter_cutoff, fSmoothing );
+	glide( end.filter_resonance, targets[1].filter_resonance, fSmoothing );
+	for ( int nFX = 0; nFX < MAX_FX; nFX++ ) {
+		glide( end.fx_level[ nFX ], targets[1].fx_level[ nFX ], fSmoothing );
+	}
+}
+
+void Instrument::set_insert_fx( FxChain* chain )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	if ( __insert_fx == chain ) {
+		return;
+	}
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	FxChain* pOld = __insert_fx;
+	__insert_fx = chain;
+	AudioEngine::get_instance()->unlock();
+	delete pOld;
+#else
+	assert( chain == NULL );
+#endif
+}
+
+void Instrument::attach_insert_fx( FxChain* chain )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	assert( __insert_fx == NULL );
+	__insert_fx = chain;
+#else
+	assert( chain == NULL );
+#endif
 }
 
 Instrument* Instrument::load_instrument( const QString& drumkit_name, const QString& instrument_name )
@@ -231,6 +358,8 @@ void Instrument::load_from( Drumkit* pDrumkit, Instrument* pInstrument, bool is_
 	this->set_lower_cc( pInstrument->get_lower_cc() );
 	this->set_higher_cc( pInstrument->get_higher_cc() );
 	this->set_apply_velocity ( pInstrument->get_apply_velocity() );
+	this->set_synth_waveform( pInstrument->get_synth_waveform() );
+	this->set_synth_frequency( pInstrument->get_synth_frequency() );
 	
 	if ( is_live ) {
 		AudioEngine::get_instance()->unlock();
@@ -295,6 +424,8 @@ Instrument* Instrument::load_from( XMLNode* node, const QString& dk_path, const
 	pInstrument->set_hihat_grp( node->read_int( "isHihat", -1, true ) );
 	pInstrument->set_lower_cc( node->read_int( "lower_cc", 0, true ) );
 	pInstrument->set_higher_cc( node->read_int( "higher_cc", 127, true ) );
+	pInstrument->set_synth_waveform( synth_waveform_from_string( node->read_string( "synthWaveform", "OFF", true, false ) ) );
+	pInstrument->set_synth_frequency( node->read_float( "synthFrequency", 65.406f, true, false ) );
 
 	for ( int i=0; i<MAX_FX; i++ ) {
 		pInstrument->set_fx_level( node->read_float( QString( "FX%1Level" ).arg( i+1 ), 0.0 ), i );
@@ -373,6 +504,8 @@ void Instrument::save_to( XMLNode* node, int component_id )
 	InstrumentNode.write_int( "isHihat", __hihat_grp );
 	InstrumentNode.write_int( "lower_cc", __lower_cc );
 	InstrumentNode.write_int( "higher_cc", __higher_cc );
+	InstrumentNode.write_string( "synthWaveform", synth_waveform_to_string( __synth_waveform ) );
+	InstrumentNode.write_float( "synthFrequency", __synth_frequency );
 
 	for ( int i=0; i<MAX_FX; i++ ) {
 		InstrumentNode.write_float( QString( "FX%1Level" ).arg( i+1 ), __fx_level[i] );
@@ -384,6 +517,35 @@ void Instrument::save_to( XMLNode* node, int component_id )
 	}
 }
 
+QString Instrument::synth_waveform_to_string( SynthWaveform waveform )
+{
+	switch ( waveform ) {
+	case SYNTH_SINE:
+		return "SINE";
+	case SYNTH_TRIANGLE:
+		return "TRIANGLE";
+	case SYNTH_SAW:
+		return "SAW";
+	case SYNTH_SQUARE:
+		return "SQUARE";
+	default:
+		return "OFF";
+	}
+}
+
+Instrument::SynthWaveform Instrument::synth_waveform_from_string( const QString& sName )
+{
+	if ( sName.compare( "SINE" ) == 0 )
+		return SYNTH_SINE;
+	else if ( sName.compare( "TRIANGLE" ) == 0 )
+		return SYNTH_TRIANGLE;
+	else if ( sName.compare( "SAW" ) == 0 )
+		return SYNTH_SAW;
+	else if ( sName.compare( "SQUARE" ) == 0 )
+		return SYNTH_SQUARE;
+	return SYNTH_OFF;
+}
+
 void Instrument::set_adsr( ADSR* adsr )
 {
 	if( __adsr ) {
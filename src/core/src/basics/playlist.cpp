@@ -27,6 +27,7 @@
 #include <hydrogen/helpers/legacy.h>
 #include <hydrogen/helpers/xml.h>
 #include <hydrogen/event_queue.h>
+#include <hydrogen/song_preloader.h>
 
 namespace H2Core
 {
@@ -178,21 +179,33 @@ bool Playlist::loadSong( int songNumber )
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	Preferences *pPref = Preferences::get_instance();
 
-	if ( pHydrogen->getState() == STATE_PLAYING ) {
-		pHydrogen->sequencer_stop();
-	}
-
-	/* Load Song from file */
 	QString selected = get( songNumber )->filePath;
-	Song *pSong = Song::load( selected );
-	if ( ! pSong ) {
+
+	/* A preloaded song replaces the current one while playing */
+	SongReader::Globals* pGlobals = NULL;
+	bool bPending;
+	Song *pSong = SongPreloader::get_instance()->take( songNumber, selected, &pGlobals, &bPending );
+	if ( bPending ) {
+		// still being read or another entry was asked for since, its own
+		// event follows, until then the sequencer plays on
 		return false;
 	}
+	if ( ! pSong ) {
+		if ( pHydrogen->getState() == STATE_PLAYING ) {
+			pHydrogen->sequencer_stop();
+		}
+
+		/* Load Song from file */
+		pSong = Song::load( selected );
+		if ( ! pSong ) {
+			return false;
+		}
+	}
 
 	setSelectedSongNr( songNumber );
 	setActiveSongNumber( songNumber );
 
-	pHydrogen->setSong( pSong );
+	pHydrogen->switchSong( pSong, pGlobals );
 
 	pPref->setLastSongFilename( pSong->get_filename() );
 	vector<QString> recentFiles = pPref->getRecentFiles();
@@ -201,6 +214,11 @@ bool Playlist::loadSong( int songNumber )
 
 	execScript( songNumber );
 
+	/* Read the next song while this one plays */
+	if ( songNumber + 1 < size() ) {
+		SongPreloader::get_instance()->preload( songNumber + 1, get( songNumber + 1 )->filePath, false );
+	}
+
 	return true;
 }
 
@@ -211,8 +229,10 @@ void Playlist::setNextSongByNumber( int songNumber )
 		return;
 	}
 
-	/* NOTE: we are in MIDI thread and can't just call loadSong from here :( */
-	EventQueue::get_instance()->push_event( EVENT_PLAYLIST_LOADSONG, songNumber );
+	/* NOTE: we are in MIDI thread and can't just call loadSong from here :(
+	 * The song is read in the background, EVENT_PLAYLIST_LOADSONG comes
+	 * once it is read, at the start of a bar when playing. */
+	SongPreloader::get_instance()->preload( songNumber, get( songNumber )->filePath, true );
 }
 
 void Playlist::execScript( int index)
@@ -333,7 +333,7 @@ void Sample::apply_rubberband( const Rubberband& rb )
 	//if( __rubberband == rb ) return;
 	if( !rb.use ) return;
 	// compute rubberband options
-	double output_duration = 60.0 / Hydrogen::get_instance()->getNewBpmJTM() * rb.divider;
+	double output_duration = 60.0 / ( rb.bpm > 0 ? rb.bpm : Hydrogen::get_instance()->getNewBpmJTM() ) * rb.divider;
 	double time_ratio = output_duration / get_sample_duration();
 	RubberBand::RubberBandStretcher::Options options = compute_rubberband_options( rb );
 	double pitch_scale = compute_pitch_scale( rb );
@@ -436,6 +436,8 @@ void Sample::apply_rubberband( const Rubberband& rb )
 	delete [] out_data_r;
 	// update sample
 	__rubberband = rb;
+	// a later stretch follows the tempo of the engine again
+	__rubberband.bpm = 0;
 	__frames = retrieved;
 	__is_modified = true;
 #endif
@@ -460,7 +462,7 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
 
 		unsigned rubberoutframes = 0;
 		double ratio = 1.0;
-		double durationtime = 60.0 / Hydrogen::get_instance()->getNewBpmJTM() * rb.divider/*beats*/;
+		double durationtime = 60.0 / ( rb.bpm > 0 ? rb.bpm : Hydrogen::get_instance()->getNewBpmJTM() ) * rb.divider/*beats*/;
 		double induration = get_sample_duration();
 		if ( induration != 0.0 ) ratio = durationtime / induration;
 
@@ -510,6 +512,7 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
 		p_Rubberbanded->__data_r = 0;
 		__is_modified = true;
 		__rubberband = rb;
+		__rubberband.bpm = 0;
 		delete p_Rubberbanded;
 	}
 	return true;
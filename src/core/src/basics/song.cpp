@@ -29,6 +29,7 @@
 #include <hydrogen/Preferences.h>
 #include <hydrogen/event_queue.h>
 #include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/FxChain.h>
 #include <hydrogen/globals.h>
 #include <hydrogen/timeline.h>
 #include <hydrogen/basics/song.h>
@@ -49,6 +50,8 @@
 
 #include <QDomDocument>
 #include <QDir>
+#include <QHash>
+#include <QLocale>
 
 namespace
 {
@@ -222,7 +225,7 @@ void Song::set_swing_factor( float factor )
 		factor = 1.0;
 	}
 
-	__swing_factor = factor;
+	__swing_factor.store( factor, std::memory_order_relaxed );
 }
 
 void Song::set_is_modified(bool is_modified)
@@ -551,6 +554,30 @@ bool Song::pasteInstrumentLineFromString( const QString& serialized, int selecte
 
 const char* SongReader::__class_name = "SongReader";
 
+SongReader::Globals::Globals()
+	: fBpm( 120 )
+	, bPatternModePlaysSelected( true )
+{
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		ladspaFX[ nFX ] = NULL;
+	}
+}
+
+SongReader::Globals::~Globals()
+{
+#ifdef H2CORE_HAVE_LADSPA
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		delete ladspaFX[ nFX ];
+	}
+	for ( unsigned i = 0; i < instrumentFx.size(); ++i ) {
+		delete instrumentFx[i].second;
+	}
+	for ( unsigned i = 0; i < componentFx.size(); ++i ) {
+		delete componentFx[i].second;
+	}
+#endif
+}
+
 SongReader::SongReader()
 	: Object( __class_name )
 {
@@ -588,23 +615,44 @@ const QString SongReader::getPath ( const QString& filename )
 /// Reads a song.
 /// return NULL = error reading song file.
 ///
-Song* SongReader::readSong( const QString& filename )
+Song* SongReader::readSong( const QString& filename, Globals* pGlobals )
 {
+	Globals globals;
+	bool bApplyGlobals = pGlobals == NULL;
+	if ( bApplyGlobals ) {
+		pGlobals = &globals;
+	}
+
 	QString FileName = getPath ( filename );
 	if ( FileName.isEmpty() ) return NULL;
 
 	INFOLOG( "Reading " + FileName );
 	Song* song = NULL;
 
-	QDomDocument doc = LocalFileMng::openXmlDocument( FileName );
-	QDomNodeList nodeList = doc.elementsByTagName( "song" );
+	QFile file( FileName );
+	if ( !file.open( QIODevice::ReadOnly ) ) {
+		ERRORLOG( "Error reading song: unable to open " + FileName );
+		return NULL;
+	}
+
+	QByteArray compatBuffer;
+	QXmlStreamReader reader;
+	if ( LocalFileMng::checkTinyXMLCompatMode( FileName ) ) {
+		compatBuffer = LocalFileMng::readTinyXMLCompat( file );
+		reader.addData( compatBuffer );
+	} else {
+		reader.setDevice( &file );
+	}
 
-	if( nodeList.isEmpty() ) {
-		ERRORLOG( "Error reading song: song node not found" );
+	QDomDocument doc;
+	bool bRead = readStream( reader, doc );
+	file.close();
+	if ( !bRead ) {
+		ERRORLOG( "Error reading song: " + reader.errorString() );
 		return NULL;
 	}
 
-	QDomNode songNode = nodeList.at( 0 );
+	QDomNode songNode = doc.firstChildElement( "song" );
 
 	m_sSongVersion = LocalFileMng::readXmlString( songNode, "version", "Unknown version" );
 
@@ -614,7 +662,7 @@ Song* SongReader::readSong( const QString& filename )
 	}
 
 	float fBpm = LocalFileMng::readXmlFloat( songNode, "bpm", 120 );
-	Hydrogen::get_instance()->setNewBpmJTM( fBpm );
+	pGlobals->fBpm = fBpm;
 	float fVolume = LocalFileMng::readXmlFloat( songNode, "volume", 0.5 );
 	float fMetronomeVolume = LocalFileMng::readXmlFloat( songNode, "metronomeVolume", 0.5 );
 	QString sName( LocalFileMng::readXmlString( songNode, "name", "Untitled Song" ) );
@@ -622,7 +670,7 @@ Song* SongReader::readSong( const QString& filename )
 	QString sNotes( LocalFileMng::readXmlString( songNode, "notes", "..." ) );
 	QString sLicense( LocalFileMng::readXmlString( songNode, "license", "Unknown license" ) );
 	bool bLoopEnabled = LocalFileMng::readXmlBool( songNode, "loopEnabled", false );
-	Preferences::get_instance()->setPatternModePlaysSelected( LocalFileMng::readXmlBool( songNode, "patternModeMode", true ) );
+	pGlobals->bPatternModePlaysSelected = LocalFileMng::readXmlBool( songNode, "patternModeMode", true );
 	Song::SongMode nMode = Song::PATTERN_MODE;	// Mode (song/pattern)
 	QString sMode = LocalFileMng::readXmlString( songNode, "mode", "pattern" );
 	if ( sMode == "song" ) {
@@ -651,6 +699,12 @@ Song* SongReader::readSong( const QString& filename )
 	song->set_playback_track_enabled( bPlaybackTrackEnabled );
 	song->set_playback_track_volume( fPlaybackTrackVolume );
 
+#ifdef H2CORE_HAVE_LADSPA
+	// insert FX are instantiated at the rate of the running driver
+	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
+	long nFXSampleRate = pAudioOutput ? pAudioOutput->getSampleRate() : 44100;
+#endif
+
 	QDomNode componentListNode = songNode.firstChildElement( "componentList" );
 	if ( ( ! componentListNode.isNull()  ) ) {
 		QDomNode componentNode = componentListNode.firstChildElement( "drumkitComponent" );
@@ -660,6 +714,12 @@ Song* SongReader::readSong( const QString& filename )
 			float fVolume = LocalFileMng::readXmlFloat( componentNode, "volume", 1.0 );	// volume
 			DrumkitComponent* pDrumkitComponent = new DrumkitComponent( id, sName );
 			pDrumkitComponent->set_volume( fVolume );
+#ifdef H2CORE_HAVE_LADSPA
+			FxChain* pChain = FxChain::load_from( componentNode, nFXSampleRate );
+			if ( pChain ) {
+				pGlobals->componentFx.push_back( std::make_pair( pDrumkitComponent, pChain ) );
+			}
+#endif
 
 			song->get_components()->push_back(pDrumkitComponent);
 
@@ -684,7 +744,7 @@ Song* SongReader::readSong( const QString& filename )
 
 			int id = LocalFileMng::readXmlInt( instrumentNode, "id", -1 );			// instrument id
 			QString sDrumkit = LocalFileMng::readXmlString( instrumentNode, "drumkit", "" );	// drumkit
-			Hydrogen::get_instance()->setCurrentDrumkitname( sDrumkit );
+			pGlobals->sDrumkitName = sDrumkit;
 			QString sName = LocalFileMng::readXmlString( instrumentNode, "name", "" );		// name
 			float fVolume = LocalFileMng::readXmlFloat( instrumentNode, "volume", 1.0 );	// volume
 			bool bIsMuted = LocalFileMng::readXmlBool( instrumentNode, "isMuted", false );	// is muted
@@ -726,6 +786,8 @@ Song* SongReader::readSong( const QString& filename )
 			int iIsHiHat = LocalFileMng::readXmlInt( instrumentNode, "isHihat", -1, true );
 			int iLowerCC = LocalFileMng::readXmlInt( instrumentNode, "lower_cc", 0, true );
 			int iHigherCC = LocalFileMng::readXmlInt( instrumentNode, "higher_cc", 127, true );
+			QString sSynthWaveform = LocalFileMng::readXmlString( instrumentNode, "synthWaveform", "OFF", false, false );
+			float fSynthFrequency = LocalFileMng::readXmlFloat( instrumentNode, "synthFrequency", 65.406f, false, false );
 
 			// create a new instrument
 			Instrument* pInstrument = new Instrument( id, sName, new ADSR( fAttack, fDecay, fSustain, fRelease ) );
@@ -749,6 +811,8 @@ Song* SongReader::readSong( const QString& filename )
 			pInstrument->set_hihat_grp( iIsHiHat );
 			pInstrument->set_lower_cc( iLowerCC );
 			pInstrument->set_higher_cc( iHigherCC );
+			pInstrument->set_synth_waveform( Instrument::synth_waveform_from_string( sSynthWaveform ) );
+			pInstrument->set_synth_frequency( fSynthFrequency );
 			if ( sRead_sample_select_algo.compare("VELOCITY") == 0 )
 				pInstrument->set_sample_selection_alg( Instrument::VELOCITY );
 			else if ( sRead_sample_select_algo.compare("ROUND_ROBIN") == 0 )
@@ -824,6 +888,7 @@ Song* SongReader::readSong( const QString& filename )
 						ro.divider = LocalFileMng::readXmlFloat( layerNode, "rubberdivider", 0.0 );
 						ro.c_settings = LocalFileMng::readXmlInt( layerNode, "rubberCsettings", 1 );
 						ro.pitch = LocalFileMng::readXmlFloat( layerNode, "rubberPitch", 0.0 );
+						ro.bpm = fBpm;
 
 						float fMin = LocalFileMng::readXmlFloat( layerNode, "min", 0.0 );
 						float fMax = LocalFileMng::readXmlFloat( layerNode, "max", 1.0 );
@@ -910,6 +975,7 @@ Song* SongReader::readSong( const QString& filename )
 						ro.divider = LocalFileMng::readXmlFloat( layerNode, "rubberdivider", 0.0 );
 						ro.c_settings = LocalFileMng::readXmlInt( layerNode, "rubberCsettings", 1 );
 						ro.pitch = LocalFileMng::readXmlFloat( layerNode, "rubberPitch", 0.0 );
+						ro.bpm = fBpm;
 
 						float fMin = LocalFileMng::readXmlFloat( layerNode, "min", 0.0 );
 						float fMax = LocalFileMng::readXmlFloat( layerNode, "max", 1.0 );
@@ -970,6 +1036,12 @@ Song* SongReader::readSong( const QString& filename )
 					pInstrument->get_components()->push_back( pCompo );
 				}
 			}
+#ifdef H2CORE_HAVE_LADSPA
+			FxChain* pChain = FxChain::load_from( instrumentNode, nFXSampleRate );
+			if ( pChain ) {
+				pGlobals->instrumentFx.push_back( std::make_pair( pInstrument, pChain ) );
+			}
+#endif
 			instrumentList->add( pInstrument );
 			instrumentNode = ( QDomNode ) instrumentNode.nextSiblingElement( "instrument" );
 		}
@@ -986,157 +1058,61 @@ Song* SongReader::readSong( const QString& filename )
 	}
 
 	// Pattern list
-	QDomNode patterns = songNode.firstChildElement( "patternList" );
-
 	PatternList* patternList = new PatternList();
-	int pattern_count = 0;
-
-	QDomNode patternNode =  patterns.firstChildElement( "pattern" );
-	while (  !patternNode.isNull()  ) {
-		pattern_count++;
-		Pattern* pat = getPattern( patternNode, instrumentList );
-		if ( pat ) {
-			patternList->add( pat );
-		} else {
-			ERRORLOG( "Error loading pattern" );
-			delete patternList;
-			delete song;
-			return NULL;
+	QHash<QString, Pattern*> patternsByName;
+
+	for ( unsigned i = 0; i < m_patterns.size(); i++ ) {
+		Pattern* pat = getPattern( m_patterns[i], instrumentList );
+		patternList->add( pat );
+		if ( !patternsByName.contains( pat->get_name() ) ) {
+			patternsByName.insert( pat->get_name(), pat );
 		}
-		patternNode = ( QDomNode ) patternNode.nextSiblingElement( "pattern" );
 	}
-	if ( pattern_count == 0 ) {
+	if ( m_patterns.empty() ) {
 		WARNINGLOG( "0 patterns?" );
 	}
+	std::vector<PatternRecord>().swap( m_patterns );
 	song->set_pattern_list( patternList );
 
 	// Virtual Patterns
-	QDomNode  virtualPatternListNode = songNode.firstChildElement( "virtualPatternList" );
-	QDomNode virtualPatternNode = virtualPatternListNode.firstChildElement( "pattern" );
-	if ( !virtualPatternNode.isNull() ) {
-
-		while (  ! virtualPatternNode.isNull()  ) {
-			QString sName = "";
-			sName = LocalFileMng::readXmlString( virtualPatternNode, "name", sName );
-
-			Pattern* curPattern = NULL;
-			unsigned nPatterns = patternList->size();
-			for ( unsigned i = 0; i < nPatterns; i++ ) {
-				Pattern* pat = patternList->get( i );
-
-				if ( pat->get_name() == sName ) {
-					curPattern = pat;
-					break;
-				}//if
-			}//for
-
-			if ( curPattern != NULL ) {
-				QDomNode  virtualNode = virtualPatternNode.firstChildElement( "virtual" );
-				while (  !virtualNode.isNull()  ) {
-					QString virtName = virtualNode.firstChild().nodeValue();
-
-					Pattern* virtPattern = NULL;
-					for ( unsigned i = 0; i < nPatterns; i++ ) {
-						Pattern* pat = patternList->get( i );
-
-						if ( pat->get_name() == virtName ) {
-							virtPattern = pat;
-							break;
-						}//if
-					}//for
-
-					if ( virtPattern != NULL ) {
-						curPattern->virtual_patterns_add( virtPattern );
-					} else {
-						ERRORLOG( "Song had invalid virtual pattern list data (virtual)" );
-					}//if
-					virtualNode = ( QDomNode ) virtualNode.nextSiblingElement( "virtual" );
-				}//while
+	for ( unsigned i = 0; i < m_virtualPatterns.size(); i++ ) {
+		Pattern* curPattern = patternsByName.value( m_virtualPatterns[i].first, NULL );
+		if ( curPattern == NULL ) {
+			ERRORLOG( "Song had invalid virtual pattern list data (name)" );
+			continue;
+		}
+		const QStringList& virtNames = m_virtualPatterns[i].second;
+		for ( int j = 0; j < virtNames.size(); j++ ) {
+			Pattern* virtPattern = patternsByName.value( virtNames[j], NULL );
+			if ( virtPattern != NULL ) {
+				curPattern->virtual_patterns_add( virtPattern );
 			} else {
-				ERRORLOG( "Song had invalid virtual pattern list data (name)" );
-			}//if
-			virtualPatternNode = ( QDomNode ) virtualPatternNode.nextSiblingElement( "pattern" );
-		}//while
-	}//if
+				ERRORLOG( "Song had invalid virtual pattern list data (virtual)" );
+			}
+		}
+	}
 
 	patternList->flattened_virtual_patterns_compute();
 
 	// Pattern sequence
-	QDomNode patternSequenceNode = songNode.firstChildElement( "patternSequence" );
-
 	std::vector<PatternList*>* pPatternGroupVector = new std::vector<PatternList*>;
 
-	// back-compatibility code..
-	QDomNode pPatternIDNode = patternSequenceNode.firstChildElement( "patternID" );
-	while ( ! pPatternIDNode.isNull()  ) {
-		WARNINGLOG( "Using old patternSequence code for back compatibility" );
+	for ( unsigned i = 0; i < m_patternSequence.size(); i++ ) {
 		PatternList* patternSequence = new PatternList();
-		QString patId = pPatternIDNode.firstChildElement().text();
-		ERRORLOG( patId );
-
-		Pattern* pat = NULL;
-		for ( unsigned i = 0; i < patternList->size(); i++ ) {
-			Pattern* tmp = patternList->get( i );
-			if ( tmp ) {
-				if ( tmp->get_name() == patId ) {
-					pat = tmp;
-					break;
-				}
-			}
-		}
-		if ( pat == NULL ) {
-			WARNINGLOG( "patternid not found in patternSequence" );
-			pPatternIDNode = ( QDomNode ) pPatternIDNode.nextSiblingElement( "patternID" );
-			continue;
-		}
-		patternSequence->add( pat );
-
-		pPatternGroupVector->push_back( patternSequence );
-
-		pPatternIDNode = ( QDomNode ) pPatternIDNode.nextSiblingElement( "patternID" );
-	}
-
-	QDomNode groupNode = patternSequenceNode.firstChildElement( "group" );
-	while (  !groupNode.isNull()  ) {
-		PatternList* patternSequence = new PatternList();
-		QDomNode patternId = groupNode.firstChildElement( "patternID" );
-		while (  !patternId.isNull()  ) {
-			QString patId = patternId.firstChild().nodeValue();
-
-			Pattern* pat = NULL;
-			for ( unsigned i = 0; i < patternList->size(); i++ ) {
-				Pattern* tmp = patternList->get( i );
-				if ( tmp ) {
-					if ( tmp->get_name() == patId ) {
-						pat = tmp;
-						break;
-					}
-				}
-			}
+		const QStringList& patIds = m_patternSequence[i];
+		for ( int j = 0; j < patIds.size(); j++ ) {
+			Pattern* pat = patternsByName.value( patIds[j], NULL );
 			if ( pat == NULL ) {
 				WARNINGLOG( "patternid not found in patternSequence" );
-				patternId = ( QDomNode ) patternId.nextSiblingElement( "patternID" );
 				continue;
 			}
 			patternSequence->add( pat );
-			patternId = ( QDomNode ) patternId.nextSiblingElement( "patternID" );
 		}
 		pPatternGroupVector->push_back( patternSequence );
-
-		groupNode = groupNode.nextSiblingElement( "group" );
 	}
 
 	song->set_pattern_group_vector( pPatternGroupVector );
 
-#ifdef H2CORE_HAVE_LADSPA
-	// reset FX
-	for ( int fx = 0; fx < MAX_FX; ++fx ) {
-		//LadspaFX* pFX = Effects::get_instance()->getLadspaFX( fx );
-		//delete pFX;
-		Effects::get_instance()->setLadspaFX( NULL, fx );
-	}
-#endif
-
 	// LADSPA FX
 	QDomNode ladspaNode = songNode.firstChildElement( "ladspa" );
 	if ( !ladspaNode.isNull() ) {
@@ -1148,11 +1124,11 @@ Song* SongReader::readSong( const QString& filename )
 			bool bEnabled = LocalFileMng::readXmlBool( fxNode, "enabled", false );
 			float fVolume = LocalFileMng::readXmlFloat( fxNode, "volume", 1.0 );
 
-			if ( sName != "no plugin" ) {
+			if ( sName != "no plugin" && nFX < MAX_FX ) {
 				// FIXME: il caricamento va fatto fare all'engine, solo lui sa il samplerate esatto
 #ifdef H2CORE_HAVE_LADSPA
 				LadspaFX* pFX = LadspaFX::load( sFilename, sName, 44100 );
-				Effects::get_instance()->setLadspaFX( pFX, nFX );
+				pGlobals->ladspaFX[ nFX ] = pFX;
 				if ( pFX ) {
 					pFX->setEnabled( bEnabled );
 					pFX->setVolume( fVolume );
@@ -1179,8 +1155,6 @@ Song* SongReader::readSong( const QString& filename )
 		WARNINGLOG( "ladspa node not found" );
 	}
 
-	Timeline* pTimeline = Hydrogen::get_instance()->getTimeline();
-	pTimeline->m_timelinevector.clear();
 	Timeline::HTimelineVector tlvector;
 	QDomNode bpmTimeLine = songNode.firstChildElement( "BPMTimeLine" );
 	if ( !bpmTimeLine.isNull() ) {
@@ -1188,15 +1162,13 @@ Song* SongReader::readSong( const QString& filename )
 		while( !newBPMNode.isNull() ) {
 			tlvector.m_htimelinebeat = LocalFileMng::readXmlInt( newBPMNode, "BAR", 0 );
 			tlvector.m_htimelinebpm = LocalFileMng::readXmlFloat( newBPMNode, "BPM", 120.0 );
-			pTimeline->m_timelinevector.push_back( tlvector );
-			pTimeline->sortTimelineVector();
+			pGlobals->timeline.push_back( tlvector );
 			newBPMNode = newBPMNode.nextSiblingElement( "newBPM" );
 		}
 	} else {
 		WARNINGLOG( "bpmTimeLine node not found" );
 	}
 
-	pTimeline->m_timelinetagvector.clear();
 	Timeline::HTimelineTagVector tltagvector;
 	QDomNode timeLineTag = songNode.firstChildElement( "timeLineTag" );
 	if ( !timeLineTag.isNull() ) {
@@ -1204,8 +1176,7 @@ Song* SongReader::readSong( const QString& filename )
 		while( !newTAGNode.isNull() ) {
 			tltagvector.m_htimelinetagbeat = LocalFileMng::readXmlInt( newTAGNode, "BAR", 0 );
 			tltagvector.m_htimelinetag = LocalFileMng::readXmlString( newTAGNode, "TAG", "" );
-			pTimeline->m_timelinetagvector.push_back( tltagvector );
-			pTimeline->sortTimelineTagVector();
+			pGlobals->timelineTags.push_back( tltagvector );
 			newTAGNode = newTAGNode.nextSiblingElement( "newTAG" );
 		}
 	} else {
@@ -1216,130 +1187,303 @@ Song* SongReader::readSong( const QString& filename )
 	QDomNode automationPathsNode = songNode.firstChildElement( "automationPaths" );
 	if ( !automationPathsNode.isNull() ) {
 		AutomationPathSerializer pathSerializer;
+		pathSerializer.read_automation_paths( automationPathsNode, song );
+	}
 
-		QDomElement pathNode = automationPathsNode.firstChildElement( "path" );
-		while( !pathNode.isNull()) {
-			QString sAdjust = pathNode.attribute( "adjust" );
+	song->set_is_modified( false );
+	song->set_filename( FileName );
 
-			// Select automation path to be read based on "adjust" attribute
-			AutomationPath *pPath = NULL;
-			if (sAdjust == "velocity") {
-				pPath = song->get_velocity_automation_path();
-			}
+	if ( bApplyGlobals ) {
+		// nobody plays the song yet
+		attachInsertFx( pGlobals );
+		applyGlobals( pGlobals );
+	}
 
-			if (pPath) {
-				pathSerializer.read_automation_path( pathNode, *pPath );
-			}
+	return song;
+}
+
+void SongReader::applyGlobals( Globals* pGlobals, bool bLadspaFX )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	pHydrogen->setNewBpmJTM( pGlobals->fBpm );
+	Preferences::get_instance()->setPatternModePlaysSelected( pGlobals->bPatternModePlaysSelected );
+	if ( !pGlobals->sDrumkitName.isNull() ) {
+		pHydrogen->setCurrentDrumkitname( pGlobals->sDrumkitName );
+	}
+
+#ifdef H2CORE_HAVE_LADSPA
+	for ( int nFX = 0; bLadspaFX && nFX < MAX_FX; ++nFX ) {
+		Effects::get_instance()->setLadspaFX( pGlobals->ladspaFX[ nFX ], nFX );
+		pGlobals->ladspaFX[ nFX ] = NULL;
+	}
+#endif
+
+	Timeline* pTimeline = pHydrogen->getTimeline();
+	pTimeline->m_timelinevector = pGlobals->timeline;
+	pTimeline->sortTimelineVector();
+	pTimeline->m_timelinetagvector = pGlobals->timelineTags;
+	pTimeline->sortTimelineTagVector();
+}
+
+void SongReader::attachInsertFx( Globals* pGlobals )
+{
+	for ( unsigned i = 0; i < pGlobals->instrumentFx.size(); ++i ) {
+		pGlobals->instrumentFx[i].first->attach_insert_fx( pGlobals->instrumentFx[i].second );
+	}
+	pGlobals->instrumentFx.clear();
+	for ( unsigned i = 0; i < pGlobals->componentFx.size(); ++i ) {
+		pGlobals->componentFx[i].first->attach_insert_fx( pGlobals->componentFx[i].second );
+	}
+	pGlobals->componentFx.clear();
+}
 
-			pathNode = pathNode.nextSiblingElement( "path" );
+Pattern* SongReader::getPattern( const PatternRecord& record, InstrumentList* instrList )
+{
+	Pattern* pPattern = new Pattern( record.sName, record.sInfo, record.sCategory, record.nSize );
+
+	for ( unsigned i = 0; i < record.notes.size(); i++ ) {
+		const NoteRecord& note = record.notes[i];
+
+		Instrument* instrRef = instrList->find( note.nInstrument );
+		if ( !instrRef ) {
+			ERRORLOG( QString( "Instrument with ID: '%1' not found. Note skipped." ).arg( note.nInstrument ) );
+			continue;
 		}
+
+		Note* pNote = new Note( instrRef, note.nPosition, note.fVelocity, note.fPan_L, note.fPan_R, note.nLength, note.fPitch );
+		pNote->set_key_octave( note.sKey );
+		pNote->set_lead_lag( note.fLeadLag );
+		pNote->set_note_off( note.bNoteOff );
+		pNote->set_probability( note.fProbability );
+		pPattern->insert_note( pNote );
 	}
 
-	song->set_is_modified( false );
-	song->set_filename( FileName );
+	return pPattern;
+}
 
-	return song;
+/// text of the current element, default_value if it is empty
+static QString read_text( QXmlStreamReader& reader, const QString& default_value )
+{
+	QString text = reader.readElementText( QXmlStreamReader::IncludeChildElements );
+	if ( text.isEmpty() ) {
+		return default_value;
+	}
+	return text;
 }
 
-Pattern* SongReader::getPattern( QDomNode pattern, InstrumentList* instrList )
+/// copy the current element and its content under parent
+static void copy_element( QXmlStreamReader& reader, QDomDocument& doc, QDomNode& parent )
 {
-	Pattern* pPattern = NULL;
-
-	QString sName;	// name
-	sName = LocalFileMng::readXmlString( pattern, "name", sName );
-	QString sInfo;
-	sInfo = LocalFileMng::readXmlString( pattern, "info", sInfo,false,false );
-	QString sCategory; // category
-	sCategory = LocalFileMng::readXmlString( pattern, "category", sCategory,false,false );
-
-	int nSize = -1;
-	nSize = LocalFileMng::readXmlInt( pattern, "size", nSize, false, false );
-
-	pPattern = new Pattern( sName, sInfo, sCategory, nSize );
-
-	QDomNode pNoteListNode = pattern.firstChildElement( "noteList" );
-	if ( ! pNoteListNode.isNull() ) {
-		// new code :)
-		QDomNode noteNode = pNoteListNode.firstChildElement( "note" );
-		while ( ! noteNode.isNull()  ) {
-
-			Note* pNote = NULL;
-
-			unsigned nPosition = LocalFileMng::readXmlInt( noteNode, "position", 0 );
-			float fLeadLag = LocalFileMng::readXmlFloat( noteNode, "leadlag", 0.0, false, false );
-			float fVelocity = LocalFileMng::readXmlFloat( noteNode, "velocity", 0.8f );
-			float fPan_L = LocalFileMng::readXmlFloat( noteNode, "pan_L", 0.5 );
-			float fPan_R = LocalFileMng::readXmlFloat( noteNode, "pan_R", 0.5 );
-			int nLength = LocalFileMng::readXmlInt( noteNode, "length", -1, true );
-			float nPitch = LocalFileMng::readXmlFloat( noteNode, "pitch", 0.0, false, false );
-			float fProbability = LocalFileMng::readXmlFloat( noteNode, "probability", 1.0, false, false );
-			QString sKey = LocalFileMng::readXmlString( noteNode, "key", "C0", false, false );
-			QString nNoteOff = LocalFileMng::readXmlString( noteNode, "note_off", "false", false, false );
-
-			int instrId = LocalFileMng::readXmlInt( noteNode, "instrument", -1 );
-
-			Instrument* instrRef = NULL;
-			// search instrument by ref
-			instrRef = instrList->find( instrId );
-			if ( !instrRef ) {
-				ERRORLOG( QString( "Instrument with ID: '%1' not found. Note skipped." ).arg( instrId ) );
-				noteNode = ( QDomNode ) noteNode.nextSiblingElement( "note" );
-				continue;
-			}
-			//assert( instrRef );
-			bool noteoff = false;
-			if ( nNoteOff == "true" )
-				noteoff = true;
-
-			pNote = new Note( instrRef, nPosition, fVelocity, fPan_L, fPan_R, nLength, nPitch );
-			pNote->set_key_octave( sKey );
-			pNote->set_lead_lag( fLeadLag );
-			pNote->set_note_off( noteoff );
-			pNote->set_probability( fProbability );
-			pPattern->insert_note( pNote );
-
-			noteNode = ( QDomNode ) noteNode.nextSiblingElement( "note" );
+	QDomElement element = doc.createElement( reader.name().toString() );
+	foreach ( const QXmlStreamAttribute& attribute, reader.attributes() ) {
+		element.setAttribute( attribute.name().toString(), attribute.value().toString() );
+	}
+	parent.appendChild( element );
+
+	// the text may come in several chunks, entities and CDATA are reported apart
+	QString text;
+	while ( !reader.atEnd() ) {
+		reader.readNext();
+		if ( reader.isStartElement() ) {
+			copy_element( reader, doc, element );
+		} else if ( reader.isCharacters() ) {
+			text += reader.text();
+		} else if ( reader.isEndElement() ) {
+			break;
 		}
-	} else {
-		// Back compatibility code. Version < 0.9.4
-		QDomNode sequenceListNode = pattern.firstChildElement( "sequenceList" );
+	}
+	if ( !text.trimmed().isEmpty() ) {
+		element.appendChild( doc.createTextNode( text ) );
+	}
+}
 
-		int sequence_count = 0;
-		QDomNode sequenceNode = sequenceListNode.firstChildElement( "sequence" );
-		while ( ! sequenceNode.isNull()  ) {
-			sequence_count++;
+bool SongReader::readStream( QXmlStreamReader& reader, QDomDocument& doc )
+{
+	m_patterns.clear();
+	m_virtualPatterns.clear();
+	m_patternSequence.clear();
 
-			QDomNode noteListNode = sequenceNode.firstChildElement( "noteList" );
-			QDomNode noteNode = noteListNode.firstChildElement( "note" );
-			while (  !noteNode.isNull() ) {
+	if ( !reader.readNextStartElement() ) {
+		return false;
+	}
+	if ( reader.name() != "song" ) {
+		reader.raiseError( "song node not found" );
+		return false;
+	}
 
-				Note* pNote = NULL;
+	QDomNode songNode = doc.createElement( "song" );
+	doc.appendChild( songNode );
 
-				unsigned nPosition = LocalFileMng::readXmlInt( noteNode, "position", 0 );
-				float fLeadLag = LocalFileMng::readXmlFloat( noteNode, "leadlag", 0.0, false, false );
-				float fVelocity = LocalFileMng::readXmlFloat( noteNode, "velocity", 0.8f );
-				float fPan_L = LocalFileMng::readXmlFloat( noteNode, "pan_L", 0.5 );
-				float fPan_R = LocalFileMng::readXmlFloat( noteNode, "pan_R", 0.5 );
-				int nLength = LocalFileMng::readXmlInt( noteNode, "length", -1, true );
-				float nPitch = LocalFileMng::readXmlFloat( noteNode, "pitch", 0.0, false, false );
+	while ( reader.readNextStartElement() ) {
+		if ( reader.name() == "patternList" ) {
+			while ( reader.readNextStartElement() ) {
+				if ( reader.name() == "pattern" ) {
+					readPattern( reader );
+				} else {
+					reader.skipCurrentElement();
+				}
+			}
+		} else if ( reader.name() == "virtualPatternList" ) {
+			while ( reader.readNextStartElement() ) {
+				if ( reader.name() == "pattern" ) {
+					readVirtualPattern( reader );
+				} else {
+					reader.skipCurrentElement();
+				}
+			}
+		} else if ( reader.name() == "patternSequence" ) {
+			readPatternSequence( reader );
+		} else {
+			copy_element( reader, doc, songNode );
+		}
+	}
 
-				int instrId = LocalFileMng::readXmlInt( noteNode, "instrument", -1 );
+	return !reader.hasError();
+}
 
-				Instrument* instrRef = instrList->find( instrId );
-				assert( instrRef );
+void SongReader::readPattern( QXmlStreamReader& reader )
+{
+	PatternRecord pattern;
+	pattern.nSize = -1;
+	bool bNoteList = false;
+	std::vector<NoteRecord> sequenceNotes;
+
+	while ( reader.readNextStartElement() ) {
+		if ( reader.name() == "name" ) {
+			pattern.sName = read_text( reader, "" );
+		} else if ( reader.name() == "info" ) {
+			pattern.sInfo = read_text( reader, "" );
+		} else if ( reader.name() == "category" ) {
+			pattern.sCategory = read_text( reader, "" );
+		} else if ( reader.name() == "size" ) {
+			pattern.nSize = QLocale::c().toInt( read_text( reader, "-1" ) );
+		} else if ( reader.name() == "noteList" ) {
+			bNoteList = true;
+			readNoteList( reader, pattern.notes );
+		} else if ( reader.name() == "sequenceList" ) {
+			// Back compatibility code. Version < 0.9.4
+			while ( reader.readNextStartElement() ) {
+				if ( reader.name() == "sequence" ) {
+					while ( reader.readNextStartElement() ) {
+						if ( reader.name() == "noteList" ) {
+							readNoteList( reader, sequenceNotes );
+						} else {
+							reader.skipCurrentElement();
+						}
+					}
+				} else {
+					reader.skipCurrentElement();
+				}
+			}
+		} else {
+			reader.skipCurrentElement();
+		}
+	}
 
-				pNote = new Note( instrRef, nPosition, fVelocity, fPan_L, fPan_R, nLength, nPitch );
-				pNote->set_lead_lag( fLeadLag );
+	if ( !bNoteList ) {
+		pattern.notes.swap( sequenceNotes );
+	}
+	m_patterns.push_back( pattern );
+}
 
-				//infoLog( "new note!! pos: " + toString( pNote->m_nPosition ) + "\t instr: " + instrId );
-				pPattern->insert_note( pNote );
+void SongReader::readNoteList( QXmlStreamReader& reader, std::vector<NoteRecord>& notes )
+{
+	while ( reader.readNextStartElement() ) {
+		if ( reader.name() != "note" ) {
+			reader.skipCurrentElement();
+			continue;
+		}
 
-				noteNode = ( QDomNode ) noteNode.nextSiblingElement( "note" );
+		NoteRecord note;
+		note.nPosition = 0;
+		note.fLeadLag = 0.0;
+		note.fVelocity = 0.8f;
+		note.fPan_L = 0.5;
+		note.fPan_R = 0.5;
+		note.nLength = -1;
+		note.fPitch = 0.0;
+		note.fProbability = 1.0;
+		note.sKey = "C0";
+		note.bNoteOff = false;
+		note.nInstrument = -1;
+
+		while ( reader.readNextStartElement() ) {
+			QStringRef name = reader.name();
+			QString text = reader.readElementText( QXmlStreamReader::IncludeChildElements );
+			if ( text.isEmpty() ) {
+				continue;
+			}
+			if ( name == "position" ) {
+				note.nPosition = QLocale::c().toInt( text );
+			} else if ( name == "leadlag" ) {
+				note.fLeadLag = QLocale::c().toFloat( text );
+			} else if ( name == "velocity" ) {
+				note.fVelocity = QLocale::c().toFloat( text );
+			} else if ( name == "pan_L" ) {
+				note.fPan_L = QLocale::c().toFloat( text );
+			} else if ( name == "pan_R" ) {
+				note.fPan_R = QLocale::c().toFloat( text );
+			} else if ( name == "length" ) {
+				note.nLength = QLocale::c().toInt( text );
+			} else if ( name == "pitch" ) {
+				note.fPitch = QLocale::c().toFloat( text );
+			} else if ( name == "probability" ) {
+				note.fProbability = QLocale::c().toFloat( text );
+			} else if ( name == "key" ) {
+				note.sKey = text;
+			} else if ( name == "note_off" ) {
+				note.bNoteOff = ( text == "true" );
+			} else if ( name == "instrument" ) {
+				note.nInstrument = QLocale::c().toInt( text );
 			}
-			sequenceNode = ( QDomNode ) sequenceNode.nextSiblingElement( "sequence" );
 		}
+		notes.push_back( note );
 	}
+}
 
-	return pPattern;
+void SongReader::readVirtualPattern( QXmlStreamReader& reader )
+{
+	std::pair<QString, QStringList> virtualPattern;
+	while ( reader.readNextStartElement() ) {
+		if ( reader.name() == "name" ) {
+			virtualPattern.first = read_text( reader, "" );
+		} else if ( reader.name() == "virtual" ) {
+			virtualPattern.second << reader.readElementText( QXmlStreamReader::IncludeChildElements );
+		} else {
+			reader.skipCurrentElement();
+		}
+	}
+	m_virtualPatterns.push_back( virtualPattern );
+}
+
+void SongReader::readPatternSequence( QXmlStreamReader& reader )
+{
+	while ( reader.readNextStartElement() ) {
+		if ( reader.name() == "group" ) {
+			QStringList group;
+			while ( reader.readNextStartElement() ) {
+				if ( reader.name() == "patternID" ) {
+					group << reader.readElementText( QXmlStreamReader::IncludeChildElements );
+				} else {
+					reader.skipCurrentElement();
+				}
+			}
+			m_patternSequence.push_back( group );
+		} else if ( reader.name() == "patternID" ) {
+			// back-compatibility code, a group of one pattern named by the first child
+			WARNINGLOG( "Using old patternSequence code for back compatibility" );
+			QString patId;
+			if ( reader.readNextStartElement() ) {
+				patId = reader.readElementText( QXmlStreamReader::IncludeChildElements );
+				while ( reader.readNextStartElement() ) {
+					reader.skipCurrentElement();
+				}
+			}
+			m_patternSequence.push_back( QStringList( patId ) );
+		} else {
+			reader.skipCurrentElement();
+		}
+	}
 }
+
 };
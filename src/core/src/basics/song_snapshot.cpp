@@ -0,0 +1,237 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/song_snapshot.h>
+
+#include <hydrogen/globals.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/note.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace H2Core
+{
+
+const char* SongSnapshot::__class_name = "SongSnapshot";
+
+/** true if the copy of a note still plays as the note */
+static bool same_note( Note* note, Note* copy )
+{
+	return note->get_instrument() == copy->get_instrument()
+		   && note->get_position() == copy->get_position()
+		   && note->get_velocity() == copy->get_velocity()
+		   && note->get_pan_l() == copy->get_pan_l()
+		   && note->get_pan_r() == copy->get_pan_r()
+		   && note->get_length() == copy->get_length()
+		   && note->get_pitch() == copy->get_pitch()
+		   && note->get_key() == copy->get_key()
+		   && note->get_octave() == copy->get_octave()
+		   && note->get_lead_lag() == copy->get_lead_lag()
+		   && note->get_probability() == copy->get_probability()
+		   && note->get_note_off() == copy->get_note_off()
+		   && note->get_specific_compo_id() == copy->get_specific_compo_id();
+}
+
+static bool note_before_tick( const Note* note, int tick )
+{
+	return note->get_position() < tick;
+}
+
+SongSnapshot::PatternData::~PatternData()
+{
+	for ( unsigned i = 0; i < notes.size(); i++ ) {
+		delete notes[i];
+	}
+}
+
+SongSnapshot::SongSnapshot( Song* song, const SongSnapshot* previous, const std::vector<const Pattern*>* edited )
+	: Object( __class_name )
+	, __length( 0 )
+	, __changes( false )
+{
+	if ( song != NULL ) {
+		PatternList* patterns = song->get_pattern_list();
+		for ( int i = 0; i < patterns->size(); i++ ) {
+			Pattern* pattern = patterns->get( i );
+			__patterns.push_back( take_pattern( pattern, previous, edited ) );
+			__index.push_back( std::make_pair( ( const Pattern* )pattern, i ) );
+		}
+		std::sort( __index.begin(), __index.end() );
+
+		// the sequencer plays the virtual patterns along with the ones they belong to
+		__playing.resize( __patterns.size() );
+		for ( int i = 0; i < patterns->size(); i++ ) {
+			__playing[i].push_back( i );
+			const Pattern::virtual_patterns_t* virtuals = patterns->get( i )->get_flattened_virtual_patterns();
+			for ( Pattern::virtual_patterns_cst_it_t it = virtuals->begin(); it != virtuals->end(); ++it ) {
+				int idx = find_pattern( *it );
+				if ( idx != -1 && std::find( __playing[i].begin(), __playing[i].end(), idx ) == __playing[i].end() ) {
+					__playing[i].push_back( idx );
+				}
+			}
+		}
+
+		std::vector<PatternList*>* columns = song->get_pattern_group_vector();
+		for ( unsigned i = 0; i < columns->size(); i++ ) {
+			PatternList* column = ( *columns )[i];
+			Column data;
+			data.start = __length;
+			// the first pattern gives the length of the column
+			data.length = column->size() != 0 ? column->get( 0 )->get_length() : MAX_NOTES;
+			for ( int j = 0; j < column->size(); j++ ) {
+				int idx = find_pattern( column->get( j ) );
+				if ( idx == -1 ) {
+					continue;
+				}
+				for ( unsigned k = 0; k < __playing[ idx ].size(); k++ ) {
+					int played = __playing[ idx ][k];
+					if ( std::find( data.patterns.begin(), data.patterns.end(), played ) == data.patterns.end() ) {
+						data.patterns.push_back( played );
+					}
+				}
+			}
+			__columns.push_back( data );
+			__length += data.length;
+		}
+	}
+
+	if ( previous == NULL
+		 || __patterns != previous->__patterns
+		 || __playing != previous->__playing
+		 || __columns.size() != previous->__columns.size() ) {
+		__changes = true;
+		return;
+	}
+	for ( unsigned i = 0; i < __columns.size(); i++ ) {
+		const Column& column = __columns[i];
+		const Column& other = previous->__columns[i];
+		if ( column.length != other.length || column.patterns != other.patterns ) {
+			__changes = true;
+			return;
+		}
+	}
+}
+
+SongSnapshot::~SongSnapshot()
+{
+}
+
+std::shared_ptr<SongSnapshot::PatternData> SongSnapshot::take_pattern( Pattern* pattern, const SongSnapshot* previous,
+																	   const std::vector<const Pattern*>* edited )
+{
+	const Pattern::notes_t* notes = pattern->get_notes();
+	int idx = previous != NULL ? previous->find_pattern( pattern ) : -1;
+	const PatternData* old = idx != -1 ? previous->get_pattern( idx ) : NULL;
+
+	if ( old != NULL && edited != NULL
+		 && std::find( edited->begin(), edited->end(), pattern ) == edited->end() ) {
+		return previous->__patterns[ idx ];
+	}
+	if ( old != NULL && old->length == pattern->get_length() && old->sources.size() == notes->size() ) {
+		bool equal = true;
+		unsigned i = 0;
+		for ( Pattern::notes_cst_it_t it = notes->begin(); it != notes->end() && equal; ++it, ++i ) {
+			equal = it->second == old->sources[i] && same_note( it->second, old->notes[i] );
+		}
+		if ( equal ) {
+			return previous->__patterns[ idx ];
+		}
+	}
+
+	std::shared_ptr<PatternData> data = std::make_shared<PatternData>();
+	data->pattern = pattern;
+	data->length = pattern->get_length();
+	data->notes.reserve( notes->size() );
+	data->sources.reserve( notes->size() );
+	for ( Pattern::notes_cst_it_t it = notes->begin(); it != notes->end(); ++it ) {
+		Note* note = it->second;
+		if ( note->get_just_recorded() && old != NULL ) {
+			// the audio thread clears the flag of the copy once it played the note
+			std::vector<Note*>::const_iterator source = std::find( old->sources.begin(), old->sources.end(), note );
+			if ( source != old->sources.end() && !old->notes[ source - old->sources.begin() ]->get_just_recorded() ) {
+				note->set_just_recorded( false );
+			}
+		}
+		data->notes.push_back( new Note( note ) );
+		data->sources.push_back( note );
+	}
+	return data;
+}
+
+int SongSnapshot::find_pattern( const Pattern* pattern ) const
+{
+	std::vector< std::pair<const Pattern*, int> >::const_iterator it =
+		std::lower_bound( __index.begin(), __index.end(), std::make_pair( pattern, -1 ) );
+	if ( it == __index.end() || it->first != pattern ) {
+		return -1;
+	}
+	return it->second;
+}
+
+unsigned SongSnapshot::first_note_at( const PatternData* pattern, int tick )
+{
+	return std::lower_bound( pattern->notes.begin(), pattern->notes.end(), tick, note_before_tick ) - pattern->notes.begin();
+}
+
+int SongSnapshot::find_column( int tick, int* column_start ) const
+{
+	if ( tick < 0 || tick >= __length ) {
+		return -1;
+	}
+	// the last column starting at or before the tick
+	int lo = 0;
+	int hi = __columns.size() - 1;
+	while ( lo < hi ) {
+		int mid = ( lo + hi + 1 ) / 2;
+		if ( __columns[ mid ].start <= tick ) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	*column_start = __columns[ lo ].start;
+	return lo;
+}
+
+float SongSnapshot::get_column_position( double tick, bool loop ) const
+{
+	if ( tick >= __length ) {
+		if ( !loop || __length == 0 ) {
+			return -1;
+		}
+		tick = fmod( tick, __length );
+	}
+
+	int start = 0;
+	int idx = find_column( ( int )tick, &start );
+	if ( idx == -1 ) {
+		return -1;
+	}
+	return idx + ( float )( ( tick - start ) / __columns[ idx ].length );
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
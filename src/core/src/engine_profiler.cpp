@@ -0,0 +1,209 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/engine_profiler.h>
+
+#include <algorithm>
+#include <chrono>
+
+/* durations below 2^PROFILER_MIN_OCTAVE ns share the first bucket */
+#define PROFILER_MIN_OCTAVE 8
+
+namespace H2Core
+{
+
+EngineProfiler* EngineProfiler::__instance = NULL;
+const char* EngineProfiler::__class_name = "EngineProfiler";
+
+void EngineProfiler::create_instance()
+{
+	if ( __instance == 0 ) {
+		__instance = new EngineProfiler;
+	}
+}
+
+EngineProfiler::EngineProfiler()
+	: Object( __class_name )
+	, __xruns( 0 )
+	, __driver_xruns( 0 )
+	, __budget( 0 )
+	, __reset_requested( false )
+{
+	__instance = this;
+	for ( int i = 0; i < STAGES; ++i ) {
+		__stages[ i ].clear();
+	}
+}
+
+EngineProfiler::~EngineProfiler()
+{
+	__instance = NULL;
+}
+
+const char* EngineProfiler::stage_name( Stage stage )
+{
+	switch ( stage ) {
+	case NOTE_QUEUE:    return "NOTE_QUEUE";
+	case PLAY_NOTES:    return "PLAY_NOTES";
+	case SAMPLER:       return "SAMPLER";
+	case SYNTH:         return "SYNTH";
+	case LADSPA:        return "LADSPA";
+	case METERING:      return "METERING";
+	case PROCESS:       return "PROCESS";
+	default:            return "UNKNOWN";
+	}
+}
+
+uint64_t EngineProfiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+void EngineProfiler::Histogram::clear()
+{
+	for ( int i = 0; i < PROFILER_BUCKETS; ++i ) {
+		buckets[ i ].store( 0, std::memory_order_relaxed );
+	}
+	count.store( 0, std::memory_order_relaxed );
+	total.store( 0, std::memory_order_relaxed );
+	max.store( 0, std::memory_order_relaxed );
+}
+
+int EngineProfiler::bucket_of( uint64_t nNs )
+{
+	if ( nNs < ( 1ULL << PROFILER_MIN_OCTAVE ) ) {
+		return 0;
+	}
+	int nOctave = PROFILER_MIN_OCTAVE;
+	while ( ( nNs >> ( nOctave + 1 ) ) != 0 ) {
+		++nOctave;
+	}
+	// the two bits below the most significant one pick the quarter of octave
+	int nBucket = 1 + ( nOctave - PROFILER_MIN_OCTAVE ) * 4 + ( int )( ( nNs >> ( nOctave - 2 ) ) & 3 );
+	return nBucket < PROFILER_BUCKETS ? nBucket : PROFILER_BUCKETS - 1;
+}
+
+uint64_t EngineProfiler::bucket_value( int nBucket )
+{
+	if ( nBucket == 0 ) {
+		return ( 1ULL << PROFILER_MIN_OCTAVE ) / 2;
+	}
+	int nOctave = PROFILER_MIN_OCTAVE + ( nBucket - 1 ) / 4;
+	uint64_t nWidth = 1ULL << ( nOctave - 2 );
+	return ( 4 + ( nBucket - 1 ) % 4 ) * nWidth + nWidth / 2;
+}
+
+void EngineProfiler::begin_cycle()
+{
+	if ( __reset_requested.load( std::memory_order_acquire ) ) {
+		for ( int i = 0; i < STAGES; ++i ) {
+			__stages[ i ].clear();
+		}
+		__xruns.store( 0, std::memory_order_relaxed );
+		__driver_xruns.store( 0, std::memory_order_relaxed );
+		__reset_requested.store( false, std::memory_order_release );
+	}
+}
+
+void EngineProfiler::add( Stage stage, uint64_t nNs )
+{
+	// single writer, no read-modify-write needed
+	Histogram& h = __stages[ stage ];
+	std::atomic<uint32_t>& bucket = h.buckets[ bucket_of( nNs ) ];
+	bucket.store( bucket.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+	h.total.store( h.total.load( std::memory_order_relaxed ) + nNs, std::memory_order_relaxed );
+	if ( nNs > h.max.load( std::memory_order_relaxed ) ) {
+		h.max.store( nNs, std::memory_order_relaxed );
+	}
+	// published last, readers never see more measures than counted
+	h.count.store( h.count.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+}
+
+bool EngineProfiler::end_cycle( uint64_t nNs, uint64_t nBudgetNs )
+{
+	add( PROCESS, nNs );
+	__budget.store( nBudgetNs, std::memory_order_relaxed );
+	if ( nNs > nBudgetNs ) {
+		__xruns.store( __xruns.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+		return true;
+	}
+	return false;
+}
+
+void EngineProfiler::report_xrun()
+{
+	// JACK reports from its own thread
+	__driver_xruns.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void EngineProfiler::reset()
+{
+	__reset_requested.store( true, std::memory_order_release );
+}
+
+void EngineProfiler::get_snapshot( ProfileSnapshot& out ) const
+{
+	for ( int i = 0; i < STAGES; ++i ) {
+		const Histogram& h = __stages[ i ];
+		StageStats& stats = out.stage[ i ];
+		uint64_t nCount = h.count.load( std::memory_order_acquire );
+		uint32_t counts[ PROFILER_BUCKETS ];
+		uint64_t nBucketsTotal = 0;
+		for ( int b = 0; b < PROFILER_BUCKETS; ++b ) {
+			counts[ b ] = h.buckets[ b ].load( std::memory_order_relaxed );
+			nBucketsTotal += counts[ b ];
+		}
+		stats.count = nCount;
+		stats.max = h.max.load( std::memory_order_relaxed ) / 1000.0f;
+		stats.mean = nCount ? h.total.load( std::memory_order_relaxed ) / 1000.0f / nCount : 0.0f;
+		stats.p50 = stats.p99 = 0.0f;
+
+		// the buckets may be a measure ahead of the count, rank within what they hold
+		uint64_t nRank50 = ( nBucketsTotal * 50 + 99 ) / 100;
+		uint64_t nRank99 = ( nBucketsTotal * 99 + 99 ) / 100;
+		uint64_t nSeen = 0;
+		for ( int b = 0; b < PROFILER_BUCKETS && nBucketsTotal > 0; ++b ) {
+			uint64_t nPrevious = nSeen;
+			nSeen += counts[ b ];
+			if ( nPrevious < nRank50 && nSeen >= nRank50 ) {
+				stats.p50 = bucket_value( b ) / 1000.0f;
+			}
+			if ( nPrevious < nRank99 && nSeen >= nRank99 ) {
+				stats.p99 = bucket_value( b ) / 1000.0f;
+				break;
+			}
+		}
+		// the middle of a bucket may be above the exact worst measure
+		stats.p50 = std::min( stats.p50, stats.max );
+		stats.p99 = std::min( stats.p99, stats.max );
+	}
+	out.cycles = out.stage[ PROCESS ].count;
+	out.xruns = __xruns.load( std::memory_order_relaxed );
+	out.driver_xruns = __driver_xruns.load( std::memory_order_relaxed );
+	out.worst_us = out.stage[ PROCESS ].max;
+	out.budget_us = __budget.load( std::memory_order_relaxed ) / 1000.0f;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -22,6 +22,15 @@
 
 #include <hydrogen/event_queue.h>
 
+#include <QtCore/QThread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#define EVENT_QUEUE_HAVE_EVENTFD
+#endif
+
 namespace H2Core
 {
 
@@ -38,48 +47,164 @@ const char* EventQueue::__class_name = "EventQueue";
 
 EventQueue::EventQueue()
 		: Object( __class_name )
-		, __read_index( 0 )
 		, __write_index( 0 )
+		, __read_index( 0 )
+		, __pending_midi_activity( false )
+		, __signaled( false )
+		, __dropped( 0 )
+		, __coalesced( 0 )
+		, __wakeup_fd( -1 )
 {
 	__instance = this;
 
 	for ( int i = 0; i < MAX_EVENTS; ++i ) {
-		__events_buffer[ i ].type = EVENT_NONE;
-		__events_buffer[ i ].value = 0;
+		__events_buffer[ i ].seq.store( i );
+		__events_buffer[ i ].event.type = EVENT_NONE;
+		__events_buffer[ i ].event.value = 0;
+	}
+	for ( int i = 0; i < MAX_INSTRUMENTS; ++i ) {
+		__pending_note_on[ i ].store( false );
 	}
+
+#ifdef EVENT_QUEUE_HAVE_EVENTFD
+	__wakeup_fd = eventfd( 0, EFD_NONBLOCK );
+	if ( __wakeup_fd == -1 ) {
+		WARNINGLOG( "Unable to create the event queue eventfd, consumers will poll" );
+	}
+#endif
 }
 
 
 EventQueue::~EventQueue()
 {
 //	infoLog( "DESTROY" );
+#ifdef EVENT_QUEUE_HAVE_EVENTFD
+	if ( __wakeup_fd != -1 ) {
+		close( __wakeup_fd );
+	}
+#endif
+	if ( __dropped.load() > 0 ) {
+		WARNINGLOG( QString( "%1 events have been dropped, queue was full" ).arg( __dropped.load() ) );
+	}
+}
+
+
+std::atomic<bool>* EventQueue::pending_flag( EventType type, int nValue )
+{
+	if ( type == EVENT_NOTEON && nValue >= 0 && nValue < MAX_INSTRUMENTS ) {
+		return &__pending_note_on[ nValue ];
+	}
+	if ( type == EVENT_MIDI_ACTIVITY ) {
+		return &__pending_midi_activity;
+	}
+	return NULL;
 }
 
 
 void EventQueue::push_event( EventType type, int nValue )
 {
-	int nIndex = ++__write_index;
-	nIndex = nIndex % MAX_EVENTS;
-	Event ev;
-	ev.type = type;
-	ev.value = nValue;
-//	INFOLOG( QString( "[pushEvent] %1 : %2 %3" ).arg( nIndex ).arg( ev.type ).arg( ev.value ) );
-	__events_buffer[ nIndex ] = ev;
+	std::atomic<bool>* pPending = pending_flag( type, nValue );
+	if ( pPending && pPending->exchange( true ) ) {
+		// the same event is still waiting to be popped
+		__coalesced.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	unsigned nIndex = __write_index.load( std::memory_order_relaxed );
+	Slot* pSlot;
+	for ( ;; ) {
+		pSlot = &__events_buffer[ nIndex % MAX_EVENTS ];
+		int nDiff = ( int )( pSlot->seq.load( std::memory_order_acquire ) - nIndex );
+		if ( nDiff == 0 ) {
+			if ( __write_index.compare_exchange_weak( nIndex, nIndex + 1, std::memory_order_relaxed ) ) {
+				break;
+			}
+		} else if ( nDiff < 0 ) {
+			// queue is full, never overwrite unread events
+			__dropped.fetch_add( 1, std::memory_order_relaxed );
+			if ( pPending ) {
+				pPending->store( false );
+			}
+			return;
+		} else {
+			nIndex = __write_index.load( std::memory_order_relaxed );
+		}
+	}
+
+	pSlot->event.type = type;
+	pSlot->event.value = nValue;
+//	INFOLOG( QString( "[pushEvent] %1 : %2 %3" ).arg( nIndex ).arg( type ).arg( nValue ) );
+	pSlot->seq.store( nIndex + 1, std::memory_order_release );
+
+	wakeup();
 }
 
 
 Event EventQueue::pop_event()
 {
-	if ( __read_index == __write_index ) {
+	Slot* pSlot = &__events_buffer[ __read_index % MAX_EVENTS ];
+	if ( pSlot->seq.load( std::memory_order_acquire ) != __read_index + 1 ) {
 		Event ev;
 		ev.type = EVENT_NONE;
 		ev.value = 0;
 		return ev;
 	}
-	int nIndex = ++__read_index;
-	nIndex = nIndex % MAX_EVENTS;
-//	INFOLOG( QString( "[popEvent] %1 : %2 %3" ).arg( nIndex ).arg( __events_buffer[ nIndex ].type ).arg( __events_buffer[ nIndex ].value ) );
-	return __events_buffer[ nIndex ];
+	Event ev = pSlot->event;
+	// release the slot for the producers
+	pSlot->seq.store( __read_index + MAX_EVENTS, std::memory_order_release );
+	++__read_index;
+
+	std::atomic<bool>* pPending = pending_flag( ev.type, ev.value );
+	if ( pPending ) {
+		pPending->store( false );
+	}
+//	INFOLOG( QString( "[popEvent] %1 : %2 %3" ).arg( __read_index ).arg( ev.type ).arg( ev.value ) );
+	return ev;
+}
+
+
+void EventQueue::wakeup()
+{
+#ifdef EVENT_QUEUE_HAVE_EVENTFD
+	// only one write per consumer wakeup, keeps the audio thread away from syscalls
+	if ( __wakeup_fd != -1 && !__signaled.exchange( true ) ) {
+		uint64_t nOne = 1;
+		if ( write( __wakeup_fd, &nOne, sizeof( nOne ) ) < 0 ) {
+			// the counter is already set, the consumer will wake up anyway
+		}
+	}
+#endif
+}
+
+
+void EventQueue::acknowledge_wakeup()
+{
+#ifdef EVENT_QUEUE_HAVE_EVENTFD
+	if ( __wakeup_fd != -1 ) {
+		uint64_t nCount;
+		if ( read( __wakeup_fd, &nCount, sizeof( nCount ) ) < 0 ) {
+			// nothing pending
+		}
+		// events pushed from now on will write the eventfd again
+		__signaled.store( false );
+	}
+#endif
+}
+
+
+void EventQueue::wait_event( int nTimeoutMs )
+{
+#ifdef EVENT_QUEUE_HAVE_EVENTFD
+	if ( __wakeup_fd != -1 ) {
+		struct pollfd pfd;
+		pfd.fd = __wakeup_fd;
+		pfd.events = POLLIN;
+		poll( &pfd, 1, nTimeoutMs );
+		acknowledge_wakeup();
+		return;
+	}
+#endif
+	QThread::msleep( nTimeoutMs );
 }
 
 };
@@ -27,9 +27,12 @@
 #include <hydrogen/fx/LadspaFX.h>
 #include <hydrogen/audio_engine.h>
 #include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/helpers/xml.h>
 
 #include <algorithm>
+#include <QDateTime>
 #include <QDir>
+#include <QFileInfo>
 #include <QLibrary>
 #include <cassert>
 
@@ -37,6 +40,8 @@
 #include <lrdf.h>
 #endif
 
+#define LADSPA_CACHE "ladspa.xml"
+
 using namespace std;
 
 namespace H2Core
@@ -84,8 +89,14 @@ Effects::~Effects()
 	m_pluginList.clear();
 
 	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
-		delete m_FXList[ nFX ];
+		if ( m_FXList[ nFX ] ) {
+			m_bufferPool.release( m_FXList[ nFX ]->m_pBuffer_L );
+			m_bufferPool.release( m_FXList[ nFX ]->m_pBuffer_R );
+			delete m_FXList[ nFX ];
+		}
 	}
+
+	__instance = NULL;
 }
 
 
@@ -106,14 +117,13 @@ void  Effects::setLadspaFX( LadspaFX* pFX, int nFX )
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
 
-	if ( m_FXList[ nFX ] ) {
-		( m_FXList[ nFX ] )->deactivate();
-		delete m_FXList[ nFX ];
-	}
+	releaseLadspaFX( m_FXList[ nFX ] );
 
 	m_FXList[ nFX ] = pFX;
 
 	if ( pFX != NULL ) {
+		pFX->m_pBuffer_L = m_bufferPool.acquire();
+		pFX->m_pBuffer_R = m_bufferPool.acquire();
 		Preferences::get_instance()->setMostRecentFX( pFX->getPluginName() );
 		updateRecentGroup();
 	}
@@ -124,15 +134,59 @@ void  Effects::setLadspaFX( LadspaFX* pFX, int nFX )
 
 
 
+void Effects::prepareLadspaFX( LadspaFX* pFX )
+{
+	pFX->m_pBuffer_L = m_bufferPool.acquire();
+	pFX->m_pBuffer_R = m_bufferPool.acquire();
+	pFX->connectAudioPorts( pFX->m_pBuffer_L, pFX->m_pBuffer_R, pFX->m_pBuffer_L, pFX->m_pBuffer_R );
+	pFX->activate();
+	Preferences::get_instance()->setMostRecentFX( pFX->getPluginName() );
+	updateRecentGroup();
+}
+
+
+
+void Effects::swapLadspaFX( LadspaFX** pFX )
+{
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		LadspaFX* pSwapped = m_FXList[ nFX ];
+		m_FXList[ nFX ] = pFX[ nFX ];
+		pFX[ nFX ] = pSwapped;
+	}
+}
+
+
+
+void Effects::releaseLadspaFX( LadspaFX* pFX )
+{
+	if ( pFX == NULL ) {
+		return;
+	}
+	pFX->deactivate();
+	m_bufferPool.release( pFX->m_pBuffer_L );
+	m_bufferPool.release( pFX->m_pBuffer_R );
+	delete pFX;
+}
+
+
+
 ///
 /// Loads only usable plugins
 ///
+/// Libraries unchanged since the previous run are not opened, their
+/// plugins come from the plugin cache.
+///
 std::vector<LadspaFXInfo*> Effects::getPluginList()
 {
 	if ( m_pluginList.size() != 0 ) {
 		return m_pluginList;
 	}
 
+	QMap<QString, PluginLibrary> cache = loadPluginCache();
+	QMap<QString, PluginLibrary> libraries;
+	bool bModified = false;
+	int nScanned = 0;
+
 	foreach ( const QString& sPluginDir, Filesystem::ladspa_paths() ) {
 		INFOLOG( "*** [getPluginList] reading directory: " + sPluginDir );
 
@@ -163,66 +217,187 @@ std::vector<LadspaFXInfo*> Effects::getPluginList()
 			if ( pos == -1 ) {
 				continue;
 			}
-			//warningLog( "[getPluginList] Loading: " + sPluginName  );
 
 			QString sAbsPath = QString( "%1/%2" ).arg( sPluginDir ).arg( sPluginName );
-
-			QLibrary lib( sAbsPath );
-			LADSPA_Descriptor_Function desc_func = ( LADSPA_Descriptor_Function )lib.resolve( "ladspa_descriptor" );
-			if ( desc_func == NULL ) {
-				ERRORLOG( "Error loading the library. (" + sAbsPath + ")" );
+			if ( libraries.contains( sAbsPath ) ) {
 				continue;
 			}
-			const LADSPA_Descriptor * d;
-			if ( desc_func ) {
-				for ( unsigned i = 0; ( d = desc_func ( i ) ) != NULL; i++ ) {
-					LadspaFXInfo* pFX = new LadspaFXInfo( QString::fromLocal8Bit(d->Name) );
-					pFX->m_sFilename = sAbsPath;
-					pFX->m_sLabel = QString::fromLocal8Bit(d->Label);
-					pFX->m_sID = QString::number(d->UniqueID);
-					pFX->m_sMaker = QString::fromLocal8Bit(d->Maker);
-					pFX->m_sCopyright = QString::fromLocal8Bit(d->Copyright);
-
-					//INFOLOG( "Loading: " + pFX->m_sLabel );
-
-					for ( unsigned j = 0; j < d->PortCount; j++ ) {
-						LADSPA_PortDescriptor pd = d->PortDescriptors[j];
-						if ( LADSPA_IS_PORT_INPUT( pd ) && LADSPA_IS_PORT_CONTROL( pd ) ) {
-							pFX->m_nICPorts++;
-						} else if ( LADSPA_IS_PORT_INPUT( pd ) && LADSPA_IS_PORT_AUDIO( pd ) ) {
-							pFX->m_nIAPorts++;
-						} else if ( LADSPA_IS_PORT_OUTPUT( pd ) && LADSPA_IS_PORT_CONTROL( pd ) ) {
-							pFX->m_nOCPorts++;
-						} else if ( LADSPA_IS_PORT_OUTPUT( pd ) && LADSPA_IS_PORT_AUDIO( pd ) ) {
-							pFX->m_nOAPorts++;
-						} else {
-//							string sPortName = d->PortNames[ j ];
-							QString sPortName;
-							ERRORLOG( QString( "%1::%2 unknown port type" ).arg( pFX->m_sLabel ).arg( sPortName ) );
-						}
-					}
-					if ( ( pFX->m_nIAPorts == 2 ) && ( pFX->m_nOAPorts == 2 ) ) {	// Stereo plugin
-						m_pluginList.push_back( pFX );
-					} else if ( ( pFX->m_nIAPorts == 1 ) && ( pFX->m_nOAPorts == 1 ) ) {	// Mono plugin
-						m_pluginList.push_back( pFX );
-					} else {	// not supported plugin
-						//WARNINGLOG( "Plugin not supported: " + sPluginName  );
-						delete pFX;
-					}
-				}
+
+			PluginLibrary library;
+			library.nModified = list.at( i ).lastModified().toMSecsSinceEpoch();
+			library.nSize = list.at( i ).size();
+
+			QMap<QString, PluginLibrary>::iterator cached = cache.find( sAbsPath );
+			if ( cached != cache.end()
+			     && cached->nModified == library.nModified
+			     && cached->nSize == library.nSize ) {
+				library.plugins = cached->plugins;
+				cache.erase( cached );
 			} else {
-				ERRORLOG( "Error loading: " + sPluginName  );
+				//warningLog( "[getPluginList] Loading: " + sPluginName  );
+				library.plugins = scanLibrary( sAbsPath );
+				bModified = true;
+				nScanned++;
 			}
+			m_pluginList.insert( m_pluginList.end(), library.plugins.begin(), library.plugins.end() );
+			libraries.insert( sAbsPath, library );
 		}
 	}
 
-	INFOLOG( QString( "Loaded %1 LADSPA plugins" ).arg( m_pluginList.size() ) );
+	// libraries removed since the previous run
+	foreach ( const PluginLibrary& library, cache ) {
+		for ( unsigned i = 0; i < library.plugins.size(); i++ ) {
+			delete library.plugins[i];
+		}
+		bModified = true;
+	}
+
+	if ( bModified ) {
+		savePluginCache( libraries );
+	}
+
+	INFOLOG( QString( "Loaded %1 LADSPA plugins, %2 libraries scanned" ).arg( m_pluginList.size() ).arg( nScanned ) );
 	std::sort( m_pluginList.begin(), m_pluginList.end(), LadspaFXInfo::alphabeticOrder );
 	return m_pluginList;
 }
 
 
 
+std::vector<LadspaFXInfo*> Effects::scanLibrary( const QString& sAbsPath )
+{
+	std::vector<LadspaFXInfo*> plugins;
+
+	QLibrary lib( sAbsPath );
+	LADSPA_Descriptor_Function desc_func = ( LADSPA_Descriptor_Function )lib.resolve( "ladspa_descriptor" );
+	if ( desc_func == NULL ) {
+		ERRORLOG( "Error loading the library. (" + sAbsPath + ")" );
+		return plugins;
+	}
+	const LADSPA_Descriptor * d;
+	for ( unsigned i = 0; ( d = desc_func ( i ) ) != NULL; i++ ) {
+		LadspaFXInfo* pFX = new LadspaFXInfo( QString::fromLocal8Bit(d->Name) );
+		pFX->m_sFilename = sAbsPath;
+		pFX->m_sLabel = QString::fromLocal8Bit(d->Label);
+		pFX->m_sID = QString::number(d->UniqueID);
+		pFX->m_sMaker = QString::fromLocal8Bit(d->Maker);
+		pFX->m_sCopyright = QString::fromLocal8Bit(d->Copyright);
+
+		//INFOLOG( "Loading: " + pFX->m_sLabel );
+
+		for ( unsigned j = 0; j < d->PortCount; j++ ) {
+			LADSPA_PortDescriptor pd = d->PortDescriptors[j];
+			if ( LADSPA_IS_PORT_INPUT( pd ) && LADSPA_IS_PORT_CONTROL( pd ) ) {
+				pFX->m_nICPorts++;
+			} else if ( LADSPA_IS_PORT_INPUT( pd ) && LADSPA_IS_PORT_AUDIO( pd ) ) {
+				pFX->m_nIAPorts++;
+			} else if ( LADSPA_IS_PORT_OUTPUT( pd ) && LADSPA_IS_PORT_CONTROL( pd ) ) {
+				pFX->m_nOCPorts++;
+			} else if ( LADSPA_IS_PORT_OUTPUT( pd ) && LADSPA_IS_PORT_AUDIO( pd ) ) {
+				pFX->m_nOAPorts++;
+			} else {
+				QString sPortName = QString::fromLocal8Bit( d->PortNames[ j ] );
+				ERRORLOG( QString( "%1::%2 unknown port type" ).arg( pFX->m_sLabel ).arg( sPortName ) );
+			}
+		}
+		if ( ( pFX->m_nIAPorts == 2 ) && ( pFX->m_nOAPorts == 2 ) ) {	// Stereo plugin
+			plugins.push_back( pFX );
+		} else if ( ( pFX->m_nIAPorts == 1 ) && ( pFX->m_nOAPorts == 1 ) ) {	// Mono plugin
+			plugins.push_back( pFX );
+		} else {	// not supported plugin
+			//WARNINGLOG( "Plugin not supported: " + sPluginName  );
+			delete pFX;
+		}
+	}
+	return plugins;
+}
+
+
+
+QMap<QString, Effects::PluginLibrary> Effects::loadPluginCache()
+{
+	QMap<QString, PluginLibrary> libraries;
+	QString sCachePath = Filesystem::cache_dir() + LADSPA_CACHE;
+	if ( !Filesystem::file_readable( sCachePath, true ) ) {
+		return libraries;
+	}
+
+	XMLDoc doc;
+	if ( !doc.read( sCachePath ) ) {
+		WARNINGLOG( QString( "Plugin cache %1 is unreadable, all the plugins will be scanned" ).arg( sCachePath ) );
+		return libraries;
+	}
+	XMLNode root = doc.firstChildElement( "ladspa_cache" );
+	XMLNode libraryNode = root.firstChildElement( "library" );
+	while ( !libraryNode.isNull() ) {
+		QString sAbsPath = libraryNode.read_string( "path", "", false, false );
+		PluginLibrary library;
+		library.nModified = libraryNode.read_string( "modified", "0" ).toLongLong();
+		library.nSize = libraryNode.read_string( "size", "-1" ).toLongLong();
+		XMLNode pluginNode = libraryNode.firstChildElement( "plugin" );
+		while ( !pluginNode.isNull() ) {
+			LadspaFXInfo* pFX = new LadspaFXInfo( pluginNode.read_string( "name", "" ) );
+			pFX->m_sFilename = sAbsPath;
+			pFX->m_sLabel = pluginNode.read_string( "label", "" );
+			pFX->m_sID = pluginNode.read_string( "id", "" );
+			pFX->m_sMaker = pluginNode.read_string( "maker", "" );
+			pFX->m_sCopyright = pluginNode.read_string( "copyright", "" );
+			pFX->m_nICPorts = pluginNode.read_int( "input_control_ports", 0 );
+			pFX->m_nOCPorts = pluginNode.read_int( "output_control_ports", 0 );
+			pFX->m_nIAPorts = pluginNode.read_int( "input_audio_ports", 0 );
+			pFX->m_nOAPorts = pluginNode.read_int( "output_audio_ports", 0 );
+			library.plugins.push_back( pFX );
+			pluginNode = pluginNode.nextSiblingElement( "plugin" );
+		}
+		if ( !sAbsPath.isEmpty() && !libraries.contains( sAbsPath ) ) {
+			libraries.insert( sAbsPath, library );
+		} else {
+			for ( unsigned i = 0; i < library.plugins.size(); i++ ) {
+				delete library.plugins[i];
+			}
+		}
+		libraryNode = libraryNode.nextSiblingElement( "library" );
+	}
+	return libraries;
+}
+
+
+
+void Effects::savePluginCache( const QMap<QString, PluginLibrary>& libraries )
+{
+	if ( !Filesystem::path_usable( Filesystem::cache_dir(), true, true ) ) {
+		ERRORLOG( QString( "Can't write the plugin cache, %1 is not usable" ).arg( Filesystem::cache_dir() ) );
+		return;
+	}
+
+	XMLDoc doc;
+	XMLNode root = doc.set_root( "ladspa_cache" );
+	QMap<QString, PluginLibrary>::const_iterator it;
+	for ( it = libraries.constBegin(); it != libraries.constEnd(); ++it ) {
+		XMLNode libraryNode = root.createNode( "library" );
+		libraryNode.write_string( "path", it.key() );
+		libraryNode.write_string( "modified", QString::number( it->nModified ) );
+		libraryNode.write_string( "size", QString::number( it->nSize ) );
+		for ( unsigned i = 0; i < it->plugins.size(); i++ ) {
+			LadspaFXInfo* pFX = it->plugins[i];
+			XMLNode pluginNode = libraryNode.createNode( "plugin" );
+			pluginNode.write_string( "name", pFX->m_sName );
+			pluginNode.write_string( "label", pFX->m_sLabel );
+			pluginNode.write_string( "id", pFX->m_sID );
+			pluginNode.write_string( "maker", pFX->m_sMaker );
+			pluginNode.write_string( "copyright", pFX->m_sCopyright );
+			pluginNode.write_int( "input_control_ports", pFX->m_nICPorts );
+			pluginNode.write_int( "output_control_ports", pFX->m_nOCPorts );
+			pluginNode.write_int( "input_audio_ports", pFX->m_nIAPorts );
+			pluginNode.write_int( "output_audio_ports", pFX->m_nOAPorts );
+		}
+	}
+	if ( !doc.write( Filesystem::cache_dir() + LADSPA_CACHE ) ) {
+		ERRORLOG( QString( "Can't write the plugin cache %1" ).arg( Filesystem::cache_dir() + LADSPA_CACHE ) );
+	}
+}
+
+
+
 LadspaFXGroup* Effects::getLadspaFXGroup()
 {
 	INFOLOG( "[getLadspaFXGroup]" );
@@ -0,0 +1,282 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/fx/FxChain.h>
+
+#ifdef H2CORE_HAVE_LADSPA
+
+#include <hydrogen/globals.h>
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/LocalFileMng.h>
+#include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/LadspaFX.h>
+
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* FxBufferPool::__class_name = "FxBufferPool";
+
+FxBufferPool::FxBufferPool()
+		: Object( __class_name )
+		, __allocated( 0 )
+{
+	pthread_mutex_init( &__mutex, NULL );
+}
+
+FxBufferPool::~FxBufferPool()
+{
+	if ( __allocated != ( int )__free.size() ) {
+		WARNINGLOG( QString( "%1 buffers still in use" ).arg( __allocated - ( int )__free.size() ) );
+	}
+	for ( unsigned i = 0; i < __free.size(); i++ ) {
+		delete[] __free[i];
+	}
+	pthread_mutex_destroy( &__mutex );
+}
+
+float* FxBufferPool::acquire()
+{
+	float* pBuffer = NULL;
+	pthread_mutex_lock( &__mutex );
+	if ( __free.empty() ) {
+		__allocated++;
+	} else {
+		pBuffer = __free.back();
+		__free.pop_back();
+	}
+	pthread_mutex_unlock( &__mutex );
+	if ( pBuffer == NULL ) {
+		pBuffer = new float[ MAX_BUFFER_SIZE ];
+	}
+	// touch all the memory, the audio thread must not page fault on it
+	memset( pBuffer, 0, MAX_BUFFER_SIZE * sizeof( float ) );
+	return pBuffer;
+}
+
+void FxBufferPool::release( float* pBuffer )
+{
+	if ( pBuffer ) {
+		pthread_mutex_lock( &__mutex );
+		__free.push_back( pBuffer );
+		pthread_mutex_unlock( &__mutex );
+	}
+}
+
+
+const char* FxChain::__class_name = "FxChain";
+
+FxChain::FxChain()
+		: Object( __class_name )
+		, __routed( false )
+{
+	FxBufferPool* pPool = Effects::get_instance()->getBufferPool();
+	__buffer_L = pPool->acquire();
+	__buffer_R = pPool->acquire();
+}
+
+FxChain::FxChain( FxChain* other, long nSampleRate )
+		: Object( __class_name )
+		, __routed( false )
+{
+	FxBufferPool* pPool = Effects::get_instance()->getBufferPool();
+	__buffer_L = pPool->acquire();
+	__buffer_R = pPool->acquire();
+
+	for ( int i = 0; i < other->size(); i++ ) {
+		LadspaFX* pOther = other->get( i );
+		LadspaFX* pFX = LadspaFX::load( pOther->getLibraryPath(), pOther->getPluginLabel(), nSampleRate );
+		if ( pFX == NULL ) {
+			ERRORLOG( QString( "Can't copy insert FX %1" ).arg( pOther->getPluginLabel() ) );
+			continue;
+		}
+		pFX->setEnabled( pOther->isEnabled() );
+		pFX->setVolume( pOther->getVolume() );
+		for ( unsigned nPort = 0; nPort < pFX->inputControlPorts.size() && nPort < pOther->inputControlPorts.size(); nPort++ ) {
+			pFX->inputControlPorts[ nPort ]->fControlValue = pOther->inputControlPorts[ nPort ]->fControlValue;
+		}
+		__fx.push_back( pFX );
+		connect( pFX );
+	}
+}
+
+FxChain::~FxChain()
+{
+	for ( unsigned i = 0; i < __fx.size(); i++ ) {
+		__fx[i]->deactivate();
+		delete __fx[i];
+	}
+	if ( Effects::has_instance() ) {
+		FxBufferPool* pPool = Effects::get_instance()->getBufferPool();
+		pPool->release( __buffer_L );
+		pPool->release( __buffer_R );
+	} else {
+		delete[] __buffer_L;
+		delete[] __buffer_R;
+	}
+}
+
+LadspaFX* FxChain::get( int nIdx ) const
+{
+	if ( nIdx < 0 || nIdx >= ( int )__fx.size() ) {
+		return NULL;
+	}
+	return __fx[ nIdx ];
+}
+
+void FxChain::set( LadspaFX* pFX, int nIdx )
+{
+	if ( nIdx < 0 || nIdx > ( int )__fx.size() ) {
+		ERRORLOG( QString( "Insert position %1 out of range" ).arg( nIdx ) );
+		delete pFX;
+		return;
+	}
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+
+	if ( nIdx < ( int )__fx.size() ) {
+		__fx[ nIdx ]->deactivate();
+		delete __fx[ nIdx ];
+		if ( pFX ) {
+			__fx[ nIdx ] = pFX;
+		} else {
+			__fx.erase( __fx.begin() + nIdx );
+		}
+	} else if ( pFX ) {
+		__fx.push_back( pFX );
+	}
+
+	if ( pFX ) {
+		connect( pFX );
+	}
+
+	AudioEngine::get_instance()->unlock();
+}
+
+bool FxChain::is_active() const
+{
+	for ( unsigned i = 0; i < __fx.size(); i++ ) {
+		if ( __fx[i]->isEnabled() ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void FxChain::connect( LadspaFX* pFX )
+{
+	pFX->deactivate();
+	pFX->connectAudioPorts( __buffer_L, __buffer_R, __buffer_L, __buffer_R );
+	pFX->activate();
+}
+
+void FxChain::process( unsigned nFrames )
+{
+	for ( unsigned i = 0; i < __fx.size(); i++ ) {
+		LadspaFX* pFX = __fx[i];
+		if ( !pFX->isEnabled() ) {
+			continue;
+		}
+		pFX->processFX( nFrames );
+		if ( pFX->getPluginType() == LadspaFX::MONO_FX ) {
+			memcpy( __buffer_R, __buffer_L, nFrames * sizeof( float ) );
+		}
+		float fVolume = pFX->getVolume();
+		if ( fVolume != 1.0f ) {
+			for ( unsigned j = 0; j < nFrames; ++j ) {
+				__buffer_L[ j ] *= fVolume;
+				__buffer_R[ j ] *= fVolume;
+			}
+		}
+	}
+}
+
+void FxChain::save_to( QXmlStreamWriter& writer )
+{
+	writer.writeStartElement( "insertFX" );
+	for ( unsigned i = 0; i < __fx.size(); i++ ) {
+		LadspaFX* pFX = __fx[i];
+		writer.writeStartElement( "fx" );
+		LocalFileMng::writeXmlString( writer, "name", pFX->getPluginLabel() );
+		LocalFileMng::writeXmlString( writer, "filename", pFX->getLibraryPath() );
+		LocalFileMng::writeXmlBool( writer, "enabled", pFX->isEnabled() );
+		LocalFileMng::writeXmlString( writer, "volume", QString("%1").arg( pFX->getVolume() ) );
+		for ( unsigned nControl = 0; nControl < pFX->inputControlPorts.size(); nControl++ ) {
+			LadspaControlPort *pControlPort = pFX->inputControlPorts[ nControl ];
+			writer.writeStartElement( "inputControlPort" );
+			LocalFileMng::writeXmlString( writer, "name", pControlPort->sName );
+			LocalFileMng::writeXmlString( writer, "value", QString("%1").arg( pControlPort->fControlValue ) );
+			writer.writeEndElement();
+		}
+		writer.writeEndElement();
+	}
+	writer.writeEndElement();
+}
+
+FxChain* FxChain::load_from( const QDomNode& node, long nSampleRate )
+{
+	QDomNode insertNode = node.firstChildElement( "insertFX" );
+	if ( insertNode.isNull() ) {
+		return NULL;
+	}
+
+	FxChain* pChain = NULL;
+	QDomNode fxNode = insertNode.firstChildElement( "fx" );
+	while ( !fxNode.isNull() ) {
+		QString sName = LocalFileMng::readXmlString( fxNode, "name", "" );
+		QString sFilename = LocalFileMng::readXmlString( fxNode, "filename", "" );
+		LadspaFX* pFX = LadspaFX::load( sFilename, sName, nSampleRate );
+		if ( pFX ) {
+			pFX->setEnabled( LocalFileMng::readXmlBool( fxNode, "enabled", false ) );
+			pFX->setVolume( LocalFileMng::readXmlFloat( fxNode, "volume", 1.0 ) );
+			QDomNode inputControlNode = fxNode.firstChildElement( "inputControlPort" );
+			while ( !inputControlNode.isNull() ) {
+				QString sPortName = LocalFileMng::readXmlString( inputControlNode, "name", "" );
+				float fValue = LocalFileMng::readXmlFloat( inputControlNode, "value", 0.0 );
+				for ( unsigned nPort = 0; nPort < pFX->inputControlPorts.size(); nPort++ ) {
+					LadspaControlPort* pPort = pFX->inputControlPorts[ nPort ];
+					if ( QString( pPort->sName ) == sPortName ) {
+						pPort->fControlValue = fValue;
+					}
+				}
+				inputControlNode = ( QDomNode ) inputControlNode.nextSiblingElement( "inputControlPort" );
+			}
+			if ( pChain == NULL ) {
+				pChain = new FxChain();
+			}
+			// nobody processes the chain yet, set() would lock the engine
+			pChain->__fx.push_back( pFX );
+			pChain->connect( pFX );
+		} else {
+			ERRORLOG( QString( "Can't load insert FX %1 from %2" ).arg( sName ).arg( sFilename ) );
+		}
+		fxNode = ( QDomNode ) fxNode.nextSiblingElement( "fx" );
+	}
+	return pChain;
+}
+
+};
+
+#endif // H2CORE_HAVE_LADSPA
+
+/* vim: set softtabstop=4 noexpandtab: */
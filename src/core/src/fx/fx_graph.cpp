@@ -0,0 +1,436 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/fx/FxGraph.h>
+
+#ifdef H2CORE_HAVE_LADSPA
+
+#include <hydrogen/fx/FxChain.h>
+#include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/LadspaFX.h>
+#include <hydrogen/meter_bus.h>
+#include <hydrogen/helpers/denormals.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/drumkit_component.h>
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/engine_profiler.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/sampler/Sampler.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sched.h>
+#include <unistd.h>
+
+namespace H2Core
+{
+
+FxGraph* FxGraph::__instance = NULL;
+const char* FxGraph::__class_name = "FxGraph";
+
+void FxGraph::create_instance()
+{
+	if ( __instance == NULL ) {
+		__instance = new FxGraph;
+	}
+}
+
+FxGraph::FxGraph()
+		: Object( __class_name )
+		, __song( NULL )
+		, __frames( 0 )
+		, __n_nodes( 0 )
+		, __n_instrument_nodes( 0 )
+		, __bypass( false )
+		, __ready_read( 0 )
+		, __ready_write( 0 )
+		, __remaining( 0 )
+		, __workers( 0 )
+{
+	for ( int i = 0; i < FX_GRAPH_MAX_NODES; ++i ) {
+		__ready[ i ].store( -1 );
+		__nodes[ i ].chain = NULL;
+		__nodes[ i ].pending.store( 0 );
+		__nodes[ i ].done.store( false );
+	}
+
+#ifdef FX_GRAPH_HAVE_WORKERS
+	__quit.store( false );
+	__open.store( false );
+	__busy.store( 0 );
+
+	long nCpus = sysconf( _SC_NPROCESSORS_ONLN );
+	int nWorkers = std::min( ( int )nCpus - 1, FX_GRAPH_MAX_WORKERS );
+	if ( nWorkers > 0 && sem_init( &__wakeup, 0, 0 ) == 0 ) {
+		for ( int i = 0; i < nWorkers; ++i ) {
+			if ( pthread_create( &__threads[ __workers ], NULL, worker_thread, this ) != 0 ) {
+				ERRORLOG( "Can't create FX worker thread" );
+				break;
+			}
+			__workers++;
+		}
+	}
+#endif
+	INFOLOG( QString( "%1 FX worker threads" ).arg( __workers ) );
+}
+
+FxGraph::~FxGraph()
+{
+#ifdef FX_GRAPH_HAVE_WORKERS
+	if ( __workers > 0 ) {
+		__quit.store( true );
+		for ( int i = 0; i < __workers; ++i ) {
+			sem_post( &__wakeup );
+		}
+		for ( int i = 0; i < __workers; ++i ) {
+			pthread_join( __threads[ i ], NULL );
+		}
+		sem_destroy( &__wakeup );
+	}
+#endif
+	__instance = NULL;
+}
+
+void FxGraph::prepare( Song* pSong, unsigned nFrames )
+{
+#ifdef FX_GRAPH_HAVE_WORKERS
+	__bypass = __busy.load() > 0;
+	if ( __bypass ) {
+		// a late worker still runs a node of a former cycle, its chains and
+		// buffers are left to it and the voices are mixed without their inserts
+		InstrumentList* pInstrList = pSong->get_instrument_list();
+		for ( int i = 0; i < pInstrList->size(); ++i ) {
+			if ( pInstrList->get( i )->get_insert_fx() ) {
+				pInstrList->get( i )->get_insert_fx()->set_routed( false );
+			}
+		}
+		std::vector<DrumkitComponent*>* pComponents = pSong->get_components();
+		for ( unsigned i = 0; i < pComponents->size(); ++i ) {
+			if ( ( *pComponents )[ i ]->get_insert_fx() ) {
+				( *pComponents )[ i ]->get_insert_fx()->set_routed( false );
+			}
+		}
+		return;
+	}
+#endif
+
+	__song = pSong;
+	__frames = nFrames;
+	__n_nodes = 0;
+
+	InstrumentList* pInstrList = pSong->get_instrument_list();
+	for ( int i = 0; i < pInstrList->size() && __n_nodes < MAX_INSTRUMENTS; ++i ) {
+		Instrument* pInstr = pInstrList->get( i );
+		FxChain* pChain = pInstr->get_insert_fx();
+		if ( pChain == NULL ) {
+			continue;
+		}
+		if ( !pChain->is_active() ) {
+			pChain->set_routed( false );
+			continue;
+		}
+		Node& node = __nodes[ __n_nodes++ ];
+		node.type = INSTRUMENT_INSERT;
+		node.chain = pChain;
+		node.instrument = pInstr;
+		node.component = NULL;
+		node.fx = -1;
+		pChain->set_routed( true );
+		memset( pChain->get_buffer_L(), 0, nFrames * sizeof( float ) );
+		memset( pChain->get_buffer_R(), 0, nFrames * sizeof( float ) );
+	}
+	__n_instrument_nodes = __n_nodes;
+
+	std::vector<DrumkitComponent*>* pComponents = pSong->get_components();
+	for ( unsigned i = 0; i < pComponents->size() && i < MAX_COMPONENTS; ++i ) {
+		DrumkitComponent* pCompo = ( *pComponents )[ i ];
+		FxChain* pChain = pCompo->get_insert_fx();
+		if ( pChain == NULL ) {
+			continue;
+		}
+		if ( !pChain->is_active() ) {
+			pChain->set_routed( false );
+			continue;
+		}
+		Node& node = __nodes[ __n_nodes++ ];
+		node.type = COMPONENT_INSERT;
+		node.chain = pChain;
+		node.instrument = NULL;
+		node.component = pCompo;
+		node.fx = -1;
+		pChain->set_routed( true );
+	}
+
+	Effects* pEffects = Effects::get_instance();
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		LadspaFX* pFX = pEffects->getLadspaFX( nFX );
+		if ( pFX == NULL || !pFX->isEnabled() ) {
+			continue;
+		}
+		Node& node = __nodes[ __n_nodes++ ];
+		node.type = SEND;
+		node.chain = NULL;
+		node.instrument = NULL;
+		node.component = NULL;
+		node.fx = nFX;
+	}
+
+	// edges: instrument inserts feed the sends post insert
+	for ( int i = 0; i < __n_nodes; ++i ) {
+		__nodes[ i ].n_dependents = 0;
+		__nodes[ i ].n_sources = 0;
+	}
+	bool bMuted = pSong->__is_muted;
+	for ( int i = 0; i < __n_instrument_nodes; ++i ) {
+		Node& source = __nodes[ i ];
+		if ( bMuted || source.instrument->is_muted() ) {
+			continue;
+		}
+		// the send levels glide and follow the automation as in the sampler
+		AudioEngine::get_instance()->get_sampler()->update_block_params( source.instrument );
+		const Instrument::BlockParams& blockStart = source.instrument->get_block_params( false );
+		const Instrument::BlockParams& blockEnd = source.instrument->get_block_params( true );
+		for ( int j = __n_instrument_nodes; j < __n_nodes; ++j ) {
+			Node& send = __nodes[ j ];
+			if ( send.type == SEND && ( blockStart.fx_level[ send.fx ] != 0.0 || blockEnd.fx_level[ send.fx ] != 0.0 ) ) {
+				source.dependents[ source.n_dependents++ ] = j;
+				send.n_sources++;
+			}
+		}
+	}
+}
+
+void FxGraph::run_node( int nNode )
+{
+	Node& node = __nodes[ nNode ];
+	unsigned nFrames = __frames;
+
+	switch ( node.type ) {
+	case INSTRUMENT_INSERT:
+		node.chain->process( nFrames );
+		break;
+
+	case COMPONENT_INSERT: {
+		float* pCompo_L = node.component->get_out_L_buffer();
+		float* pCompo_R = node.component->get_out_R_buffer();
+		float* pBus_L = node.chain->get_buffer_L();
+		float* pBus_R = node.chain->get_buffer_R();
+		memcpy( pBus_L, pCompo_L, nFrames * sizeof( float ) );
+		memcpy( pBus_R, pCompo_R, nFrames * sizeof( float ) );
+		node.chain->process( nFrames );
+		// the component meters show the processed signal
+		memcpy( pCompo_L, pBus_L, nFrames * sizeof( float ) );
+		memcpy( pCompo_R, pBus_R, nFrames * sizeof( float ) );
+		break;
+	}
+
+	case SEND: {
+		LadspaFX* pFX = Effects::get_instance()->getLadspaFX( node.fx );
+		float* pBuf_L = pFX->m_pBuffer_L;
+		float* pBuf_R = pFX->m_pBuffer_R;
+		// instruments with an insert chain are sent post chain
+		for ( int i = 0; i < __n_instrument_nodes; ++i ) {
+			Node& source = __nodes[ i ];
+			if ( std::find( source.dependents, source.dependents + source.n_dependents, nNode )
+				 == source.dependents + source.n_dependents ) {
+				continue;
+			}
+			float fLevel = source.instrument->get_block_params( false ).fx_level[ node.fx ] * pFX->getVolume();
+			float fLevelEnd = source.instrument->get_block_params( true ).fx_level[ node.fx ] * pFX->getVolume();
+			float fStep = ( fLevelEnd - fLevel ) / nFrames;
+			const float* pSrc_L = source.chain->get_buffer_L();
+			const float* pSrc_R = source.chain->get_buffer_R();
+			for ( unsigned n = 0; n < nFrames; ++n ) {
+				pBuf_L[ n ] += pSrc_L[ n ] * ( fLevel + n * fStep );
+				pBuf_R[ n ] += pSrc_R[ n ] * ( fLevel + n * fStep );
+			}
+		}
+		pFX->processFX( nFrames );
+		if ( pFX->getPluginType() == LadspaFX::STEREO_FX ) {
+			MeterBus::get_instance()->process_fx( node.fx, pBuf_L, pBuf_R, nFrames );
+		} else {
+			MeterBus::get_instance()->process_fx( node.fx, pBuf_L, pBuf_L, nFrames );
+		}
+		break;
+	}
+	}
+
+	for ( int i = 0; i < node.n_dependents; ++i ) {
+		int nDependent = node.dependents[ i ];
+		if ( __nodes[ nDependent ].pending.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+			push_ready( nDependent );
+		}
+	}
+	node.done.store( true, std::memory_order_release );
+	__remaining.fetch_sub( 1, std::memory_order_acq_rel );
+}
+
+void FxGraph::push_ready( int nNode )
+{
+	int nSlot = __ready_write.fetch_add( 1, std::memory_order_acq_rel );
+	__ready[ nSlot ].store( nNode, std::memory_order_release );
+}
+
+bool FxGraph::pop_ready( int& nNode )
+{
+	int nSlot = __ready_read.load( std::memory_order_acquire );
+	while ( nSlot < __ready_write.load( std::memory_order_acquire ) ) {
+		// a slot is written once per cycle, only a stored one is taken
+		int n = __ready[ nSlot ].load( std::memory_order_acquire );
+		if ( n < 0 ) {
+			return false;
+		}
+		if ( __ready_read.compare_exchange_weak( nSlot, nSlot + 1, std::memory_order_acq_rel ) ) {
+			nNode = n;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FxGraph::run_ready( uint64_t nDeadline )
+{
+	int nNode;
+	while ( __remaining.load( std::memory_order_acquire ) > 0 ) {
+#ifdef FX_GRAPH_HAVE_WORKERS
+		if ( nDeadline == 0 && !__open.load() ) {
+			// a worker, the audio thread is done with this cycle
+			return false;
+		}
+#endif
+		if ( pop_ready( nNode ) ) {
+			run_node( nNode );
+		} else if ( nDeadline != 0 && EngineProfiler::now() >= nDeadline ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+#ifdef FX_GRAPH_HAVE_WORKERS
+void* FxGraph::worker_thread( void* pArg )
+{
+	FxGraph* pGraph = static_cast<FxGraph*>( pArg );
+	Preferences::get_instance()->applyThreadPolicy( Preferences::THREAD_FX, pthread_self() );
+	// the plugins run here as well as in the audio thread
+	enable_flush_to_zero();
+	while ( true ) {
+		while ( sem_wait( &pGraph->__wakeup ) != 0 ) {
+		}
+		if ( pGraph->__quit.load() ) {
+			break;
+		}
+		// either the audio thread sees this worker busy or the worker sees the graph closed
+		pGraph->__busy.fetch_add( 1 );
+		if ( pGraph->__open.load() ) {
+			pGraph->run_ready( 0 );
+		}
+		pGraph->__busy.fetch_sub( 1 );
+	}
+	return NULL;
+}
+#endif
+
+void FxGraph::process( unsigned nFrames, unsigned nSampleRate, float* pMain_L, float* pMain_R )
+{
+	if ( __bypass || __n_nodes == 0 ) {
+		return;
+	}
+	assert( nFrames == __frames );
+
+	for ( int i = 0; i < __n_nodes; ++i ) {
+		__ready[ i ].store( -1, std::memory_order_relaxed );
+		__nodes[ i ].pending.store( __nodes[ i ].n_sources, std::memory_order_relaxed );
+		__nodes[ i ].done.store( false, std::memory_order_relaxed );
+	}
+	__ready_read.store( 0, std::memory_order_relaxed );
+	__ready_write.store( 0, std::memory_order_relaxed );
+	__remaining.store( __n_nodes, std::memory_order_release );
+
+	for ( int i = 0; i < __n_nodes; ++i ) {
+		if ( __nodes[ i ].n_sources == 0 ) {
+			push_ready( i );
+		}
+	}
+
+	bool bDone;
+#ifdef FX_GRAPH_HAVE_WORKERS
+	uint64_t nDeadline = EngineProfiler::now() + ( uint64_t )( FX_GRAPH_MAX_WAIT * 1e9 * nFrames / nSampleRate );
+
+	// small graphs are run by the audio thread alone
+	int nWake = __n_nodes < FX_GRAPH_MIN_PARALLEL_NODES ? 0 : std::min( __workers, __n_nodes - 1 );
+	if ( nWake > 0 ) {
+		__open.store( true );
+		for ( int i = 0; i < nWake; ++i ) {
+			sem_post( &__wakeup );
+		}
+	}
+
+	// the audio thread runs the ready nodes and spins on the ones taken by the workers
+	bDone = run_ready( nDeadline );
+
+	if ( nWake > 0 ) {
+		// the graph is reset on the next cycle, no worker may still be in it.
+		// Workers woken too late see it closed and go back to sleep.
+		__open.store( false );
+		while ( __busy.load() > 0 && EngineProfiler::now() < nDeadline ) {
+		}
+		if ( __busy.load() > 0 ) {
+			WARNINGLOG( "FX workers missed the deadline, the FX are bypassed until they are back" );
+		}
+	}
+#else
+	( void )nSampleRate;
+	bDone = run_ready( 0 );
+#endif
+
+	// sum the outputs in a fixed order, the mix does not depend on the scheduling
+	for ( int i = 0; i < __n_nodes; ++i ) {
+		Node& node = __nodes[ i ];
+		if ( !bDone && !node.done.load( std::memory_order_acquire ) ) {
+			// still run by a late worker
+			continue;
+		}
+		const float* pBuf_L;
+		const float* pBuf_R;
+		if ( node.type == SEND ) {
+			LadspaFX* pFX = Effects::get_instance()->getLadspaFX( node.fx );
+			pBuf_L = pFX->m_pBuffer_L;
+			pBuf_R = ( pFX->getPluginType() == LadspaFX::STEREO_FX ) ? pFX->m_pBuffer_R : pFX->m_pBuffer_L;
+		} else {
+			pBuf_L = node.chain->get_buffer_L();
+			pBuf_R = node.chain->get_buffer_R();
+		}
+		for ( unsigned n = 0; n < nFrames; ++n ) {
+			pMain_L[ n ] += pBuf_L[ n ];
+			pMain_R[ n ] += pBuf_R[ n ];
+		}
+	}
+}
+
+};
+
+#endif // H2CORE_HAVE_LADSPA
+
+/* vim: set softtabstop=4 noexpandtab: */
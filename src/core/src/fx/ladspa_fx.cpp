@@ -141,18 +141,6 @@ LadspaFX::LadspaFX( const QString& sLibraryPath, const QString& sPluginLabel )
 		, m_nOAPorts( 0 )
 {
 	INFOLOG( QString( "INIT - %1 - %2" ).arg( sLibraryPath ).arg( sPluginLabel ) );
-
-
-	m_pBuffer_L = new float[MAX_BUFFER_SIZE];
-	m_pBuffer_R = new float[MAX_BUFFER_SIZE];
-
-
-	// Touch all the memory (is this really necessary?)
-	for ( unsigned i = 0; i < MAX_BUFFER_SIZE; ++i ) {
-		m_pBuffer_L[ i ] = 0;
-		m_pBuffer_R[ i ] = 0;
-	}
-
 }
 
 
@@ -187,9 +175,6 @@ LadspaFX::~LadspaFX()
 	for ( unsigned i = 0; i < outputControlPorts.size(); i++ ) {
 		delete outputControlPorts[i];
 	}
-
-	delete[] m_pBuffer_L;
-	delete[] m_pBuffer_R;
 }
 
 
@@ -453,7 +438,7 @@ void LadspaFX::setVolume( float fValue )
 	} else if ( fValue < 0.0 ) {
 		fValue = 0.0;
 	}
-	m_fVolume = fValue;
+	m_fVolume.store( fValue, std::memory_order_relaxed );
 }
 
 
@@ -0,0 +1,221 @@
+#include <hydrogen/helpers/drumkit_index.h>
+
+#include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/helpers/xml.h>
+#include <hydrogen/basics/drumkit.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+
+#define DRUMKIT_INDEX   "drumkits.xml"
+
+namespace H2Core
+{
+
+const char* DrumkitIndex::__class_name = "DrumkitIndex";
+
+QMap<QString, DrumkitIndex::Entry> DrumkitIndex::__entries;
+bool DrumkitIndex::__loaded = false;
+bool DrumkitIndex::__modified = false;
+QMutex DrumkitIndex::__mutex;
+
+static qint64 mtime_of( const QFileInfo& info )
+{
+	return info.lastModified().toMSecsSinceEpoch();
+}
+
+std::vector<DrumkitIndex::Entry> DrumkitIndex::sys_drumkits()
+{
+	QMutexLocker lock( &__mutex );
+	std::vector<Entry> entries = drumkits( Filesystem::sys_drumkits_dir() );
+	save();
+	return entries;
+}
+
+std::vector<DrumkitIndex::Entry> DrumkitIndex::usr_drumkits()
+{
+	QMutexLocker lock( &__mutex );
+	std::vector<Entry> entries = drumkits( Filesystem::usr_drumkits_dir() );
+	save();
+	return entries;
+}
+
+QString DrumkitIndex::path_of( const QString& dk_name )
+{
+	QMutexLocker lock( &__mutex );
+	QString path;
+	std::vector<Entry> entries = drumkits( Filesystem::usr_drumkits_dir() );
+	for ( unsigned i = 0; i < entries.size() && path.isEmpty(); i++ ) {
+		if ( entries[i].name == dk_name ) path = entries[i].path;
+	}
+	if ( path.isEmpty() ) {
+		entries = drumkits( Filesystem::sys_drumkits_dir() );
+		for ( unsigned i = 0; i < entries.size() && path.isEmpty(); i++ ) {
+			if ( entries[i].name == dk_name ) path = entries[i].path;
+		}
+	}
+	save();
+	return path;
+}
+
+QString DrumkitIndex::index_path()
+{
+	return Filesystem::cache_dir() + DRUMKIT_INDEX;
+}
+
+std::vector<DrumkitIndex::Entry> DrumkitIndex::drumkits( const QString& path )
+{
+	load();
+
+	QStringList dks;
+	if ( path == Filesystem::sys_drumkits_dir() ) {
+		dks = Filesystem::sys_drumkit_list();
+	} else {
+		dks = Filesystem::usr_drumkit_list();
+	}
+
+	std::vector<Entry> entries;
+	QStringList listed;
+	foreach ( const QString& dk, dks ) {
+		QString dk_path = QDir::cleanPath( path + dk );
+		QFileInfo dir_info( dk_path );
+		QFileInfo xml_info( Filesystem::drumkit_file( dk_path ) );
+		listed << dk_path;
+
+		QMap<QString, Entry>::iterator it = __entries.find( dk_path );
+		if ( it == __entries.end()
+		     || it->dir_mtime != mtime_of( dir_info )
+		     || it->xml_mtime != mtime_of( xml_info )
+		     || it->xml_size != xml_info.size() ) {
+			Entry entry;
+			entry.path = dk_path;
+			parse( entry );
+			it = __entries.insert( dk_path, entry );
+			__modified = true;
+		}
+		if ( it->valid ) {
+			entries.push_back( *it );
+		}
+	}
+
+	// forget the drumkits removed from this directory
+	QString prefix = QDir::cleanPath( path ) + "/";
+	QMap<QString, Entry>::iterator it = __entries.begin();
+	while ( it != __entries.end() ) {
+		if ( it.key().startsWith( prefix ) && !listed.contains( it.key() ) ) {
+			it = __entries.erase( it );
+			__modified = true;
+		} else {
+			++it;
+		}
+	}
+
+	return entries;
+}
+
+void DrumkitIndex::parse( Entry& entry )
+{
+	INFOLOG( QString( "Indexing drumkit %1" ).arg( entry.path ) );
+	Drumkit* pDrumkit = Drumkit::load( entry.path );
+	entry.valid = ( pDrumkit != 0 );
+	if ( pDrumkit ) {
+		entry.name = pDrumkit->get_name();
+		entry.author = pDrumkit->get_author();
+		entry.info = pDrumkit->get_info();
+		entry.license = pDrumkit->get_license();
+		InstrumentList* pInstruments = pDrumkit->get_instruments();
+		for ( int i = 0; i < pInstruments->size(); i++ ) {
+			entry.instruments << pInstruments->get( i )->get_name();
+		}
+		delete pDrumkit;
+	} else {
+		ERRORLOG( QString( "%1 can't be loaded, it will be indexed again once modified" ).arg( entry.path ) );
+	}
+	// stat after loading, legacy drumkits are upgraded in place
+	QFileInfo xml_info( Filesystem::drumkit_file( entry.path ) );
+	entry.dir_mtime = mtime_of( QFileInfo( entry.path ) );
+	entry.xml_mtime = mtime_of( xml_info );
+	entry.xml_size = xml_info.size();
+}
+
+void DrumkitIndex::load()
+{
+	if ( __loaded ) return;
+	__loaded = true;
+
+	if ( !Filesystem::file_readable( index_path(), true ) ) return;
+	XMLDoc doc;
+	if ( !doc.read( index_path() ) ) {
+		WARNINGLOG( QString( "Drumkit index %1 is unreadable, it will be rebuilt" ).arg( index_path() ) );
+		return;
+	}
+	XMLNode root = doc.firstChildElement( "drumkit_index" );
+	if ( root.isNull() ) {
+		WARNINGLOG( "drumkit_index node not found" );
+		return;
+	}
+	XMLNode node = root.firstChildElement( "drumkit" );
+	while ( !node.isNull() ) {
+		Entry entry;
+		entry.path = node.read_string( "path", "", false, false );
+		entry.name = node.read_string( "name", "" );
+		entry.author = node.read_string( "author", "" );
+		entry.info = node.read_string( "info", "" );
+		entry.license = node.read_string( "license", "" );
+		entry.dir_mtime = node.read_string( "dir_mtime", "0" ).toLongLong();
+		entry.xml_mtime = node.read_string( "xml_mtime", "0" ).toLongLong();
+		entry.xml_size = node.read_string( "xml_size", "-1" ).toLongLong();
+		entry.valid = node.read_bool( "valid", false );
+		XMLNode instruments = node.firstChildElement( "instruments" );
+		XMLNode instrument = instruments.firstChildElement( "instrument" );
+		while ( !instrument.isNull() ) {
+			entry.instruments << instrument.read_text( true );
+			instrument = instrument.nextSiblingElement( "instrument" );
+		}
+		if ( !entry.path.isEmpty() ) {
+			__entries.insert( entry.path, entry );
+		}
+		node = node.nextSiblingElement( "drumkit" );
+	}
+	INFOLOG( QString( "%1 drumkits indexed in %2" ).arg( __entries.size() ).arg( index_path() ) );
+}
+
+void DrumkitIndex::save()
+{
+	if ( !__modified ) return;
+	__modified = false;
+
+	if ( !Filesystem::path_usable( Filesystem::cache_dir(), true, true ) ) {
+		ERRORLOG( QString( "Can't write the drumkit index, %1 is not usable" ).arg( Filesystem::cache_dir() ) );
+		return;
+	}
+	XMLDoc doc;
+	XMLNode root = doc.set_root( "drumkit_index" );
+	foreach ( const Entry& entry, __entries ) {
+		XMLNode node = root.createNode( "drumkit" );
+		node.write_string( "path", entry.path );
+		node.write_string( "name", entry.name );
+		node.write_string( "author", entry.author );
+		node.write_string( "info", entry.info );
+		node.write_string( "license", entry.license );
+		node.write_string( "dir_mtime", QString::number( entry.dir_mtime ) );
+		node.write_string( "xml_mtime", QString::number( entry.xml_mtime ) );
+		node.write_string( "xml_size", QString::number( entry.xml_size ) );
+		node.write_bool( "valid", entry.valid );
+		XMLNode instruments = node.createNode( "instruments" );
+		foreach ( const QString& name, entry.instruments ) {
+			instruments.write_string( "instrument", name );
+		}
+	}
+	if ( !doc.write( index_path() ) ) {
+		ERRORLOG( QString( "Can't write the drumkit index %1" ).arg( index_path() ) );
+	}
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -3,6 +3,9 @@
 
 #include <QtCore/QFile>
 #include <QtCore/QLocale>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QString>
 #include <QtCore/QTextStream>
 #include <QtXmlPatterns/QXmlSchema>
@@ -169,27 +172,39 @@ const char* XMLDoc::__class_name ="XMLDoc";
 
 XMLDoc::XMLDoc( ) : Object( __class_name ) { }
 
+/// compiled schemas shared by all the documents, keyed by path
+static QMap<QString, QXmlSchema> __schemas;
+/// protects __schemas and the validations using them
+static QMutex __schemas_mutex;
+
 bool XMLDoc::read( const QString& filepath, const QString& schemapath )
 {
-	SilentMessageHandler Handler;
+	static SilentMessageHandler Handler;
+	QMutexLocker schemas_lock( &__schemas_mutex );
 	QXmlSchema schema;
-	schema.setMessageHandler( &Handler );
 	
 	bool schema_usable = false;
 	
 	if( schemapath!=0 ) {
-		QFile file( schemapath );
-		if ( !file.open( QIODevice::ReadOnly ) ) {
-			ERRORLOG( QString( "Unable to open XML schema %1 for reading" ).arg( schemapath ) );
+		QMap<QString, QXmlSchema>::const_iterator it = __schemas.constFind( schemapath );
+		if ( it != __schemas.constEnd() ) {
+			schema = it.value();
 		} else {
-			schema.load( &file, QUrl::fromLocalFile( file.fileName() ) );
-			file.close();
-			if ( schema.isValid() ) {
-				schema_usable = true;
+			QFile file( schemapath );
+			if ( !file.open( QIODevice::ReadOnly ) ) {
+				ERRORLOG( QString( "Unable to open XML schema %1 for reading" ).arg( schemapath ) );
 			} else {
-				ERRORLOG( QString( "%2 XML schema is not valid" ).arg( schemapath ) );
+				schema.setMessageHandler( &Handler );
+				schema.load( &file, QUrl::fromLocalFile( file.fileName() ) );
+				file.close();
+				if ( !schema.isValid() ) {
+					ERRORLOG( QString( "%1 XML schema is not valid" ).arg( schemapath ) );
+				}
+				// invalid schemas are kept too, compiling them again would fail the same way
+				__schemas.insert( schemapath, schema );
 			}
 		}
+		schema_usable = schema.isValid();
 	}
 	
 	QFile file( filepath );
@@ -197,25 +212,25 @@ bool XMLDoc::read( const QString& filepath, const QString& schemapath )
 		ERRORLOG( QString( "Unable to open %1 for reading" ).arg( filepath ) );
 		return false;
 	}
+	// the file is read once, validation and parsing both work on the buffer
+	QByteArray content = file.readAll();
+	file.close();
 	
 	if ( schema_usable ) {
 		QXmlSchemaValidator validator( schema );
-		if ( !validator.validate( &file, QUrl::fromLocalFile( file.fileName() ) ) ) {
+		if ( !validator.validate( content, QUrl::fromLocalFile( filepath ) ) ) {
 			WARNINGLOG( QString( "XML document %1 is not valid (%2), loading may fail" ).arg( filepath ).arg( schemapath ) );
-			file.close();
 			return false;
 		} else {
 			INFOLOG( QString( "XML document %1 is valid (%2)" ).arg( filepath ).arg( schemapath ) );
 		}
-		file.seek( 0 );
 	}
+	schemas_lock.unlock();
 	
-	if( !setContent( &file ) ) {
+	if( !setContent( content ) ) {
 		ERRORLOG( QString( "Unable to read XML document %1" ).arg( filepath ) );
-		file.close();
 		return false;
 	}
-	file.close();
 	
 	return true;
 }
@@ -38,11 +38,14 @@
 #include <ctime>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
 
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
 
 #include <hydrogen/event_queue.h>
+#include <hydrogen/meter_bus.h>
+#include <hydrogen/engine_profiler.h>
 #include <hydrogen/basics/adsr.h>
 #include <hydrogen/basics/drumkit.h>
 #include <hydrogen/basics/drumkit_component.h>
@@ -58,10 +61,14 @@
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song_snapshot.h>
+#include <hydrogen/song_preloader.h>
 #include <hydrogen/basics/note.h>
 #include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/helpers/denormals.h>
 #include <hydrogen/fx/LadspaFX.h>
 #include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/FxGraph.h>
 
 #include <hydrogen/Preferences.h>
 #include <hydrogen/sampler/Sampler.h>
@@ -97,8 +104,6 @@ namespace H2Core
 // GLOBALS
 
 // info
-float					m_fMasterPeak_L = 0.0f;		///< Master peak (left channel)
-float					m_fMasterPeak_R = 0.0f;		///< Master peak (right channel)
 float					m_fProcessTime = 0.0f;		///< time used in process function
 float					m_fMaxProcessTime = 0.0f;	///< max ms usable in process with no xrun
 //~ info
@@ -151,13 +156,9 @@ Hydrogen*				hydrogenInstance = NULL;   ///< Hydrogen class instance (used for l
 
 int						m_audioEngineState = STATE_UNINITIALIZED;	///< Audio engine state
 
-#ifdef H2CORE_HAVE_LADSPA
-float					m_fFXPeak_L[MAX_FX];
-float					m_fFXPeak_R[MAX_FX];
-#endif
-
 int						m_nPatternStartTick = -1;
 unsigned int			m_nPatternTickPosition = 0;
+int						m_nSongStartTick = 0;			///< the tick the song started at when it was switched to at a bar
 int						m_nLookaheadFrames = 0;
 
 // used in findPatternInTick
@@ -168,6 +169,34 @@ struct timeval			m_currentTickTime;
 unsigned long			m_nRealtimeFrames = 0;
 unsigned int			m_naddrealtimenotetickposition = 0;
 
+/// A song replacing the current one while playing, see Hydrogen::switchSong()
+struct SongSwitch {
+	Song*					pSong;					///< the song switched to, the song replaced once swapped
+	SongSnapshot*			pSnapshot;				///< a snapshot of it, the snapshot replaced once swapped
+	LadspaFX*				pLadspaFX[ MAX_FX ];	///< its send FX set up, the FX replaced once swapped
+	bool					bLadspaFX;				///< the send FX are swapped too
+	SongReader::Globals*	pGlobals;				///< the other settings of the song, applied once swapped
+};
+std::atomic<SongSwitch*>	m_pSongSwitch( NULL );		///< prepared, swapped in by the audio thread
+std::atomic<SongSwitch*>	m_pSongSwitched( NULL );	///< swapped in, cleaned up by Hydrogen::finishSongSwitch()
+
+/// free a song switch which wasn't swapped in, NULL is ignored
+static void dropSongSwitch( SongSwitch* pSwitch )
+{
+	if ( pSwitch == NULL ) {
+		return;
+	}
+#ifdef H2CORE_HAVE_LADSPA
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		Effects::get_instance()->releaseLadspaFX( pSwitch->pLadspaFX[ nFX ] );
+	}
+#endif
+	delete pSwitch->pSnapshot;
+	delete pSwitch->pSong;
+	delete pSwitch->pGlobals;
+	delete pSwitch;
+}
+
 // PROTOTYPES
 void					audioEngine_init();
 void					audioEngine_destroy();
@@ -187,21 +216,15 @@ inline unsigned			audioEngine_renderNote( Note* pNote, const unsigned& nBufferSi
 inline int				audioEngine_updateNoteQueue( unsigned nFrames );
 inline void				audioEngine_prepNoteQueue();
 
-inline int				findPatternInTick( int tick, bool loopMode, int *patternStartTick );
+inline int				findPatternInTick( int tick, bool loopMode, int *patternStartTick, const SongSnapshot* pSnapshot );
 
 void					audioEngine_seek( long long nFrames, bool bLoopMode = false );
+bool					audioEngine_switchSong( int nTick );
 
 void					audioEngine_restartAudioDrivers();
 void					audioEngine_startAudioDrivers();
 void					audioEngine_stopAudioDrivers();
 
-inline timeval currentTime2()
-{
-	struct timeval now;
-	gettimeofday( &now, NULL );
-	return now;
-}
-
 inline int randomValue( int max )
 {
 	return rand() % max;
@@ -279,6 +302,7 @@ void audioEngine_init()
 #endif
 	AudioEngine::create_instance();
 	Playlist::create_instance();
+	SongPreloader::create_instance();
 
 	EventQueue::get_instance()->push_event( EVENT_STATE, STATE_INITIALIZED );
 
@@ -346,8 +370,7 @@ int audioEngine_start( bool bLockEngine, unsigned nTotalFrames )
 		return 0;	// FIXME!!
 	}
 
-	m_fMasterPeak_L = 0.0f;
-	m_fMasterPeak_R = 0.0f;
+	MeterBus::get_instance()->reset();
 	m_pAudioDriver->m_transport.m_nFrames = nTotalFrames;	// reset total frames
 	m_nSongPos = -1;
 	m_nPatternStartTick = -1;
@@ -387,8 +410,7 @@ void audioEngine_stop( bool bLockEngine )
 	m_audioEngineState = STATE_READY;
 	EventQueue::get_instance()->push_event( EVENT_STATE, STATE_READY );
 
-	m_fMasterPeak_L = 0.0f;
-	m_fMasterPeak_R = 0.0f;
+	MeterBus::get_instance()->reset();
 	//	m_nPatternTickPosition = 0;
 	m_nPatternStartTick = -1;
 
@@ -432,7 +454,7 @@ inline void audioEngine_process_checkBPMChanged(Song* pSong)
 	if ( fNewTickSize == 0 || fOldTickSize == 0 )
 		return;
 
-	___WARNINGLOG( "Tempo change: Recomputing ticksize and frame position" );
+	___WARNINGLOG_RT( "Tempo change: Recomputing ticksize and frame position" );
 	float fTickNumber = m_pAudioDriver->m_transport.m_nFrames / fOldTickSize;
 
 	// update frame position in transport class
@@ -572,16 +594,15 @@ void audioEngine_seek( long long nFrames, bool bLoopMode )
 	}
 
 	if ( nFrames < 0 ) {
-		___ERRORLOG( "nFrames < 0" );
+		___ERRORLOG_RT( "nFrames < 0" );
 	}
 
-	char tmp[200];
-	sprintf( tmp, "seek in %lld (old pos = %d)",
-			 nFrames,
-			 ( int )m_pAudioDriver->m_transport.m_nFrames );
-	___INFOLOG( tmp );
+	___INFOLOG_RT( "seek in %1 (old pos = %2)",
+				   nFrames,
+				   ( int )m_pAudioDriver->m_transport.m_nFrames );
 
 	m_pAudioDriver->m_transport.m_nFrames = nFrames;
+	m_nSongStartTick = 0;
 
 	int tickNumber_start = ( unsigned )(
 				m_pAudioDriver->m_transport.m_nFrames
@@ -595,13 +616,92 @@ void audioEngine_seek( long long nFrames, bool bLoopMode )
 		loop = true;
 	}
 
-	m_nSongPos = findPatternInTick( tickNumber_start, loop, &m_nPatternStartTick );
+	const SongSnapshot* pSnapshot = AudioEngine::get_instance()->acquire_song_snapshot();
+	m_nSongPos = findPatternInTick( tickNumber_start, loop, &m_nPatternStartTick, pSnapshot );
+	AudioEngine::get_instance()->release_song_snapshot();
 	//	sprintf(tmp, "[audioEngine_seek()] m_nSongPos = %d", m_nSongPos);
 	//	hydrogenInstance->infoLog(tmp);
 
 	audioEngine_clearNoteQueue();
 }
 
+/// Swap in the song prepared by Hydrogen::switchSong(), audio thread only
+/// \param nTick the tick of the bar the song starts at, -1 when stopped
+/// \return true if the song was swapped
+bool audioEngine_switchSong( int nTick )
+{
+	if ( m_pSongSwitch.load( std::memory_order_relaxed ) == NULL || m_pSongSwitched.load() != NULL ) {
+		// nothing to switch to, or the previous switch isn't cleaned up yet
+		return false;
+	}
+	SongSwitch* pSwitch = m_pSongSwitch.exchange( NULL );
+	if ( pSwitch == NULL ) {
+		return false;
+	}
+
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pSwitch->pSong;
+
+#ifdef H2CORE_HAVE_LADSPA
+	// the notes still ringing go dry to the main out, the insert chains
+	// of the song replaced are not processed anymore
+	Song* pOldSong = pHydrogen->getSong();
+	InstrumentList* pInstruments = pOldSong->get_instrument_list();
+	for ( unsigned i = 0; i < pInstruments->size(); ++i ) {
+		FxChain* pChain = pInstruments->get( i )->get_insert_fx();
+		if ( pChain != NULL ) {
+			pChain->set_routed( false );
+		}
+	}
+	std::vector<DrumkitComponent*>* pComponents = pOldSong->get_components();
+	for ( unsigned i = 0; i < pComponents->size(); ++i ) {
+		FxChain* pChain = ( *pComponents )[ i ]->get_insert_fx();
+		if ( pChain != NULL ) {
+			pChain->set_routed( false );
+		}
+	}
+
+	if ( pSwitch->bLadspaFX ) {
+		Effects::get_instance()->swapLadspaFX( pSwitch->pLadspaFX );
+	}
+#endif
+#ifdef H2CORE_HAVE_JACK
+	if ( m_pAudioDriver->class_name() == JackAudioDriver::class_name() ) {
+		static_cast< JackAudioDriver* >( m_pAudioDriver )->swapTrackOutputs();
+	}
+#endif
+
+	// the switch keeps the song and the snapshot replaced
+	AudioEngine::get_instance()->swap_song( &pSwitch->pSong, &pSwitch->pSnapshot );
+	pHydrogen->__song = pSong;
+
+	m_pPlayingPatterns->clear();
+	m_pNextPatterns->clear();
+	if ( pSong->get_pattern_list()->size() > 0 ) {
+		m_pPlayingPatterns->add( pSong->get_pattern_list()->get( 0 ) );
+	}
+	m_nSelectedPatternNumber = 0;
+	m_pAudioDriver->setBpm( pSong->__bpm );
+
+	if ( nTick < 0 ) {
+		// the song plays from its start
+		m_nSongStartTick = 0;
+		m_nSongPos = -1;
+		m_nPatternStartTick = -1;
+		m_pAudioDriver->locate( 0 );
+	} else {
+		// the transport keeps rolling, the song starts at this bar
+		m_nSongStartTick = nTick;
+		m_nSongPos = 0;
+		m_nPatternStartTick = nTick;
+	}
+	m_nPatternTickPosition = 0;
+
+	m_pSongSwitched.store( pSwitch );
+	EventQueue::get_instance()->push_event( EVENT_SONG_SWITCHED, -1 );
+	return true;
+}
+
 inline void audioEngine_process_transport()
 {
 	if ( m_audioEngineState != STATE_READY
@@ -630,10 +730,9 @@ inline void audioEngine_process_transport()
 
 		/* Now we're playing | Update BPM */
 		if ( pSong->__bpm != m_pAudioDriver->m_transport.m_nBPM ) {
-			___INFOLOG( QString( "song bpm: (%1) gets transport bpm: (%2)" )
-				.arg( pSong->__bpm )
-				.arg( m_pAudioDriver->m_transport.m_nBPM )
-			);
+			___INFOLOG_RT( "song bpm: (%1) gets transport bpm: (%2)",
+						   pSong->__bpm,
+						   m_pAudioDriver->m_transport.m_nBPM );
 			pHydrogen->setBPM ( m_pAudioDriver->m_transport.m_nBPM );
 		}
 
@@ -695,20 +794,9 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
 	}
 
 #ifdef H2CORE_HAVE_JACK
-	JackAudioDriver * jo = dynamic_cast<JackAudioDriver*>(m_pAudioDriver);
-	if( jo && jo->has_track_outs() ) {
-		float* buf;
-		int k;
-		for( k=0 ; k<jo->getNumTracks() ; ++k ) {
-			buf = jo->getTrackOut_L(k);
-			if( buf ) {
-				memset( buf, 0, nFrames * sizeof( float ) );
-			}
-			buf = jo->getTrackOut_R(k);
-			if( buf ) {
-				memset( buf, 0, nFrames * sizeof( float ) );
-			}
-		}
+	// only the JACK driver enables track outputs
+	if( m_pAudioDriver && m_pAudioDriver->has_track_outs() ) {
+		static_cast<JackAudioDriver*>(m_pAudioDriver)->clearPerTrackAudioBuffers( nFrames );
 	}
 #endif
 
@@ -733,7 +821,11 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
 /// Main audio processing function. Called by audio drivers.
 int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 {
-	timeval startTimeval = currentTime2();
+	EngineProfiler* pProfiler = EngineProfiler::get_instance();
+	uint64_t nStart = EngineProfiler::now();
+
+	// the thread belongs to the driver, JACK or the OS, set the mode each time
+	enable_flush_to_zero();
 
 	audioEngine_process_clearAudioBuffers( nframes );
 
@@ -742,6 +834,9 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	 * alsa driver shutdown). The try_lock *should* only fail in rare circumstances
 	 * (like shutting down drivers). In such cases, it seems to be ok to interrupt
 	 * audio processing.
+	 * Notes, sequence, mixer parameters and previewed notes are changed
+	 * without this lock. It is only held for structural changes (instruments,
+	 * samples, patterns added or removed, drivers, tempo) and automation points.
 	 */
 
 	if(!AudioEngine::get_instance()->try_lock( RIGHT_HERE )){
@@ -754,34 +849,41 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	}
 
 	if ( m_nBufferSize != nframes ) {
-		___INFOLOG(
-					QString( "Buffer size changed. Old size = %1, new size = %2" )
-					.arg( m_nBufferSize )
-					.arg( nframes )
-					);
+		___INFOLOG_RT( "Buffer size changed. Old size = %1, new size = %2",
+					   m_nBufferSize,
+					   nframes );
 		m_nBufferSize = nframes;
 	}
 
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	Song* pSong = pHydrogen->getSong();
 
+	pProfiler->begin_cycle();
+	// notes and sequence are read from the snapshot published by the editors
+	AudioEngine::get_instance()->begin_snapshot_cycle();
+
 	audioEngine_process_transport();
 	audioEngine_process_checkBPMChanged(pSong); // pSong->__bpm decides tick size
 
 	bool sendPatternChange = false;
 	// always update note queue.. could come from pattern or realtime input
 	// (midi, keyboard)
+	uint64_t nStageStart = EngineProfiler::now();
 	int res2 = audioEngine_updateNoteQueue( nframes );
+	uint64_t nStageEnd = EngineProfiler::now();
+	pProfiler->add( EngineProfiler::NOTE_QUEUE, nStageEnd - nStageStart );
 	if ( res2 == -1 ) {	// end of song
-		___INFOLOG( "End of song received, calling engine_stop()" );
+		___INFOLOG_RT( "End of song received, calling engine_stop()" );
+		AudioEngine::get_instance()->end_snapshot_cycle();
 		AudioEngine::get_instance()->unlock();
 		m_pAudioDriver->stop();
 		m_pAudioDriver->locate( 0 ); // locate 0, reposition from start of the song
+		m_nSongStartTick = 0;
 
 		if ( ( m_pAudioDriver->class_name() == DiskWriterDriver::class_name() )
 			 || ( m_pAudioDriver->class_name() == FakeDriver::class_name() )
 			 ) {
-			___INFOLOG( "End of song." );
+			___INFOLOG_RT( "End of song." );
 			return 1;	// kill the audio AudioDriver thread
 		}
 
@@ -798,11 +900,17 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	} else if ( res2 == 2 ) { // send pattern change
 		sendPatternChange = true;
 	}
+	// a song switched to may have been swapped in
+	pSong = pHydrogen->getSong();
 
 	// play all notes
+	nStageStart = nStageEnd;
 	audioEngine_process_playNotes( nframes );
+	nStageEnd = EngineProfiler::now();
+	pProfiler->add( EngineProfiler::PLAY_NOTES, nStageEnd - nStageStart );
 
 	// SAMPLER
+	nStageStart = nStageEnd;
 	AudioEngine::get_instance()->get_sampler()->process( nframes, pSong );
 	float* out_L = AudioEngine::get_instance()->get_sampler()->__main_out_L;
 	float* out_R = AudioEngine::get_instance()->get_sampler()->__main_out_R;
@@ -810,106 +918,62 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		m_pMainBuffer_L[ i ] += out_L[ i ];
 		m_pMainBuffer_R[ i ] += out_R[ i ];
 	}
+	nStageEnd = EngineProfiler::now();
+	pProfiler->add( EngineProfiler::SAMPLER, nStageEnd - nStageStart );
 
 	// SYNTH
-	AudioEngine::get_instance()->get_synth()->process( nframes );
+	nStageStart = nStageEnd;
+	AudioEngine::get_instance()->get_synth()->process( nframes, pSong );
 	out_L = AudioEngine::get_instance()->get_synth()->m_pOut_L;
 	out_R = AudioEngine::get_instance()->get_synth()->m_pOut_R;
 	for ( unsigned i = 0; i < nframes; ++i ) {
 		m_pMainBuffer_L[ i ] += out_L[ i ];
 		m_pMainBuffer_R[ i ] += out_R[ i ];
 	}
-
-	timeval renderTime_end = currentTime2();
-	timeval ladspaTime_start = renderTime_end;
+	nStageEnd = EngineProfiler::now();
+	pProfiler->add( EngineProfiler::SYNTH, nStageEnd - nStageStart );
 
 #ifdef H2CORE_HAVE_LADSPA
-	// Process LADSPA FX
+	// Process the insert chains and the LADSPA send FX
+	nStageStart = nStageEnd;
 	if ( m_audioEngineState >= STATE_READY ) {
-		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-			LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
-			if ( ( pFX ) && ( pFX->isEnabled() ) ) {
-				pFX->processFX( nframes );
-
-				float *buf_L, *buf_R;
-				if ( pFX->getPluginType() == LadspaFX::STEREO_FX ) {
-					buf_L = pFX->m_pBuffer_L;
-					buf_R = pFX->m_pBuffer_R;
-				} else { // MONO FX
-					buf_L = pFX->m_pBuffer_L;
-					buf_R = buf_L;
-				}
-
-				for ( unsigned i = 0; i < nframes; ++i ) {
-					m_pMainBuffer_L[ i ] += buf_L[ i ];
-					m_pMainBuffer_R[ i ] += buf_R[ i ];
-					if ( buf_L[ i ] > m_fFXPeak_L[nFX] )
-						m_fFXPeak_L[nFX] = buf_L[ i ];
-
-					if ( buf_R[ i ] > m_fFXPeak_R[nFX] )
-						m_fFXPeak_R[nFX] = buf_R[ i ];
-				}
-			}
-		}
+		FxGraph::get_instance()->process( nframes, m_pAudioDriver->getSampleRate(), m_pMainBuffer_L, m_pMainBuffer_R );
 	}
+	nStageEnd = EngineProfiler::now();
+	pProfiler->add( EngineProfiler::LADSPA, nStageEnd - nStageStart );
 #endif
-	timeval ladspaTime_end = currentTime2();
 
-	// update master peaks
-	float val_L, val_R;
+	// update master, component and instrument levels
+	nStageStart = nStageEnd;
 	if ( m_audioEngineState >= STATE_READY ) {
-		for ( unsigned i = 0; i < nframes; ++i ) {
-			val_L = m_pMainBuffer_L[i];
-			val_R = m_pMainBuffer_R[i];
-
-			if ( val_L > m_fMasterPeak_L )
-				m_fMasterPeak_L = val_L;
-
-			if ( val_R > m_fMasterPeak_R )
-				m_fMasterPeak_R = val_R;
-
-			for (std::vector<DrumkitComponent*>::iterator it = pSong->get_components()->begin() ; it != pSong->get_components()->end(); ++it) {
-				DrumkitComponent* drumkit_component = *it;
-
-				float compo_val_L = drumkit_component->get_out_L(i);
-				float compo_val_R = drumkit_component->get_out_R(i);
-
-				if( compo_val_L > drumkit_component->get_peak_l() )
-					drumkit_component->set_peak_l( compo_val_L );
-				if( compo_val_R > drumkit_component->get_peak_r() )
-					drumkit_component->set_peak_r( compo_val_R );
-			}
-		}
+		MeterBus::get_instance()->process( pSong, m_pMainBuffer_L, m_pMainBuffer_R,
+										   nframes, m_pAudioDriver->getSampleRate() );
 	}
+	nStageEnd = EngineProfiler::now();
+	pProfiler->add( EngineProfiler::METERING, nStageEnd - nStageStart );
 
 	// update total frames number
 	if ( m_audioEngineState == STATE_PLAYING ) {
 		m_pAudioDriver->m_transport.m_nFrames += nframes;
 	}
 
-	timeval finishTimeval = currentTime2();
-	m_fProcessTime =
-			( finishTimeval.tv_sec - startTimeval.tv_sec ) * 1000.0
-			+ ( finishTimeval.tv_usec - startTimeval.tv_usec ) / 1000.0;
-
-	float sampleRate = ( float )m_pAudioDriver->getSampleRate();
-	m_fMaxProcessTime = 1000.0 / ( sampleRate / nframes );
+	uint64_t nProcessTime = EngineProfiler::now() - nStart;
+	unsigned nSampleRate = m_pAudioDriver->getSampleRate();
+	uint64_t nBudget = nSampleRate ? 1000000000ULL * nframes / nSampleRate : 0;
+	m_fProcessTime = nProcessTime / 1000000.0;
+	m_fMaxProcessTime = nBudget / 1000000.0;
 
+	if ( pProfiler->end_cycle( nProcessTime, nBudget ) ) {
 #ifdef CONFIG_DEBUG
-	if ( m_fProcessTime > m_fMaxProcessTime ) {
-		___WARNINGLOG( "" );
-		___WARNINGLOG( "----XRUN----" );
-		___WARNINGLOG( QString( "XRUN of %1 msec (%2 > %3)" )
-					   .arg( ( m_fProcessTime - m_fMaxProcessTime ) )
-					   .arg( m_fProcessTime ).arg( m_fMaxProcessTime ) );
-		___WARNINGLOG( QString( "Ladspa process time = %1" ).arg( fLadspaTime ) );
-		___WARNINGLOG( "------------" );
-		___WARNINGLOG( "" );
+		___WARNINGLOG_RT( "XRUN of %1 msec (%2 > %3)",
+						  ( m_fProcessTime - m_fMaxProcessTime ),
+						  m_fProcessTime, m_fMaxProcessTime );
+#endif
 		// raise xRun event
 		EventQueue::get_instance()->push_event( EVENT_XRUN, -1 );
 	}
-#endif
 
+	AudioEngine::get_instance()->end_snapshot_cycle();
 	AudioEngine::get_instance()->unlock();
 
 	if ( sendPatternChange ) {
@@ -936,7 +1000,7 @@ void audioEngine_setupLadspaFX( unsigned nBufferSize )
 	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
 		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
 		if ( pFX == NULL ) {
-			return;
+			continue;
 		}
 
 		pFX->deactivate();
@@ -991,6 +1055,10 @@ void audioEngine_setSong( Song * pNewSong )
 
 	m_pAudioDriver->setBpm( pNewSong->__bpm );
 
+	// the sequencer plays the snapshot published on unlock
+	AudioEngine::get_instance()->set_song( pNewSong );
+	m_nSongStartTick = 0;
+
 	// change the current audio engine state
 	m_audioEngineState = STATE_READY;
 
@@ -1019,6 +1087,7 @@ void audioEngine_removeSong()
 
 	m_pPlayingPatterns->clear();
 	m_pNextPatterns->clear();
+	AudioEngine::get_instance()->set_song( NULL );
 
 	audioEngine_clearNoteQueue();
 
@@ -1033,8 +1102,15 @@ void audioEngine_removeSong()
 // return 2 = send pattern changed event!!
 inline int audioEngine_updateNoteQueue( unsigned nFrames )
 {
+	if ( m_audioEngineState != STATE_PLAYING ) {
+		// stopped before the bar, a song switched to replaces this one at once
+		audioEngine_switchSong( -1 );
+	}
+
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	Song* pSong = pHydrogen->getSong();
+	// notes and sequence as published by the editors
+	const SongSnapshot* pSnapshot = AudioEngine::get_instance()->get_song_snapshot();
 
 //	static int nLastTick = -1;
 	bool bSendPatternChange = false;
@@ -1104,20 +1180,22 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 				&& Preferences::get_instance()->getDestructiveRecord()
 				&& Preferences::get_instance()->m_nRecPreDelete == 0;
 		if ( pSong->get_mode() == Song::SONG_MODE ) {
-			if ( pSong->get_pattern_group_vector()->size() == 0 ) {
+			if ( pSnapshot == NULL || pSnapshot->get_columns_count() == 0 ) {
 				// there's no song!!
-				___ERRORLOG( "no patterns in song." );
+				___ERRORLOG_RT( "no patterns in song." );
 				m_pAudioDriver->stop();
 				return -1;
 			}
 
-			m_nSongPos = findPatternInTick( tick, pSong->is_loop_enabled(), &m_nPatternStartTick );
+			// the song may have been switched to at a bar, see audioEngine_switchSong()
+			int nSongTick = tick - m_nSongStartTick;
+			m_nSongPos = findPatternInTick( nSongTick, pSong->is_loop_enabled(), &m_nPatternStartTick, pSnapshot );
 
 			if ( m_nSongSizeInTicks != 0 ) {
-				m_nPatternTickPosition = ( tick - m_nPatternStartTick )
+				m_nPatternTickPosition = ( nSongTick - m_nPatternStartTick )
 						% m_nSongSizeInTicks;
 			} else {
-				m_nPatternTickPosition = tick - m_nPatternStartTick;
+				m_nPatternTickPosition = nSongTick - m_nPatternStartTick;
 			}
 
 			if ( m_nPatternTickPosition == 0 ) {
@@ -1126,12 +1204,19 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 
 			// PatternList *pPatternList = (*(pSong->getPatternGroupVector()))[m_nSongPos];
 			if ( m_nSongPos == -1 ) {
-				___INFOLOG( "song pos = -1" );
+				___INFOLOG_RT( "song pos = -1" );
+				if ( audioEngine_switchSong( tick ) ) {
+					// the song switched to follows the end of this one
+					pSong = pHydrogen->getSong();
+					pSnapshot = AudioEngine::get_instance()->get_song_snapshot();
+					tick--;
+					continue;
+				}
 				if ( pSong->is_loop_enabled() == true ) {
-					m_nSongPos = findPatternInTick( 0, true, &m_nPatternStartTick );
+					m_nSongPos = findPatternInTick( 0, true, &m_nPatternStartTick, pSnapshot );
 				} else {
 
-					___INFOLOG( "End of Song" );
+					___INFOLOG_RT( "End of Song" );
 
 					if( Hydrogen::get_instance()->getMidiOutput() != NULL ){
 						Hydrogen::get_instance()->getMidiOutput()->handleQueueAllNoteOff();
@@ -1140,12 +1225,10 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 					return -1;
 				}
 			}
-			PatternList *pPatternList = ( *( pSong->get_pattern_group_vector() ) )[m_nSongPos];
+			const std::vector<int>& column = pSnapshot->get_column( m_nSongPos ).patterns;
 			m_pPlayingPatterns->clear();
-			for ( int i=0; i< pPatternList->size(); ++i ) {
-				Pattern* pattern = pPatternList->get(i);
-				m_pPlayingPatterns->add( pattern );
-				pattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+			for ( unsigned i = 0; i < column.size(); ++i ) {
+				m_pPlayingPatterns->add( pSnapshot->get_pattern( column[i] )->pattern );
 			}
 			// Set destructive record depending on punch area
 			doErase = doErase && Preferences::get_instance()->inPunchArea(m_nSongPos);
@@ -1162,18 +1245,24 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			if ( Preferences::get_instance()->patternModePlaysSelected() )
 			{
 				m_pPlayingPatterns->clear();
-				Pattern * pattern = pSong->get_pattern_list()->get(m_nSelectedPatternNumber);
-				m_pPlayingPatterns->add( pattern );
-				pattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+				if ( pSnapshot != NULL && m_nSelectedPatternNumber >= 0
+					 && m_nSelectedPatternNumber < pSnapshot->get_patterns_count() ) {
+					const std::vector<int>& playing = pSnapshot->get_playing( m_nSelectedPatternNumber );
+					for ( unsigned i = 0; i < playing.size(); ++i ) {
+						m_pPlayingPatterns->add( pSnapshot->get_pattern( playing[i] )->pattern );
+					}
+				}
 			}
 
-			if ( m_pPlayingPatterns->size() != 0 ) {
-				Pattern *pFirstPattern = m_pPlayingPatterns->get( 0 );
-				nPatternSize = pFirstPattern->get_length();
+			if ( m_pPlayingPatterns->size() != 0 && pSnapshot != NULL ) {
+				int nFirstPattern = pSnapshot->find_pattern( m_pPlayingPatterns->get( 0 ) );
+				if ( nFirstPattern != -1 ) {
+					nPatternSize = pSnapshot->get_pattern( nFirstPattern )->length;
+				}
 			}
 
 			if ( nPatternSize == 0 ) {
-				___ERRORLOG( "nPatternSize == 0" );
+				___ERRORLOG_RT( "nPatternSize == 0" );
 			}
 
 			if ( ( tick == m_nPatternStartTick + nPatternSize )
@@ -1205,6 +1294,15 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			}
 		}
 
+		// a song switched to replaces this one at the start of a bar
+		if ( m_nPatternTickPosition == 0 && audioEngine_switchSong( tick ) ) {
+			pSong = pHydrogen->getSong();
+			pSnapshot = AudioEngine::get_instance()->get_song_snapshot();
+			// the tick is played again, with the new song
+			tick--;
+			continue;
+		}
+
 		// metronome
 		// if (  ( m_nPatternStartTick == tick ) || ( ( tick - m_nPatternStartTick ) % 48 == 0 ) )
 		if ( m_nPatternTickPosition % 48 == 0 ) {
@@ -1239,18 +1337,26 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 		}
 
 		// update the notes queue
-		if ( m_pPlayingPatterns->size() != 0 ) {
+		if ( m_pPlayingPatterns->size() != 0 && pSnapshot != NULL ) {
 			for ( unsigned nPat = 0 ;
 				  nPat < m_pPlayingPatterns->size() ;
 				  ++nPat ) {
 				Pattern *pPattern = m_pPlayingPatterns->get( nPat );
 				assert( pPattern != NULL );
-				Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
+				int nSnapshotPattern = pSnapshot->find_pattern( pPattern );
+				if ( nSnapshotPattern == -1 ) {
+					continue;
+				}
+				// copies of the notes, sorted by position
+				const std::vector<Note*>& notes = pSnapshot->get_pattern( nSnapshotPattern )->notes;
+				unsigned nFirstNote = SongSnapshot::first_note_at( pSnapshot->get_pattern( nSnapshotPattern ),
+																   m_nPatternTickPosition );
 				// Delete notes before attempting to play them
 				if ( doErase ) {
-					FOREACH_NOTE_IT_BOUND(notes,it,m_nPatternTickPosition) {
-						Note* pNote = it->second;
-						assert( pNote != NULL );
+					for ( unsigned n = nFirstNote;
+						  n < notes.size() && notes[n]->get_position() == m_nPatternTickPosition;
+						  ++n ) {
+						Note* pNote = notes[n];
 						if ( pNote->get_just_recorded() == false ) {
 							EventQueue::AddMidiNoteVector noteAction;
 							noteAction.m_column = pNote->get_position();
@@ -1271,8 +1377,10 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 				}
 
 				// Now play notes
-				FOREACH_NOTE_CST_IT_BOUND(notes,it,m_nPatternTickPosition) {
-					Note *pNote = it->second;
+				for ( unsigned n = nFirstNote;
+					  n < notes.size() && notes[n]->get_position() == m_nPatternTickPosition;
+					  ++n ) {
+					Note *pNote = notes[n];
 					if ( pNote ) {
 						pNote->set_just_recorded( false );
 						int nOffset = 0;
@@ -1329,61 +1437,76 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 }
 
 /// restituisce l'indice relativo al patternGroup in base al tick
-inline int findPatternInTick( int nTick, bool bLoopMode, int *pPatternStartTick )
+inline int findPatternInTick( int nTick, bool bLoopMode, int *pPatternStartTick, const SongSnapshot* pSnapshot )
 {
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	Song* pSong = pHydrogen->getSong();
 	assert( pSong );
 
-	int nTotalTick = 0;
-	m_nSongSizeInTicks = 0;
-
-	std::vector<PatternList*> *pPatternColumns = pSong->get_pattern_group_vector();
-	int nColumns = pPatternColumns->size();
-
-	int nPatternSize;
-	for ( int i = 0; i < nColumns; ++i ) {
-		PatternList *pColumn = ( *pPatternColumns )[ i ];
-		if ( pColumn->size() != 0 ) {
-			// tengo in considerazione solo il primo pattern. I
-			// pattern nel gruppo devono avere la stessa lunghezza.
-			nPatternSize = pColumn->get( 0 )->get_length();
-		} else {
-			nPatternSize = MAX_NOTES;
+	if ( pSnapshot != NULL ) {
+		// the sequence is the one the audio thread plays
+		m_nSongSizeInTicks = 0;
+		int nColumn = pSnapshot->find_column( nTick, pPatternStartTick );
+		if ( nColumn == -1 && bLoopMode ) {
+			m_nSongSizeInTicks = pSnapshot->get_length();
+			if ( m_nSongSizeInTicks != 0 ) {
+				nColumn = pSnapshot->find_column( nTick % m_nSongSizeInTicks, pPatternStartTick );
+			}
 		}
-
-		if ( ( nTick >= nTotalTick ) && ( nTick < nTotalTick + nPatternSize ) ) {
-			( *pPatternStartTick ) = nTotalTick;
-			return i;
+		if ( nColumn != -1 ) {
+			return nColumn;
 		}
-		nTotalTick += nPatternSize;
-	}
+	} else {
+		int nTotalTick = 0;
+		m_nSongSizeInTicks = 0;
 
-	if ( bLoopMode ) {
-		m_nSongSizeInTicks = nTotalTick;
-		int nLoopTick = 0;
-		if ( m_nSongSizeInTicks != 0 ) {
-			nLoopTick = nTick % m_nSongSizeInTicks;
-		}
-		nTotalTick = 0;
+		std::vector<PatternList*> *pPatternColumns = pSong->get_pattern_group_vector();
+		int nColumns = pPatternColumns->size();
+
+		int nPatternSize;
 		for ( int i = 0; i < nColumns; ++i ) {
 			PatternList *pColumn = ( *pPatternColumns )[ i ];
 			if ( pColumn->size() != 0 ) {
-				// tengo in considerazione solo il primo
-				// pattern. I pattern nel gruppo devono avere la
-				// stessa lunghezza.
+				// tengo in considerazione solo il primo pattern. I
+				// pattern nel gruppo devono avere la stessa lunghezza.
 				nPatternSize = pColumn->get( 0 )->get_length();
 			} else {
 				nPatternSize = MAX_NOTES;
 			}
 
-			if ( ( nLoopTick >= nTotalTick )
-				 && ( nLoopTick < nTotalTick + nPatternSize ) ) {
+			if ( ( nTick >= nTotalTick ) && ( nTick < nTotalTick + nPatternSize ) ) {
 				( *pPatternStartTick ) = nTotalTick;
 				return i;
 			}
 			nTotalTick += nPatternSize;
 		}
+
+		if ( bLoopMode ) {
+			m_nSongSizeInTicks = nTotalTick;
+			int nLoopTick = 0;
+			if ( m_nSongSizeInTicks != 0 ) {
+				nLoopTick = nTick % m_nSongSizeInTicks;
+			}
+			nTotalTick = 0;
+			for ( int i = 0; i < nColumns; ++i ) {
+				PatternList *pColumn = ( *pPatternColumns )[ i ];
+				if ( pColumn->size() != 0 ) {
+					// tengo in considerazione solo il primo
+					// pattern. I pattern nel gruppo devono avere la
+					// stessa lunghezza.
+					nPatternSize = pColumn->get( 0 )->get_length();
+				} else {
+					nPatternSize = MAX_NOTES;
+				}
+
+				if ( ( nLoopTick >= nTotalTick )
+					 && ( nLoopTick < nTotalTick + nPatternSize ) ) {
+					( *pPatternStartTick ) = nTotalTick;
+					return i;
+				}
+				nTotalTick += nPatternSize;
+			}
+		}
 	}
 
 	QString err = QString( "[findPatternInTick] tick = %1. No pattern found" ).arg( QString::number(nTick) );
@@ -1770,9 +1893,13 @@ Hydrogen::~Hydrogen()
 	}
 #endif
 
+	delete SongPreloader::get_instance();
+
 	if ( m_audioEngineState == STATE_PLAYING ) {
 		audioEngine_stop();
 	}
+	dropSongSwitch( m_pSongSwitch.exchange( NULL ) );
+	finishSongSwitch();
 	removeSong();
 	audioEngine_stopAudioDrivers();
 	audioEngine_destroy();
@@ -1792,6 +1919,8 @@ void Hydrogen::create_instance()
 	MidiMap::create_instance();
 	Preferences::create_instance();
 	EventQueue::create_instance();
+	MeterBus::create_instance();
+	EngineProfiler::create_instance();
 	MidiActionManager::create_instance();
 
 #ifdef H2CORE_HAVE_OSC
@@ -1861,6 +1990,10 @@ void Hydrogen::setSong( Song *pSong )
 {
 	assert ( pSong );
 
+	// done with a song switched to while playing
+	dropSongSwitch( m_pSongSwitch.exchange( NULL ) );
+	finishSongSwitch();
+
 	/* Set first pattern */
 	setSelectedPatternNumber( 0 );
 
@@ -1872,18 +2005,20 @@ void Hydrogen::setSong( Song *pSong )
 
 	if ( pCurrentSong ) {
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
-		
-		delete pCurrentSong;
-		pCurrentSong = nullptr;
-		
-		AudioEngine::get_instance()->unlock();
-
 		/* NOTE: 
 		 *       - this is actually some kind of cleanup 
 		 *       - removeSong cares itself for aquiring a lock
 		 */
 		removeSong();
+
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		AudioEngine::get_instance()->set_song( NULL );
+		AudioEngine::get_instance()->unlock();
+
+		// the cycles which started before the unlock may still read the song
+		AudioEngine::get_instance()->wait_for_cycles();
+		delete pCurrentSong;
+		pCurrentSong = nullptr;
 	}
 
 	/* Reset GUI */
@@ -1901,6 +2036,102 @@ void Hydrogen::setSong( Song *pSong )
 	m_pCoreActionController->initExternalControlInterfaces();
 }
 
+void Hydrogen::switchSong( Song *pSong, SongReader::Globals* pGlobals )
+{
+	// a song switched to before and not played yet is dropped
+	dropSongSwitch( m_pSongSwitch.exchange( NULL ) );
+	finishSongSwitch();
+
+	Song* pCurrentSong = getSong();
+	if ( m_audioEngineState != STATE_PLAYING || pCurrentSong == NULL ) {
+		if ( pGlobals ) {
+			SongReader::attachInsertFx( pGlobals );
+			SongReader::applyGlobals( pGlobals );
+			delete pGlobals;
+		}
+		setSong( pSong );
+		EventQueue::get_instance()->push_event( EVENT_SONG_SWITCHED, -1 );
+		return;
+	}
+
+	// the new song is set up while the current one plays on, without
+	// locking the engine, the audio thread swaps it in at the next bar
+	SongSwitch* pSwitch = new SongSwitch;
+	pSwitch->pSong = pSong;
+	pSwitch->pGlobals = pGlobals;
+	pSwitch->bLadspaFX = pGlobals != NULL;
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		pSwitch->pLadspaFX[ nFX ] = NULL;
+	}
+	if ( pGlobals ) {
+		// the song isn't played yet
+		SongReader::attachInsertFx( pGlobals );
+#ifdef H2CORE_HAVE_LADSPA
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			pSwitch->pLadspaFX[ nFX ] = pGlobals->ladspaFX[ nFX ];
+			pGlobals->ladspaFX[ nFX ] = NULL;
+			if ( pSwitch->pLadspaFX[ nFX ] != NULL ) {
+				Effects::get_instance()->prepareLadspaFX( pSwitch->pLadspaFX[ nFX ] );
+			}
+		}
+#endif
+	}
+	pSwitch->pSnapshot = new SongSnapshot( pSong, NULL );
+
+#ifdef H2CORE_HAVE_JACK
+	if ( m_pAudioDriver->class_name() == JackAudioDriver::class_name() ) {
+		static_cast< JackAudioDriver* >( m_pAudioDriver )->prepareTrackOutputs( pSong );
+	}
+#endif
+
+	m_pSongSwitch.store( pSwitch );
+}
+
+void Hydrogen::finishSongSwitch()
+{
+	SongSwitch* pSwitch = m_pSongSwitched.exchange( NULL );
+	if ( pSwitch == NULL ) {
+		return;
+	}
+
+	AudioEngine* pEngine = AudioEngine::get_instance();
+	pEngine->lock_edit( RIGHT_HERE );
+	pEngine->retire_snapshot( pSwitch->pSnapshot );
+	pEngine->unlock_edit();
+
+	// the cycle which swapped may still read the FX replaced
+	pEngine->wait_for_cycles();
+#ifdef H2CORE_HAVE_LADSPA
+	if ( pSwitch->bLadspaFX ) {
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			Effects::get_instance()->releaseLadspaFX( pSwitch->pLadspaFX[ nFX ] );
+		}
+	}
+#endif
+	if ( pSwitch->pGlobals ) {
+		// the send FX are in place already
+		SongReader::applyGlobals( pSwitch->pGlobals, false );
+		delete pSwitch->pGlobals;
+	}
+
+	// the notes still ringing hold the instruments of the song replaced
+	InstrumentList* pInstruments = pSwitch->pSong->get_instrument_list();
+	while ( pInstruments->size() > 0 ) {
+		__instrument_death_row.push_back( pInstruments->del( 0 ) );
+	}
+	delete pSwitch->pSong;
+	delete pSwitch;
+	__kill_instruments();
+
+	EventQueue::get_instance()->push_event( EVENT_SELECTED_PATTERN_CHANGED, -1 );
+	EventQueue::get_instance()->push_event( EVENT_PATTERN_CHANGED, -1 );
+	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
+
+	pEngine->get_sampler()->reinitialize_playback_track();
+
+	m_pCoreActionController->initExternalControlInterfaces();
+}
+
 /* Mean: remove current song from memory */
 void Hydrogen::removeSong()
 {
@@ -2259,16 +2490,6 @@ void Hydrogen::addRealtimeNote( int instrument,
 	AudioEngine::get_instance()->unlock(); // unlock the audio engine
 }
 
-float Hydrogen::getMasterPeak_L()
-{
-	return m_fMasterPeak_L;
-}
-
-float Hydrogen::getMasterPeak_R()
-{
-	return m_fMasterPeak_R;
-}
-
 unsigned long Hydrogen::getTickPosition()
 {
 	return m_nPatternTickPosition;
@@ -2353,7 +2574,10 @@ int Hydrogen::getPosForTick( unsigned long TickPos )
 	if ( ! pSong ) return 0;
 
 	int patternStartTick;
-	return findPatternInTick( TickPos, pSong->is_loop_enabled(), &patternStartTick );
+	const SongSnapshot* pSnapshot = AudioEngine::get_instance()->acquire_song_snapshot();
+	int nPos = findPatternInTick( TickPos, pSong->is_loop_enabled(), &patternStartTick, pSnapshot );
+	AudioEngine::get_instance()->release_song_snapshot();
+	return nPos;
 }
 
 void Hydrogen::restartDrivers()
@@ -2477,16 +2701,6 @@ MidiOutput* Hydrogen::getMidiOutput()
 	return m_pMidiDriverOut;
 }
 
-void Hydrogen::setMasterPeak_L( float value )
-{
-	m_fMasterPeak_L = value;
-}
-
-void Hydrogen::setMasterPeak_R( float value )
-{
-	m_fMasterPeak_R = value;
-}
-
 int Hydrogen::getState()
 {
 	return m_audioEngineState;
@@ -2824,6 +3038,7 @@ void Hydrogen::setPatternPos( int pos )
 		m_nSongPos = pos;
 		m_nPatternTickPosition = 0;
 	}
+	m_nSongStartTick = 0;
 	m_pAudioDriver->locate(
 				( int ) ( totalTick * m_pAudioDriver->m_transport.m_nTickSize )
 				);
@@ -2831,25 +3046,6 @@ void Hydrogen::setPatternPos( int pos )
 	AudioEngine::get_instance()->unlock();
 }
 
-void Hydrogen::getLadspaFXPeak( int nFX, float *fL, float *fR )
-{
-#ifdef H2CORE_HAVE_LADSPA
-	( *fL ) = m_fFXPeak_L[nFX];
-	( *fR ) = m_fFXPeak_R[nFX];
-#else
-	( *fL ) = 0;
-	( *fR ) = 0;
-#endif
-}
-
-void Hydrogen::setLadspaFXPeak( int nFX, float fL, float fR )
-{
-#ifdef H2CORE_HAVE_LADSPA
-	m_fFXPeak_L[nFX] = fL;
-	m_fFXPeak_R[nFX] = fR;
-#endif
-}
-
 void Hydrogen::onTapTempoAccelEvent()
 {
 #ifndef WIN32
@@ -3300,6 +3496,10 @@ void Hydrogen::__kill_instruments()
 {
 	int c = 0;
 	Instrument * pInstr = NULL;
+	if ( __instrument_death_row.size() ) {
+		// the snapshot played until the last unlock may still refer to them
+		AudioEngine::get_instance()->wait_for_cycles();
+	}
 	while ( __instrument_death_row.size()
 			&& __instrument_death_row.front()->is_queued() == 0 ) {
 		pInstr = __instrument_death_row.front();
@@ -3378,8 +3578,9 @@ void Hydrogen::setTimelineBpm()
 	if ( BPM != pSong->__bpm )
 		setBPM( BPM );
 
-	// Update "realtime" BPM
+	// Update "realtime" BPM, in the ticks of the song
 	unsigned long PlayTick = getRealtimeTickPosition();
+	PlayTick = PlayTick > (unsigned long)m_nSongStartTick ? PlayTick - m_nSongStartTick : 0;
 	int RealtimePatternPos = getPosForTick ( PlayTick );
 	float RealtimeBPM = getTimelineBpm ( RealtimePatternPos );
 
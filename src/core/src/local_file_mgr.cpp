@@ -42,6 +42,7 @@
 #include <hydrogen/helpers/filesystem.h>
 #include <hydrogen/automation_path_serializer.h>
 #include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/FxChain.h>
 
 #include <algorithm>
 #include <cassert>
@@ -181,6 +182,18 @@ void LocalFileMng::writeXmlBool( QDomNode parent, const QString& name, bool valu
 	}
 }
 
+void LocalFileMng::writeXmlString( QXmlStreamWriter& writer, const QString& name, const QString& text )
+{
+	writer.writeTextElement( name, text );
+}
+
+
+
+void LocalFileMng::writeXmlBool( QXmlStreamWriter& writer, const QString& name, bool value )
+{
+	writer.writeTextElement( name, value ? QString( "true" ) : QString( "false" ) );
+}
+
 /* Convert (in-place) an XML escape sequence into a literal byte,
  * rather than the character it actually refers to.
  */
@@ -262,6 +275,25 @@ bool LocalFileMng::checkTinyXMLCompatMode( const QString& filename )
 
 }
 
+QByteArray LocalFileMng::readTinyXMLCompat( QFile& file )
+{
+	QString enc = QTextCodec::codecForLocale()->name();
+	if( enc == QString("System") ) {
+		enc = "UTF-8";
+	}
+	QByteArray line;
+	QByteArray buf = QString("<?xml version='1.0' encoding='%1' ?>\n")
+			.arg( enc )
+			.toLocal8Bit();
+
+	while( !file.atEnd() ) {
+		line = file.readLine();
+		LocalFileMng::convertFromTinyXMLString( &line );
+		buf += line;
+	}
+	return buf;
+}
+
 QDomDocument LocalFileMng::openXmlDocument( const QString& filename )
 {
 	bool TinyXMLCompat = LocalFileMng::checkTinyXMLCompatMode( filename );
@@ -273,22 +305,7 @@ QDomDocument LocalFileMng::openXmlDocument( const QString& filename )
 		return QDomDocument();
 
 	if( TinyXMLCompat ) {
-		QString enc = QTextCodec::codecForLocale()->name();
-		if( enc == QString("System") ) {
-			enc = "UTF-8";
-		}
-		QByteArray line;
-		QByteArray buf = QString("<?xml version='1.0' encoding='%1' ?>\n")
-				.arg( enc )
-				.toLocal8Bit();
-
-		while( !file.atEnd() ) {
-			line = file.readLine();
-			LocalFileMng::convertFromTinyXMLString( &line );
-			buf += line;
-		}
-
-		if( ! doc.setContent( buf ) ) {
+		if( ! doc.setContent( readTinyXMLCompat( file ) ) ) {
 			file.close();
 			return QDomDocument();
 		}
@@ -324,7 +341,10 @@ SongWriter::~SongWriter()
 }
 
 
-// Returns 0 on success, passes the TinyXml error code otherwise.
+// Returns 0 on success.
+//
+// The song is streamed to the file, no document tree is built: the
+// output follows the layout QDomDocument::save() gave it.
 int SongWriter::writeSong( Song *song, const QString& filename )
 {
 	INFOLOG( "Saving song " + filename );
@@ -334,56 +354,68 @@ int SongWriter::writeSong( Song *song, const QString& filename )
 	// FIXME: verificare che il file non sia gia' esistente
 	// FIXME: effettuare copia di backup per il file gia' esistente
 
+	QFile file(filename);
+	if ( !file.open(QIODevice::WriteOnly) ) {
+		WARNINGLOG("File save reported an error.");
+		song->set_filename( filename );
+		return 1;
+	}
 
-	QDomDocument doc;
-	QDomProcessingInstruction header = doc.createProcessingInstruction( "xml", "version=\"1.0\" encoding=\"UTF-8\"");
-	doc.appendChild( header );
-
-	QDomNode songNode = doc.createElement( "song" );
-
-	LocalFileMng::writeXmlString( songNode, "version", QString( get_version().c_str() ) );
-	LocalFileMng::writeXmlString( songNode, "bpm", QString("%1").arg( song->__bpm ) );
-	LocalFileMng::writeXmlString( songNode, "volume", QString("%1").arg( song->get_volume() ) );
-	LocalFileMng::writeXmlString( songNode, "metronomeVolume", QString("%1").arg( song->get_metronome_volume() ) );
-	LocalFileMng::writeXmlString( songNode, "name", song->__name );
-	LocalFileMng::writeXmlString( songNode, "author", song->__author );
-	LocalFileMng::writeXmlString( songNode, "notes", song->get_notes() );
-	LocalFileMng::writeXmlString( songNode, "license", song->get_license() );
-	LocalFileMng::writeXmlBool( songNode, "loopEnabled", song->is_loop_enabled() );
-	LocalFileMng::writeXmlBool( songNode, "patternModeMode", Preferences::get_instance()->patternModePlaysSelected());
+	QXmlStreamWriter writer( &file );
+	writer.setAutoFormatting( true );
+	writer.setAutoFormattingIndent( 1 );
+	writer.writeStartDocument();
+
+	writer.writeStartElement( "song" );
+
+	LocalFileMng::writeXmlString( writer, "version", QString( get_version().c_str() ) );
+	LocalFileMng::writeXmlString( writer, "bpm", QString("%1").arg( song->__bpm ) );
+	LocalFileMng::writeXmlString( writer, "volume", QString("%1").arg( song->get_volume() ) );
+	LocalFileMng::writeXmlString( writer, "metronomeVolume", QString("%1").arg( song->get_metronome_volume() ) );
+	LocalFileMng::writeXmlString( writer, "name", song->__name );
+	LocalFileMng::writeXmlString( writer, "author", song->__author );
+	LocalFileMng::writeXmlString( writer, "notes", song->get_notes() );
+	LocalFileMng::writeXmlString( writer, "license", song->get_license() );
+	LocalFileMng::writeXmlBool( writer, "loopEnabled", song->is_loop_enabled() );
+	LocalFileMng::writeXmlBool( writer, "patternModeMode", Preferences::get_instance()->patternModePlaysSelected());
 	
-	LocalFileMng::writeXmlString( songNode, "playbackTrackFilename", QString("%1").arg( song->get_playback_track_filename() ) );
-	LocalFileMng::writeXmlBool( songNode, "playbackTrackEnabled", song->get_playback_track_enabled() );
-	LocalFileMng::writeXmlString( songNode, "playbackTrackVolume", QString("%1").arg( song->get_playback_track_volume() ) );
+	LocalFileMng::writeXmlString( writer, "playbackTrackFilename", QString("%1").arg( song->get_playback_track_filename() ) );
+	LocalFileMng::writeXmlBool( writer, "playbackTrackEnabled", song->get_playback_track_enabled() );
+	LocalFileMng::writeXmlString( writer, "playbackTrackVolume", QString("%1").arg( song->get_playback_track_volume() ) );
 
 	
 	if ( song->get_mode() == Song::SONG_MODE ) {
-		LocalFileMng::writeXmlString( songNode, "mode", QString( "song" ) );
+		LocalFileMng::writeXmlString( writer, "mode", QString( "song" ) );
 	} else {
-		LocalFileMng::writeXmlString( songNode, "mode", QString( "pattern" ) );
+		LocalFileMng::writeXmlString( writer, "mode", QString( "pattern" ) );
 	}
 
-	LocalFileMng::writeXmlString( songNode, "humanize_time", QString("%1").arg( song->get_humanize_time_value() ) );
-	LocalFileMng::writeXmlString( songNode, "humanize_velocity", QString("%1").arg( song->get_humanize_velocity_value() ) );
-	LocalFileMng::writeXmlString( songNode, "swing_factor", QString("%1").arg( song->get_swing_factor() ) );
+	LocalFileMng::writeXmlString( writer, "humanize_time", QString("%1").arg( song->get_humanize_time_value() ) );
+	LocalFileMng::writeXmlString( writer, "humanize_velocity", QString("%1").arg( song->get_humanize_velocity_value() ) );
+	LocalFileMng::writeXmlString( writer, "swing_factor", QString("%1").arg( song->get_swing_factor() ) );
 
 	// component List
-	QDomNode componentListNode = doc.createElement( "componentList" );
+	writer.writeStartElement( "componentList" );
 	for (std::vector<DrumkitComponent*>::iterator it = song->get_components()->begin() ; it != song->get_components()->end(); ++it) {
 		DrumkitComponent* pCompo = *it;
 
-		QDomNode componentNode = doc.createElement( "drumkitComponent" );
+		writer.writeStartElement( "drumkitComponent" );
 
-		LocalFileMng::writeXmlString( componentNode, "id", QString("%1").arg( pCompo->get_id() ) );
-		LocalFileMng::writeXmlString( componentNode, "name", pCompo->get_name() );
-		LocalFileMng::writeXmlString( componentNode, "volume", QString("%1").arg( pCompo->get_volume() ) );
+		LocalFileMng::writeXmlString( writer, "id", QString("%1").arg( pCompo->get_id() ) );
+		LocalFileMng::writeXmlString( writer, "name", pCompo->get_name() );
+		LocalFileMng::writeXmlString( writer, "volume", QString("%1").arg( pCompo->get_volume() ) );
+#ifdef H2CORE_HAVE_LADSPA
+		if ( pCompo->get_insert_fx() ) {
+			pCompo->get_insert_fx()->save_to( writer );
+		}
+#endif
 
-		componentListNode.appendChild( componentNode );
+		writer.writeEndElement();
 	}
-	songNode.appendChild( componentListNode );
+	writer.writeEndElement();
 
 	// instrument list
-	QDomNode instrumentListNode = doc.createElement( "instrumentList" );
+	writer.writeStartElement( "instrumentList" );
 	unsigned nInstrument = song->get_instrument_list()->size();
 
 	// INSTRUMENT NODE
@@ -391,62 +423,67 @@ int SongWriter::writeSong( Song *song, const QString& filename )
 		Instrument *instr = song->get_instrument_list()->get( i );
 		assert( instr );
 
-		QDomNode instrumentNode = doc.createElement( "instrument" );
+		writer.writeStartElement( "instrument" );
 
-		LocalFileMng::writeXmlString( instrumentNode, "id", QString("%1").arg( instr->get_id() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "name", instr->get_name() );
-		LocalFileMng::writeXmlString( instrumentNode, "drumkit", instr->get_drumkit_name() );
-		LocalFileMng::writeXmlString( instrumentNode, "volume", QString("%1").arg( instr->get_volume() ) );
-		LocalFileMng::writeXmlBool( instrumentNode, "isMuted", instr->is_muted() );
-		LocalFileMng::writeXmlString( instrumentNode, "pan_L", QString("%1").arg( instr->get_pan_l() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "pan_R", QString("%1").arg( instr->get_pan_r() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "gain", QString("%1").arg( instr->get_gain() ) );
-		LocalFileMng::writeXmlBool( instrumentNode, "applyVelocity", instr->get_apply_velocity() );
+		LocalFileMng::writeXmlString( writer, "id", QString("%1").arg( instr->get_id() ) );
+		LocalFileMng::writeXmlString( writer, "name", instr->get_name() );
+		LocalFileMng::writeXmlString( writer, "drumkit", instr->get_drumkit_name() );
+		LocalFileMng::writeXmlString( writer, "volume", QString("%1").arg( instr->get_volume() ) );
+		LocalFileMng::writeXmlBool( writer, "isMuted", instr->is_muted() );
+		LocalFileMng::writeXmlString( writer, "pan_L", QString("%1").arg( instr->get_pan_l() ) );
+		LocalFileMng::writeXmlString( writer, "pan_R", QString("%1").arg( instr->get_pan_r() ) );
+		LocalFileMng::writeXmlString( writer, "gain", QString("%1").arg( instr->get_gain() ) );
+		LocalFileMng::writeXmlBool( writer, "applyVelocity", instr->get_apply_velocity() );
 
-		LocalFileMng::writeXmlBool( instrumentNode, "filterActive", instr->is_filter_active() );
-		LocalFileMng::writeXmlString( instrumentNode, "filterCutoff", QString("%1").arg( instr->get_filter_cutoff() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "filterResonance", QString("%1").arg( instr->get_filter_resonance() ) );
+		LocalFileMng::writeXmlBool( writer, "filterActive", instr->is_filter_active() );
+		LocalFileMng::writeXmlString( writer, "filterCutoff", QString("%1").arg( instr->get_filter_cutoff() ) );
+		LocalFileMng::writeXmlString( writer, "filterResonance", QString("%1").arg( instr->get_filter_resonance() ) );
 
-		LocalFileMng::writeXmlString( instrumentNode, "FX1Level", QString("%1").arg( instr->get_fx_level( 0 ) ) );
-		LocalFileMng::writeXmlString( instrumentNode, "FX2Level", QString("%1").arg( instr->get_fx_level( 1 ) ) );
-		LocalFileMng::writeXmlString( instrumentNode, "FX3Level", QString("%1").arg( instr->get_fx_level( 2 ) ) );
-		LocalFileMng::writeXmlString( instrumentNode, "FX4Level", QString("%1").arg( instr->get_fx_level( 3 ) ) );
+		LocalFileMng::writeXmlString( writer, "FX1Level", QString("%1").arg( instr->get_fx_level( 0 ) ) );
+		LocalFileMng::writeXmlString( writer, "FX2Level", QString("%1").arg( instr->get_fx_level( 1 ) ) );
+		LocalFileMng::writeXmlString( writer, "FX3Level", QString("%1").arg( instr->get_fx_level( 2 ) ) );
+		LocalFileMng::writeXmlString( writer, "FX4Level", QString("%1").arg( instr->get_fx_level( 3 ) ) );
 
 		assert( instr->get_adsr() );
-		LocalFileMng::writeXmlString( instrumentNode, "Attack", QString("%1").arg( instr->get_adsr()->get_attack() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "Decay", QString("%1").arg( instr->get_adsr()->get_decay() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "Sustain", QString("%1").arg( instr->get_adsr()->get_sustain() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "Release", QString("%1").arg( instr->get_adsr()->get_release() ) );
+		LocalFileMng::writeXmlString( writer, "Attack", QString("%1").arg( instr->get_adsr()->get_attack() ) );
+		LocalFileMng::writeXmlString( writer, "Decay", QString("%1").arg( instr->get_adsr()->get_decay() ) );
+		LocalFileMng::writeXmlString( writer, "Sustain", QString("%1").arg( instr->get_adsr()->get_sustain() ) );
+		LocalFileMng::writeXmlString( writer, "Release", QString("%1").arg( instr->get_adsr()->get_release() ) );
 
-		LocalFileMng::writeXmlString( instrumentNode, "randomPitchFactor", QString("%1").arg( instr->get_random_pitch_factor() ) );
+		LocalFileMng::writeXmlString( writer, "randomPitchFactor", QString("%1").arg( instr->get_random_pitch_factor() ) );
 
-		LocalFileMng::writeXmlString( instrumentNode, "muteGroup", QString("%1").arg( instr->get_mute_group() ) );
-		LocalFileMng::writeXmlBool( instrumentNode, "isStopNote", instr->is_stop_notes() );
+		LocalFileMng::writeXmlString( writer, "muteGroup", QString("%1").arg( instr->get_mute_group() ) );
+		LocalFileMng::writeXmlBool( writer, "isStopNote", instr->is_stop_notes() );
 		switch ( instr->sample_selection_alg() ) {
 			case Instrument::VELOCITY:
-				LocalFileMng::writeXmlString( instrumentNode, "sampleSelectionAlgo", "VELOCITY" );
+				LocalFileMng::writeXmlString( writer, "sampleSelectionAlgo", "VELOCITY" );
 				break;
 			case Instrument::RANDOM:
-				LocalFileMng::writeXmlString( instrumentNode, "sampleSelectionAlgo", "RANDOM" );
+				LocalFileMng::writeXmlString( writer, "sampleSelectionAlgo", "RANDOM" );
 				break;
 			case Instrument::ROUND_ROBIN:
-				LocalFileMng::writeXmlString( instrumentNode, "sampleSelectionAlgo", "ROUND_ROBIN" );
+				LocalFileMng::writeXmlString( writer, "sampleSelectionAlgo", "ROUND_ROBIN" );
 				break;
 		}
 
-		LocalFileMng::writeXmlString( instrumentNode, "midiOutChannel", QString("%1").arg( instr->get_midi_out_channel() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "midiOutNote", QString("%1").arg( instr->get_midi_out_note() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "isHihat", QString("%1").arg( instr->get_hihat_grp() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "lower_cc", QString("%1").arg( instr->get_lower_cc() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "higher_cc", QString("%1").arg( instr->get_higher_cc() ) );
+		LocalFileMng::writeXmlString( writer, "midiOutChannel", QString("%1").arg( instr->get_midi_out_channel() ) );
+		LocalFileMng::writeXmlString( writer, "midiOutNote", QString("%1").arg( instr->get_midi_out_note() ) );
+		LocalFileMng::writeXmlString( writer, "isHihat", QString("%1").arg( instr->get_hihat_grp() ) );
+		LocalFileMng::writeXmlString( writer, "lower_cc", QString("%1").arg( instr->get_lower_cc() ) );
+		LocalFileMng::writeXmlString( writer, "higher_cc", QString("%1").arg( instr->get_higher_cc() ) );
+		// sampled instruments keep the layout of the former files
+		if ( instr->get_synth_waveform() != Instrument::SYNTH_OFF ) {
+			LocalFileMng::writeXmlString( writer, "synthWaveform", Instrument::synth_waveform_to_string( instr->get_synth_waveform() ) );
+			LocalFileMng::writeXmlString( writer, "synthFrequency", QString("%1").arg( instr->get_synth_frequency() ) );
+		}
 
 		for (std::vector<InstrumentComponent*>::iterator it = instr->get_components()->begin() ; it != instr->get_components()->end(); ++it) {
 			InstrumentComponent* pComponent = *it;
 
-			QDomNode componentNode = doc.createElement( "instrumentComponent" );
+			writer.writeStartElement( "instrumentComponent" );
 
-			LocalFileMng::writeXmlString( componentNode, "component_id", QString("%1").arg( pComponent->get_drumkit_componentID() ) );
-			LocalFileMng::writeXmlString( componentNode, "gain", QString("%1").arg( pComponent->get_gain() ) );
+			LocalFileMng::writeXmlString( writer, "component_id", QString("%1").arg( pComponent->get_drumkit_componentID() ) );
+			LocalFileMng::writeXmlString( writer, "gain", QString("%1").arg( pComponent->get_gain() ) );
 
 			for ( unsigned nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); nLayer++ ) {
 				InstrumentLayer *pLayer = pComponent->get_layer( nLayer );
@@ -461,158 +498,161 @@ int SongWriter::writeSong( Song *song, const QString& filename )
 				QString sMode = pSample->get_loop_mode_string();
 
 
-				QDomNode layerNode = doc.createElement( "layer" );
-				LocalFileMng::writeXmlString( layerNode, "filename", Filesystem::prepare_sample_path( pSample->get_filepath() ) );
-				LocalFileMng::writeXmlBool( layerNode, "ismodified", sIsModified);
-				LocalFileMng::writeXmlString( layerNode, "smode", pSample->get_loop_mode_string() );
-				LocalFileMng::writeXmlString( layerNode, "startframe", QString("%1").arg( lo.start_frame ) );
-				LocalFileMng::writeXmlString( layerNode, "loopframe", QString("%1").arg( lo.loop_frame ) );
-				LocalFileMng::writeXmlString( layerNode, "loops", QString("%1").arg( lo.count ) );
-				LocalFileMng::writeXmlString( layerNode, "endframe", QString("%1").arg( lo.end_frame ) );
-				LocalFileMng::writeXmlString( layerNode, "userubber", QString("%1").arg( ro.use ) );
-				LocalFileMng::writeXmlString( layerNode, "rubberdivider", QString("%1").arg( ro.divider ) );
-				LocalFileMng::writeXmlString( layerNode, "rubberCsettings", QString("%1").arg( ro.c_settings ) );
-				LocalFileMng::writeXmlString( layerNode, "rubberPitch", QString("%1").arg( ro.pitch ) );
-				LocalFileMng::writeXmlString( layerNode, "min", QString("%1").arg( pLayer->get_start_velocity() ) );
-				LocalFileMng::writeXmlString( layerNode, "max", QString("%1").arg( pLayer->get_end_velocity() ) );
-				LocalFileMng::writeXmlString( layerNode, "gain", QString("%1").arg( pLayer->get_gain() ) );
-				LocalFileMng::writeXmlString( layerNode, "pitch", QString("%1").arg( pLayer->get_pitch() ) );
+				writer.writeStartElement( "layer" );
+				LocalFileMng::writeXmlString( writer, "filename", Filesystem::prepare_sample_path( pSample->get_filepath() ) );
+				LocalFileMng::writeXmlBool( writer, "ismodified", sIsModified);
+				LocalFileMng::writeXmlString( writer, "smode", pSample->get_loop_mode_string() );
+				LocalFileMng::writeXmlString( writer, "startframe", QString("%1").arg( lo.start_frame ) );
+				LocalFileMng::writeXmlString( writer, "loopframe", QString("%1").arg( lo.loop_frame ) );
+				LocalFileMng::writeXmlString( writer, "loops", QString("%1").arg( lo.count ) );
+				LocalFileMng::writeXmlString( writer, "endframe", QString("%1").arg( lo.end_frame ) );
+				LocalFileMng::writeXmlString( writer, "userubber", QString("%1").arg( ro.use ) );
+				LocalFileMng::writeXmlString( writer, "rubberdivider", QString("%1").arg( ro.divider ) );
+				LocalFileMng::writeXmlString( writer, "rubberCsettings", QString("%1").arg( ro.c_settings ) );
+				LocalFileMng::writeXmlString( writer, "rubberPitch", QString("%1").arg( ro.pitch ) );
+				LocalFileMng::writeXmlString( writer, "min", QString("%1").arg( pLayer->get_start_velocity() ) );
+				LocalFileMng::writeXmlString( writer, "max", QString("%1").arg( pLayer->get_end_velocity() ) );
+				LocalFileMng::writeXmlString( writer, "gain", QString("%1").arg( pLayer->get_gain() ) );
+				LocalFileMng::writeXmlString( writer, "pitch", QString("%1").arg( pLayer->get_pitch() ) );
 
 
 				Sample::VelocityEnvelope* velocity = pSample->get_velocity_envelope();
 				for (int y = 0; y < velocity->size(); y++){
-					QDomNode volumeNode = doc.createElement( "volume" );
-					LocalFileMng::writeXmlString( volumeNode, "volume-position", QString("%1").arg( velocity->at(y).frame ) );
-					LocalFileMng::writeXmlString( volumeNode, "volume-value", QString("%1").arg( velocity->at(y).value ) );
-					layerNode.appendChild( volumeNode );
+					writer.writeStartElement( "volume" );
+					LocalFileMng::writeXmlString( writer, "volume-position", QString("%1").arg( velocity->at(y).frame ) );
+					LocalFileMng::writeXmlString( writer, "volume-value", QString("%1").arg( velocity->at(y).value ) );
+					writer.writeEndElement();
 				}
 
 				Sample::PanEnvelope* pan = pSample->get_pan_envelope();
 				for (int y = 0; y < pan->size(); y++){
-					QDomNode panNode = doc.createElement( "pan" );
-					LocalFileMng::writeXmlString( panNode, "pan-position", QString("%1").arg( pan->at(y).frame ) );
-					LocalFileMng::writeXmlString( panNode, "pan-value", QString("%1").arg( pan->at(y).value ) );
-					layerNode.appendChild( panNode );
+					writer.writeStartElement( "pan" );
+					LocalFileMng::writeXmlString( writer, "pan-position", QString("%1").arg( pan->at(y).frame ) );
+					LocalFileMng::writeXmlString( writer, "pan-value", QString("%1").arg( pan->at(y).value ) );
+					writer.writeEndElement();
 				}
 
-				componentNode.appendChild( layerNode );
+				writer.writeEndElement();
 			}
-			instrumentNode.appendChild( componentNode );
+			writer.writeEndElement();
 		}
 
-		instrumentListNode.appendChild( instrumentNode );
+#ifdef H2CORE_HAVE_LADSPA
+		if ( instr->get_insert_fx() ) {
+			instr->get_insert_fx()->save_to( writer );
+		}
+#endif
+
+		writer.writeEndElement();
 	}
-	songNode.appendChild( instrumentListNode );
+	writer.writeEndElement();
 
 
 	// pattern list
-	QDomNode patternListNode = doc.createElement( "patternList" );
+	writer.writeStartElement( "patternList" );
 
 	unsigned nPatterns = song->get_pattern_list()->size();
 	for ( unsigned i = 0; i < nPatterns; i++ ) {
 		Pattern *pat = song->get_pattern_list()->get( i );
 
 		// pattern
-		QDomNode patternNode = doc.createElement( "pattern" );
-		LocalFileMng::writeXmlString( patternNode, "name", pat->get_name() );
-		LocalFileMng::writeXmlString( patternNode, "category", pat->get_category() );
-		LocalFileMng::writeXmlString( patternNode, "size", QString("%1").arg( pat->get_length() ) );
-		LocalFileMng::writeXmlString( patternNode, "info", pat->get_info() );
+		writer.writeStartElement( "pattern" );
+		LocalFileMng::writeXmlString( writer, "name", pat->get_name() );
+		LocalFileMng::writeXmlString( writer, "category", pat->get_category() );
+		LocalFileMng::writeXmlString( writer, "size", QString("%1").arg( pat->get_length() ) );
+		LocalFileMng::writeXmlString( writer, "info", pat->get_info() );
 
-		QDomNode noteListNode = doc.createElement( "noteList" );
+		writer.writeStartElement( "noteList" );
 		const Pattern::notes_t* notes = pat->get_notes();
 		FOREACH_NOTE_CST_IT_BEGIN_END(notes,it) {
 			Note *pNote = it->second;
 			assert( pNote );
 
-			QDomNode noteNode = doc.createElement( "note" );
-			LocalFileMng::writeXmlString( noteNode, "position", QString("%1").arg( pNote->get_position() ) );
-			LocalFileMng::writeXmlString( noteNode, "leadlag", QString("%1").arg( pNote->get_lead_lag() ) );
-			LocalFileMng::writeXmlString( noteNode, "velocity", QString("%1").arg( pNote->get_velocity() ) );
-			LocalFileMng::writeXmlString( noteNode, "pan_L", QString("%1").arg( pNote->get_pan_l() ) );
-			LocalFileMng::writeXmlString( noteNode, "pan_R", QString("%1").arg( pNote->get_pan_r() ) );
-			LocalFileMng::writeXmlString( noteNode, "pitch", QString("%1").arg( pNote->get_pitch() ) );
-			LocalFileMng::writeXmlString( noteNode, "probability", QString("%1").arg( pNote->get_probability() ) );
-
-			LocalFileMng::writeXmlString( noteNode, "key", pNote->key_to_string() );
+			writer.writeStartElement( "note" );
+			LocalFileMng::writeXmlString( writer, "position", QString("%1").arg( pNote->get_position() ) );
+			LocalFileMng::writeXmlString( writer, "leadlag", QString("%1").arg( pNote->get_lead_lag() ) );
+			LocalFileMng::writeXmlString( writer, "velocity", QString("%1").arg( pNote->get_velocity() ) );
+			LocalFileMng::writeXmlString( writer, "pan_L", QString("%1").arg( pNote->get_pan_l() ) );
+			LocalFileMng::writeXmlString( writer, "pan_R", QString("%1").arg( pNote->get_pan_r() ) );
+			LocalFileMng::writeXmlString( writer, "pitch", QString("%1").arg( pNote->get_pitch() ) );
+			LocalFileMng::writeXmlString( writer, "probability", QString("%1").arg( pNote->get_probability() ) );
 
-			LocalFileMng::writeXmlString( noteNode, "length", QString("%1").arg( pNote->get_length() ) );
-			LocalFileMng::writeXmlString( noteNode, "instrument", QString("%1").arg( pNote->get_instrument()->get_id() ) );
+			LocalFileMng::writeXmlString( writer, "key", pNote->key_to_string() );
 
-			QString noteoff = "false";
-			if ( pNote->get_note_off() ) noteoff = "true";
-			LocalFileMng::writeXmlString( noteNode, "note_off", noteoff );
-			noteListNode.appendChild( noteNode );
+			LocalFileMng::writeXmlString( writer, "length", QString("%1").arg( pNote->get_length() ) );
+			LocalFileMng::writeXmlString( writer, "instrument", QString("%1").arg( pNote->get_instrument()->get_id() ) );
+			LocalFileMng::writeXmlBool( writer, "note_off", pNote->get_note_off() );
+			writer.writeEndElement();
 
 		}
-		patternNode.appendChild( noteListNode );
+		writer.writeEndElement();
 
-		patternListNode.appendChild( patternNode );
+		writer.writeEndElement();
 	}
-	songNode.appendChild( patternListNode );
+	writer.writeEndElement();
 
-	QDomNode virtualPatternListNode = doc.createElement( "virtualPatternList" );
+	writer.writeStartElement( "virtualPatternList" );
 	for ( unsigned i = 0; i < nPatterns; i++ ) {
 		Pattern *pat = song->get_pattern_list()->get( i );
 
 		// pattern
 		if (pat->get_virtual_patterns()->empty() == false) {
-			QDomNode patternNode = doc.createElement( "pattern" );
-			LocalFileMng::writeXmlString( patternNode, "name", pat->get_name() );
+			writer.writeStartElement( "pattern" );
+			LocalFileMng::writeXmlString( writer, "name", pat->get_name() );
 
 			for (Pattern::virtual_patterns_it_t  virtIter = pat->get_virtual_patterns()->begin(); virtIter != pat->get_virtual_patterns()->end(); ++virtIter) {
-				LocalFileMng::writeXmlString( patternNode, "virtual", (*virtIter)->get_name() );
+				LocalFileMng::writeXmlString( writer, "virtual", (*virtIter)->get_name() );
 			}//for
 
-			virtualPatternListNode.appendChild( patternNode );
+			writer.writeEndElement();
 		}//if
 	}//for
-	songNode.appendChild(virtualPatternListNode);
+	writer.writeEndElement();
 
 	// pattern sequence
-	QDomNode patternSequenceNode = doc.createElement( "patternSequence" );
+	writer.writeStartElement( "patternSequence" );
 
 	unsigned nPatternGroups = song->get_pattern_group_vector()->size();
 	for ( unsigned i = 0; i < nPatternGroups; i++ ) {
-		QDomNode groupNode = doc.createElement( "group" );
+		writer.writeStartElement( "group" );
 
 		PatternList *pList = ( *song->get_pattern_group_vector() )[i];
 		for ( unsigned j = 0; j < pList->size(); j++ ) {
 			Pattern *pPattern = pList->get( j );
-			LocalFileMng::writeXmlString( groupNode, "patternID", pPattern->get_name() );
+			LocalFileMng::writeXmlString( writer, "patternID", pPattern->get_name() );
 		}
-		patternSequenceNode.appendChild( groupNode );
+		writer.writeEndElement();
 	}
 
-	songNode.appendChild( patternSequenceNode );
+	writer.writeEndElement();
 
 
 	// LADSPA FX
-	QDomNode ladspaFxNode = doc.createElement( "ladspa" );
+	writer.writeStartElement( "ladspa" );
 
 	for ( unsigned nFX = 0; nFX < MAX_FX; nFX++ ) {
-		QDomNode fxNode = doc.createElement( "fx" );
+		writer.writeStartElement( "fx" );
 
 #ifdef H2CORE_HAVE_LADSPA
 		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
 		if ( pFX ) {
-			LocalFileMng::writeXmlString( fxNode, "name", pFX->getPluginLabel() );
-			LocalFileMng::writeXmlString( fxNode, "filename", pFX->getLibraryPath() );
-			LocalFileMng::writeXmlBool( fxNode, "enabled", pFX->isEnabled() );
-			LocalFileMng::writeXmlString( fxNode, "volume", QString("%1").arg( pFX->getVolume() ) );
+			LocalFileMng::writeXmlString( writer, "name", pFX->getPluginLabel() );
+			LocalFileMng::writeXmlString( writer, "filename", pFX->getLibraryPath() );
+			LocalFileMng::writeXmlBool( writer, "enabled", pFX->isEnabled() );
+			LocalFileMng::writeXmlString( writer, "volume", QString("%1").arg( pFX->getVolume() ) );
 			for ( unsigned nControl = 0; nControl < pFX->inputControlPorts.size(); nControl++ ) {
 				LadspaControlPort *pControlPort = pFX->inputControlPorts[ nControl ];
-				QDomNode controlPortNode = doc.createElement( "inputControlPort" );
-				LocalFileMng::writeXmlString( controlPortNode, "name", pControlPort->sName );
-				LocalFileMng::writeXmlString( controlPortNode, "value", QString("%1").arg( pControlPort->fControlValue ) );
-				fxNode.appendChild( controlPortNode );
+				writer.writeStartElement( "inputControlPort" );
+				LocalFileMng::writeXmlString( writer, "name", pControlPort->sName );
+				LocalFileMng::writeXmlString( writer, "value", QString("%1").arg( pControlPort->fControlValue ) );
+				writer.writeEndElement();
 			}
 			for ( unsigned nControl = 0; nControl < pFX->outputControlPorts.size(); nControl++ ) {
 				LadspaControlPort *pControlPort = pFX->inputControlPorts[ nControl ];
-				QDomNode controlPortNode = doc.createElement( "outputControlPort" );
-				LocalFileMng::writeXmlString( controlPortNode, "name", pControlPort->sName );
-				LocalFileMng::writeXmlString( controlPortNode, "value", QString("%1").arg( pControlPort->fControlValue ) );
-				fxNode.appendChild( controlPortNode );
+				writer.writeStartElement( "outputControlPort" );
+				LocalFileMng::writeXmlString( writer, "name", pControlPort->sName );
+				LocalFileMng::writeXmlString( writer, "value", QString("%1").arg( pControlPort->fControlValue ) );
+				writer.writeEndElement();
 			}
 		}
 #else
@@ -620,67 +660,54 @@ int SongWriter::writeSong( Song *song, const QString& filename )
 		}
 #endif
 		else {
-			LocalFileMng::writeXmlString( fxNode, "name", QString( "no plugin" ) );
-			LocalFileMng::writeXmlString( fxNode, "filename", QString( "-" ) );
-			LocalFileMng::writeXmlBool( fxNode, "enabled", false );
-			LocalFileMng::writeXmlString( fxNode, "volume", "0.0" );
+			LocalFileMng::writeXmlString( writer, "name", QString( "no plugin" ) );
+			LocalFileMng::writeXmlString( writer, "filename", QString( "-" ) );
+			LocalFileMng::writeXmlBool( writer, "enabled", false );
+			LocalFileMng::writeXmlString( writer, "volume", "0.0" );
 		}
-		ladspaFxNode.appendChild( fxNode );
+		writer.writeEndElement();
 	}
 
-	songNode.appendChild( ladspaFxNode );
-	doc.appendChild( songNode );
+	writer.writeEndElement();
 
 
 	//bpm time line
 	Timeline * pTimeline = Hydrogen::get_instance()->getTimeline();
 
-	QDomNode bpmTimeLine = doc.createElement( "BPMTimeLine" );
+	writer.writeStartElement( "BPMTimeLine" );
 
 	if(pTimeline->m_timelinevector.size() >= 1 ){
 		for ( int t = 0; t < static_cast<int>(pTimeline->m_timelinevector.size()); t++){
-			QDomNode newBPMNode = doc.createElement( "newBPM" );
-			LocalFileMng::writeXmlString( newBPMNode, "BAR",QString("%1").arg( pTimeline->m_timelinevector[t].m_htimelinebeat ));
-			LocalFileMng::writeXmlString( newBPMNode, "BPM", QString("%1").arg( pTimeline->m_timelinevector[t].m_htimelinebpm  ) );
-			bpmTimeLine.appendChild( newBPMNode );
+			writer.writeStartElement( "newBPM" );
+			LocalFileMng::writeXmlString( writer, "BAR",QString("%1").arg( pTimeline->m_timelinevector[t].m_htimelinebeat ));
+			LocalFileMng::writeXmlString( writer, "BPM", QString("%1").arg( pTimeline->m_timelinevector[t].m_htimelinebpm  ) );
+			writer.writeEndElement();
 		}
 	}
-	songNode.appendChild( bpmTimeLine );
+	writer.writeEndElement();
 
 	//time line tag
-	QDomNode timeLineTag = doc.createElement( "timeLineTag" );
+	writer.writeStartElement( "timeLineTag" );
 	if(pTimeline->m_timelinetagvector.size() >= 1 ){
 		for ( int t = 0; t < static_cast<int>(pTimeline->m_timelinetagvector.size()); t++){
-			QDomNode newTAGNode = doc.createElement( "newTAG" );
-			LocalFileMng::writeXmlString( newTAGNode, "BAR",QString("%1").arg( pTimeline->m_timelinetagvector[t].m_htimelinetagbeat ));
-			LocalFileMng::writeXmlString( newTAGNode, "TAG", QString("%1").arg( pTimeline->m_timelinetagvector[t].m_htimelinetag  ) );
-			timeLineTag.appendChild( newTAGNode );
+			writer.writeStartElement( "newTAG" );
+			LocalFileMng::writeXmlString( writer, "BAR",QString("%1").arg( pTimeline->m_timelinetagvector[t].m_htimelinetagbeat ));
+			LocalFileMng::writeXmlString( writer, "TAG", QString("%1").arg( pTimeline->m_timelinetagvector[t].m_htimelinetag  ) );
+			writer.writeEndElement();
 		}
 	}
-	songNode.appendChild( timeLineTag );
+	writer.writeEndElement();
 
 	// Automation Paths
-	QDomNode automationPathsTag = doc.createElement( "automationPaths" );
-	AutomationPath *pPath = song->get_velocity_automation_path();
-	if (pPath) {
-		QDomElement pathNode = doc.createElement("path");
-		pathNode.setAttribute("adjust", "velocity");
-
-		AutomationPathSerializer serializer;
-		serializer.write_automation_path(pathNode, *pPath);
-
-		automationPathsTag.appendChild(pathNode);
-	}
-	songNode.appendChild( automationPathsTag );
-
-	QFile file(filename);
-	if ( !file.open(QIODevice::WriteOnly) )
-		rv = 1;
+	writer.writeStartElement( "automationPaths" );
+	AutomationPathSerializer serializer;
+	serializer.write_automation_paths( writer, song );
+	writer.writeEndElement();
 
-	QTextStream TextStream( &file );
-	doc.save( TextStream, 1 );
+	writer.writeEndElement();
+	writer.writeEndDocument();
 
-	if( file.size() == 0)
+	if( writer.hasError() || file.size() == 0)
 		rv = 1;
 
 	file.close();
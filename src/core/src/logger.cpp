@@ -23,17 +23,27 @@
 #include "hydrogen/logger.h"
 
 #include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
 #include <QtCore/QDir>
 #include <QtCore/QString>
 
 #ifdef WIN32
 #include <windows.h>
-#define LOGGER_SLEEP Sleep( 100 )
 #else
 #include <unistd.h>
-#define LOGGER_SLEEP do { usleep( 500000 ); usleep( 500000 ); } while (0)
+#include <sys/time.h>
 #endif
 
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#define LOGGER_HAVE_EVENTFD
+#endif
+
+#define LOGGER_WAIT_MS 100
+
 namespace H2Core {
 
 unsigned Logger::__bit_msk = 0;
@@ -66,27 +76,73 @@ void* loggerThread_func( void* param ) {
 			fprintf( stderr, "Error: can't open log file for writing...\n" );
 		}
 	}
-	Logger::queue_t* queue = &logger->__msg_queue;
-	Logger::queue_t::iterator it, last;
-	//QString tmpString;
-	while ( logger->__running ) {
-		LOGGER_SLEEP;
-		if( !queue->empty() ) {
-			for( it = last = queue->begin() ; it != queue->end() ; ++it ) {
-				last = it;
-				fprintf( stdout, "%s", it->toLocal8Bit().data() );
-				if( log_file ) {
-					fprintf( log_file, "%s", it->toLocal8Bit().data() );
-					fflush( log_file );
+	QString line;
+	unsigned reported_drops = 0;
+	bool running = true;
+	while ( running ) {
+		// read the flag before draining, so that records pushed before shutdown are output
+		running = logger->__running.load();
+		while ( logger->pop( line ) ) {
+			fprintf( stdout, "%s", line.toLocal8Bit().data() );
+			if( log_file ) {
+				fprintf( log_file, "%s", line.toLocal8Bit().data() );
+			}
+		}
+		unsigned drops = logger->dropped();
+		if ( drops != reported_drops ) {
+			line = QString( "\033[36m(W) Logger: %1 messages dropped, ring full\033[0m\n" ).arg( drops - reported_drops );
+			fprintf( stdout, "%s", line.toLocal8Bit().data() );
+			if( log_file ) {
+				fprintf( log_file, "%s", line.toLocal8Bit().data() );
+			}
+			reported_drops = drops;
+		}
+		fflush( stdout );
+		if( log_file ) {
+			fflush( log_file );
+		}
+		if ( !running ) break;
+
+		logger->__waiting.store( true );
+		// pairs with the fence of commit(), either the producer sees __waiting
+		// or this thread sees its record
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		// a producer may have committed between pop() and __waiting, check again
+		Logger::record_t* next = &logger->__ring[ logger->__read_pos & ( Logger::ring_size - 1 ) ];
+		if ( next->seq.load( std::memory_order_acquire ) != logger->__read_pos + 1 && logger->__running.load() ) {
+#ifdef LOGGER_HAVE_EVENTFD
+			if ( logger->__wakeup_fd != -1 ) {
+				struct pollfd pfd;
+				pfd.fd = logger->__wakeup_fd;
+				pfd.events = POLLIN;
+				if ( poll( &pfd, 1, LOGGER_WAIT_MS ) > 0 ) {
+					uint64_t count;
+					if ( read( logger->__wakeup_fd, &count, sizeof( count ) ) < 0 ) {
+						// nothing to do, the counter will be read next time
+					}
 				}
+			} else
+#endif
+			{
+#ifdef WIN32
+				Sleep( LOGGER_WAIT_MS );
+#else
+				struct timeval now;
+				gettimeofday( &now, 0 );
+				struct timespec deadline;
+				deadline.tv_sec = now.tv_sec;
+				deadline.tv_nsec = now.tv_usec * 1000 + LOGGER_WAIT_MS * 1000000;
+				if ( deadline.tv_nsec >= 1000000000 ) {
+					deadline.tv_sec += 1;
+					deadline.tv_nsec -= 1000000000;
+				}
+				pthread_mutex_lock( &logger->__mutex );
+				pthread_cond_timedwait( &logger->__cond, &logger->__mutex, &deadline );
+				pthread_mutex_unlock( &logger->__mutex );
+#endif
 			}
-			// remove all in front of last
-			queue->erase( queue->begin(), last );
-			// lock before removing last
-			pthread_mutex_lock( &logger->__mutex );
-			queue->pop_front();
-			pthread_mutex_unlock( &logger->__mutex );
 		}
+		logger->__waiting.store( false );
 	}
 	if ( log_file ) {
 		fprintf( log_file, "Stop logger" );
@@ -95,7 +151,6 @@ void* loggerThread_func( void* param ) {
 #ifdef WIN32
 	::FreeConsole();
 #endif
-	LOGGER_SLEEP;
 	pthread_exit( 0 );
 	return 0;
 }
@@ -110,25 +165,150 @@ Logger* Logger::create_instance() {
 	return __instance;
 }
 
-Logger::Logger() : __use_file( false ), __running( true ) {
+Logger::Logger() : __use_file( false ), __running( true ), __waiting( false ), __dropped( 0 ), __write_pos( 0 ), __read_pos( 0 ), __wakeup_fd( -1 ) {
 	__instance = this;
+	__ring = new record_t[ ring_size ];
+	for ( unsigned i = 0; i < ring_size; i++ ) {
+		__ring[i].seq.store( i );
+		__ring[i].long_msg = 0;
+	}
+#ifdef LOGGER_HAVE_EVENTFD
+	__wakeup_fd = eventfd( 0, EFD_NONBLOCK );
+#endif
 	pthread_attr_t attr;
 	pthread_attr_init( &attr );
 	pthread_mutex_init( &__mutex, 0 );
+	pthread_cond_init( &__cond, 0 );
 	pthread_create( &loggerThread, &attr, loggerThread_func, this );
 }
 
+pthread_t Logger::thread() const {
+	return loggerThread;
+}
+
 Logger::~Logger() {
 	__running = false;
+	wakeup();
 	pthread_join( loggerThread, 0 );
+#ifdef LOGGER_HAVE_EVENTFD
+	if ( __wakeup_fd != -1 ) close( __wakeup_fd );
+#endif
+	pthread_cond_destroy( &__cond );
+	pthread_mutex_destroy( &__mutex );
+	for ( unsigned i = 0; i < ring_size; i++ ) {
+		delete[] __ring[i].long_msg;
+	}
+	delete[] __ring;
+}
+
+Logger::record_t* Logger::claim( unsigned& pos ) {
+	pos = __write_pos.load( std::memory_order_relaxed );
+	for ( ;; ) {
+		record_t* rec = &__ring[ pos & ( ring_size - 1 ) ];
+		int diff = ( int )( rec->seq.load( std::memory_order_acquire ) - pos );
+		if ( diff == 0 ) {
+			// the slot is free, try to claim it
+			if ( __write_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+				return rec;
+			}
+			// pos has been reloaded by compare_exchange_weak
+		} else if ( diff < 0 ) {
+			// the slot has not been consumed yet, the ring is full
+			__dropped.fetch_add( 1, std::memory_order_relaxed );
+			return 0;
+		} else {
+			// another producer claimed it
+			pos = __write_pos.load( std::memory_order_relaxed );
+		}
+	}
+}
+
+void Logger::commit( record_t* rec, unsigned pos ) {
+	rec->seq.store( pos + 1, std::memory_order_release );
+	// keeps the load of __waiting after the store of the record, see the logger thread
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	if ( __waiting.load( std::memory_order_relaxed ) ) {
+		wakeup();
+	}
+}
+
+void Logger::wakeup() {
+#ifdef LOGGER_HAVE_EVENTFD
+	if ( __wakeup_fd != -1 ) {
+		uint64_t one = 1;
+		if ( write( __wakeup_fd, &one, sizeof( one ) ) < 0 ) {
+			// the counter is saturated, the logger thread will wake up anyway
+		}
+		return;
+	}
+#endif
+	// never block the caller, the logger thread wakes up periodically anyway
+	if ( pthread_mutex_trylock( &__mutex ) == 0 ) {
+		pthread_cond_signal( &__cond );
+		pthread_mutex_unlock( &__mutex );
+	}
+}
+
+void Logger::log( unsigned level, const char* class_name, const char* func_name, const QString& msg ) {
+
+	if( level == None ){
+		return;
+	}
+
+	unsigned pos;
+	record_t* rec = claim( pos );
+	if ( rec == 0 ) {
+		return;
+	}
+	rec->level = level;
+	rec->class_name = class_name;
+	rec->func_name = func_name;
+	rec->fmt = 0;
+	rec->nargs = 0;
+
+	QByteArray utf8 = msg.toUtf8();
+	if ( ( unsigned )utf8.size() < msg_size ) {
+		memcpy( rec->msg, utf8.constData(), utf8.size() + 1 );
+		rec->long_msg = 0;
+	} else {
+		// only non realtime callers build messages this long
+		rec->msg[0] = 0;
+		rec->long_msg = new char[ utf8.size() + 1 ];
+		memcpy( rec->long_msg, utf8.constData(), utf8.size() + 1 );
+	}
+	commit( rec, pos );
 }
 
-void Logger::log( unsigned level, const QString& class_name, const char* func_name, const QString& msg ) {
+void Logger::push_fmt( unsigned level, const char* class_name, const char* func_name, const char* fmt, unsigned nargs, const arg_t* args ) {
 
 	if( level == None ){
 		return;
 	}
 
+	unsigned pos;
+	record_t* rec = claim( pos );
+	if ( rec == 0 ) {
+		return;
+	}
+	rec->level = level;
+	rec->class_name = class_name;
+	rec->func_name = func_name;
+	rec->fmt = fmt;
+	rec->nargs = nargs;
+	for ( unsigned i = 0; i < nargs; i++ ) {
+		rec->args[i] = args[i];
+	}
+	rec->long_msg = 0;
+	rec->msg[0] = 0;
+	commit( rec, pos );
+}
+
+bool Logger::pop( QString& out ) {
+	record_t* rec = &__ring[ __read_pos & ( ring_size - 1 ) ];
+	if ( rec->seq.load( std::memory_order_acquire ) != __read_pos + 1 ) {
+		return false;
+	}
+
 	const char* prefix[] = { "", "(E) ", "(W) ", "(I) ", "(D) " };
 #ifdef WIN32
 	const char* color[] = { "", "", "", "", "" };
@@ -137,7 +317,7 @@ void Logger::log( unsigned level, const QString& class_name, const char* func_na
 #endif // WIN32
 
 	int i;
-	switch( level ) {
+	switch( rec->level ) {
 	case Error:
 		i = 1;
 		break;
@@ -155,16 +335,45 @@ void Logger::log( unsigned level, const QString& class_name, const char* func_na
 		break;
 	}
 
-	QString tmp = QString( "%1%2%3::%4 %5\033[0m\n" )
-				  .arg( color[i] )
-				  .arg( prefix[i] )
-				  .arg( class_name )
-				  .arg( func_name )
-				  .arg( msg );
+	QString msg;
+	if ( rec->fmt ) {
+		msg = QString::fromUtf8( rec->fmt );
+		for ( unsigned n = 0; n < rec->nargs; n++ ) {
+			const arg_t& a = rec->args[n];
+			switch( a.type ) {
+			case arg_t::Int:
+				msg = msg.arg( a.i );
+				break;
+			case arg_t::UInt:
+				msg = msg.arg( a.u );
+				break;
+			case arg_t::Double:
+				msg = msg.arg( a.d );
+				break;
+			case arg_t::String:
+				msg = msg.arg( QString::fromUtf8( a.s ) );
+				break;
+			}
+		}
+	} else if ( rec->long_msg ) {
+		msg = QString::fromUtf8( rec->long_msg );
+		delete[] rec->long_msg;
+		rec->long_msg = 0;
+	} else {
+		msg = QString::fromUtf8( rec->msg );
+	}
+
+	out = QString( "%1%2%3::%4 %5\033[0m\n" )
+		  .arg( color[i] )
+		  .arg( prefix[i] )
+		  .arg( rec->class_name )
+		  .arg( rec->func_name )
+		  .arg( msg );
 
-	pthread_mutex_lock( &__mutex );
-	__msg_queue.push_back( tmp );
-	pthread_mutex_unlock( &__mutex );
+	// release the slot for the producers
+	rec->seq.store( __read_pos + ring_size, std::memory_order_release );
+	__read_pos++;
+	return true;
 }
 
 unsigned Logger::parse_log_level( const char* level ) {
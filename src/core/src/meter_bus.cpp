@@ -0,0 +1,353 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/meter_bus.h>
+
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/drumkit_component.h>
+#include <hydrogen/sampler/Sampler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/* levels are reset even if nobody reads them, after this number of frames */
+#define METER_MAX_ACCUMULATED_FRAMES ( 1 << 22 )
+/* duration of an history entry in seconds */
+#define METER_HISTORY_PERIOD 0.05
+
+namespace H2Core
+{
+
+void MeterAccumulator::reset()
+{
+	peak_l = peak_r = 0.0f;
+	true_peak_l = true_peak_r = 0.0f;
+	sum_sq_l = sum_sq_r = 0.0;
+	frames = 0;
+}
+
+void MeterAccumulator::merge( const MeterAccumulator& other )
+{
+	peak_l = std::max( peak_l, other.peak_l );
+	peak_r = std::max( peak_r, other.peak_r );
+	true_peak_l = std::max( true_peak_l, other.true_peak_l );
+	true_peak_r = std::max( true_peak_r, other.true_peak_r );
+	sum_sq_l += other.sum_sq_l;
+	sum_sq_r += other.sum_sq_r;
+	frames += other.frames;
+}
+
+void MeterAccumulator::add_voice( float fPeak_L, float fPeak_R, double fSumSq_L, double fSumSq_R )
+{
+	peak_l = std::max( peak_l, fPeak_L );
+	peak_r = std::max( peak_r, fPeak_R );
+	// no oversampling on the voices
+	true_peak_l = peak_l;
+	true_peak_r = peak_r;
+	sum_sq_l += fSumSq_L;
+	sum_sq_r += fSumSq_R;
+}
+
+
+MeterBus* MeterBus::__instance = NULL;
+const char* MeterBus::__class_name = "MeterBus";
+
+void MeterBus::create_instance()
+{
+	if ( __instance == 0 ) {
+		__instance = new MeterBus;
+	}
+}
+
+MeterBus::MeterBus()
+	: Object( __class_name )
+	, __history_frames( 0 )
+	, __back( 0 )
+	, __front( 1 )
+	, __middle( 2 )
+	, __serial( 0 )
+	, __history_pos( 0 )
+{
+	__instance = this;
+	__instruments = new MeterAccumulator[ MAX_INSTRUMENTS ];
+	for ( int i = 0; i < 3; ++i ) {
+		__buffers[ i ] = new MeterSnapshot;
+		memset( __buffers[ i ], 0, sizeof( MeterSnapshot ) );
+	}
+	memset( __component_history, 0, sizeof( __component_history ) );
+	memset( __master_history, 0, sizeof( __master_history ) );
+}
+
+MeterBus::~MeterBus()
+{
+	delete[] __instruments;
+	for ( int i = 0; i < 3; ++i ) {
+		delete __buffers[ i ];
+	}
+	__instance = NULL;
+}
+
+void MeterBus::reset()
+{
+	__master.reset();
+	__playback.reset();
+	for ( int i = 0; i < MAX_FX; ++i ) {
+		__fx[ i ].reset();
+	}
+	for ( int i = 0; i < MAX_INSTRUMENTS; ++i ) {
+		__instruments[ i ].reset();
+	}
+	for ( int i = 0; i < MAX_COMPONENTS; ++i ) {
+		__components[ i ].reset();
+	}
+}
+
+void MeterBus::reduce( const float* pBuf, unsigned nFrames, float& fPeak, double& fSumSq )
+{
+	unsigned i = 0;
+	float fMax = 0.0f;
+	float fSum = 0.0f;
+#if defined(__SSE__)
+	if ( nFrames >= 4 ) {
+		const __m128 absMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+		__m128 vMax = _mm_setzero_ps();
+		__m128 vSum = _mm_setzero_ps();
+		for ( ; i + 4 <= nFrames; i += 4 ) {
+			__m128 v = _mm_loadu_ps( pBuf + i );
+			vMax = _mm_max_ps( vMax, _mm_and_ps( v, absMask ) );
+			vSum = _mm_add_ps( vSum, _mm_mul_ps( v, v ) );
+		}
+		float max4[4], sum4[4];
+		_mm_storeu_ps( max4, vMax );
+		_mm_storeu_ps( sum4, vSum );
+		fMax = std::max( std::max( max4[0], max4[1] ), std::max( max4[2], max4[3] ) );
+		fSum = ( sum4[0] + sum4[1] ) + ( sum4[2] + sum4[3] );
+	}
+#endif
+	for ( ; i < nFrames; ++i ) {
+		float v = pBuf[ i ];
+		fMax = std::max( fMax, std::fabs( v ) );
+		fSum += v * v;
+	}
+	fPeak = fMax;
+	fSumSq = fSum;
+}
+
+float MeterBus::TruePeak::process( const float* pBuf, unsigned nFrames )
+{
+	// cubic interpolation between x1 and x2 at 1/4, 1/2 and 3/4
+	float fMax = 0.0f;
+	float x0 = x[0], x1 = x[1], x2 = x[2];
+	for ( unsigned i = 0; i < nFrames; ++i ) {
+		float x3 = pBuf[ i ];
+		float c1 = 0.5f * ( x2 - x0 );
+		float c2 = x0 - 2.5f * x1 + 2.0f * x2 - 0.5f * x3;
+		float c3 = 0.5f * ( x3 - x0 ) + 1.5f * ( x1 - x2 );
+		float y1 = ( ( c3 * 0.25f + c2 ) * 0.25f + c1 ) * 0.25f + x1;
+		float y2 = ( ( c3 * 0.5f + c2 ) * 0.5f + c1 ) * 0.5f + x1;
+		float y3 = ( ( c3 * 0.75f + c2 ) * 0.75f + c1 ) * 0.75f + x1;
+		fMax = std::max( fMax, std::max( std::fabs( x2 ), std::fabs( y1 ) ) );
+		fMax = std::max( fMax, std::max( std::fabs( y2 ), std::fabs( y3 ) ) );
+		x0 = x1;
+		x1 = x2;
+		x2 = x3;
+	}
+	x[0] = x0;
+	x[1] = x1;
+	x[2] = x2;
+	return fMax;
+}
+
+float MeterBus::meter( MeterAccumulator& acc, TruePeak* pTruePeak, const float* pBuf_L, const float* pBuf_R, unsigned nFrames )
+{
+	float fPeak_L, fPeak_R;
+	double fSumSq_L, fSumSq_R;
+	reduce( pBuf_L, nFrames, fPeak_L, fSumSq_L );
+	reduce( pBuf_R, nFrames, fPeak_R, fSumSq_R );
+	acc.peak_l = std::max( acc.peak_l, fPeak_L );
+	acc.peak_r = std::max( acc.peak_r, fPeak_R );
+	acc.sum_sq_l += fSumSq_L;
+	acc.sum_sq_r += fSumSq_R;
+	acc.frames += nFrames;
+	acc.true_peak_l = std::max( acc.true_peak_l, pTruePeak[0].process( pBuf_L, nFrames ) );
+	acc.true_peak_r = std::max( acc.true_peak_r, pTruePeak[1].process( pBuf_R, nFrames ) );
+	return std::max( fPeak_L, fPeak_R );
+}
+
+void MeterBus::to_meter( const MeterAccumulator& acc, Meter& out )
+{
+	out.peak_l = acc.peak_l;
+	out.peak_r = acc.peak_r;
+	out.true_peak_l = std::max( acc.peak_l, acc.true_peak_l );
+	out.true_peak_r = std::max( acc.peak_r, acc.true_peak_r );
+	if ( acc.frames > 0 ) {
+		out.rms_l = sqrt( acc.sum_sq_l / acc.frames );
+		out.rms_r = sqrt( acc.sum_sq_r / acc.frames );
+	} else {
+		out.rms_l = out.rms_r = 0.0f;
+	}
+}
+
+void MeterBus::process_fx( int nFX, const float* pBuf_L, const float* pBuf_R, unsigned nFrames )
+{
+	if ( nFX < 0 || nFX >= MAX_FX ) {
+		return;
+	}
+	meter( __fx[ nFX ], __fx_tp[ nFX ], pBuf_L, pBuf_R, nFrames );
+}
+
+void MeterBus::process( Song* pSong, const float* pMain_L, const float* pMain_R, unsigned nFrames, unsigned nSampleRate )
+{
+	// the histories take the peaks of this block, the accumulators may hold the previous ones
+	float fBlockPeak = meter( __master, __master_tp, pMain_L, pMain_R, nFrames );
+	__master_history[ __history_pos ] = std::max( __master_history[ __history_pos ], fBlockPeak );
+
+	int nComponents = 0;
+	int nInstruments = 0;
+	MeterSnapshot* pBack = __buffers[ __back ];
+
+	if ( pSong ) {
+		// one reduction per component instead of a per-frame loop over all of them
+		std::vector<DrumkitComponent*>* pComponents = pSong->get_components();
+		for ( std::vector<DrumkitComponent*>::iterator it = pComponents->begin(); it != pComponents->end() && nComponents < MAX_COMPONENTS; ++it ) {
+			DrumkitComponent* pCompo = *it;
+			fBlockPeak = meter( __components[ nComponents ], __components_tp[ nComponents ], pCompo->get_out_L_buffer(), pCompo->get_out_R_buffer(), nFrames );
+			__component_history[ nComponents ][ __history_pos ] = std::max( __component_history[ nComponents ][ __history_pos ], fBlockPeak );
+			pBack->component_id[ nComponents ] = pCompo->get_id();
+			nComponents++;
+		}
+
+		// the sampler accumulates the voices into their instrument
+		InstrumentList* pInstrList = pSong->get_instrument_list();
+		nInstruments = std::min( pInstrList->size(), MAX_INSTRUMENTS );
+		for ( int i = 0; i < nInstruments; ++i ) {
+			MeterAccumulator& acc = pInstrList->get( i )->get_meter();
+			acc.frames = nFrames;
+			__instruments[ i ].merge( acc );
+			acc.reset();
+		}
+	}
+
+	Instrument* pPlayback = AudioEngine::get_instance()->get_sampler()->__playback_instrument;
+	if ( pPlayback ) {
+		pPlayback->get_meter().frames = nFrames;
+		__playback.merge( pPlayback->get_meter() );
+		pPlayback->get_meter().reset();
+	}
+
+	// histories, one entry every METER_HISTORY_PERIOD
+	__history_frames += nFrames;
+
+	// fill the back buffer
+	if ( ++__serial == 0 ) {	// 0 is kept for the clients' empty snapshots
+		++__serial;
+	}
+	pBack->serial = __serial;
+	to_meter( __master, pBack->master );
+	to_meter( __playback, pBack->playback_track );
+	for ( int i = 0; i < MAX_FX; ++i ) {
+		to_meter( __fx[ i ], pBack->fx[ i ] );
+	}
+	pBack->instruments = nInstruments;
+	for ( int i = 0; i < nInstruments; ++i ) {
+		to_meter( __instruments[ i ], pBack->instrument[ i ] );
+	}
+	pBack->components = nComponents;
+	for ( int i = 0; i < nComponents; ++i ) {
+		to_meter( __components[ i ], pBack->component[ i ] );
+		memcpy( pBack->component_history[ i ], __component_history[ i ], sizeof( float ) * METER_HISTORY_SIZE );
+	}
+	memcpy( pBack->master_history, __master_history, sizeof( __master_history ) );
+	pBack->history_pos = __history_pos;
+
+	if ( __history_frames >= nSampleRate * METER_HISTORY_PERIOD ) {
+		__history_frames = 0;
+		__history_pos = ( __history_pos + 1 ) % METER_HISTORY_SIZE;
+		__master_history[ __history_pos ] = 0.0f;
+		for ( int i = 0; i < MAX_COMPONENTS; ++i ) {
+			__component_history[ i ][ __history_pos ] = 0.0f;
+		}
+	}
+
+	// publish
+	int nPrevious = __middle.exchange( __back | __new_data, std::memory_order_acq_rel );
+	__back = nPrevious & ~__new_data;
+
+	// keep on accumulating while the previous levels have not been read
+	if ( !( nPrevious & __new_data ) || __master.frames > METER_MAX_ACCUMULATED_FRAMES ) {
+		__master.reset();
+		__playback.reset();
+		for ( int i = 0; i < MAX_FX; ++i ) {
+			__fx[ i ].reset();
+		}
+		for ( int i = 0; i < nInstruments; ++i ) {
+			__instruments[ i ].reset();
+		}
+		for ( int i = 0; i < nComponents; ++i ) {
+			__components[ i ].reset();
+		}
+	}
+}
+
+bool MeterBus::get_snapshot( MeterSnapshot& out )
+{
+	QMutexLocker lock( &__reader_mutex );
+
+	if ( __middle.load( std::memory_order_acquire ) & __new_data ) {
+		int nPrevious = __middle.exchange( __front, std::memory_order_acq_rel );
+		__front = nPrevious & ~__new_data;
+	}
+
+	// several clients share the front buffer, each one only gets it once
+	const MeterSnapshot* pFront = __buffers[ __front ];
+	if ( pFront->serial == 0 || pFront->serial == out.serial ) {
+		return false;
+	}
+	out.serial = pFront->serial;
+	out.master = pFront->master;
+	out.playback_track = pFront->playback_track;
+	for ( int i = 0; i < MAX_FX; ++i ) {
+		out.fx[ i ] = pFront->fx[ i ];
+	}
+	out.instruments = pFront->instruments;
+	memcpy( out.instrument, pFront->instrument, sizeof( Meter ) * pFront->instruments );
+	out.components = pFront->components;
+	memcpy( out.component_id, pFront->component_id, sizeof( int ) * pFront->components );
+	memcpy( out.component, pFront->component, sizeof( Meter ) * pFront->components );
+	memcpy( out.component_history, pFront->component_history, sizeof( float ) * METER_HISTORY_SIZE * pFront->components );
+	memcpy( out.master_history, pFront->master_history, sizeof( pFront->master_history ) );
+	out.history_pos = pFront->history_pos;
+	return true;
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -38,6 +38,7 @@
 #include "hydrogen/hydrogen.h"
 #include "hydrogen/basics/song.h"
 #include "hydrogen/midi_action.h"
+#include "hydrogen/engine_profiler.h"
 
 OscServer * OscServer::__instance = 0;
 const char* OscServer::__class_name = "OscServer";
@@ -595,6 +596,46 @@ void OscServer::REDO_ACTION_Handler(lo_arg **argv,int i)
 	delete pAction;
 }
 
+void OscServer::ENGINE_PROFILE_Handler(lo_address source)
+{
+	H2Core::EngineProfiler* pProfiler = H2Core::EngineProfiler::get_instance();
+	H2Core::ProfileSnapshot snapshot;
+	pProfiler->get_snapshot( snapshot );
+
+	// one message per stage: median, 99th percentile, worst and mean, in microseconds
+	for ( int i = 0; i < H2Core::EngineProfiler::STAGES; ++i ) {
+		const H2Core::StageStats& stats = snapshot.stage[ i ];
+		lo_message reply = lo_message_new();
+		lo_message_add_float(reply, stats.p50);
+		lo_message_add_float(reply, stats.p99);
+		lo_message_add_float(reply, stats.max);
+		lo_message_add_float(reply, stats.mean);
+
+		QByteArray ba = QString("/Hydrogen/ENGINE_PROFILE/%1")
+				.arg( H2Core::EngineProfiler::stage_name( ( H2Core::EngineProfiler::Stage )i ) ).toLatin1();
+		lo_send_message(source, ba.data(), reply);
+		lo_message_free( reply );
+	}
+
+	lo_message reply = lo_message_new();
+	lo_message_add_float(reply, snapshot.xruns);
+	lo_message_add_float(reply, snapshot.driver_xruns);
+	lo_message_add_float(reply, snapshot.cycles);
+	lo_send_message(source, "/Hydrogen/ENGINE_PROFILE/XRUNS", reply);
+	lo_message_free( reply );
+
+	reply = lo_message_new();
+	lo_message_add_float(reply, snapshot.worst_us);
+	lo_message_add_float(reply, snapshot.budget_us);
+	lo_send_message(source, "/Hydrogen/ENGINE_PROFILE/WORST", reply);
+	lo_message_free( reply );
+}
+
+void OscServer::ENGINE_PROFILE_RESET_Handler(lo_arg **argv,int i)
+{
+	H2Core::EngineProfiler::get_instance()->reset();
+}
+
 
 bool IsLoAddressEqual( lo_address first, lo_address second )
 {
@@ -854,6 +895,14 @@ void OscServer::start()
 	m_pServerThread->add_method("/Hydrogen/UNDO_ACTION", "f", UNDO_ACTION_Handler);
 	m_pServerThread->add_method("/Hydrogen/REDO_ACTION", "", REDO_ACTION_Handler);
 	m_pServerThread->add_method("/Hydrogen/REDO_ACTION", "f", REDO_ACTION_Handler);
+
+	//The profile is only sent back to the client asking for it
+	m_pServerThread->add_method("/Hydrogen/ENGINE_PROFILE", "", [&](lo_message msg){
+									ENGINE_PROFILE_Handler( lo_message_get_source( msg ) );
+									return 0;
+								});
+	m_pServerThread->add_method("/Hydrogen/ENGINE_PROFILE_RESET", "", ENGINE_PROFILE_RESET_Handler);
+	m_pServerThread->add_method("/Hydrogen/ENGINE_PROFILE_RESET", "f", ENGINE_PROFILE_RESET_Handler);
 	
 	/*
 	 * Start the server.
@@ -35,7 +35,9 @@
 #include <fstream>
 #include <iostream>
 #include <cstdio>
+#include <cstring>
 #include <list>
+#include <sched.h>
 
 #include <hydrogen/midi_map.h>
 #include "hydrogen/version.h"
@@ -149,6 +151,7 @@ Preferences::Preferences()
 
 	//___ oss driver properties ___
 	m_sOSSDevice = QString("/dev/dsp");
+	m_nOSSFragments = 4;
 
 	//___ MIDI Driver properties
 	m_sMidiDriver = QString("ALSA");
@@ -160,6 +163,11 @@ Preferences::Preferences()
 
 	//___  alsa audio driver properties ___
 	m_sAlsaAudioDevice = QString("hw:0");
+	m_nAlsaPeriods = 2;
+
+	//___  PulseAudio driver properties ___
+	m_nPulseAudioLatencyMode = PULSE_DEFAULT_LATENCY;
+	m_nPulseAudioLatency = 0;
 
 	//___  jack driver properties ___
 	m_sJackPortName1 = QString("alsa_pcm:playback_1");
@@ -175,6 +183,13 @@ Preferences::Preferences()
 	m_bOscFeedbackEnabled = true;
 	m_nOscServerPort = 9000;
 
+	// threads, the audio drivers used to set SCHED_FIFO 50 themselves
+	m_threadPolicies[ THREAD_AUDIO ].set( "fifo", 50, "" );
+	m_threadPolicies[ THREAD_MIDI_IN ].set( "default", 0, "" );
+	m_threadPolicies[ THREAD_DISK_WRITER ].set( "default", 0, "" );
+	m_threadPolicies[ THREAD_HELPER ].set( "default", 0, "" );
+	m_threadPolicies[ THREAD_FX ].set( "fifo", 50, "" );
+
 	//___ General properties ___
 	m_bPatternModePlaysSelected = true;
 	m_brestoreLastSong = true;
@@ -243,6 +258,9 @@ Preferences::Preferences()
 
 	loadPreferences( true );	// Global settings
 	loadPreferences( false );	// User settings
+
+	// the logger thread is started before the preferences are known
+	applyThreadPolicy( THREAD_HELPER, Logger::get_instance()->thread() );
 }
 
 
@@ -391,6 +409,7 @@ void Preferences::loadPreferences( bool bGlobal )
 					recreate = true;
 				} else {
 					m_sOSSDevice = LocalFileMng::readXmlString( ossDriverNode, "ossDevice", m_sOSSDevice );
+					m_nOSSFragments = LocalFileMng::readXmlInt( ossDriverNode, "ossFragments", m_nOSSFragments );
 				}
 
 				//// JACK DRIVER ////
@@ -431,6 +450,14 @@ void Preferences::loadPreferences( bool bGlobal )
 					recreate = true;
 				} else {
 					m_sAlsaAudioDevice = LocalFileMng::readXmlString( alsaAudioDriverNode, "alsa_audio_device", m_sAlsaAudioDevice );
+					m_nAlsaPeriods = LocalFileMng::readXmlInt( alsaAudioDriverNode, "alsa_periods", m_nAlsaPeriods );
+				}
+
+				/// PULSEAUDIO DRIVER ///
+				QDomNode pulseAudioDriverNode = audioEngineNode.firstChildElement( "pulseaudio_driver" );
+				if ( !pulseAudioDriverNode.isNull() ) {
+					m_nPulseAudioLatencyMode = LocalFileMng::readXmlInt( pulseAudioDriverNode, "latency_mode", m_nPulseAudioLatencyMode );
+					m_nPulseAudioLatency = LocalFileMng::readXmlInt( pulseAudioDriverNode, "latency", m_nPulseAudioLatency );
 				}
 
 				/// MIDI DRIVER ///
@@ -576,6 +603,20 @@ void Preferences::loadPreferences( bool bGlobal )
 				m_sDefaultEditor = LocalFileMng::readXmlString( filesNode, "defaulteditor", m_sDefaultEditor, true );
 			}
 
+			/////////////// THREADS //////////////
+			QDomNode threadPoliciesNode = rootNode.firstChildElement( "thread_policies" );
+			if ( !threadPoliciesNode.isNull() ) {
+				for ( int i = 0; i < THREAD_ROLES; ++i ) {
+					QDomNode threadNode = threadPoliciesNode.firstChildElement( threadRoleName( ( ThreadRole )i ) );
+					if ( !threadNode.isNull() ) {
+						ThreadPolicy& policy = m_threadPolicies[ i ];
+						policy.scheduling = LocalFileMng::readXmlString( threadNode, "scheduling", policy.scheduling );
+						policy.priority = LocalFileMng::readXmlInt( threadNode, "priority", policy.priority );
+						policy.cpus = LocalFileMng::readXmlString( threadNode, "cpus", policy.cpus, true );
+					}
+				}
+			}
+
 			MidiMap::reset_instance();
 			MidiMap* mM = MidiMap::get_instance();
 
@@ -773,6 +814,7 @@ void Preferences::savePreferences()
 		QDomNode ossDriverNode = doc.createElement( "oss_driver" );
 		{
 			LocalFileMng::writeXmlString( ossDriverNode, "ossDevice", m_sOSSDevice );
+			LocalFileMng::writeXmlString( ossDriverNode, "ossFragments", QString("%1").arg( m_nOSSFragments ) );
 		}
 		audioEngineNode.appendChild( ossDriverNode );
 
@@ -824,9 +866,18 @@ void Preferences::savePreferences()
 		QDomNode alsaAudioDriverNode = doc.createElement( "alsa_audio_driver" );
 		{
 			LocalFileMng::writeXmlString( alsaAudioDriverNode, "alsa_audio_device", m_sAlsaAudioDevice );
+			LocalFileMng::writeXmlString( alsaAudioDriverNode, "alsa_periods", QString("%1").arg( m_nAlsaPeriods ) );
 		}
 		audioEngineNode.appendChild( alsaAudioDriverNode );
 
+		//// PULSEAUDIO DRIVER ////
+		QDomNode pulseAudioDriverNode = doc.createElement( "pulseaudio_driver" );
+		{
+			LocalFileMng::writeXmlString( pulseAudioDriverNode, "latency_mode", QString("%1").arg( m_nPulseAudioLatencyMode ) );
+			LocalFileMng::writeXmlString( pulseAudioDriverNode, "latency", QString("%1").arg( m_nPulseAudioLatency ) );
+		}
+		audioEngineNode.appendChild( pulseAudioDriverNode );
+
 		/// MIDI DRIVER ///
 		QDomNode midiDriverNode = doc.createElement( "midi_driver" );
 		{
@@ -884,6 +935,18 @@ void Preferences::savePreferences()
 	}
 	rootNode.appendChild( audioEngineNode );
 
+	//---- THREADS ----
+	QDomNode threadPoliciesNode = doc.createElement( "thread_policies" );
+	for ( int i = 0; i < THREAD_ROLES; ++i ) {
+		const ThreadPolicy& policy = m_threadPolicies[ i ];
+		QDomNode threadNode = doc.createElement( threadRoleName( ( ThreadRole )i ) );
+		LocalFileMng::writeXmlString( threadNode, "scheduling", policy.scheduling );
+		LocalFileMng::writeXmlString( threadNode, "priority", QString("%1").arg( policy.priority ) );
+		LocalFileMng::writeXmlString( threadNode, "cpus", policy.cpus );
+		threadPoliciesNode.appendChild( threadNode );
+	}
+	rootNode.appendChild( threadPoliciesNode );
+
 	//---- GUI ----
 	QDomNode guiNode = doc.createElement( "gui" );
 	{
@@ -1079,6 +1142,150 @@ void Preferences::setRecentFiles( std::vector<QString> recentFiles )
 
 
 
+const char* Preferences::threadRoleName( ThreadRole role )
+{
+	switch ( role ) {
+	case THREAD_AUDIO:          return "audio";
+	case THREAD_MIDI_IN:        return "midi_in";
+	case THREAD_DISK_WRITER:    return "disk_writer";
+	case THREAD_HELPER:         return "helper";
+	case THREAD_FX:             return "fx";
+	default:                    return "unknown";
+	}
+}
+
+
+
+/// Parse a CPU list like "0-2,5", returns false if it is malformed
+static bool parseCpuList( const QString& sCpus, std::vector<int>& cpus )
+{
+	QStringList ranges = sCpus.split( ',', QString::SkipEmptyParts );
+	for ( int i = 0; i < ranges.size(); ++i ) {
+		QStringList bounds = ranges[ i ].trimmed().split( '-' );
+		if ( bounds.size() > 2 ) {
+			return false;
+		}
+		bool bFirstOk, bLastOk;
+		int nFirst = bounds.first().toInt( &bFirstOk );
+		int nLast = bounds.last().toInt( &bLastOk );
+		if ( !bFirstOk || !bLastOk || nFirst < 0 || nLast < nFirst ) {
+			return false;
+		}
+		for ( int nCpu = nFirst; nCpu <= nLast; ++nCpu ) {
+			cpus.push_back( nCpu );
+		}
+	}
+	return true;
+}
+
+
+
+void Preferences::applyThreadPolicy( ThreadRole role, pthread_t thread, bool bScheduling )
+{
+	const ThreadPolicy& policy = m_threadPolicies[ role ];
+	const char* sRole = threadRoleName( role );
+
+	if ( bScheduling && policy.scheduling != "default" ) {
+		int nPolicy = -1;
+		struct sched_param param;
+		param.sched_priority = 0;
+		if ( policy.scheduling == "fifo" ) {
+			nPolicy = SCHED_FIFO;
+			param.sched_priority = policy.priority;
+		} else if ( policy.scheduling == "rr" ) {
+			nPolicy = SCHED_RR;
+			param.sched_priority = policy.priority;
+		} else if ( policy.scheduling == "other" ) {
+			nPolicy = SCHED_OTHER;
+#ifdef SCHED_BATCH
+		} else if ( policy.scheduling == "batch" ) {
+			nPolicy = SCHED_BATCH;
+#endif
+#ifdef SCHED_IDLE
+		} else if ( policy.scheduling == "idle" ) {
+			nPolicy = SCHED_IDLE;
+#endif
+		} else {
+			WARNINGLOG( QString( "Unknown scheduling '%1' for the %2 thread" ).arg( policy.scheduling ).arg( sRole ) );
+		}
+
+		if ( nPolicy != -1 ) {
+			int nErr = pthread_setschedparam( thread, nPolicy, &param );
+			if ( nErr != 0 ) {
+				ERRORLOG( QString( "Can't set %1 scheduling for the %2 thread: %3" )
+						  .arg( policy.scheduling ).arg( sRole ).arg( strerror( nErr ) ) );
+			}
+		}
+	}
+
+	if ( !policy.cpus.isEmpty() ) {
+		std::vector<int> cpus;
+		if ( !parseCpuList( policy.cpus, cpus ) ) {
+			WARNINGLOG( QString( "Malformed CPU list '%1' for the %2 thread" ).arg( policy.cpus ).arg( sRole ) );
+		} else {
+#ifdef __linux__
+			cpu_set_t set;
+			CPU_ZERO( &set );
+			for ( size_t i = 0; i < cpus.size(); ++i ) {
+				if ( cpus[ i ] < CPU_SETSIZE ) {
+					CPU_SET( cpus[ i ], &set );
+				}
+			}
+			int nErr = pthread_setaffinity_np( thread, sizeof( set ), &set );
+			if ( nErr != 0 ) {
+				ERRORLOG( QString( "Can't set the CPU affinity of the %1 thread: %2" ).arg( sRole ).arg( strerror( nErr ) ) );
+			}
+#else
+			WARNINGLOG( QString( "CPU affinity isn't supported on this platform, the %1 thread runs on any CPU" ).arg( sRole ) );
+#endif
+		}
+	}
+
+	// report what the thread ended up with, the system may have refused the request
+	QString sScheduling = "unknown scheduling";
+	int nPolicy;
+	struct sched_param param;
+	if ( pthread_getschedparam( thread, &nPolicy, &param ) == 0 ) {
+		switch ( nPolicy ) {
+		case SCHED_FIFO:    sScheduling = "SCHED_FIFO"; break;
+		case SCHED_RR:      sScheduling = "SCHED_RR"; break;
+		case SCHED_OTHER:   sScheduling = "SCHED_OTHER"; break;
+#ifdef SCHED_BATCH
+		case SCHED_BATCH:   sScheduling = "SCHED_BATCH"; break;
+#endif
+#ifdef SCHED_IDLE
+		case SCHED_IDLE:    sScheduling = "SCHED_IDLE"; break;
+#endif
+		default:            sScheduling = QString( "policy %1" ).arg( nPolicy ); break;
+		}
+		sScheduling += QString( " priority %1" ).arg( param.sched_priority );
+	}
+
+	QString sCpus = "any CPU";
+#ifdef __linux__
+	cpu_set_t set;
+	if ( pthread_getaffinity_np( thread, sizeof( set ), &set ) == 0 ) {
+		QStringList ranges;
+		for ( int nCpu = 0; nCpu < CPU_SETSIZE; ++nCpu ) {
+			if ( !CPU_ISSET( nCpu, &set ) ) {
+				continue;
+			}
+			int nLast = nCpu;
+			while ( nLast + 1 < CPU_SETSIZE && CPU_ISSET( nLast + 1, &set ) ) {
+				++nLast;
+			}
+			ranges << ( nLast == nCpu ? QString::number( nCpu ) : QString( "%1-%2" ).arg( nCpu ).arg( nLast ) );
+			nCpu = nLast;
+		}
+		sCpus = "CPUs " + ranges.join( "," );
+	}
+#endif
+
+	INFOLOG( QString( "%1 thread: %2, %3" ).arg( sRole ).arg( sScheduling ).arg( sCpus ) );
+}
+
+
+
 /// Read the xml nodes related to window properties
 WindowProperties Preferences::readWindowProperties( QDomNode parent, const QString& windowName, WindowProperties defaultProp )
 {
@@ -1224,6 +1431,27 @@ WindowProperties::~WindowProperties()
 
 
 
+// :::::::::::::::::::::::::::::::
+
+
+const char* ThreadPolicy::__class_name = "ThreadPolicy";
+
+ThreadPolicy::ThreadPolicy()
+		: Object( __class_name )
+		, scheduling( "default" )
+		, priority( 0 )
+{
+}
+
+
+
+ThreadPolicy::~ThreadPolicy()
+{
+}
+
+
+
+
 // :::::::::::::::::::::::::::::::
 
 
@@ -20,6 +20,7 @@
  *
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
@@ -40,12 +41,15 @@
 #include <hydrogen/Preferences.h>
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_snapshot.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
 #include <hydrogen/helpers/filesystem.h>
 #include <hydrogen/event_queue.h>
 
 #include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/FxChain.h>
+#include <hydrogen/fx/FxGraph.h>
 #include <hydrogen/sampler/Sampler.h>
 
 #include <iostream>
@@ -73,7 +77,18 @@ Sampler::Sampler()
 		, __main_out_L( NULL )
 		, __main_out_R( NULL )
 		, __preview_instrument( NULL )
+		, __block( 0 )
+		, __block_start( -1.0f )
+		, __block_end( -1.0f )
+		, __block_smoothing( 1.0f )
+		, __queued_notes_write( 0 )
+		, __queued_notes_read( 0 )
 {
+	__song_volume[0] = __song_volume[1] = 1.0f;
+	for ( int i = 0; i < SAMPLER_MAX_QUEUED_NOTES; ++i ) {
+		__queued_notes[ i ].seq.store( i );
+		__queued_notes[ i ].note = NULL;
+	}
 	INFOLOG( "INIT" );
 		__interpolateMode = LINEAR;
 	__main_out_L = new float[ MAX_BUFFER_SIZE ];
@@ -100,6 +115,16 @@ Sampler::~Sampler()
 	delete[] __main_out_L;
 	delete[] __main_out_R;
 
+	// notes queued after the last process cycle
+	for ( ;; ) {
+		QueuedNote* pSlot = &__queued_notes[ __queued_notes_read % SAMPLER_MAX_QUEUED_NOTES ];
+		if ( pSlot->seq.load( std::memory_order_acquire ) != __queued_notes_read + 1 ) {
+			break;
+		}
+		delete pSlot->note;
+		++__queued_notes_read;
+	}
+
 	delete __preview_instrument;
 	__preview_instrument = NULL;
 
@@ -118,9 +143,34 @@ void Sampler::process( uint32_t nFrames, Song* pSong )
 	memset( __main_out_L, 0, nFrames * sizeof( float ) );
 	memset( __main_out_R, 0, nFrames * sizeof( float ) );
 
+	// control changes reach their value in a few time constants whatever the buffer size
+	__block_smoothing = 1.0f - expf( -( float )nFrames / ( SAMPLER_SMOOTHING_TIME * audio_output->getSampleRate() ) );
+	__song_volume[0] = __block == 0 ? pSong->get_volume() : __song_volume[1];
+	__song_volume[1] = __song_volume[0] + ( pSong->get_volume() - __song_volume[0] ) * __block_smoothing;
+
+	// song position of the block, the instruments evaluate their automation at its ends
+	++__block;
+	__block_start = -1.0f;
+	__block_end = -1.0f;
+	const SongSnapshot* pSnapshot = AudioEngine::get_instance()->get_song_snapshot();
+	if ( Hydrogen::get_instance()->getState() == STATE_PLAYING && pSong->get_mode() == Song::SONG_MODE
+		 && pSnapshot != NULL ) {
+		float fTickSize = audio_output->m_transport.m_nTickSize;
+		long long nFrame = audio_output->m_transport.m_nFrames;
+		bool bLoop = pSong->is_loop_enabled();
+		__block_start = pSnapshot->get_column_position( nFrame / fTickSize, bLoop );
+		__block_end = pSnapshot->get_column_position( ( nFrame + nFrames ) / fTickSize, bLoop );
+		if ( __block_end < __block_start ) {
+			// the song ends or loops within the block, hold the values
+			__block_end = __block_start;
+		}
+	}
+
 	// Track output queues are zeroed by
 	// audioEngine_process_clearAudioBuffers()
 
+	start_queued_notes();
+
 	// Max notes limit
 	int m_nMaxNotes = Preferences::get_instance()->m_nMaxNotes;
 	while ( ( int )__playing_notes_queue.size() > m_nMaxNotes ) {
@@ -135,6 +185,11 @@ void Sampler::process( uint32_t nFrames, Song* pSong )
 		component->reset_outs(nFrames);
 	}
 
+#ifdef H2CORE_HAVE_LADSPA
+	// decide which insert chains take the voices of this cycle
+	FxGraph::get_instance()->prepare( pSong, nFrames );
+#endif
+
 
 	// eseguo tutte le note nella lista di note in esecuzione
 	unsigned i = 0;
@@ -171,13 +226,25 @@ void Sampler::process( uint32_t nFrames, Song* pSong )
 
 
 
+void Sampler::update_block_params( Instrument* pInstr )
+{
+	pInstr->update_block_params( __block, __block_start, __block_end, __block_smoothing );
+}
+
+
+
 void Sampler::note_on( Note *note )
 {
 	//infoLog( "[noteOn]" );
 	assert( note );
 
-	note->get_adsr()->attack();
 	Instrument *pInstr = note->get_instrument();
+	if ( pInstr->get_synth_waveform() != Instrument::SYNTH_OFF ) {
+		AudioEngine::get_instance()->get_synth()->note_on( note );
+		return;
+	}
+
+	note->get_adsr()->attack();
 
 	// mute group
 	int mute_grp = pInstr->get_mute_group();
@@ -209,8 +276,59 @@ void Sampler::note_on( Note *note )
 	}
 }
 
+void Sampler::queue_note_on( Note *note )
+{
+	assert( note );
+
+	// keeps the instrument off the death row until the note is started
+	note->get_instrument()->enqueue();
+
+	unsigned nIndex = __queued_notes_write.load( std::memory_order_relaxed );
+	QueuedNote* pSlot;
+	for ( ;; ) {
+		pSlot = &__queued_notes[ nIndex % SAMPLER_MAX_QUEUED_NOTES ];
+		int nDiff = ( int )( pSlot->seq.load( std::memory_order_acquire ) - nIndex );
+		if ( nDiff == 0 ) {
+			if ( __queued_notes_write.compare_exchange_weak( nIndex, nIndex + 1, std::memory_order_relaxed ) ) {
+				break;
+			}
+		} else if ( nDiff < 0 ) {
+			// queue is full, the audio thread isn't processing
+			WARNINGLOG( "Note dropped, too many notes are waiting for the audio thread" );
+			note->get_instrument()->dequeue();
+			delete note;
+			return;
+		} else {
+			nIndex = __queued_notes_write.load( std::memory_order_relaxed );
+		}
+	}
+
+	pSlot->note = note;
+	pSlot->seq.store( nIndex + 1, std::memory_order_release );
+}
+
+void Sampler::start_queued_notes()
+{
+	for ( ;; ) {
+		QueuedNote* pSlot = &__queued_notes[ __queued_notes_read % SAMPLER_MAX_QUEUED_NOTES ];
+		if ( pSlot->seq.load( std::memory_order_acquire ) != __queued_notes_read + 1 ) {
+			return;
+		}
+		Note* pNote = pSlot->note;
+		// release the slot for the producers
+		pSlot->seq.store( __queued_notes_read + SAMPLER_MAX_QUEUED_NOTES, std::memory_order_release );
+		++__queued_notes_read;
+
+		Instrument* pInstr = pNote->get_instrument();
+		note_on( pNote );
+		pInstr->dequeue();
+	}
+}
+
 void Sampler::midi_keyboard_note_off( int key )
 {
+	AudioEngine::get_instance()->get_synth()->midi_keyboard_note_off( key );
+
 	for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
 		Note *pNote = __playing_notes_queue[ j ];
 
@@ -230,6 +348,10 @@ void Sampler::note_off( Note* note )
 {
 
 	Instrument *pInstr = note->get_instrument();
+	if ( pInstr->get_synth_waveform() != Instrument::SYNTH_OFF ) {
+		AudioEngine::get_instance()->get_synth()->note_off( note );
+		return;
+	}
 	// find the notes using the same instrument, and release them
 	for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
 		Note *pNote = __playing_notes_queue[ j ];
@@ -261,10 +383,14 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 
 	Instrument *pInstr = pNote->get_instrument();
 	if ( !pInstr ) {
-		ERRORLOG( "NULL instrument" );
+		ERRORLOG_RT( "NULL instrument" );
 		return 1;
 	}
 
+	update_block_params( pInstr );
+	const Instrument::BlockParams& blockStart = pInstr->get_block_params( false );
+	const Instrument::BlockParams& blockEnd = pInstr->get_block_params( true );
+
 	bool nReturnValues [pInstr->get_components()->size()];
 	
 	for(int i = 0; i < pInstr->get_components()->size(); i++){
@@ -288,6 +414,10 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 		} else {
 			pMainCompo = pEngine->getSong()->get_component( pCompo->get_drumkit_componentID() );
 		}
+		if ( pMainCompo == NULL ) {
+			// a note ringing from the song replaced at the last bar, its component went with it
+			pMainCompo = pEngine->getSong()->get_components()->front();
+		}
 
 		assert(pMainCompo);
 
@@ -299,8 +429,7 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 		SelectedLayerInfo *pSelectedLayer = pNote->get_layer_selected( pCompo->get_drumkit_componentID() );
 
 		if ( !pSelectedLayer ) {
-			QString dummy = QString( "NULL Layer Information for instrument %1. Component: %2" ).arg( pInstr->get_name() ).arg( pCompo->get_drumkit_componentID() );
-			WARNINGLOG( dummy );
+			WARNINGLOG_RT( "NULL Layer Information for instrument %1. Component: %2", pInstr->get_id(), pCompo->get_drumkit_componentID() );
 			nReturnValues[nReturnValueIndex] = true;
 			continue;
 		}
@@ -418,14 +547,13 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 			}
 		}
 		if ( !pSample ) {
-			QString dummy = QString( "NULL sample for instrument %1. Note velocity: %2" ).arg( pInstr->get_name() ).arg( pNote->get_velocity() );
-			WARNINGLOG( dummy );
+			WARNINGLOG_RT( "NULL sample for instrument %1. Note velocity: %2", pInstr->get_id(), pNote->get_velocity() );
 			nReturnValues[nReturnValueIndex] = true;
 			continue;
 		}
 
 		if ( pSelectedLayer->SamplePosition >= pSample->get_frames() ) {
-			WARNINGLOG( "sample position out of bounds. The layer has been resized during note play?" );
+			WARNINGLOG_RT( "sample position out of bounds. The layer has been resized during note play?" );
 			nReturnValues[nReturnValueIndex] = true;
 			continue;
 		}
@@ -440,7 +568,7 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 				int noteStartInFramesNoHumanize = ( int )pNote->get_position() * audio_output->m_transport.m_nTickSize;
 				if ( noteStartInFramesNoHumanize > ( int )( nFramepos + nBufferSize ) ) {
 					// this note is not valid. it's in the future...let's skip it....
-					ERRORLOG( QString( "Note pos in the future?? Current frames: %1, note frame pos: %2" ).arg( nFramepos ).arg(noteStartInFramesNoHumanize ) );
+					ERRORLOG_RT( "Note pos in the future?? Current frames: %1, note frame pos: %2", nFramepos, noteStartInFramesNoHumanize );
 					//pNote->dumpInfo();
 					nReturnValues[nReturnValueIndex] = true;
 					continue;
@@ -454,6 +582,8 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 
 		float cost_L = 1.0f;
 		float cost_R = 1.0f;
+		float cost_step_L = 0.0f;
+		float cost_step_R = 0.0f;
 		float cost_track_L = 1.0f;
 		float cost_track_R = 1.0f;
 
@@ -484,35 +614,40 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 			}
 			cost_L = cost_L * pNote->get_pan_l();		// note pan
 			cost_L = cost_L * fLayerGain;				// layer gain
-			cost_L = cost_L * pInstr->get_pan_l();		// instrument pan
 			cost_L = cost_L * pInstr->get_gain();		// instrument gain
 
 			cost_L = cost_L * pCompo->get_gain();		// Component gain
 			cost_L = cost_L * pMainCompo->get_volume(); // Component volument
 
-			cost_L = cost_L * pInstr->get_volume();		// instrument volume
+			// instrument pan and volume may be automated, ramp from the start to the end of the block
+			float cost_end_L = cost_L * blockEnd.pan_l * blockEnd.volume * __song_volume[1] * 2;
+			cost_L = cost_L * blockStart.pan_l;		// instrument pan
+			cost_L = cost_L * blockStart.volume;		// instrument volume
 			if ( Preferences::get_instance()->m_nJackTrackOutputMode == 0 ) {
 			// Post-Fader
 			cost_track_L = cost_L * 2;
 			}
-			cost_L = cost_L * pSong->get_volume();	// song volume
+			cost_L = cost_L * __song_volume[0];	// song volume
 			cost_L = cost_L * 2; // max pan is 0.5
+			cost_step_L = ( cost_end_L - cost_L ) / nBufferSize;
 
 			cost_R = cost_R * pNote->get_pan_r();		// note pan
 			cost_R = cost_R * fLayerGain;				// layer gain
-			cost_R = cost_R * pInstr->get_pan_r();		// instrument pan
 			cost_R = cost_R * pInstr->get_gain();		// instrument gain
 
 			cost_R = cost_R * pCompo->get_gain();		// Component gain
 			cost_R = cost_R * pMainCompo->get_volume(); // Component volument
 
-			cost_R = cost_R * pInstr->get_volume();		// instrument volume
+			float cost_end_R = cost_R * blockEnd.pan_r * blockEnd.volume * __song_volume[1] * 2;
+			cost_R = cost_R * blockStart.pan_r;		// instrument pan
+			cost_R = cost_R * blockStart.volume;		// instrument volume
 			if ( Preferences::get_instance()->m_nJackTrackOutputMode == 0 ) {
 			// Post-Fader
 			cost_track_R = cost_R * 2;
 			}
-			cost_R = cost_R * pSong->get_volume();	// song pan
+			cost_R = cost_R * __song_volume[0];	// song pan
 			cost_R = cost_R * 2; // max pan is 0.5
+			cost_step_R = ( cost_end_R - cost_R ) / nBufferSize;
 		}
 
 		// direct track outputs only use velocity
@@ -538,9 +673,9 @@ bool Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
 		}
 
 		if ( fTotalPitch == 0.0 && pSample->get_sample_rate() == audio_output->getSampleRate() ) // NO RESAMPLE
-			nReturnValues[nReturnValueIndex] = __render_note_no_resample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, pSong );
+			nReturnValues[nReturnValueIndex] = __render_note_no_resample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialSilence, cost_L, cost_R, cost_step_L, cost_step_R, cost_track_L, cost_track_R, pSong );
 		else // RESAMPLE
-			nReturnValues[nReturnValueIndex] = __render_note_resample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, fLayerPitch, pSong );
+			nReturnValues[nReturnValueIndex] = __render_note_resample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialSilence, cost_L, cost_R, cost_step_L, cost_step_R, cost_track_L, cost_track_R, fLayerPitch, pSong );
 
 		nReturnValueIndex++;
 	}
@@ -571,8 +706,11 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 	float *pSample_data_L = pSample->get_data_l();
 	float *pSample_data_R = pSample->get_data_r();
 	
-	float fInstrPeak_L = __playback_instrument->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = __playback_instrument->get_peak_r(); // this value will be reset to 0 by the mixer..
+	// levels of this voice, handed over to the meter bus at the end of the block
+	float fInstrPeak_L = 0.0f;
+	float fInstrPeak_R = 0.0f;
+	double fInstrSumSq_L = 0.0;
+	double fInstrSumSq_R = 0.0;
 
 	assert(pSample);
 
@@ -609,12 +747,10 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 			//pDrumCompo->set_outs( nBufferPos, fVal_L, fVal_R );
 	
 			// to main mix
-			if ( fVal_L > fInstrPeak_L ) {
-				fInstrPeak_L = fVal_L;
-			}
-			if ( fVal_R > fInstrPeak_R ) {
-				fInstrPeak_R = fVal_R;
-			}
+			fInstrPeak_L = std::max( fInstrPeak_L, fabsf( fVal_L ) );
+			fInstrPeak_R = std::max( fInstrPeak_R, fabsf( fVal_R ) );
+			fInstrSumSq_L += fVal_L * fVal_L;
+			fInstrSumSq_R += fVal_R * fVal_R;
 			
 			__main_out_L[nBufferPos] += fVal_L;
 			__main_out_R[nBufferPos] += fVal_R;
@@ -688,12 +824,10 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 					}
 			}
 			
-			if ( fVal_L > fInstrPeak_L ) {
-				fInstrPeak_L = fVal_L;
-			}
-			if ( fVal_R > fInstrPeak_R ) {
-				fInstrPeak_R = fVal_R;
-			}
+			fInstrPeak_L = std::max( fInstrPeak_L, fabsf( fVal_L ) );
+			fInstrPeak_R = std::max( fInstrPeak_R, fabsf( fVal_R ) );
+			fInstrSumSq_L += fVal_L * fVal_L;
+			fInstrSumSq_R += fVal_R * fVal_R;
 
 			__main_out_L[nBufferPos] += fVal_L;
 			__main_out_R[nBufferPos] += fVal_R;
@@ -703,12 +837,58 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 		} //for
 	}
 	
-	__playback_instrument->set_peak_l( fInstrPeak_L );
-	__playback_instrument->set_peak_r( fInstrPeak_R );
+	__playback_instrument->get_meter().add_voice( fInstrPeak_L, fInstrPeak_R, fInstrSumSq_L, fInstrSumSq_R );
 
 	return true;
 }
 
+void Sampler::__route_voice( Note* pNote, DrumkitComponent* pDrumCompo, unsigned nBufferSize, Song* pSong, VoiceRouting& routing )
+{
+	routing.out_L = __main_out_L;
+	routing.out_R = __main_out_R;
+	routing.compo_L = pDrumCompo->get_out_L_buffer();
+	routing.compo_R = pDrumCompo->get_out_R_buffer();
+	routing.sends = 0;
+
+#ifdef H2CORE_HAVE_LADSPA
+	Instrument* pInstr = pNote->get_instrument();
+	FxChain* pInsert = pInstr->get_insert_fx();
+	if ( pInsert && pInsert->is_routed() ) {
+		// the insert bus feeds the main mix and the sends itself
+		routing.out_L = pInsert->get_buffer_L();
+		routing.out_R = pInsert->get_buffer_R();
+		routing.compo_L = NULL;
+		routing.compo_R = NULL;
+		return;
+	}
+
+	FxChain* pCompoInsert = pDrumCompo->get_insert_fx();
+	if ( pCompoInsert && pCompoInsert->is_routed() ) {
+		// the component buffer goes through the insert to the main mix
+		routing.out_L = NULL;
+		routing.out_R = NULL;
+	}
+
+	if ( pInstr->is_muted() || pSong->__is_muted ) {
+		return;
+	}
+	const Instrument::BlockParams& blockStart = pInstr->get_block_params( false );
+	const Instrument::BlockParams& blockEnd = pInstr->get_block_params( true );
+	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
+		float fLevel = blockStart.fx_level[ nFX ];
+		float fLevelEnd = blockEnd.fx_level[ nFX ];
+		if ( ( pFX ) && ( fLevel != 0.0 || fLevelEnd != 0.0 ) ) {
+			routing.send_L[ routing.sends ] = pFX->m_pBuffer_L;
+			routing.send_R[ routing.sends ] = pFX->m_pBuffer_R;
+			routing.send_cost[ routing.sends ] = fLevel * pFX->getVolume() * __song_volume[0];
+			routing.send_step[ routing.sends ] = ( fLevelEnd * __song_volume[1] - fLevel * __song_volume[0] ) * pFX->getVolume() / nBufferSize;
+			routing.sends++;
+		}
+	}
+#endif
+}
+
 bool Sampler::__render_note_no_resample(
 	Sample *pSample,
 	Note *pNote,
@@ -719,6 +899,8 @@ bool Sampler::__render_note_no_resample(
 	int nInitialSilence,
 	float cost_L,
 	float cost_R,
+	float cost_step_L,
+	float cost_step_R,
 	float cost_track_L,
 	float cost_track_R,
 	Song* pSong
@@ -751,8 +933,11 @@ bool Sampler::__render_note_no_resample(
 	float *pSample_data_L = pSample->get_data_l();
 	float *pSample_data_R = pSample->get_data_r();
 
-	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
+	// levels of this voice, handed over to the meter bus at the end of the block
+	float fInstrPeak_L = 0.0f;
+	float fInstrPeak_R = 0.0f;
+	double fInstrSumSq_L = 0.0;
+	double fInstrSumSq_R = 0.0;
 
 	float fADSRValue;
 	float fVal_L;
@@ -760,17 +945,27 @@ bool Sampler::__render_note_no_resample(
 
 
 #ifdef H2CORE_HAVE_JACK
-	JackAudioDriver* pJackAudioDriver = 0;
 	float *		pTrackOutL = 0;
 	float *		pTrackOutR = 0;
 
-	if( pAudioOutput->has_track_outs()
-	&& (pJackAudioDriver = dynamic_cast<JackAudioDriver*>(pAudioOutput)) ) {
-		 pTrackOutL = pJackAudioDriver->getTrackOut_L( pNote->get_instrument(), pCompo );
+	// only the JACK driver enables track outputs, its buffers are resolved
+	// once per cycle by audioEngine_process_clearAudioBuffers()
+	if( pAudioOutput->has_track_outs() ) {
+		JackAudioDriver* pJackAudioDriver = static_cast<JackAudioDriver*>(pAudioOutput);
+		pTrackOutL = pJackAudioDriver->getTrackOut_L( pNote->get_instrument(), pCompo );
 		pTrackOutR = pJackAudioDriver->getTrackOut_R( pNote->get_instrument(), pCompo );
 	}
 #endif
 
+	VoiceRouting routing;
+	__route_voice( pNote, pDrumCompo, nBufferSize, pSong, routing );
+
+	// automated filter settings, ramped across the block
+	const Instrument::BlockParams& blockStart = pNote->get_instrument()->get_block_params( false );
+	const Instrument::BlockParams& blockEnd = pNote->get_instrument()->get_block_params( true );
+	float fCutoffStep = ( blockEnd.filter_cutoff - blockStart.filter_cutoff ) / nBufferSize;
+	float fResonanceStep = ( blockEnd.filter_resonance - blockStart.filter_resonance ) / nBufferSize;
+
 	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
 		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pSelectedLayerInfo->SamplePosition ) ) {
 						if ( pNote->get_adsr()->release() == 0 ) {
@@ -778,13 +973,22 @@ bool Sampler::__render_note_no_resample(
 			}
 		}
 
+		// sends are taken from the sample, before the envelope, the filter and the fader
+		for ( int nSend = 0; nSend < routing.sends; ++nSend ) {
+			float fSendCost = routing.send_cost[ nSend ] + nBufferPos * routing.send_step[ nSend ];
+			routing.send_L[ nSend ][ nBufferPos ] += pSample_data_L[ nSamplePos ] * fSendCost;
+			routing.send_R[ nSend ][ nBufferPos ] += pSample_data_R[ nSamplePos ] * fSendCost;
+		}
+
 		fADSRValue = pNote->get_adsr()->get_value( 1 );
 		fVal_L = pSample_data_L[ nSamplePos ] * fADSRValue;
 		fVal_R = pSample_data_R[ nSamplePos ] * fADSRValue;
 
 		// Low pass resonant filter
 		if ( pNote->get_instrument()->is_filter_active() ) {
-			pNote->compute_lr_values( &fVal_L, &fVal_R );
+			pNote->compute_lr_values( &fVal_L, &fVal_R,
+									  blockStart.filter_cutoff + nBufferPos * fCutoffStep,
+									  blockStart.filter_resonance + nBufferPos * fResonanceStep );
 		}
 
 #ifdef H2CORE_HAVE_JACK
@@ -796,60 +1000,30 @@ bool Sampler::__render_note_no_resample(
 		}
 #endif
 
-		fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
+		fVal_L = fVal_L * ( cost_L + nBufferPos * cost_step_L );
+		fVal_R = fVal_R * ( cost_R + nBufferPos * cost_step_R );
 
 		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
-		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
+		fInstrPeak_L = std::max( fInstrPeak_L, fabsf( fVal_L ) );
+		fInstrPeak_R = std::max( fInstrPeak_R, fabsf( fVal_R ) );
+		fInstrSumSq_L += fVal_L * fVal_L;
+		fInstrSumSq_R += fVal_R * fVal_R;
+
+		if ( routing.compo_L ) {
+			routing.compo_L[nBufferPos] += fVal_L;
+			routing.compo_R[nBufferPos] += fVal_R;
 		}
 
-		pDrumCompo->set_outs( nBufferPos, fVal_L, fVal_R );
-
-		// to main mix
-		__main_out_L[nBufferPos] += fVal_L;
-		__main_out_R[nBufferPos] += fVal_R;
+		// to main mix, or to the instrument insert
+		if ( routing.out_L ) {
+			routing.out_L[nBufferPos] += fVal_L;
+			routing.out_R[nBufferPos] += fVal_R;
+		}
 
 		++nSamplePos;
 	}
 	pSelectedLayerInfo->SamplePosition += nAvail_bytes;
-	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
-	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
-
-
-#ifdef H2CORE_HAVE_LADSPA
-	// LADSPA
-	// change the below return logic if you add code after that ifdef
-	if (pNote->get_instrument()->is_muted() || pSong->__is_muted) return retValue;
-	float masterVol =  pSong->get_volume();
-	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
-
-		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
-
-		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
-			fLevel = fLevel * pFX->getVolume();
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
-
-			float fFXCost_L = fLevel * masterVol;
-			float fFXCost_R = fLevel * masterVol;
-
-			int nBufferPos = nInitialBufferPos;
-			int nSamplePos = nInitialSamplePos;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-				pBuf_L[ nBufferPos ] += pSample_data_L[ nSamplePos ] * fFXCost_L;
-				pBuf_R[ nBufferPos ] += pSample_data_R[ nSamplePos ] * fFXCost_R;
-				++nSamplePos;
-				++nBufferPos;
-			}
-		}
-	}
-	// ~LADSPA
-#endif
+	pNote->get_instrument()->get_meter().add_voice( fInstrPeak_L, fInstrPeak_R, fInstrSumSq_L, fInstrSumSq_R );
 
 	return retValue;
 }
@@ -866,6 +1040,8 @@ bool Sampler::__render_note_resample(
 	int nInitialSilence,
 	float cost_L,
 	float cost_R,
+	float cost_step_L,
+	float cost_step_R,
 	float cost_track_L,
 	float cost_track_R,
 	float fLayerPitch,
@@ -905,8 +1081,11 @@ bool Sampler::__render_note_resample(
 	float *pSample_data_L = pSample->get_data_l();
 	float *pSample_data_R = pSample->get_data_r();
 
-	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
+	// levels of this voice, handed over to the meter bus at the end of the block
+	float fInstrPeak_L = 0.0f;
+	float fInstrPeak_R = 0.0f;
+	double fInstrSumSq_L = 0.0;
+	double fInstrSumSq_R = 0.0;
 
 	float fADSRValue = 1.0;
 	float fVal_L;
@@ -915,17 +1094,27 @@ bool Sampler::__render_note_resample(
 
 
 #ifdef H2CORE_HAVE_JACK
-	JackAudioDriver* pJackAudioDriver = 0;
 	float *		pTrackOutL = 0;
 	float *		pTrackOutR = 0;
 
-	if( pAudioOutput->has_track_outs()
-	&& (pJackAudioDriver = dynamic_cast<JackAudioDriver*>(pAudioOutput)) ) {
-				pTrackOutL = pJackAudioDriver->getTrackOut_L( pNote->get_instrument(), pCompo );
-				pTrackOutR = pJackAudioDriver->getTrackOut_R( pNote->get_instrument(), pCompo );
+	// only the JACK driver enables track outputs, its buffers are resolved
+	// once per cycle by audioEngine_process_clearAudioBuffers()
+	if( pAudioOutput->has_track_outs() ) {
+		JackAudioDriver* pJackAudioDriver = static_cast<JackAudioDriver*>(pAudioOutput);
+		pTrackOutL = pJackAudioDriver->getTrackOut_L( pNote->get_instrument(), pCompo );
+		pTrackOutR = pJackAudioDriver->getTrackOut_R( pNote->get_instrument(), pCompo );
 	}
 #endif
 
+	VoiceRouting routing;
+	__route_voice( pNote, pDrumCompo, nBufferSize, pSong, routing );
+
+	// automated filter settings, ramped across the block
+	const Instrument::BlockParams& blockStart = pNote->get_instrument()->get_block_params( false );
+	const Instrument::BlockParams& blockEnd = pNote->get_instrument()->get_block_params( true );
+	float fCutoffStep = ( blockEnd.filter_cutoff - blockStart.filter_cutoff ) / nBufferSize;
+	float fResonanceStep = ( blockEnd.filter_resonance - blockStart.filter_resonance ) / nBufferSize;
+
 	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
 		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pSelectedLayerInfo->SamplePosition ) ) {
 						if ( pNote->get_adsr()->release() == 0 ) {
@@ -979,13 +1168,22 @@ bool Sampler::__render_note_resample(
 				}
 		}
 
+		// sends are taken from the sample, before the envelope, the filter and the fader
+		for ( int nSend = 0; nSend < routing.sends; ++nSend ) {
+			float fSendCost = routing.send_cost[ nSend ] + nBufferPos * routing.send_step[ nSend ];
+			routing.send_L[ nSend ][ nBufferPos ] += fVal_L * fSendCost;
+			routing.send_R[ nSend ][ nBufferPos ] += fVal_R * fSendCost;
+		}
+
 		// ADSR envelope
 		fADSRValue = pNote->get_adsr()->get_value( fStep );
 		fVal_L = fVal_L * fADSRValue;
 		fVal_R = fVal_R * fADSRValue;
 		// Low pass resonant filter
 		if ( pNote->get_instrument()->is_filter_active() ) {
-			pNote->compute_lr_values( &fVal_L, &fVal_R );
+			pNote->compute_lr_values( &fVal_L, &fVal_R,
+									  blockStart.filter_cutoff + nBufferPos * fCutoffStep,
+									  blockStart.filter_resonance + nBufferPos * fResonanceStep );
 		}
 
 
@@ -999,107 +1197,30 @@ bool Sampler::__render_note_resample(
 		}
 #endif
 
-		fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
+		fVal_L = fVal_L * ( cost_L + nBufferPos * cost_step_L );
+		fVal_R = fVal_R * ( cost_R + nBufferPos * cost_step_R );
 
 		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
-		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
+		fInstrPeak_L = std::max( fInstrPeak_L, fabsf( fVal_L ) );
+		fInstrPeak_R = std::max( fInstrPeak_R, fabsf( fVal_R ) );
+		fInstrSumSq_L += fVal_L * fVal_L;
+		fInstrSumSq_R += fVal_R * fVal_R;
+
+		if ( routing.compo_L ) {
+			routing.compo_L[nBufferPos] += fVal_L;
+			routing.compo_R[nBufferPos] += fVal_R;
 		}
 
-		pDrumCompo->set_outs( nBufferPos, fVal_L, fVal_R );
-
-		// to main mix
-		__main_out_L[nBufferPos] += fVal_L;
-		__main_out_R[nBufferPos] += fVal_R;
+		// to main mix, or to the instrument insert
+		if ( routing.out_L ) {
+			routing.out_L[nBufferPos] += fVal_L;
+			routing.out_R[nBufferPos] += fVal_R;
+		}
 
 		fSamplePos += fStep;
 	}
 	pSelectedLayerInfo->SamplePosition += nAvail_bytes * fStep;
-	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
-	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
-
-
-
-#ifdef H2CORE_HAVE_LADSPA
-	// LADSPA
-	// change the below return logic if you add code after that ifdef
-	if (pNote->get_instrument()->is_muted() || pSong->__is_muted) return retValue;
-	float masterVol = pSong->get_volume();
-	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
-		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
-		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
-			fLevel = fLevel * pFX->getVolume();
-
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
-
-//			float fFXCost_L = cost_L * fLevel;
-//			float fFXCost_R = cost_R * fLevel;
-			float fFXCost_L = fLevel * masterVol;
-			float fFXCost_R = fLevel * masterVol;
-
-			int nBufferPos = nInitialBufferPos;
-			float fSamplePos = pSelectedLayerInfo->SamplePosition;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-				int nSamplePos = ( int )fSamplePos;
-				double fDiff = fSamplePos - nSamplePos;
-
-				if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-					//we reach the last audioframe.
-					//set this last frame to zero do nothin wrong.
-					fVal_L = 0.0;
-					fVal_R = 0.0;
-				} else {
-					// some interpolation methods need 4 frames data.
-					float last_l;
-					float last_r;
-					if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-						last_l = 0.0;
-						last_r = 0.0;
-					}else
-					{
-						last_l =  pSample_data_L[nSamplePos + 2];
-						last_r =  pSample_data_R[nSamplePos + 2];
-					}
-
-					switch( __interpolateMode ){
-
-					case LINEAR:
-						fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-						fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-						break;
-					case COSINE:
-						fVal_L = cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-						fVal_R = cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-						break;
-					case THIRD:
-						fVal_L = third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					case CUBIC:
-						fVal_L = cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					case HERMITE:
-						fVal_L = hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					}
-				}
-
-				pBuf_L[ nBufferPos ] += fVal_L * fFXCost_L;
-								pBuf_R[ nBufferPos ] += fVal_R * fFXCost_R;
-				fSamplePos += fStep;
-				++nBufferPos;
-			}
-		}
-	}
-#endif
+	pNote->get_instrument()->get_meter().add_voice( fInstrPeak_L, fInstrPeak_R, fInstrSumSq_L, fInstrSumSq_R );
 
 	return retValue;
 }
@@ -1107,6 +1228,8 @@ bool Sampler::__render_note_resample(
 
 void Sampler::stop_playing_notes( Instrument* instrument )
 {
+	AudioEngine::get_instance()->get_synth()->stop_playing_notes( instrument );
+
 	if ( instrument ) { // stop all notes using this instrument
 		for ( unsigned i = 0; i < __playing_notes_queue.size(); ) {
 			Note *pNote = __playing_notes_queue[ i ];
@@ -28,6 +28,11 @@
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/automation_path.h>
 
+#include <QFile>
+#include <QMap>
+#include <QSet>
+
+#include <algorithm>
 #include <fstream>
 
 using std::vector;
@@ -105,9 +110,7 @@ std::vector<char> SMFTrack::getBuffer()
 		vector<char> buf = pEv->getBuffer();
 
 		// copy the buffer into the data vector
-		for ( unsigned j = 0; j < buf.size(); j++ ) {
-			trackData.push_back( buf[ j ] );
-		}
+		trackData.insert( trackData.end(), buf.begin(), buf.end() );
 	}
 
 
@@ -117,10 +120,8 @@ std::vector<char> SMFTrack::getBuffer()
 	buf.writeDWord( trackData.size() + 4 );	// Track length
 
 	vector<char> trackBuf = buf.getBuffer();
-
-	for ( unsigned i = 0; i < trackData.size(); i++ ) {
-		trackBuf.push_back( trackData[i] );
-	}
+	trackBuf.reserve( trackBuf.size() + trackData.size() + 4 );
+	trackBuf.insert( trackBuf.end(), trackData.begin(), trackData.end() );
 
 
 	//  track end
@@ -149,12 +150,12 @@ void SMFTrack::addEvent( SMFEvent *pEvent )
 
 const char* SMF::__class_name = "SMF";
 
-SMF::SMF()
+SMF::SMF( int nFormat )
 		: Object( __class_name )
 {
 	INFOLOG( "INIT" );
 
-	m_pHeader = new SMFHeader( 1, -1, 192 );
+	m_pHeader = new SMFHeader( nFormat, -1, 192 );
 }
 
 
@@ -186,18 +187,14 @@ vector<char> SMF::getBuffer()
 
 	// header
 	vector<char> headerVect = m_pHeader->getBuffer();
-	for ( unsigned i = 0; i < headerVect.size(); i++ ) {
-		smfVect.push_back( headerVect[ i ] );
-	}
+	smfVect.insert( smfVect.end(), headerVect.begin(), headerVect.end() );
 
 
 	// tracks
 	for ( unsigned nTrack = 0; nTrack < m_trackList.size(); nTrack++ ) {
 		SMFTrack *pTrack = m_trackList[ nTrack ];
 		vector<char> trackVect = pTrack->getBuffer();
-		for ( unsigned i = 0; i < trackVect.size(); i++ ) {
-			smfVect.push_back( trackVect[ i ] );
-		}
+		smfVect.insert( smfVect.end(), trackVect.begin(), trackVect.end() );
 	}
 
 	return smfVect;
@@ -226,18 +223,32 @@ SMFWriter::~SMFWriter()
 
 
 
-void SMFWriter::save( const QString& sFilename, Song *pSong )
+/// orders the events by time, events at the same tick keep their order
+static bool smf_event_before( const SMFEvent* pEvent, const SMFEvent* pOther )
+{
+	return pEvent->m_nTicks < pOther->m_nTicks;
+}
+
+
+
+bool SMFWriter::save( const QString& sFilename, Song *pSong, int nFormat )
 {
 	INFOLOG( "save" );
 	const int DRUM_CHANNEL = 9;
 
+	if ( nFormat != 0 && nFormat != 1 ) {
+		ERRORLOG( QString( "Unsupported SMF format %1" ).arg( nFormat ) );
+		return false;
+	}
+
 	vector<SMFEvent*> eventList;
 
-	SMF smf;
+	SMF smf( nFormat );
 
 
 	// Standard MIDI format 1 files should have the first track being the tempo map
 	// which is a track that contains global meta events only.
+	// Format 0 files have the meta events and the notes in this single track.
 	SMFTrack *pTrack0 = new SMFTrack();
 	pTrack0->addEvent( new SMFCopyRightNoticeMetaEvent( pSong->__author , 0 ) );
 	pTrack0->addEvent( new SMFTrackNameMetaEvent( pSong->__name , 0 ) );
@@ -247,8 +258,11 @@ void SMFWriter::save( const QString& sFilename, Song *pSong )
 
 	
 	// Standard MIDI Format 1 files should have note events in tracks =>2
-	SMFTrack *pTrack1 = new SMFTrack();
-	smf.addTrack( pTrack1 );
+	SMFTrack *pTrack1 = pTrack0;
+	if ( nFormat == 1 ) {
+		pTrack1 = new SMFTrack();
+		smf.addTrack( pTrack1 );
+	}
 
 	AutomationPath *vp = pSong->get_velocity_automation_path();
 
@@ -319,20 +333,7 @@ void SMFWriter::save( const QString& sFilename, Song *pSong )
 		nTick += nMaxPatternLength;
 	}
 
-	// awful bubble sort..
-	for ( unsigned i = 0; i < eventList.size(); i++ ) {
-		for ( vector<SMFEvent*>::iterator it = eventList.begin() ;
-			  it != ( eventList.end() - 1 ) ;
-			  it++ ) {
-			SMFEvent *pEvent = *it;
-			SMFEvent *pNextEvent = *( it + 1 );
-			if ( pNextEvent->m_nTicks < pEvent->m_nTicks ) {
-				// swap
-				*it = pNextEvent;
-				*( it +1 ) = pEvent;
-			}
-		}
-	}
+	std::stable_sort( eventList.begin(), eventList.end(), smf_event_before );
 
 	unsigned nLastTick = 1;
 	for ( vector<SMFEvent*>::iterator it = eventList.begin() ;
@@ -351,14 +352,332 @@ void SMFWriter::save( const QString& sFilename, Song *pSong )
 	// save the midi file
 	m_file = fopen( sFilename.toLocal8Bit(), "wb" );
 
-	if( m_file == NULL )
-		return;
+	if( m_file == NULL ) {
+		ERRORLOG( QString( "Unable to open %1" ).arg( sFilename ) );
+		return false;
+	}
 
 	vector<char> smfVect = smf.getBuffer();
-	for ( unsigned i = 0; i < smfVect.size(); i++ ) {
-		fwrite( &smfVect[ i ], 1, 1, m_file );
+	size_t nWritten = fwrite( smfVect.data(), 1, smfVect.size(), m_file );
+	if ( fclose( m_file ) != 0 || nWritten != smfVect.size() ) {
+		ERRORLOG( QString( "Error writing %1" ).arg( sFilename ) );
+		m_file = NULL;
+		return false;
+	}
+	m_file = NULL;
+	return true;
+}
+
+// :::::::::::::::::::...
+
+
+const char* SMFReader::__class_name = "SMFReader";
+
+SMFReader::SMFReader()
+		: Object( __class_name )
+		, m_nTPQN( 192 )
+		, m_nBarTicks( MAX_NOTES )
+{
+	INFOLOG( "INIT" );
+}
+
+
+
+SMFReader::~SMFReader()
+{
+	INFOLOG( "DESTROY" );
+}
+
+
+
+/// reads a big endian value of nBytes bytes
+static long smf_read_int( const unsigned char *pData, int nBytes )
+{
+	long nVal = 0;
+	for ( int i = 0; i < nBytes; i++ ) {
+		nVal = ( nVal << 8 ) | pData[ i ];
+	}
+	return nVal;
+}
+
+
+
+/// reads a variable length quantity, returns -1 past the end of the data
+static long smf_read_var_len( const unsigned char *pData, int nSize, int& nPos )
+{
+	long nVal = 0;
+	for ( int i = 0; i < 4; i++ ) {
+		if ( nPos >= nSize ) {
+			return -1;
+		}
+		unsigned char c = pData[ nPos++ ];
+		nVal = ( nVal << 7 ) | ( c & 0x7f );
+		if ( !( c & 0x80 ) ) {
+			return nVal;
+		}
+	}
+	return -1;
+}
+
+
+
+int SMFReader::toTicks( long nMidiTicks ) const
+{
+	// Hydrogen counts MAX_NOTES / 4 ticks per quarter note
+	return ( int )( ( nMidiTicks * ( MAX_NOTES / 4 ) + m_nTPQN / 2 ) / m_nTPQN );
+}
+
+
+
+bool SMFReader::readTrack( const unsigned char *pData, int nSize, Track& track )
+{
+	// note on events waiting for their note off, by channel and pitch
+	std::vector<int> pending( 16 * 128, -1 );
+	std::vector<long> pendingStart( 16 * 128, 0 );
+
+	long nTime = 0;
+	int nPos = 0;
+	unsigned char nStatus = 0;
+
+	while ( nPos < nSize ) {
+		long nDelta = smf_read_var_len( pData, nSize, nPos );
+		if ( nDelta < 0 || nPos >= nSize ) {
+			ERRORLOG( "Truncated track" );
+			return false;
+		}
+		nTime += nDelta;
+
+		unsigned char nByte = pData[ nPos ];
+		if ( nByte & 0x80 ) {
+			nStatus = nByte;
+			nPos++;
+		} else if ( nStatus == 0 || nStatus >= 0xF0 ) {
+			ERRORLOG( "Running status without a status byte" );
+			return false;
+		}
+
+		if ( nStatus == 0xFF ) {
+			// meta event
+			if ( nPos >= nSize ) {
+				return false;
+			}
+			unsigned char nType = pData[ nPos++ ];
+			long nLen = smf_read_var_len( pData, nSize, nPos );
+			if ( nLen < 0 || nPos + nLen > nSize ) {
+				ERRORLOG( "Truncated meta event" );
+				return false;
+			}
+			if ( nType == TRACK_NAME && track.sName.isEmpty() ) {
+				track.sName = QString::fromLocal8Bit( ( const char* )pData + nPos, nLen );
+			} else if ( nType == TIME_SIGNATURE && nLen >= 2 && nTime == 0 ) {
+				// the denominator is given as a power of two, notes shorter than a tick are ignored
+				int nBeats = pData[ nPos ];
+				int nExponent = pData[ nPos + 1 ];
+				if ( nBeats > 0 && nExponent < 16 && ( 1 << nExponent ) <= MAX_NOTES ) {
+					// patterns can't be longer than MAX_NOTES
+					m_nBarTicks = std::min( nBeats * MAX_NOTES / ( 1 << nExponent ), MAX_NOTES );
+				}
+			} else if ( nType == END_OF_TRACK ) {
+				nPos = nSize;
+				break;
+			}
+			nPos += nLen;
+			nStatus = 0;
+		} else if ( nStatus == 0xF0 || nStatus == 0xF7 ) {
+			// system exclusive, skipped
+			long nLen = smf_read_var_len( pData, nSize, nPos );
+			if ( nLen < 0 || nPos + nLen > nSize ) {
+				ERRORLOG( "Truncated sysex event" );
+				return false;
+			}
+			nPos += nLen;
+			nStatus = 0;
+		} else {
+			int nType = nStatus & 0xF0;
+			int nChannel = nStatus & 0x0F;
+			int nDataLen = ( nType == 0xC0 || nType == 0xD0 ) ? 1 : 2;
+			if ( nPos + nDataLen > nSize ) {
+				ERRORLOG( "Truncated channel event" );
+				return false;
+			}
+			int nPitch = pData[ nPos ] & 0x7f;
+			int nVelocity = ( nDataLen == 2 ) ? ( pData[ nPos + 1 ] & 0x7f ) : 0;
+			nPos += nDataLen;
+
+			int nKey = nChannel * 128 + nPitch;
+			if ( nType == NOTE_ON && nVelocity > 0 ) {
+				NoteEvent note;
+				note.nTick = toTicks( nTime );
+				note.nLength = -1;
+				note.nPitch = nPitch;
+				note.nVelocity = nVelocity;
+				pending[ nKey ] = track.notes.size();
+				pendingStart[ nKey ] = nTime;
+				track.notes.push_back( note );
+			} else if ( nType == NOTE_OFF || nType == NOTE_ON ) {
+				if ( pending[ nKey ] != -1 ) {
+					track.notes[ pending[ nKey ] ].nLength = toTicks( nTime ) - track.notes[ pending[ nKey ] ].nTick;
+					pending[ nKey ] = -1;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
+
+bool SMFReader::load( const QString& sFilename, Song *pSong )
+{
+	INFOLOG( "load " + sFilename );
+
+	QFile file( sFilename );
+	if ( !file.open( QIODevice::ReadOnly ) ) {
+		ERRORLOG( QString( "Unable to open %1" ).arg( sFilename ) );
+		return false;
+	}
+	QByteArray content = file.readAll();
+	file.close();
+
+	const unsigned char *pData = ( const unsigned char* )content.constData();
+	int nSize = content.size();
+
+	if ( nSize < 14 || smf_read_int( pData, 4 ) != 1297377380 ) {		// MThd
+		ERRORLOG( QString( "%1 is not a standard MIDI file" ).arg( sFilename ) );
+		return false;
+	}
+	long long nHeaderLen = smf_read_int( pData + 4, 4 );
+	if ( nHeaderLen < 6 || 8 + nHeaderLen > nSize ) {
+		ERRORLOG( QString( "Invalid header length in %1" ).arg( sFilename ) );
+		return false;
+	}
+	int nFormat = smf_read_int( pData + 8, 2 );
+	int nTracks = smf_read_int( pData + 10, 2 );
+	int nDivision = smf_read_int( pData + 12, 2 );
+	if ( nFormat > 1 ) {
+		ERRORLOG( QString( "SMF format %1 is not supported" ).arg( nFormat ) );
+		return false;
+	}
+	if ( ( nDivision & 0x8000 ) || nDivision == 0 ) {
+		ERRORLOG( "SMPTE time division is not supported" );
+		return false;
+	}
+	m_nTPQN = nDivision;
+	m_nBarTicks = MAX_NOTES;
+
+	std::vector<Track> tracks;
+	int nPos = 8 + nHeaderLen;
+	while ( (int)tracks.size() < nTracks && nPos + 8 <= nSize ) {
+		long nChunkId = smf_read_int( pData + nPos, 4 );
+		long nChunkLen = smf_read_int( pData + nPos + 4, 4 );
+		nPos += 8;
+		if ( nChunkLen < 0 || nChunkLen > nSize - nPos ) {
+			ERRORLOG( "Truncated track chunk" );
+			return false;
+		}
+		if ( nChunkId == 1297379947 ) {		// MTrk
+			tracks.push_back( Track() );
+			if ( !readTrack( pData + nPos, nChunkLen, tracks.back() ) ) {
+				ERRORLOG( QString( "Error reading track %1 of %2" ).arg( tracks.size() ).arg( sFilename ) );
+				return false;
+			}
+		}
+		nPos += nChunkLen;
+	}
+
+	// instruments by MIDI out note, the first one wins
+	InstrumentList *pInstrList = pSong->get_instrument_list();
+	std::vector<Instrument*> instrByPitch( 128, (Instrument*)NULL );
+	for ( int i = pInstrList->size() - 1; i >= 0; i-- ) {
+		Instrument *pInstr = pInstrList->get( i );
+		int nNote = pInstr->get_midi_out_note();
+		if ( nNote >= 0 && nNote < 128 ) {
+			instrByPitch[ nNote ] = pInstr;
+		}
+	}
+
+	PatternList *pPatternList = pSong->get_pattern_list();
+	std::vector<PatternList*> *pColumns = pSong->get_pattern_group_vector();
+	int nFirstColumn = pColumns->size();
+
+	QSet<QString> names;
+	for ( int i = 0; i < pPatternList->size(); i++ ) {
+		names.insert( pPatternList->get( i )->get_name() );
+	}
+
+	int nSkipped = 0;
+	int nImported = 0;
+	for ( unsigned nTrack = 0; nTrack < tracks.size(); nTrack++ ) {
+		Track& track = tracks[ nTrack ];
+		if ( track.notes.empty() ) {
+			continue;
+		}
+		QString sTrackName = track.sName.isEmpty() ? QString( "Track %1" ).arg( nTrack + 1 ) : track.sName;
+
+		// the notes are in time order, identical bars of a track share their pattern
+		QMap<QByteArray, Pattern*> barPatterns;
+		unsigned nNote = 0;
+		while ( nNote < track.notes.size() ) {
+			int nBar = track.notes[ nNote ].nTick / m_nBarTicks;
+			unsigned nEnd = nNote;
+			QByteArray key;
+			while ( nEnd < track.notes.size() && track.notes[ nEnd ].nTick / m_nBarTicks == nBar ) {
+				const NoteEvent& note = track.notes[ nEnd ];
+				if ( instrByPitch[ note.nPitch ] ) {
+					key += QByteArray::number( note.nTick - nBar * m_nBarTicks ) + ','
+					       + QByteArray::number( note.nPitch ) + ','
+					       + QByteArray::number( note.nVelocity ) + ','
+					       + QByteArray::number( note.nLength ) + ';';
+					nImported++;
+				} else {
+					nSkipped++;
+				}
+				nEnd++;
+			}
+
+			if ( !key.isEmpty() ) {
+				Pattern *pPattern = barPatterns.value( key, NULL );
+				if ( pPattern == NULL ) {
+					QString sName = QString( "%1 %2" ).arg( sTrackName ).arg( barPatterns.size() + 1 );
+					for ( int i = 1; names.contains( sName ); i++ ) {
+						sName = QString( "%1 %2 #%3" ).arg( sTrackName ).arg( barPatterns.size() + 1 ).arg( i );
+					}
+					names.insert( sName );
+
+					pPattern = new Pattern( sName, "", "not_categorized", m_nBarTicks );
+					for ( unsigned i = nNote; i < nEnd; i++ ) {
+						const NoteEvent& note = track.notes[ i ];
+						Instrument *pInstr = instrByPitch[ note.nPitch ];
+						if ( pInstr == NULL ) {
+							continue;
+						}
+						// the export truncates 127 * velocity, half a step keeps the value
+						float fVelocity = std::min( 1.0f, ( note.nVelocity + 0.5f ) / 127.0f );
+						pPattern->insert_note( new Note( pInstr, note.nTick - nBar * m_nBarTicks, fVelocity, 0.5f, 0.5f, note.nLength, 0.0f ) );
+					}
+					pPatternList->add( pPattern );
+					barPatterns.insert( key, pPattern );
+				}
+
+				while ( (int)pColumns->size() <= nFirstColumn + nBar ) {
+					pColumns->push_back( new PatternList() );
+				}
+				( *pColumns )[ nFirstColumn + nBar ]->add( pPattern );
+			}
+
+			nNote = nEnd;
+		}
+	}
+
+	if ( nSkipped > 0 ) {
+		WARNINGLOG( QString( "%1 notes skipped, no instrument has their MIDI out note" ).arg( nSkipped ) );
+	}
+	INFOLOG( QString( "%1 tracks, %2 notes imported" ).arg( tracks.size() ).arg( nImported ) );
+	if ( nImported > 0 ) {
+		pSong->set_is_modified( true );
 	}
-	fclose( m_file );
+	return true;
 }
 
 };
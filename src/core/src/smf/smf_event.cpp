@@ -60,11 +60,9 @@ void SMFBuffer::writeDWord( long nVal )
 void SMFBuffer::writeString( const QString& sMsg )
 {
 //	infoLog( "writeString" );
-	writeVarLen( sMsg.length() );
-
-	for ( int i = 0; i < sMsg.length(); i++ ) {
-				writeByte( sMsg.toLocal8Bit().at(i) );
-	}
+	QByteArray msg = sMsg.toLocal8Bit();
+	writeVarLen( msg.size() );
+	m_buffer.insert( m_buffer.end(), msg.constData(), msg.constData() + msg.size() );
 }
 
 
@@ -75,7 +73,6 @@ void SMFBuffer::writeVarLen( long value )
 	long buffer;
 	buffer = value & 0x7f;
 	while ( ( value >>= 7 ) > 0 ) {
-		INFOLOG( "." );
 		buffer <<= 8;
 		buffer |= 0x80;
 		buffer += ( value & 0x7f );
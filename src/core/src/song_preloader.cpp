@@ -0,0 +1,197 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/song_preloader.h>
+
+#include <hydrogen/event_queue.h>
+
+namespace H2Core
+{
+
+SongPreloader* SongPreloader::__instance = NULL;
+const char* SongPreloader::__class_name = "SongPreloader";
+
+void SongPreloader::create_instance()
+{
+	if ( __instance == NULL ) {
+		__instance = new SongPreloader;
+	}
+}
+
+SongPreloader::SongPreloader()
+	: Object( __class_name )
+	, __quit( false )
+	, __number( -1 )
+	, __switch( false )
+	, __song( NULL )
+	, __globals( NULL )
+	, __raised( -1 )
+	, __superseded( -1 )
+{
+	pthread_mutex_init( &__mutex, NULL );
+	pthread_cond_init( &__cond, NULL );
+	if ( pthread_create( &__worker, NULL, thread_func, this ) != 0 ) {
+		ERRORLOG( "Can't create the song preloader thread" );
+		__quit = true;
+	}
+}
+
+SongPreloader::~SongPreloader()
+{
+	pthread_mutex_lock( &__mutex );
+	bool bRunning = !__quit;
+	__quit = true;
+	pthread_cond_broadcast( &__cond );
+	pthread_mutex_unlock( &__mutex );
+	if ( bRunning ) {
+		pthread_join( __worker, NULL );
+	}
+
+	drop();
+	pthread_cond_destroy( &__cond );
+	pthread_mutex_destroy( &__mutex );
+	__instance = NULL;
+}
+
+void SongPreloader::preload( int nSongNumber, const QString& sFilename, bool bSwitch )
+{
+	pthread_mutex_lock( &__mutex );
+	if ( nSongNumber != __number || sFilename != __filename ) {
+		// the worker drops what it is reading, the request changed
+		if ( __raised != -1 ) {
+			// EVENT_PLAYLIST_LOADSONG is on its way for a song no longer wanted
+			__superseded = __raised;
+		}
+		__raised = -1;
+		drop();
+		__number = nSongNumber;
+		__filename = sFilename;
+		__switch = bSwitch;
+	} else if ( bSwitch ) {
+		__switch = true;
+		if ( __song != NULL ) {
+			switch_to( nSongNumber );
+		}
+	}
+	pthread_cond_broadcast( &__cond );
+	pthread_mutex_unlock( &__mutex );
+}
+
+Song* SongPreloader::take( int nSongNumber, const QString& sFilename, SongReader::Globals** ppGlobals, bool* pPending )
+{
+	Song* pSong = NULL;
+	*pPending = false;
+
+	pthread_mutex_lock( &__mutex );
+	if ( nSongNumber == __superseded ) {
+		__superseded = -1;
+		*pPending = true;
+	} else if ( __number == nSongNumber && __filename == sFilename ) {
+		if ( __song == NULL ) {
+			// the caller doesn't wait for the disk, the switch follows the reading
+			__switch = !__quit;
+			*pPending = __switch;
+		} else {
+			pSong = __song;
+			*ppGlobals = __globals;
+			__song = NULL;
+			__globals = NULL;
+			__number = -1;
+			__filename = QString();
+			__switch = false;
+			__raised = -1;
+		}
+	}
+	pthread_mutex_unlock( &__mutex );
+
+	return pSong;
+}
+
+void SongPreloader::drop()
+{
+	delete __song;
+	delete __globals;
+	__song = NULL;
+	__globals = NULL;
+	__switch = false;
+}
+
+void SongPreloader::switch_to( int nSongNumber )
+{
+	__switch = false;
+	__raised = nSongNumber;
+	EventQueue::get_instance()->push_event( EVENT_PLAYLIST_LOADSONG, nSongNumber );
+}
+
+void* SongPreloader::thread_func( void* param )
+{
+	static_cast< SongPreloader* >( param )->run();
+	return NULL;
+}
+
+void SongPreloader::run()
+{
+	pthread_mutex_lock( &__mutex );
+	while ( !__quit ) {
+		if ( __number == -1 || __song != NULL ) {
+			pthread_cond_wait( &__cond, &__mutex );
+			continue;
+		}
+
+		int nSongNumber = __number;
+		QString sFilename = __filename;
+		pthread_mutex_unlock( &__mutex );
+
+		INFOLOG( QString( "Preloading song %1: %2" ).arg( nSongNumber ).arg( sFilename ) );
+		SongReader reader;
+		SongReader::Globals* pGlobals = new SongReader::Globals;
+		Song* pSong = reader.readSong( sFilename, pGlobals );
+
+		pthread_mutex_lock( &__mutex );
+		if ( nSongNumber != __number || sFilename != __filename ) {
+			// another song was asked for meanwhile
+			delete pSong;
+			delete pGlobals;
+		} else if ( pSong == NULL ) {
+			ERRORLOG( "Error preloading song: " + sFilename );
+			delete pGlobals;
+			__number = -1;
+			__filename = QString();
+			if ( __switch ) {
+				// the playlist reads it itself and reports the error
+				__switch = false;
+				EventQueue::get_instance()->push_event( EVENT_PLAYLIST_LOADSONG, nSongNumber );
+			}
+		} else {
+			__song = pSong;
+			__globals = pGlobals;
+			if ( __switch ) {
+				switch_to( nSongNumber );
+			}
+		}
+	}
+	pthread_mutex_unlock( &__mutex );
+}
+
+};
+
+/* vim: set softtabstop=4 noexpandtab: */
@@ -22,8 +22,27 @@
 
 
 #include <hydrogen/synth/Synth.h>
+#include <hydrogen/IO/AudioOutput.h>
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/helpers/denormals.h>
+#include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/FxChain.h>
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/sampler/Sampler.h>
+
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <vector>
+
+/* bits of the phase below the table index */
+#define SYNTH_FRAC_BITS ( 32 - SYNTH_TABLE_BITS )
+/* waveforms having tables, all but SYNTH_OFF */
+#define SYNTH_WAVEFORMS 4
 
 namespace H2Core
 {
@@ -32,15 +51,17 @@ const char* Synth::__class_name = "Synth";
 
 Synth::Synth()
 		: Object( __class_name )
+		, m_nVoices( 0 )
 {
 	INFOLOG( "INIT" );
 
 	m_pOut_L = new float[ MAX_BUFFER_SIZE ];
 	m_pOut_R = new float[ MAX_BUFFER_SIZE ];
+	m_pOsc = new float[ MAX_BUFFER_SIZE ];
+	m_pEnv = new float[ MAX_BUFFER_SIZE ];
 
-	m_fTheta = 0.0;
-
-	m_pAudioOutput = NULL;
+	m_pTables = new float[ SYNTH_WAVEFORMS * SYNTH_TABLE_LEVELS * ( SYNTH_TABLE_SIZE + 1 ) ];
+	build_tables();
 }
 
 
@@ -48,81 +69,412 @@ Synth::Synth()
 Synth::~Synth()
 {
 	INFOLOG( "DESTROY" );
+	// the instruments may be gone already, only the notes are ours
+	for ( int i = 0; i < m_nVoices; ++i ) {
+		delete m_voices[ i ].pNote;
+	}
 	delete[] m_pOut_L;
 	delete[] m_pOut_R;
+	delete[] m_pOsc;
+	delete[] m_pEnv;
+	delete[] m_pTables;
 }
 
 
 
+void Synth::build_tables()
+{
+	const int N = SYNTH_TABLE_SIZE;
+	std::vector<double> sine( N );
+	for ( int n = 0; n < N; ++n ) {
+		sine[ n ] = sin( TWOPI * n / N );
+	}
+
+	std::vector<double> accu( N );
+	for ( int nWave = 0; nWave < SYNTH_WAVEFORMS; ++nWave ) {
+		Instrument::SynthWaveform waveform = ( Instrument::SynthWaveform )( Instrument::SYNTH_SINE + nWave );
+		float* pWave = m_pTables + nWave * SYNTH_TABLE_LEVELS * ( N + 1 );
+
+		// the level l is used up to an increment of 2^l / N, it holds the
+		// harmonics below Nyquist at that increment. Going from the top level
+		// down, each level adds the harmonics missing in the previous one
+		std::fill( accu.begin(), accu.end(), 0.0 );
+		std::vector< std::vector<double> > levels( SYNTH_TABLE_LEVELS );
+		int nHarmonics = 0;
+		for ( int nLevel = SYNTH_TABLE_LEVELS - 1; nLevel >= 0; --nLevel ) {
+			int nMaxHarmonic = std::min( N / 2 - 1, ( N / 2 ) >> nLevel );
+			if ( waveform == Instrument::SYNTH_SINE ) {
+				nMaxHarmonic = 1;
+			}
+			for ( int k = nHarmonics + 1; k <= nMaxHarmonic; ++k ) {
+				double fAmplitude;
+				switch ( waveform ) {
+				case Instrument::SYNTH_SAW:
+					fAmplitude = 1.0 / k;
+					break;
+				case Instrument::SYNTH_SQUARE:
+					fAmplitude = ( k % 2 ) ? 1.0 / k : 0.0;
+					break;
+				case Instrument::SYNTH_TRIANGLE:
+					fAmplitude = ( k % 2 ) ? ( ( k % 4 == 1 ) ? 1.0 : -1.0 ) / ( ( double )k * k ) : 0.0;
+					break;
+				default:
+					fAmplitude = ( k == 1 ) ? 1.0 : 0.0;
+				}
+				if ( fAmplitude == 0.0 ) {
+					continue;
+				}
+				for ( int n = 0; n < N; ++n ) {
+					accu[ n ] += fAmplitude * sine[ ( ( long )k * n ) % N ];
+				}
+			}
+			nHarmonics = std::max( nHarmonics, nMaxHarmonic );
+			levels[ nLevel ] = accu;
+		}
+
+		// one gain for all the levels, a note keeps its loudness across them
+		double fPeak = 0.0;
+		for ( int n = 0; n < N; ++n ) {
+			fPeak = std::max( fPeak, fabs( levels[ 0 ][ n ] ) );
+		}
+		double fGain = fPeak > 0.0 ? 1.0 / fPeak : 1.0;
+		for ( int nLevel = 0; nLevel < SYNTH_TABLE_LEVELS; ++nLevel ) {
+			float* pTable = pWave + nLevel * ( N + 1 );
+			for ( int n = 0; n < N; ++n ) {
+				pTable[ n ] = ( float )( levels[ nLevel ][ n ] * fGain );
+			}
+			// guard point, the interpolation never wraps
+			pTable[ N ] = pTable[ 0 ];
+		}
+	}
+}
+
+
 
-void Synth::noteOn( Note* pNote )
+const float* Synth::get_table( Instrument::SynthWaveform waveform, float fIncrement ) const
 {
-	INFOLOG( "NOTE ON" );
-	assert( pNote );
+	// smallest level with 2^level >= increment * N
+	int nLevel = 0;
+	float fReach = fIncrement * SYNTH_TABLE_SIZE;
+	while ( nLevel < SYNTH_TABLE_LEVELS - 1 && ( float )( 1 << nLevel ) < fReach ) {
+		++nLevel;
+	}
+	int nWave = waveform - Instrument::SYNTH_SINE;
+	return m_pTables + ( nWave * SYNTH_TABLE_LEVELS + nLevel ) * ( SYNTH_TABLE_SIZE + 1 );
+}
+
 
-	m_playingNotesQueue.push_back( pNote );
+
+void Synth::start_voice( Voice* pVoice, unsigned nSampleRate )
+{
+	Note* pNote = pVoice->pNote;
+	Instrument* pInstr = pNote->get_instrument();
+
+	float fFrequency = pInstr->get_synth_frequency() * pow( 2.0, pNote->get_total_pitch() / 12.0 );
+	float fIncrement = fFrequency / nSampleRate;
+	// above Nyquist there is nothing left to play
+	fIncrement = std::min( fIncrement, 0.5f );
+
+	pVoice->pTable = get_table( pInstr->get_synth_waveform(), fIncrement );
+	pVoice->nStep = std::max( ( uint32_t )1, ( uint32_t )( fIncrement * 4294967296.0 ) );
 }
 
 
 
+void Synth::remove_voice( int nVoice )
+{
+	Note* pNote = m_voices[ nVoice ].pNote;
+	pNote->get_instrument()->dequeue();
+	delete pNote;
+	for ( int i = nVoice + 1; i < m_nVoices; ++i ) {
+		m_voices[ i - 1 ] = m_voices[ i ];
+	}
+	--m_nVoices;
+}
+
+
 
-void Synth::noteOff( Note* pNote )
+void Synth::note_on( Note* pNote )
 {
-	INFOLOG( "NOTE OFF - not implemented yet" );
 	assert( pNote );
+	Instrument* pInstr = pNote->get_instrument();
+
+	// mute group
+	int nMuteGroup = pInstr->get_mute_group();
+	if ( nMuteGroup != -1 ) {
+		for ( int i = 0; i < m_nVoices; ++i ) {
+			Instrument* pPlaying = m_voices[ i ].pNote->get_instrument();
+			if ( pPlaying != pInstr && pPlaying->get_mute_group() == nMuteGroup ) {
+				m_voices[ i ].pNote->get_adsr()->release();
+			}
+		}
+	}
 
-	// delete the older note...
-	for ( uint i = 0; i < m_playingNotesQueue.size(); ++i ) {
-		Note *pPlayingNote = m_playingNotesQueue[ i ];
-		if ( pPlayingNote->get_instrument() == pNote->get_instrument() ) {
-			m_playingNotesQueue.erase( m_playingNotesQueue.begin() + i );
-			delete pPlayingNote;
+	if ( pNote->get_note_off() ) {
+		for ( int i = 0; i < m_nVoices; ++i ) {
+			if ( m_voices[ i ].pNote->get_instrument() == pInstr ) {
+				m_voices[ i ].pNote->get_adsr()->release();
+			}
+		}
+		return;
+	}
 
-			delete pNote;
-			pNote = NULL;
-			break;
+	if ( m_nVoices == SYNTH_VOICES ) {
+		remove_voice( 0 );
+	}
+
+	pNote->get_adsr()->attack();
+	pInstr->enqueue();
+
+	Voice* pVoice = &m_voices[ m_nVoices++ ];
+	pVoice->pNote = pNote;
+	pVoice->pTable = NULL;
+	pVoice->nPhase = 0;
+	pVoice->nStep = 0;
+	pVoice->nPlayed = 0;
+	pVoice->fBpfb = 0.0f;
+	pVoice->fLpfb = 0.0f;
+	pVoice->nLength = -1;
+}
+
+
+
+void Synth::note_off( Note* pNote )
+{
+	assert( pNote );
+
+	Instrument* pInstr = pNote->get_instrument();
+	for ( int i = 0; i < m_nVoices; ++i ) {
+		if ( m_voices[ i ].pNote->get_instrument() == pInstr ) {
+			m_voices[ i ].pNote->get_adsr()->release();
 		}
 	}
+	delete pNote;
+}
+
+
 
-	ERRORLOG( "note not found" );
+void Synth::midi_keyboard_note_off( int key )
+{
+	for ( int i = 0; i < m_nVoices; ++i ) {
+		if ( m_voices[ i ].pNote->get_midi_msg() == key ) {
+			m_voices[ i ].pNote->get_adsr()->release();
+		}
+	}
 }
 
 
 
-// perche' viene passata anche la canzone? E' davvero necessaria?
-void Synth::process( uint32_t nFrames )
+void Synth::stop_playing_notes( Instrument* pInstr )
 {
-	//INFOLOG( "process" );
+	int i = 0;
+	while ( i < m_nVoices ) {
+		if ( pInstr == NULL || m_voices[ i ].pNote->get_instrument() == pInstr ) {
+			remove_voice( i );
+		} else {
+			++i;
+		}
+	}
+}
+
+
 
+void Synth::process( uint32_t nFrames, Song* pSong )
+{
 	// cleanup of the output buffers
 	memset( m_pOut_L, 0, nFrames * sizeof( float ) );
 	memset( m_pOut_R, 0, nFrames * sizeof( float ) );
 
+	if ( m_nVoices == 0 ) {
+		return;
+	}
+	assert( pSong );
+
+	Hydrogen* pEngine = Hydrogen::get_instance();
+	AudioOutput* pAudioOutput = pEngine->getAudioOutput();
+	assert( pAudioOutput );
+
+	uint32_t nFramepos;
+	if ( pEngine->getState() == STATE_PLAYING ) {
+		nFramepos = pAudioOutput->m_transport.m_nFrames;
+	} else {
+		// use this to support realtime events when not playing
+		nFramepos = pEngine->getRealtimeFrames();
+	}
 
-	for ( uint i = 0; i < m_playingNotesQueue.size(); ++i ) {
-		Note *pPlayingNote = m_playingNotesQueue[ i ];
+	int i = 0;
+	while ( i < m_nVoices ) {
+		if ( render_voice( &m_voices[ i ], nFrames, nFramepos, pAudioOutput, pSong ) ) {
+			remove_voice( i );
+		} else {
+			++i;
+		}
+	}
+}
 
-		//pPlayingNote->dumpInfo();
 
-		float amplitude = pPlayingNote->get_velocity();
-		float frequency = TWOPI * 220.0 / 44100.0;
 
-		for ( uint i = 0; i < nFrames; ++i ) {
-			float fVal = sin( m_fTheta ) * amplitude;
-			m_pOut_L[ i ] += fVal;
-			m_pOut_R[ i ] += fVal;
+bool Synth::render_voice( Voice* pVoice, uint32_t nFrames, uint32_t nFramepos, AudioOutput* pAudioOutput, Song* pSong )
+{
+	Note* pNote = pVoice->pNote;
+	Instrument* pInstr = pNote->get_instrument();
+	ADSR* pADSR = pNote->get_adsr();
+
+	int nStart = 0;
+	if ( pVoice->nStep == 0 ) {
+		int nNoteStart = ( int )( pNote->get_position() * pAudioOutput->m_transport.m_nTickSize ) + pNote->get_humanize_delay();
+		if ( nNoteStart > ( int )nFramepos ) {
+			nStart = nNoteStart - nFramepos;
+			if ( nStart >= ( int )nFrames ) {
+				int nNoteStartNoHumanize = ( int )( pNote->get_position() * pAudioOutput->m_transport.m_nTickSize );
+				if ( nNoteStartNoHumanize > ( int )( nFramepos + nFrames ) ) {
+					// this note is not valid. it's in the future...let's skip it....
+					ERRORLOG_RT( "Note pos in the future?? Current frames: %1, note frame pos: %2", nFramepos, nNoteStartNoHumanize );
+					return true;
+				}
+				// delay note execution
+				return false;
+			}
+		}
+		start_voice( pVoice, pAudioOutput->getSampleRate() );
+		if ( pNote->get_length() != -1 ) {
+			pVoice->nLength = ( int )( pNote->get_length() * pAudioOutput->m_transport.m_nTickSize );
+		} else {
+			// a hit, released once the decay reached the sustain level
+			pVoice->nLength = pADSR->get_attack() + pADSR->get_decay();
+		}
+	}
 
-			m_fTheta += frequency;
+	int nCount = nFrames - nStart;
+	float* __restrict pOsc = m_pOsc;
+	float* __restrict pEnv = m_pEnv;
+
+	// oscillator, the table index is in the upper bits of the phase
+	const float* pTable = pVoice->pTable;
+	uint32_t nPhase = pVoice->nPhase;
+	const uint32_t nStep = pVoice->nStep;
+	const float fFracScale = 1.0f / ( float )( 1u << SYNTH_FRAC_BITS );
+	for ( int n = 0; n < nCount; ++n ) {
+		uint32_t nIndex = nPhase >> SYNTH_FRAC_BITS;
+		float fFrac = ( nPhase & ( ( 1u << SYNTH_FRAC_BITS ) - 1 ) ) * fFracScale;
+		pOsc[ n ] = pTable[ nIndex ] + fFrac * ( pTable[ nIndex + 1 ] - pTable[ nIndex ] );
+		nPhase += nStep;
+	}
+	pVoice->nPhase = nPhase;
+
+	// envelope, stepped a frame at a time as in the sampler
+	bool bEnded = false;
+	int nPlayed = pVoice->nPlayed;
+	for ( int n = 0; n < nCount; ++n ) {
+		if ( nPlayed >= pVoice->nLength ) {
+			pADSR->release();
+		}
+		pEnv[ n ] = pADSR->get_value( 1 );
+		++nPlayed;
+		if ( pADSR->is_idle() ) {
+			// the rest of the block is silent
+			std::fill( pEnv + n + 1, pEnv + nCount, 0.0f );
+			bEnded = true;
+			break;
 		}
 	}
-}
+	pVoice->nPlayed = nPlayed;
 
+	for ( int n = 0; n < nCount; ++n ) {
+		pOsc[ n ] *= pEnv[ n ];
+	}
 
-void Synth::setAudioOutput( AudioOutput* pAudioOutput )
-{
-	m_pAudioOutput = pAudioOutput;
-}
+	// automated parameters, ramped from the start to the end of the block
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+	pSampler->update_block_params( pInstr );
+	float fSongVolume = pSampler->get_song_volume( false );
+	float fSongVolumeEnd = pSampler->get_song_volume( true );
+	const Instrument::BlockParams& blockStart = pInstr->get_block_params( false );
+	const Instrument::BlockParams& blockEnd = pInstr->get_block_params( true );
+
+	// Low pass resonant filter
+	if ( pInstr->is_filter_active() ) {
+		float fCutoffStep = ( blockEnd.filter_cutoff - blockStart.filter_cutoff ) / nFrames;
+		float fResonanceStep = ( blockEnd.filter_resonance - blockStart.filter_resonance ) / nFrames;
+		float fCutoff = blockStart.filter_cutoff + nStart * fCutoffStep;
+		float fResonance = blockStart.filter_resonance + nStart * fResonanceStep;
+		float fBpfb = pVoice->fBpfb;
+		float fLpfb = pVoice->fLpfb;
+		for ( int n = 0; n < nCount; ++n ) {
+			fBpfb = flush_denormal( fResonance * fBpfb + fCutoff * ( pOsc[ n ] - fLpfb ) );
+			fLpfb = flush_denormal( fLpfb + fCutoff * fBpfb );
+			pOsc[ n ] = fLpfb;
+			fCutoff += fCutoffStep;
+			fResonance += fResonanceStep;
+		}
+		pVoice->fBpfb = fBpfb;
+		pVoice->fLpfb = fLpfb;
+	}
 
+	Hydrogen* pEngine = Hydrogen::get_instance();
+	bool bMutedForExport = pEngine->getIsExportSessionActive() && !pInstr->is_currently_exported();
+	if ( bMutedForExport || pInstr->is_muted() || pSong->__is_muted ) {
+		return bEnded;
+	}
 
+	float fCost = pInstr->get_gain();
+	if ( pInstr->get_apply_velocity() ) {
+		fCost *= pNote->get_velocity();
+	}
+	float* __restrict pOut_L = m_pOut_L + nStart;
+	float* __restrict pOut_R = m_pOut_R + nStart;
+
+#ifdef H2CORE_HAVE_LADSPA
+	FxChain* pInsert = pInstr->get_insert_fx();
+	bool bInsert = pInsert && pInsert->is_routed();
+	if ( bInsert ) {
+		// the insert bus feeds the main mix and the sends itself
+		pOut_L = pInsert->get_buffer_L() + nStart;
+		pOut_R = pInsert->get_buffer_R() + nStart;
+	} else {
+		// sends are taken after the envelope and the filter
+		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+			LadspaFX* pFX = Effects::get_instance()->getLadspaFX( nFX );
+			float fLevel = blockStart.fx_level[ nFX ];
+			float fLevelEnd = blockEnd.fx_level[ nFX ];
+			if ( pFX && ( fLevel != 0.0 || fLevelEnd != 0.0 ) ) {
+				float fSendStep = ( fLevelEnd * fSongVolumeEnd - fLevel * fSongVolume ) * pFX->getVolume() / nFrames;
+				float fSendCost = fLevel * pFX->getVolume() * fSongVolume + nStart * fSendStep;
+				float* __restrict pSend_L = pFX->m_pBuffer_L + nStart;
+				float* __restrict pSend_R = pFX->m_pBuffer_R + nStart;
+				for ( int n = 0; n < nCount; ++n ) {
+					float fSendCost_n = fSendCost + n * fSendStep;
+					pSend_L[ n ] += pOsc[ n ] * fSendCost_n;
+					pSend_R[ n ] += pOsc[ n ] * fSendCost_n;
+				}
+			}
+		}
+	}
+#endif
+
+	fCost *= 2; // max pan is 0.5
+	float fCostEnd_L = fCost * pNote->get_pan_l() * blockEnd.pan_l * blockEnd.volume * fSongVolumeEnd;
+	float fCostEnd_R = fCost * pNote->get_pan_r() * blockEnd.pan_r * blockEnd.volume * fSongVolumeEnd;
+	float fCost_L = fCost * pNote->get_pan_l() * blockStart.pan_l * blockStart.volume * fSongVolume;
+	float fCost_R = fCost * pNote->get_pan_r() * blockStart.pan_r * blockStart.volume * fSongVolume;
+	float fCostStep_L = ( fCostEnd_L - fCost_L ) / nFrames;
+	float fCostStep_R = ( fCostEnd_R - fCost_R ) / nFrames;
+	fCost_L += nStart * fCostStep_L;
+	fCost_R += nStart * fCostStep_R;
+
+	float fPeak = 0.0f;
+	float fSumSq = 0.0f;
+	for ( int n = 0; n < nCount; ++n ) {
+		float fVal = pOsc[ n ];
+		pOut_L[ n ] += fVal * ( fCost_L + n * fCostStep_L );
+		pOut_R[ n ] += fVal * ( fCost_R + n * fCostStep_R );
+		fPeak = std::max( fPeak, fabsf( fVal ) );
+		fSumSq += fVal * fVal;
+	}
+	pInstr->get_meter().add_voice( fPeak * fCost_L, fPeak * fCost_R,
+								   fSumSq * fCost_L * fCost_L, fSumSq * fCost_R * fCost_R );
+
+	return bEnded;
+}
 
 } // namespace H2Core
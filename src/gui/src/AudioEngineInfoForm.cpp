@@ -37,6 +37,7 @@
 #include <hydrogen/IO/AudioOutput.h>
 #include <hydrogen/sampler/Sampler.h>
 #include <hydrogen/audio_engine.h>
+#include <hydrogen/engine_profiler.h>
 using namespace H2Core;
 
 #include "Skin.h"
@@ -54,6 +55,10 @@ AudioEngineInfoForm::AudioEngineInfoForm(QWidget* parent)
 
 	setWindowTitle( trUtf8( "Audio Engine Info" ) );
 
+	QFont profileFont( "Monospace" );
+	profileFont.setStyleHint( QFont::TypeWriter );
+	m_pProfileLbl->setFont( profileFont );
+
 	updateInfo();
 
 	timer = new QTimer(this);
@@ -205,6 +210,50 @@ void AudioEngineInfoForm::updateInfo()
 	// Synth
 	Synth *pSynth = AudioEngine::get_instance()->get_synth();
 	synth_playingNotesLbl->setText( QString( "%1" ).arg( pSynth->getPlayingNotesNumber() ) );
+
+	updateProfile();
+}
+
+
+/**
+ * Update m_pProfileLbl with the timings of the engine stages
+ */
+void AudioEngineInfoForm::updateProfile()
+{
+	ProfileSnapshot snapshot;
+	EngineProfiler::get_instance()->get_snapshot( snapshot );
+
+	QString sProfile = QString( "%1 %2 %3 %4 %5\n" )
+			.arg( "Stage", -12 ).arg( "p50", 9 ).arg( "p99", 9 ).arg( "max", 9 ).arg( "mean", 9 );
+	for ( int i = 0; i < EngineProfiler::STAGES; ++i ) {
+		const StageStats& stats = snapshot.stage[ i ];
+		sProfile += QString( "%1 %2 %3 %4 %5\n" )
+				.arg( EngineProfiler::stage_name( ( EngineProfiler::Stage )i ), -12 )
+				.arg( stats.p50, 9, 'f', 1 )
+				.arg( stats.p99, 9, 'f', 1 )
+				.arg( stats.max, 9, 'f', 1 )
+				.arg( stats.mean, 9, 'f', 1 );
+	}
+	sProfile += QString( "\nXRuns: %1 engine, %2 driver in %3 cycles\nWorst callback: %4 / %5" )
+			.arg( snapshot.xruns )
+			.arg( snapshot.driver_xruns )
+			.arg( snapshot.cycles )
+			.arg( snapshot.worst_us, 0, 'f', 1 )
+			.arg( snapshot.budget_us, 0, 'f', 1 );
+
+	AudioOutput *pDriver = Hydrogen::get_instance()->getAudioOutput();
+	if ( pDriver && pDriver->getLatency() > 0 && pDriver->getSampleRate() > 0 ) {
+		sProfile += QString( "\nOutput latency: %1 frames (%2 ms)" )
+				.arg( pDriver->getLatency() )
+				.arg( pDriver->getLatency() * 1000.0 / pDriver->getSampleRate(), 0, 'f', 1 );
+	}
+	m_pProfileLbl->setText( sProfile );
+}
+
+
+void AudioEngineInfoForm::on_m_pProfileResetBtn_clicked()
+{
+	EngineProfiler::get_instance()->reset();
 }
 
 
@@ -45,6 +45,7 @@ class AudioEngineInfoForm : public QWidget, public Ui_AudioEngineInfoForm_UI, pu
 		QTimer *timer;
 
 		virtual void updateAudioEngineState();
+		void updateProfile();
 
 		// EventListener implementation
 		virtual void stateChangedEvent(int nState);
@@ -60,6 +61,7 @@ class AudioEngineInfoForm : public QWidget, public Ui_AudioEngineInfoForm_UI, pu
 
 	public slots:
 		void updateInfo();
+		void on_m_pProfileResetBtn_clicked();
 };
 
 #endif
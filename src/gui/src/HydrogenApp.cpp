@@ -89,6 +89,14 @@ HydrogenApp::HydrogenApp( MainForm *pMainForm, Song *pFirstSong )
 
 	// Create the audio engine :)
 	Hydrogen::create_instance();
+
+	// react to engine events as soon as they are pushed, the timer is kept as fallback
+	m_pEventQueueNotifier = NULL;
+	int nEventFd = EventQueue::get_instance()->get_wakeup_fd();
+	if ( nEventFd != -1 ) {
+		m_pEventQueueNotifier = new QSocketNotifier( nEventFd, QSocketNotifier::Read, this );
+		connect( m_pEventQueueNotifier, SIGNAL( activated( int ) ), this, SLOT( onEventQueueNotifier() ) );
+	}
 	Hydrogen::get_instance()->setSong( pFirstSong );
 	Preferences::get_instance()->setLastSongFilename( pFirstSong->get_filename() );
 	SoundLibraryDatabase::create_instance();
@@ -123,6 +131,9 @@ HydrogenApp::~HydrogenApp()
 {
 	INFOLOG( "[~HydrogenApp]" );
 	m_pEventQueueTimer->stop();
+	if ( m_pEventQueueNotifier ) {
+		m_pEventQueueNotifier->setEnabled( false );
+	}
 
 
 	//delete the undo tmp directory
@@ -470,6 +481,12 @@ void HydrogenApp::songModifiedEvent()
 	updateWindowTitle();
 }
 
+void HydrogenApp::onEventQueueNotifier()
+{
+	EventQueue::get_instance()->acknowledge_wakeup();
+	onEventQueueTimer();
+}
+
 void HydrogenApp::onEventQueueTimer()
 {
 	// use the timer to do schedule instrument slaughter;
@@ -553,6 +570,10 @@ void HydrogenApp::onEventQueueTimer()
 				pListener->tempoChangedEvent( event.value );
 				break;
 
+			case EVENT_SONG_SWITCHED:
+				pListener->songSwitchedEvent();
+				break;
+
 			default:
 				ERRORLOG( QString("[onEventQueueTimer] Unhandled event: %1").arg( event.type ) );
 			}
@@ -118,6 +118,7 @@ class HydrogenApp : public QObject, public H2Core::Object
 
 	public slots:
 		void onEventQueueTimer();
+		void onEventQueueNotifier();
 		void currentTabChanged(int);
 
 
@@ -142,6 +143,7 @@ class HydrogenApp : public QObject, public H2Core::Object
 		InfoBar *					m_pInfoBar;
 		Director *					m_pDirector;
 		QTimer *					m_pEventQueueTimer;
+		QSocketNotifier *			m_pEventQueueNotifier;
 		std::vector<EventListener*> m_EventListeners;
 		QTabWidget *				m_pTab;
 		QSplitter *					m_pSplitter;
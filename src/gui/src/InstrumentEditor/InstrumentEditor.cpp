@@ -181,6 +181,41 @@ InstrumentEditor::InstrumentEditor( QWidget* pParent )
 	m_pRandomPitchRotary->move( 117, 210 );
 	connect( m_pRandomPitchRotary, SIGNAL( valueChanged(Rotary*) ), this, SLOT( rotaryChanged(Rotary*) ) );
 
+	// Synth
+	m_pSynthWaveformCombo = new LCDCombo( m_pInstrumentProp, 8 );
+	m_pSynthWaveformCombo->move( 20, 240 );
+	m_pSynthWaveformCombo->setToolTip( trUtf8( "Play the notes with the synth instead of the layers" ) );
+	m_pSynthWaveformCombo->addItem( QString( "Off" ) );
+	m_pSynthWaveformCombo->addItem( QString( "Sine" ) );
+	m_pSynthWaveformCombo->addItem( QString( "Triangle" ) );
+	m_pSynthWaveformCombo->addItem( QString( "Saw" ) );
+	m_pSynthWaveformCombo->addItem( QString( "Square" ) );
+	connect( m_pSynthWaveformCombo, SIGNAL( valueChanged( int ) ), this, SLOT( synthWaveformChanged( int ) ) );
+
+	m_pSynthFrequencyLCD = new LCDDisplay( m_pInstrumentProp, LCDDigit::SMALL_BLUE, 6 );
+	m_pSynthFrequencyLCD->move( 144, 241 );
+	m_pSynthFrequencyLCD->setToolTip( trUtf8( "Synth frequency of a note without pitch, in Hz" ) );
+
+	m_pAddSynthFrequencyBtn = new Button(
+							 m_pInstrumentProp,
+							 "/lcd/LCDSpinBox_up_on.png",
+							 "/lcd/LCDSpinBox_up_off.png",
+							 "/lcd/LCDSpinBox_up_over.png",
+							 QSize( 16, 8 )
+							 );
+	m_pAddSynthFrequencyBtn->move( 202, 240 );
+	connect( m_pAddSynthFrequencyBtn, SIGNAL( clicked(Button*) ), this, SLOT( synthFrequencyBtnClicked(Button*) ) );
+
+	m_pDelSynthFrequencyBtn = new Button(
+							 m_pInstrumentProp,
+							 "/lcd/LCDSpinBox_down_on.png",
+							 "/lcd/LCDSpinBox_down_off.png",
+							 "/lcd/LCDSpinBox_down_over.png",
+							 QSize(16,8)
+							 );
+	m_pDelSynthFrequencyBtn->move( 202, 249 );
+	connect( m_pDelSynthFrequencyBtn, SIGNAL( clicked(Button*) ), this, SLOT( synthFrequencyBtnClicked(Button*) ) );
+
 	// Filter
 	m_pFilterBypassBtn = new ToggleButton(
 							 m_pInstrumentProp,
@@ -524,7 +559,9 @@ InstrumentEditor::~InstrumentEditor()
 
 void InstrumentEditor::selectedInstrumentChangedEvent()
 {
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	// the instrument list is only changed by the editors
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( NULL );
 
 	Hydrogen *pEngine = Hydrogen::get_instance();
 	Song *pSong = pEngine->getSong();
@@ -547,7 +584,7 @@ void InstrumentEditor::selectedInstrumentChangedEvent()
 	else {
 		m_pInstrument = nullptr;
 	}
-	AudioEngine::get_instance()->unlock();
+	AudioEngine::get_instance()->unlock_edit();
 
 	// update layer list
 	if ( m_pInstrument ) {
@@ -617,6 +654,10 @@ void InstrumentEditor::selectedInstrumentChangedEvent()
 		// see instrument.h
 		m_sampleSelectionAlg->select( m_pInstrument->sample_selection_alg(), false);
 
+		// synth
+		m_pSynthWaveformCombo->select( m_pInstrument->get_synth_waveform(), false );
+		m_pSynthFrequencyLCD->setText( QString( "%1" ).arg( m_pInstrument->get_synth_frequency(), 0, 'f', 1 ) );
+
 		itemsCompo.clear();
 		std::vector<DrumkitComponent*>* compoList = pSong->get_components();
 		for (auto& it : *pSong->get_components() ) {
@@ -1148,6 +1189,25 @@ void InstrumentEditor::muteGroupBtnClicked(Button *pRef)
 	selectedInstrumentChangedEvent();	// force an update
 }
 
+void InstrumentEditor::synthFrequencyBtnClicked(Button *pRef)
+{
+	assert( m_pInstrument );
+
+	// a semitone per click
+	float fFrequency = m_pInstrument->get_synth_frequency();
+	if (pRef == m_pAddSynthFrequencyBtn ) {
+		fFrequency *= 1.0594630943593;
+	}
+	else if (pRef == m_pDelSynthFrequencyBtn ) {
+		fFrequency /= 1.0594630943593;
+	}
+	if ( fFrequency >= 20.0 && fFrequency <= 2000.0 ) {
+		m_pInstrument->set_synth_frequency( fFrequency );
+	}
+
+	selectedInstrumentChangedEvent();	// force an update
+}
+
 void InstrumentEditor::onIsStopNoteCheckBoxClicked( bool on )
 {
 	m_pInstrument->set_stop_notes( on );
@@ -1412,6 +1472,16 @@ void InstrumentEditor::pSampleSelectionChanged( int selected )
 	selectedInstrumentChangedEvent();	// force an update
 }
 
+void InstrumentEditor::synthWaveformChanged( int selected )
+{
+	assert( m_pInstrument );
+
+	// the items follow Instrument::SynthWaveform
+	m_pInstrument->set_synth_waveform( ( Instrument::SynthWaveform )selected );
+
+	selectedInstrumentChangedEvent();	// force an update
+}
+
 void InstrumentEditor::hihatGroupClicked(Button *pRef)
 {
 	assert( m_pInstrument );
@@ -91,6 +91,8 @@ class InstrumentEditor : public QWidget, public H2Core::Object, public EventList
 		void hihatMaxRangeBtnClicked(Button *pRef);
 
 		void pSampleSelectionChanged( int );
+		void synthWaveformChanged( int );
+		void synthFrequencyBtnClicked( Button *pRef );
 
 		void waveDisplayDoubleClicked( QWidget *pRef );
 
@@ -176,6 +178,12 @@ class InstrumentEditor : public QWidget, public H2Core::Object, public EventList
 		//LCDCombo *__pattern_size_combo;
 		LCDCombo *m_sampleSelectionAlg;
 
+		// Instrument synth
+		LCDCombo *m_pSynthWaveformCombo;
+		LCDDisplay *m_pSynthFrequencyLCD;
+		Button *m_pAddSynthFrequencyBtn;
+		Button *m_pDelSynthFrequencyBtn;
+
 		WaveDisplay *m_pWaveDisplay;
 
 		Button *m_pLoadLayerBtn;
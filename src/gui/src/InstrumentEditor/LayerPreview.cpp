@@ -285,7 +285,7 @@ void LayerPreview::mousePressEvent(QMouseEvent *ev)
 
 		Note *note = new Note( m_pInstrument, nPosition, fVelocity, fPan_L, fPan_R, nLength, fPitch );
 		note->set_specific_compo_id( m_nSelectedComponent );
-		AudioEngine::get_instance()->get_sampler()->note_on(note);
+		AudioEngine::get_instance()->get_sampler()->queue_note_on(note);
 		
 		for ( int i = 0; i < InstrumentComponent::getMaxLayers(); i++ ) {
 			InstrumentComponent *pCompo = m_pInstrument->get_component(m_nSelectedComponent);
@@ -316,7 +316,7 @@ void LayerPreview::mousePressEvent(QMouseEvent *ev)
 			if ( pLayer ) {
 				Note *note = new Note( m_pInstrument , nPosition, m_pInstrument->get_component(m_nSelectedComponent)->get_layer( m_nSelectedLayer )->get_end_velocity() - 0.01, fPan_L, fPan_R, nLength, fPitch );
 				note->set_specific_compo_id( m_nSelectedComponent );
-				AudioEngine::get_instance()->get_sampler()->note_on(note);
+				AudioEngine::get_instance()->get_sampler()->queue_note_on(note);
 				
 				int x1 = (int)( pLayer->get_start_velocity() * width() );
 				int x2 = (int)( pLayer->get_end_velocity() * width() );
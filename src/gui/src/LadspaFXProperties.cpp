@@ -24,6 +24,10 @@
 #include <hydrogen/audio_engine.h>
 #include <hydrogen/basics/song.h>
 #include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/FxChain.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/drumkit_component.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/IO/AudioOutput.h>
 
@@ -50,6 +54,10 @@ LadspaFXProperties::LadspaFXProperties(QWidget* parent, uint nLadspaFX)
 //	INFOLOG( "INIT" );
 
 	m_nLadspaFX = nLadspaFX;
+	m_bInsert = false;
+	m_nInstrumentID = -1;
+	m_nComponentID = -1;
+	m_nSlot = 0;
 
 	resize( 500, 200 );
 	setMinimumSize( width(), height() );
@@ -112,6 +120,16 @@ LadspaFXProperties::LadspaFXProperties(QWidget* parent, uint nLadspaFX)
 }
 
 
+LadspaFXProperties::LadspaFXProperties(QWidget* parent, int nInstrumentID, int nComponentID, int nSlot)
+ : LadspaFXProperties( parent, 0 )
+{
+	m_bInsert = true;
+	m_nInstrumentID = nInstrumentID;
+	m_nComponentID = nComponentID;
+	m_nSlot = nSlot;
+}
+
+
 LadspaFXProperties::~LadspaFXProperties()
 {
 //	INFOLOG( "DESTROY" );
@@ -119,6 +137,76 @@ LadspaFXProperties::~LadspaFXProperties()
 
 
 
+H2Core::FxChain* LadspaFXProperties::getChain( bool bCreate )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	Song *pSong = Hydrogen::get_instance()->getSong();
+	if ( pSong == NULL ) {
+		return NULL;
+	}
+	if ( m_nInstrumentID != -1 ) {
+		Instrument *pInstr = pSong->get_instrument_list()->find( m_nInstrumentID );
+		if ( pInstr == NULL ) {
+			return NULL;
+		}
+		if ( pInstr->get_insert_fx() == NULL && bCreate ) {
+			pInstr->set_insert_fx( new FxChain() );
+		}
+		return pInstr->get_insert_fx();
+	}
+	for ( uint i = 0; i < pSong->get_components()->size(); i++ ) {
+		DrumkitComponent *pCompo = pSong->get_components()->at( i );
+		if ( pCompo->get_id() == m_nComponentID ) {
+			if ( pCompo->get_insert_fx() == NULL && bCreate ) {
+				pCompo->set_insert_fx( new FxChain() );
+			}
+			return pCompo->get_insert_fx();
+		}
+	}
+#endif
+	return NULL;
+}
+
+
+
+H2Core::LadspaFX* LadspaFXProperties::getFX()
+{
+#ifdef H2CORE_HAVE_LADSPA
+	if ( !m_bInsert ) {
+		return Effects::get_instance()->getLadspaFX( m_nLadspaFX );
+	}
+	FxChain *pChain = getChain( false );
+	return pChain ? pChain->get( m_nSlot ) : NULL;
+#else
+	return NULL;
+#endif
+}
+
+
+
+void LadspaFXProperties::setFX( H2Core::LadspaFX* pFX )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	if ( !m_bInsert ) {
+		Effects::get_instance()->setLadspaFX( pFX, m_nLadspaFX );
+		return;
+	}
+	FxChain *pChain = getChain( pFX != NULL );
+	if ( pChain == NULL ) {
+		delete pFX;
+		return;
+	}
+	if ( m_nSlot > pChain->size() ) {
+		m_nSlot = pChain->size();
+	}
+	if ( pFX != NULL || m_nSlot < pChain->size() ) {
+		pChain->set( pFX, m_nSlot );
+	}
+#endif
+}
+
+
+
 void LadspaFXProperties::showEvent ( QShowEvent* )
 {
 	updateControls();
@@ -140,7 +228,10 @@ void LadspaFXProperties::faderChanged( Fader * ref )
 	Song *pSong = (Hydrogen::get_instance() )->getSong();
 
 #ifdef H2CORE_HAVE_LADSPA
-	LadspaFX *pFX = Effects::get_instance()->getLadspaFX( m_nLadspaFX );
+	LadspaFX *pFX = getFX();
+	if ( pFX == NULL ) {
+		return;
+	}
 
 	for ( uint i = 0; i < m_pInputControlFaders.size(); i++ ) {
 		if (ref == m_pInputControlFaders[ i ] ) {
@@ -175,7 +266,7 @@ void LadspaFXProperties::updateControls()
 	INFOLOG( "*** [updateControls] ***" );
 	m_pTimer->stop();
 
-	LadspaFX *pFX = Effects::get_instance()->getLadspaFX( m_nLadspaFX );
+	LadspaFX *pFX = getFX();
 
 	// svuoto i vettori..
 	if ( m_pInputControlNames.size() != 0 ) {
@@ -334,7 +425,11 @@ void LadspaFXProperties::updateControls()
 	}
 	else {
 		INFOLOG( "NULL PLUGIN" );
-		setWindowTitle( trUtf8( "LADSPA FX %1 Properties" ).arg( m_nLadspaFX) );
+		if ( m_bInsert ) {
+			setWindowTitle( trUtf8( "Insert FX %1 Properties" ).arg( m_nSlot + 1 ) );
+		} else {
+			setWindowTitle( trUtf8( "LADSPA FX %1 Properties" ).arg( m_nLadspaFX) );
+		}
 		m_pNameLbl->setText( trUtf8("No plugin") );
 		m_pActivateBtn->setEnabled(false);
 	}
@@ -348,7 +443,7 @@ void LadspaFXProperties::updateControls()
 void LadspaFXProperties::selectFXBtnClicked()
 {
 #ifdef H2CORE_HAVE_LADSPA
-	LadspaFXSelector fxSelector(m_nLadspaFX);
+	LadspaFXSelector fxSelector( getFX() );
 	if (fxSelector.exec() == QDialog::Accepted) {
 		QString sSelectedFX = fxSelector.getSelectedFX();
 		if ( !sSelectedFX.isEmpty() ) {
@@ -367,7 +462,7 @@ void LadspaFXProperties::selectFXBtnClicked()
 			Song *pSong = (Hydrogen::get_instance() )->getSong();
 			pSong->set_is_modified(true);
 
-			Effects::get_instance()->setLadspaFX( pFX, m_nLadspaFX );
+			setFX( pFX );
 
 			//AudioEngine::get_instance()->unlock();
 			Hydrogen::get_instance()->restartLadspaFX();
@@ -386,7 +481,7 @@ void LadspaFXProperties::removeFXBtnClicked()
 #ifdef H2CORE_HAVE_LADSPA
 	Song *pSong = (Hydrogen::get_instance() )->getSong();
 	pSong->set_is_modified( true );
-	Effects::get_instance()->setLadspaFX( NULL, m_nLadspaFX );
+	setFX( NULL );
 	Hydrogen::get_instance()->restartLadspaFX();
 	updateControls();	
 #endif
@@ -399,7 +494,7 @@ void LadspaFXProperties::updateOutputControls()
 
 //	INFOLOG( "[updateOutputControls]" );
 //	Song *pSong = (Hydrogen::get_instance() )->getSong();
-	LadspaFX *pFX = Effects::get_instance()->getLadspaFX(m_nLadspaFX);
+	LadspaFX *pFX = getFX();
 
 	if (pFX) {
 		m_pActivateBtn->setEnabled(true);
@@ -445,11 +540,9 @@ void LadspaFXProperties::activateBtnClicked()
 {
 #ifdef H2CORE_HAVE_LADSPA
 //	Song *pSong = (Hydrogen::get_instance() )->getSong();
-	LadspaFX *pFX = Effects::get_instance()->getLadspaFX(m_nLadspaFX);
+	LadspaFX *pFX = getFX();
 	if (pFX) {
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		pFX->setEnabled( !pFX->isEnabled() );
-		AudioEngine::get_instance()->unlock();
 	}
 #endif
 }
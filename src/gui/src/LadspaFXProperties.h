@@ -35,12 +35,23 @@ class Fader;
 class LCDDisplay;
 class InstrumentNameWidget;
 
+namespace H2Core {
+	class FxChain;
+	class LadspaFX;
+}
+
 class LadspaFXProperties : public QWidget, public H2Core::Object {
     H2_OBJECT
 	Q_OBJECT
 
 	public:
 		LadspaFXProperties(QWidget* parent, uint nLadspaFX);
+		/**
+		 * edit the insert FX nSlot of an instrument or, if nInstrumentID
+		 * is -1, of a drumkit component. nSlot past the end of the chain
+		 * adds a new insert.
+		 */
+		LadspaFXProperties(QWidget* parent, int nInstrumentID, int nComponentID, int nSlot);
 		~LadspaFXProperties();
 
 		void updateControls();
@@ -58,6 +69,16 @@ class LadspaFXProperties : public QWidget, public H2Core::Object {
 	private:
 		uint m_nLadspaFX;
 
+		bool m_bInsert;				///< editing an insert FX instead of a send
+		int m_nInstrumentID;
+		int m_nComponentID;
+		int m_nSlot;
+
+		/** the insert chain of the song instrument or component, looked up each time */
+		H2Core::FxChain* getChain( bool bCreate );
+		H2Core::LadspaFX* getFX();
+		void setFX( H2Core::LadspaFX* pFX );
+
 		QLabel *m_pNameLbl;
 
 		std::vector<Fader*> m_pInputControlFaders;
@@ -35,7 +35,7 @@ using namespace H2Core;
 
 const char* LadspaFXSelector::__class_name = "LadspaFXSelector";
 
-LadspaFXSelector::LadspaFXSelector(int nLadspaFX)
+LadspaFXSelector::LadspaFXSelector( H2Core::LadspaFX* pCurrentFX )
  : QDialog( NULL )
  , Object( __class_name )
  , m_pCurrentItem( NULL )
@@ -63,9 +63,8 @@ LadspaFXSelector::LadspaFXSelector(int nLadspaFX)
 
 #ifdef H2CORE_HAVE_LADSPA
 	//Song *pSong = Hydrogen::get_instance()->getSong();
-	LadspaFX *pFX = Effects::get_instance()->getLadspaFX(nLadspaFX);
-	if (pFX) {
-		m_sSelectedPluginName = pFX->getPluginName();
+	if (pCurrentFX) {
+		m_sSelectedPluginName = pCurrentFX->getPluginName();
 	}
 	buildLadspaGroups();
 
@@ -39,6 +39,7 @@
 namespace H2Core {
 	class LadspaFXInfo;
 	class LadspaFXGroup;
+	class LadspaFX;
 }
 
 class LadspaFXSelector : public QDialog, public Ui_LadspaFXSelector_UI, public H2Core::Object
@@ -47,7 +48,8 @@ class LadspaFXSelector : public QDialog, public Ui_LadspaFXSelector_UI, public H
 	Q_OBJECT
 
 	public:
-		LadspaFXSelector(int nLadspaFX);
+		/** \param pCurrentFX the plugin to preselect, may be NULL */
+		LadspaFXSelector( H2Core::LadspaFX* pCurrentFX );
 		~LadspaFXSelector();
 
 		QString getSelectedFX();
@@ -28,6 +28,7 @@
 #include <hydrogen/Preferences.h>
 #include <hydrogen/timeline.h>
 #include <hydrogen/helpers/files.h>
+#include <hydrogen/helpers/drumkit_index.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
 #include <hydrogen/basics/instrument_list.h>
@@ -281,6 +282,7 @@ void MainForm::createMenuBar()
 
 	m_pFileMenu->addSeparator();				// -----
 
+	m_pFileMenu->addAction( trUtf8( "&Import MIDI file" ), this, SLOT( action_file_import_midi() ), QKeySequence( "" ) );
 	m_pFileMenu->addAction( trUtf8( "Export &MIDI file" ), this, SLOT( action_file_export_midi() ), QKeySequence( "Ctrl+M" ) );
 	m_pFileMenu->addAction( trUtf8( "&Export song" ), this, SLOT( action_file_export() ), QKeySequence( "Ctrl+E" ) );
 	m_pFileMenu->addAction( trUtf8( "Export &LilyPond file" ), this, SLOT( action_file_export_lilypond() ), QKeySequence( "Ctrl+L" ) );
@@ -1038,30 +1040,10 @@ void MainForm::action_instruments_saveLibrary()
 	QString sDrumkitName = Hydrogen::get_instance()->getCurrentDrumkitname();
 	Drumkit *drumkitInfo = NULL;
 
-	//User drumkit list
-	QStringList usr_dks = Filesystem::usr_drumkit_list();
-	for (int i = 0; i < usr_dks.size(); ++i) {
-		QString absPath = Filesystem::usr_drumkits_dir() + usr_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			if ( QString(pInfo->get_name() ) == sDrumkitName ){
-				drumkitInfo = pInfo;
-				break;
-			}
-		}
-	}
-
-	//System drumkit list
-	QStringList sys_dks = Filesystem::sys_drumkit_list();
-	for (int i = 0; i < sys_dks.size(); ++i) {
-		QString absPath = Filesystem::sys_drumkits_dir() + sys_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			if ( QString( pInfo->get_name() ) == sDrumkitName ){
-				drumkitInfo = pInfo;
-				break;
-			}
-		}
+	// the index finds the drumkit without loading all the others
+	QString sDrumkitPath = DrumkitIndex::path_of( sDrumkitName );
+	if ( !sDrumkitPath.isEmpty() ) {
+		drumkitInfo = Drumkit::load( sDrumkitPath );
 	}
 
 	if ( drumkitInfo != NULL ){
@@ -1627,16 +1609,23 @@ void MainForm::action_file_export_midi()
 		Hydrogen::get_instance()->sequencer_stop();
 	}
 
+	QString sType1Filter = trUtf8("Midi file, type 1 (*.mid)");
+	QString sType0Filter = trUtf8("Midi file, type 0 (*.mid)");
+
 	QFileDialog fd(this);
 	fd.setFileMode(QFileDialog::AnyFile);
-	fd.setNameFilter( trUtf8("Midi file (*.mid)") );
+	fd.setNameFilters( QStringList() << sType1Filter << sType0Filter );
 	fd.setDirectory( QDir::homePath() );
 	fd.setWindowTitle( trUtf8( "Export MIDI file" ) );
 	fd.setAcceptMode( QFileDialog::AcceptSave );
 
 	QString sFilename;
+	int nFormat = 1;
 	if ( fd.exec() == QDialog::Accepted ) {
 		sFilename = fd.selectedFiles().first();
+		if ( fd.selectedNameFilter() == sType0Filter ) {
+			nFormat = 0;
+		}
 	}
 
 	if ( !sFilename.isEmpty() ) {
@@ -1648,12 +1637,55 @@ void MainForm::action_file_export_midi()
 
 		// create the Standard Midi File object
 		SMFWriter *pSmfWriter = new SMFWriter();
-		pSmfWriter->save( sFilename, pSong );
+		if ( !pSmfWriter->save( sFilename, pSong, nFormat ) ) {
+			QMessageBox::warning( this, "Hydrogen", trUtf8( "Could not export MIDI file." ) );
+		}
 
 		delete pSmfWriter;
 	}
 }
 
+void MainForm::action_file_import_midi()
+{
+	if ( ((Hydrogen::get_instance())->getState() == STATE_PLAYING) ) {
+		Hydrogen::get_instance()->sequencer_stop();
+	}
+
+	QFileDialog fd(this);
+	fd.setFileMode(QFileDialog::ExistingFile);
+	fd.setNameFilter( trUtf8("Midi file (*.mid *.midi)") );
+	fd.setDirectory( QDir::homePath() );
+	fd.setWindowTitle( trUtf8( "Import MIDI file" ) );
+
+	QString sFilename;
+	if ( fd.exec() == QDialog::Accepted ) {
+		sFilename = fd.selectedFiles().first();
+	}
+
+	if ( sFilename.isEmpty() ) {
+		return;
+	}
+
+	Song *pSong = Hydrogen::get_instance()->getSong();
+
+	// the patterns and the sequence are extended in place
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	SMFReader reader;
+	bool bLoaded = reader.load( sFilename, pSong );
+	AudioEngine::get_instance()->unlock();
+
+	if ( !bLoaded ) {
+		QMessageBox::warning( this, "Hydrogen", trUtf8( "Could not import MIDI file." ) );
+		return;
+	}
+
+	// the undo actions refer to the sequence as it was
+	h2app->m_pUndoStack->clear();
+	h2app->getSongEditorPanel()->getSongEditor()->updateEditorandSetTrue();
+	h2app->getSongEditorPanel()->updateAll();
+	EventQueue::get_instance()->push_event( EVENT_SELECTED_PATTERN_CHANGED, -1 );
+}
+
 void MainForm::action_file_export_lilypond()
 {
 	if ( ( ( Hydrogen::get_instance() )->getState() == STATE_PLAYING ) ) {
@@ -1736,12 +1768,16 @@ void MainForm::errorEvent( int nErrorCode )
 
 void MainForm::playlistLoadSongEvent (int nIndex)
 {
-	Playlist* pPlaylist = Playlist::get_instance();
+	// the song is current once EVENT_SONG_SWITCHED comes
+	Playlist::get_instance()->loadSong( nIndex );
+}
 
-	if ( ! pPlaylist->loadSong ( nIndex ) )
-		return;
+void MainForm::songSwitchedEvent()
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	pHydrogen->finishSongSwitch();
 
-	Song* pSong = Hydrogen::get_instance()->getSong();
+	Song* pSong = pHydrogen->getSong();
 
 	h2app->getSongEditorPanel()->updateAll();
 	h2app->getPatternEditorPanel()->updateSLnameLabel();
@@ -1758,7 +1794,7 @@ void MainForm::playlistLoadSongEvent (int nIndex)
 	h2app->m_pUndoStack->clear();
 
 	EventQueue::get_instance()->push_event( EVENT_METRONOME, 3 );
-	HydrogenApp::get_instance()->setScrollStatusBarMessage( trUtf8( "Playlist: Set song No. %1" ).arg( nIndex +1 ), 5000 );
+	HydrogenApp::get_instance()->setScrollStatusBarMessage( trUtf8( "Playlist: Set song No. %1" ).arg( Playlist::get_instance()->getActiveSongNumber() +1 ), 5000 );
 }
 
 void MainForm::jacksessionEvent( int nEvent )
@@ -1987,30 +2023,9 @@ void MainForm::action_banks_properties()
 	QString sDrumkitName = Hydrogen::get_instance()->getCurrentDrumkitname();
 	Drumkit *pDrumkitInfo = nullptr;
 
-	//User drumkit list
-	QStringList usr_dks = Filesystem::usr_drumkit_list();
-	for (int i = 0; i < usr_dks.size(); ++i) {
-		QString absPath = Filesystem::usr_drumkits_dir() + usr_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			if ( QString(pInfo->get_name() ) == sDrumkitName ){
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
-	}
-
-	//System drumkit list
-	QStringList sys_dks = Filesystem::sys_drumkit_list();
-	for (int i = 0; i < sys_dks.size(); ++i) {
-		QString absPath = Filesystem::sys_drumkits_dir() + sys_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			if ( QString( pInfo->get_name() ) == sDrumkitName ){
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
+	QString sDrumkitPath = DrumkitIndex::path_of( sDrumkitName );
+	if ( !sDrumkitPath.isEmpty() ) {
+		pDrumkitInfo = Drumkit::load( sDrumkitPath );
 	}
 
 	if( pDrumkitInfo )
@@ -59,6 +59,7 @@ class MainForm : public QMainWindow, public EventListener, public H2Core::Object
 		virtual void errorEvent( int nErrorCode );
 		virtual void jacksessionEvent( int nValue);
 		virtual void playlistLoadSongEvent(int nIndex);
+		virtual void songSwitchedEvent();
 		virtual void undoRedoActionEvent( int nEvent );
 		static void usr1SignalHandler(int unused);
 
@@ -78,6 +79,7 @@ public slots:
 
 		void action_file_export();
 		void action_file_export_midi();
+		void action_file_import_midi();
 		void action_file_export_lilypond();
 		void action_file_songProperties();
 
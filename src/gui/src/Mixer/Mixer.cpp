@@ -40,6 +40,7 @@
 #include <hydrogen/Preferences.h>
 #include <hydrogen/basics/note.h>
 #include <hydrogen/fx/Effects.h>
+#include <hydrogen/fx/FxChain.h>
 using namespace H2Core;
 
 #include <cassert>
@@ -52,6 +53,8 @@ const char* Mixer::__class_name = "Mixer";
 Mixer::Mixer( QWidget* pParent )
  : QWidget( pParent )
  , Object( __class_name )
+ , m_pMeterSnapshot( new MeterSnapshot() )
+ , m_pInsertFXProperties( NULL )
 {
 	setWindowTitle( trUtf8( "Mixer" ) );
 	setMaximumHeight( 284 );
@@ -160,6 +163,8 @@ Mixer::Mixer( QWidget* pParent )
 Mixer::~Mixer()
 {
 	m_pUpdateTimer->stop();
+	delete m_pMeterSnapshot;
+	delete m_pInsertFXProperties;
 }
 
 MixerLine* Mixer::createMixerLine( int nInstr )
@@ -178,6 +183,7 @@ MixerLine* Mixer::createMixerLine( int nInstr )
 	connect( pMixerLine, SIGNAL( instrumentNameSelected(MixerLine*) ), this, SLOT( nameSelected(MixerLine*) ) );
 	connect( pMixerLine, SIGNAL( panChanged(MixerLine*) ), this, SLOT( panChanged( MixerLine*) ) );
 	connect( pMixerLine, SIGNAL( knobChanged(MixerLine*, int) ), this, SLOT( knobChanged( MixerLine*, int) ) );
+	connect( pMixerLine, SIGNAL( insertFXMenuRequested(MixerLine*, QPoint) ), this, SLOT( insertFXMenuRequested( MixerLine*, QPoint) ) );
 
 	return pMixerLine;
 }
@@ -198,6 +204,7 @@ ComponentMixerLine* Mixer::createComponentMixerLine( int theCompoID )
 	connect( pMixerLine, SIGNAL( muteBtnClicked(ComponentMixerLine*) ), this, SLOT( muteClicked(ComponentMixerLine*) ) );
 	connect( pMixerLine, SIGNAL( soloBtnClicked(ComponentMixerLine*) ), this, SLOT( soloClicked(ComponentMixerLine*) ) );
 	connect( pMixerLine, SIGNAL( volumeChanged(ComponentMixerLine*) ), this, SLOT( volumeChanged(ComponentMixerLine*) ) );
+	connect( pMixerLine, SIGNAL( insertFXMenuRequested(ComponentMixerLine*, QPoint) ), this, SLOT( insertFXMenuRequested( ComponentMixerLine*, QPoint) ) );
 
 	return pMixerLine;
 }
@@ -347,7 +354,7 @@ void Mixer::noteOnClicked( MixerLine* ref )
 
 	const float fPitch = 0.0f;
 	Note *pNote = new Note( pInstrList->get(nLine), 0, 1.0, 0.5f, 0.5f, -1, fPitch );
-	AudioEngine::get_instance()->get_sampler()->note_on(pNote);
+	AudioEngine::get_instance()->get_sampler()->queue_note_on(pNote);
 
 	Hydrogen::get_instance()->setSelectedInstrumentNumber(nLine);
 }
@@ -429,6 +436,10 @@ void Mixer::updateMixer()
 
 	float fallOff = pPref->getMixerFalloffSpeed();
 
+	// levels accumulated since the last update, the last ones are kept if the engine published nothing new
+	const MeterSnapshot* pMeters = m_pMeterSnapshot;
+	MeterBus::get_instance()->get_snapshot( *m_pMeterSnapshot );
+
 	uint nMuteClicked = 0;
 	int nInstruments = pInstrList->size();
 	int nCompo = compoList->size();
@@ -462,11 +473,12 @@ void Mixer::updateMixer()
 			Instrument *pInstr = pInstrList->get( nInstr );
 			assert( pInstr );
 
-			float fNewPeak_L = pInstr->get_peak_l();
-			pInstr->set_peak_l( 0.0f );	// reset instrument peak
-
-			float fNewPeak_R = pInstr->get_peak_r();
-			pInstr->set_peak_r( 0.0f );	// reset instrument peak
+			float fNewPeak_L = 0.0f;
+			float fNewPeak_R = 0.0f;
+			if ( (int)nInstr < pMeters->instruments ) {
+				fNewPeak_L = pMeters->instrument[ nInstr ].peak_l;
+				fNewPeak_R = pMeters->instrument[ nInstr ].peak_r;
+			}
 
 			float fNewVolume = pInstr->get_volume();
 			bool bMuted = pInstr->is_muted();
@@ -556,11 +568,15 @@ void Mixer::updateMixer()
 
 		ComponentMixerLine *pLine = m_pComponentMixerLine[ p_compo->get_id() ];
 
-		float fNewPeak_L = p_compo->get_peak_l();
-		p_compo->set_peak_l( 0.0f );	// reset instrument peak
-
-		float fNewPeak_R = p_compo->get_peak_r();
-		p_compo->set_peak_r( 0.0f );	// reset instrument peak
+		float fNewPeak_L = 0.0f;
+		float fNewPeak_R = 0.0f;
+		for ( int nMeter = 0; nMeter < pMeters->components; ++nMeter ) {
+			if ( pMeters->component_id[ nMeter ] == p_compo->get_id() ) {
+				fNewPeak_L = pMeters->component[ nMeter ].peak_l;
+				fNewPeak_R = pMeters->component[ nMeter ].peak_r;
+				break;
+			}
+		}
 
 		float fNewVolume = p_compo->get_volume();
 		bool bMuted = p_compo->is_muted();
@@ -650,11 +666,9 @@ void Mixer::updateMixer()
 
 	// update MasterPeak
 	float oldPeak_L = m_pMasterLine->getPeak_L();
-	float newPeak_L = pEngine->getMasterPeak_L();
-	pEngine->setMasterPeak_L(0.0);
+	float newPeak_L = pMeters->master.peak_l;
 	float oldPeak_R = m_pMasterLine->getPeak_R();
-	float newPeak_R = pEngine->getMasterPeak_R();
-	pEngine->setMasterPeak_R(0.0);
+	float newPeak_R = pMeters->master.peak_r;
 
 	if (!bShowPeaks) {
 		newPeak_L = 0.0;
@@ -692,8 +706,8 @@ void Mixer::updateMixer()
 		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
 		if ( pFX ) {
 			m_pLadspaFXLine[nFX]->setName( pFX->getPluginName() );
-			float fNewPeak_L = 0.0;
-			float fNewPeak_R = 0.0;
+			float fNewPeak_L = bShowPeaks ? pMeters->fx[ nFX ].peak_l : 0.0f;
+			float fNewPeak_R = bShowPeaks ? pMeters->fx[ nFX ].peak_r : 0.0f;
 
 			float fOldPeak_L = 0.0;
 			float fOldPeak_R = 0.0;
@@ -868,6 +882,73 @@ void Mixer::ladspaEditBtnClicked( LadspaFXMixerLine *ref )
 
 
 
+void Mixer::insertFXMenuRequested( MixerLine* ref, QPoint pos )
+{
+	int nLine = findMixerLineByRef( ref );
+	Instrument *pInstr = Hydrogen::get_instance()->getSong()->get_instrument_list()->get( nLine );
+	if ( pInstr ) {
+		showInsertFXMenu( pInstr->get_id(), -1, pos );
+	}
+}
+
+
+
+void Mixer::insertFXMenuRequested( ComponentMixerLine* ref, QPoint pos )
+{
+	showInsertFXMenu( -1, ref->getCompoID(), pos );
+}
+
+
+
+void Mixer::showInsertFXMenu( int nInstrumentID, int nComponentID, const QPoint& pos )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	Song *pSong = Hydrogen::get_instance()->getSong();
+	FxChain *pChain = NULL;
+	if ( nInstrumentID != -1 ) {
+		Instrument *pInstr = pSong->get_instrument_list()->find( nInstrumentID );
+		if ( pInstr ) {
+			pChain = pInstr->get_insert_fx();
+		}
+	} else {
+		for ( uint i = 0; i < pSong->get_components()->size(); i++ ) {
+			DrumkitComponent *pCompo = pSong->get_components()->at( i );
+			if ( pCompo->get_id() == nComponentID ) {
+				pChain = pCompo->get_insert_fx();
+			}
+		}
+	}
+
+	QMenu menu( this );
+	int nSlots = pChain ? pChain->size() : 0;
+	for ( int nSlot = 0; nSlot < nSlots; nSlot++ ) {
+		LadspaFX *pFX = pChain->get( nSlot );
+		QString sName = QString( "%1. %2" ).arg( nSlot + 1 ).arg( pFX->getPluginName() );
+		if ( !pFX->isEnabled() ) {
+			sName += trUtf8( " (inactive)" );
+		}
+		menu.addAction( sName )->setData( nSlot );
+	}
+	if ( nSlots > 0 ) {
+		menu.addSeparator();
+	}
+	menu.addAction( trUtf8( "Add insert FX..." ) )->setData( nSlots );
+
+	QAction *pAction = menu.exec( pos );
+	if ( pAction == NULL ) {
+		return;
+	}
+
+	delete m_pInsertFXProperties;
+	m_pInsertFXProperties = new LadspaFXProperties( NULL, nInstrumentID, nComponentID, pAction->data().toInt() );
+	m_pInsertFXProperties->show();
+#else
+	QMessageBox::critical( this, "Hydrogen", trUtf8("LADSPA effects are not available in this version of Hydrogen.") );
+#endif
+}
+
+
+
 void Mixer::ladspaVolumeChanged( LadspaFXMixerLine* ref)
 {
 #ifdef H2CORE_HAVE_LADSPA
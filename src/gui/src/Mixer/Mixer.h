@@ -32,6 +32,7 @@
 
 #include <hydrogen/object.h>
 #include <hydrogen/globals.h>
+#include <hydrogen/meter_bus.h>
 #include "../EventListener.h"
 
 class Button;
@@ -41,6 +42,7 @@ class ComponentMixerLine;
 class FxMixerLine;
 class MasterMixerLine;
 class LadspaFXMixerLine;
+class LadspaFXProperties;
 class PixmapWidget;
 
 class Mixer : public QWidget, public EventListener, public H2Core::Object
@@ -81,6 +83,8 @@ class Mixer : public QWidget, public EventListener, public H2Core::Object
 		void ladspaActiveBtnClicked( LadspaFXMixerLine* ref );
 		void ladspaEditBtnClicked( LadspaFXMixerLine *ref );
 		void ladspaVolumeChanged( LadspaFXMixerLine* ref);
+		void insertFXMenuRequested( MixerLine* ref, QPoint pos );
+		void insertFXMenuRequested( ComponentMixerLine* ref, QPoint pos );
 		void closeEvent(QCloseEvent *event);
 
 	private:
@@ -99,11 +103,15 @@ class Mixer : public QWidget, public EventListener, public H2Core::Object
 		PixmapWidget *			m_pFXFrame;
 
 		QTimer *				m_pUpdateTimer;
+		H2Core::MeterSnapshot *	m_pMeterSnapshot;		///< levels published by the meter bus
+		LadspaFXProperties *	m_pInsertFXProperties;	///< editor of the last insert FX picked in a strip menu
 
 		uint findMixerLineByRef(MixerLine* ref);
 		uint findCompoMixerLineByRef(ComponentMixerLine* ref);
 		MixerLine* createMixerLine( int );
 		ComponentMixerLine* createComponentMixerLine( int );
+		/** list the insert FX of an instrument or a component and edit the one picked */
+		void showInsertFXMenu( int nInstrumentID, int nComponentID, const QPoint& pos );
 
 		// Implements EventListener interface
 		virtual void noteOnEvent( int nInstrument );
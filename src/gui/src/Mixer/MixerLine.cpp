@@ -324,6 +324,11 @@ float MixerLine::getPeak_R() {
 	return m_pFader->getPeak_R();
 }
 
+void MixerLine::contextMenuEvent( QContextMenuEvent *ev )
+{
+	emit insertFXMenuRequested( this, ev->globalPos() );
+}
+
 void MixerLine::nameClicked() {
 	emit instrumentNameClicked(this);
 }
@@ -564,6 +569,11 @@ void ComponentMixerLine::faderChanged(Fader *ref)
 	( HydrogenApp::get_instance() )->setStatusBarMessage( trUtf8( "Set instrument volume [%1]" ).arg( value, 0, 'f', 2 ), 2000 );
 }
 
+void ComponentMixerLine::contextMenuEvent( QContextMenuEvent *ev )
+{
+	emit insertFXMenuRequested( this, ev->globalPos() );
+}
+
 bool ComponentMixerLine::isMuteClicked() {
 	return m_pMuteBtn->isPressed();
 }
@@ -837,7 +847,6 @@ void MasterMixerLine::rotaryChanged( Rotary *pRef )
 	double fVal = (double) pRef->getValue();
 
 	Hydrogen *pEngine = Hydrogen::get_instance();
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
 	if ( pRef == m_pHumanizeTimeRotary ) {
 		pEngine->getSong()->set_humanize_time_value( fVal );
@@ -855,8 +864,6 @@ void MasterMixerLine::rotaryChanged( Rotary *pRef )
 		ERRORLOG( "[knobChanged] Unhandled knob" );
 	}
 
-	AudioEngine::get_instance()->unlock();
-
 	( HydrogenApp::get_instance() )->setStatusBarMessage( sMsg, 2000 );
 }
 
@@ -120,6 +120,8 @@ class MixerLine: public PixmapWidget
 
 		void	setSelected( bool bIsSelected );
 
+		virtual void contextMenuEvent( QContextMenuEvent *ev );
+
 	signals:
 		void	muteBtnClicked(MixerLine *ref);
 		void	soloBtnClicked(MixerLine *ref);
@@ -130,6 +132,7 @@ class MixerLine: public PixmapWidget
 		void	noteOffClicked(MixerLine *ref);
 		void	panChanged(MixerLine *ref);
 		void	knobChanged(MixerLine *ref, int nKnob);
+		void	insertFXMenuRequested(MixerLine *ref, QPoint pos);
 
 	public slots:
 		void	click(Button *ref);
@@ -192,10 +195,13 @@ class ComponentMixerLine: public PixmapWidget
 
 		int		getCompoID(){ return __compoID; }
 
+		virtual void contextMenuEvent( QContextMenuEvent *ev );
+
 	signals:
 		void	muteBtnClicked(ComponentMixerLine *ref);
 		void	soloBtnClicked(ComponentMixerLine *ref);
 		void	volumeChanged(ComponentMixerLine *ref);
+		void	insertFXMenuRequested(ComponentMixerLine *ref, QPoint pos);
 
 	public slots:
 		void	click(Button *ref);
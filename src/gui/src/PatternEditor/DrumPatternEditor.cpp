@@ -62,6 +62,10 @@ DrumPatternEditor::DrumPatternEditor(QWidget* parent, PatternEditorPanel *panel)
  , m_pDraggedNote( NULL )
  , m_pPattern( NULL )
  , m_pPatternEditorPanel( panel )
+ , m_bBackgroundChanged( true )
+ , m_bPatternChanged( true )
+ , m_nBackgroundSelectedInstrument( -1 )
+ , m_nTickPosition( -1 )
 {
 	setFocusPolicy(Qt::ClickFocus);
 
@@ -73,6 +77,9 @@ DrumPatternEditor::DrumPatternEditor(QWidget* parent, PatternEditorPanel *panel)
 
 	resize( nEditorWidth, m_nEditorHeight );
 
+	m_pBackground = new QPixmap( nEditorWidth, m_nEditorHeight );
+	m_pPatternPixmap = new QPixmap( nEditorWidth, m_nEditorHeight );
+
 	HydrogenApp::get_instance()->addEventListener( this );
 
 }
@@ -81,6 +88,8 @@ DrumPatternEditor::DrumPatternEditor(QWidget* parent, PatternEditorPanel *panel)
 
 DrumPatternEditor::~DrumPatternEditor()
 {
+	delete m_pBackground;
+	delete m_pPatternPixmap;
 }
 
 
@@ -118,7 +127,7 @@ void DrumPatternEditor::updateEditor()
 	resize( nEditorWidth, height() );
 
 	// redraw all
-	update( 0, 0, width(), height() );
+	__invalidate_background();
 }
 
 
@@ -264,9 +273,11 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 	Instrument *pSelectedInstrument = pSong->get_instrument_list()->get( row );
 	m_bRightBtnPressed = false;
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+	AudioEngine::get_instance()->mark_edited( pPattern );
 
 	bool bNoteAlreadyExist = false;
+	Note *pPreviewNote = NULL;
 	if(!isInstrumentMode){
 		Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
 		FOREACH_NOTE_IT_BOUND(notes,it,nColumn) {
@@ -276,6 +287,7 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 
 				// the note exists...remove it!
 				bNoteAlreadyExist = true;
+				__invalidate_note( pNote );
 				delete pNote;
 				notes->erase( it );
 				break;
@@ -289,6 +301,7 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 
 			// the note exists...remove it!
 			bNoteAlreadyExist = true;
+			__invalidate_note( note );
 			m_pPattern->remove_note( note );
 			delete note;
 		}
@@ -318,18 +331,22 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 		if( !isNoteOff ) pNote->set_lead_lag( oldLeadLag );
 		pNote->set_key_octave( (Note::Key)oldNoteKeyVal, (Note::Octave)oldOctaveKeyVal );
 		pPattern->insert_note( pNote );
+		__invalidate_note( pNote );
 
 		if(isMidi){
 			pNote->set_just_recorded(true);
 		}
 		// hear note
 		if ( listen && !isNoteOff ) {
-			Note *pNote2 = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
-			AudioEngine::get_instance()->get_sampler()->note_on(pNote2);
+			pPreviewNote = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
 		}
 	}
 	pSong->set_is_modified( true );
-	AudioEngine::get_instance()->unlock(); // unlock the audio engine
+	AudioEngine::get_instance()->unlock_edit(); // publish the changes
+
+	if ( pPreviewNote ) {
+		AudioEngine::get_instance()->get_sampler()->queue_note_on( pPreviewNote );
+	}
 
 	// update the selected line
 	int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
@@ -337,7 +354,6 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 		Hydrogen::get_instance()->setSelectedInstrumentNumber( row );
 	}
 	else {
-		update( 0, 0, width(), height() );
 		m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 		m_pPatternEditorPanel->getPanEditor()->updateEditor();
 		m_pPatternEditorPanel->getLeadLagEditor()->updateEditor();
@@ -383,14 +399,15 @@ void DrumPatternEditor::editNoteLengthAction( int nColumn, int nRealColumn, int
 
 	Instrument *pSelectedInstrument = pSong->get_instrument_list()->get( row );
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( pPattern );
 	pDraggedNote = pPattern->find_note( nColumn, nRealColumn, pSelectedInstrument, false );
 	if( pDraggedNote ){
+		__invalidate_note( pDraggedNote );
 		pDraggedNote->set_length( length );
+		__invalidate_note( pDraggedNote );
 	}
-	AudioEngine::get_instance()->unlock();
-
-	update( 0, 0, width(), height() );
+	AudioEngine::get_instance()->unlock_edit();
 
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 	m_pPatternEditorPanel->getPanEditor()->updateEditor();
@@ -417,7 +434,8 @@ void DrumPatternEditor::mouseMoveEvent(QMouseEvent *ev)
 		if ( m_pDraggedNote->get_note_off() ) return;
 		int nTickColumn = getColumn( ev );
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+		AudioEngine::get_instance()->mark_edited( m_pPattern );
 		int nLen = nTickColumn - (int)m_pDraggedNote->get_position();
 
 		if (nLen <= 0) {
@@ -432,13 +450,13 @@ void DrumPatternEditor::mouseMoveEvent(QMouseEvent *ev)
 		{
 			fStep = 1.0;
 		}
+		__invalidate_note( m_pDraggedNote );
 		m_pDraggedNote->set_length( nLen * fStep);
+		__invalidate_note( m_pDraggedNote );
 
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_edit(); // publish the changes
 
-		//__draw_pattern();
-		update( 0, 0, width(), height() );
 		m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 		m_pPatternEditorPanel->getPanEditor()->updateEditor();
 		m_pPatternEditorPanel->getLeadLagEditor()->updateEditor();
@@ -457,72 +475,75 @@ void DrumPatternEditor::keyPressEvent (QKeyEvent *ev)
 
 
 ///
-/// Draws a pattern
+/// Draws the notes of the pattern over the background, only within rect
 ///
-void DrumPatternEditor::__draw_pattern(QPainter& painter)
+void DrumPatternEditor::__draw_pattern( const QRect& rect )
 {
-	const UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
-	const QColor selectedRowColor( pStyle->m_patternEditor_selectedRowColor.getRed(), pStyle->m_patternEditor_selectedRowColor.getGreen(), pStyle->m_patternEditor_selectedRowColor.getBlue() );
-
-	__create_background( painter );
+	QPainter painter( m_pPatternPixmap );
+	painter.drawPixmap( rect, *m_pBackground, rect );
 
-	if (m_pPattern == NULL) {
+	if ( m_pPattern == NULL ) {
 		return;
 	}
 
-	int nNotes = m_pPattern->get_length();
-	int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
-	Song *pSong = Hydrogen::get_instance()->getSong();
+	painter.setClipRect( rect );
 
-	InstrumentList * pInstrList = pSong->get_instrument_list();
+	InstrumentList * pInstrList = Hydrogen::get_instance()->getSong()->get_instrument_list();
+	const Pattern::notes_t* notes = m_pPattern->get_notes();
+	FOREACH_NOTE_CST_IT_BEGIN_END(notes,it) {
+		Note *note = it->second;
+		assert( note );
+		int nRow = pInstrList->index( note->get_instrument() );
+		if ( nRow == -1 ) {
+			ERRORLOG( "Instrument not found..skipping note" );
+			continue;
+		}
+		if ( rect.intersects( __note_rect( note, nRow ) ) ) {
+			__draw_note( note, nRow, painter );
+		}
+	}
+}
 
 
-	if ( m_nEditorHeight != (int)( m_nGridHeight * pInstrList->size() ) ) {
-		// the number of instruments is changed...recreate all
-		m_nEditorHeight = m_nGridHeight * pInstrList->size();
-		resize( width(), m_nEditorHeight );
-	}
 
-	for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-		uint y = m_nGridHeight * nInstr;
-		if ( nInstr == (uint)nSelectedInstrument ) {	// selected instrument
-			painter.fillRect( 0, y + 1, ( 20 + nNotes * m_nGridWidth ), m_nGridHeight - 1, selectedRowColor );
-		}
-	}
+QRect DrumPatternEditor::__note_rect( Note* note, int nRow )
+{
+	int x = 20 + ( note->get_position() * m_nGridWidth );
+	int y = nRow * m_nGridHeight;
 
+	if ( ( note->get_length() == -1 && note->get_note_off() == false )
+		 || ( note->get_length() == 1 && note->get_note_off() == true ) ) {
+		// trigger and note off ellipses, plus the antialiased outline
+		return QRect( x - 5, y, 10, m_nGridHeight );
+	}
 
-	// draw the grid
-	__draw_grid( painter );
+	float fNotePitch = note->get_octave() * 12 + note->get_key();
+	float fStep = pow( 1.0594630943593, ( double )fNotePitch );
+	int w = m_nGridWidth * note->get_length() / fStep;
+	return QRect( x - 1, y, std::max( w, 0 ) + 2, m_nGridHeight );
+}
 
 
-	/*
-		BUGFIX
 
-		if m_pPattern is not renewed every time we draw a note,
-		hydrogen will crash after you save a song and create a new one.
-		-smoors
-	*/
-	Hydrogen *pEngine = Hydrogen::get_instance();
-	PatternList *pPatternList = pEngine->getSong()->get_pattern_list();
-	int nSelectedPatternNumber = pEngine->getSelectedPatternNumber();
-	if ( (nSelectedPatternNumber != -1) && ( (uint)nSelectedPatternNumber < pPatternList->size() ) ) {
-		m_pPattern = pPatternList->get( nSelectedPatternNumber );
-	}
-	else {
-		m_pPattern = NULL;
+void DrumPatternEditor::__invalidate_note( Note* note )
+{
+	InstrumentList * pInstrList = Hydrogen::get_instance()->getSong()->get_instrument_list();
+	int nRow = pInstrList->index( note->get_instrument() );
+	if ( nRow == -1 ) {
+		return;
 	}
-	// ~ FIX
 
+	QRect rect = __note_rect( note, nRow );
+	m_dirtyRect = m_dirtyRect.united( rect );
+	update( rect );
+}
 
 
-	if( m_pPattern->get_notes()->size() == 0) return;
 
-	const Pattern::notes_t* notes = m_pPattern->get_notes();
-	FOREACH_NOTE_CST_IT_BEGIN_END(notes,it) {
-		Note *note = it->second;
-		assert( note );
-		__draw_note( note, painter );
-	}
+void DrumPatternEditor::__invalidate_background()
+{
+	m_bBackgroundChanged = true;
+	update( 0, 0, width(), height() );
 }
 
 
@@ -560,7 +581,7 @@ QColor DrumPatternEditor::computeNoteColor( float velocity ){
 ///
 /// Draws a note
 ///
-void DrumPatternEditor::__draw_note( Note *note, QPainter& p )
+void DrumPatternEditor::__draw_note( Note *note, int nInstrument, QPainter& p )
 {
 	static const UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
 	static const QColor noteColor( pStyle->m_patternEditor_noteColor.getRed(), pStyle->m_patternEditor_noteColor.getGreen(), pStyle->m_patternEditor_noteColor.getBlue() );
@@ -568,20 +589,6 @@ void DrumPatternEditor::__draw_note( Note *note, QPainter& p )
 
 	p.setRenderHint( QPainter::Antialiasing );
 
-	int nInstrument = -1;
-	InstrumentList * pInstrList = Hydrogen::get_instance()->getSong()->get_instrument_list();
-	for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-		Instrument *pInstr = pInstrList->get( nInstr );
-		if ( pInstr == note->get_instrument() ) {
- 			nInstrument = nInstr;
-			break;
-		}
-	}
-	if ( nInstrument == -1 ) {
-		ERRORLOG( "Instrument not found..skipping note" );
-		return;
-	}
-
 	uint pos = note->get_position();
 
 	p.setPen( noteColor );
@@ -736,28 +743,36 @@ void DrumPatternEditor::__draw_grid( QPainter& p )
 }
 
 
-void DrumPatternEditor::__create_background( QPainter& p)
+void DrumPatternEditor::__create_background()
 {
 	static const UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
 	static const QColor backgroundColor( pStyle->m_patternEditor_backgroundColor.getRed(), pStyle->m_patternEditor_backgroundColor.getGreen(), pStyle->m_patternEditor_backgroundColor.getBlue() );
 	static const QColor alternateRowColor( pStyle->m_patternEditor_alternateRowColor.getRed(), pStyle->m_patternEditor_alternateRowColor.getGreen(), pStyle->m_patternEditor_alternateRowColor.getBlue() );
+	static const QColor selectedRowColor( pStyle->m_patternEditor_selectedRowColor.getRed(), pStyle->m_patternEditor_selectedRowColor.getGreen(), pStyle->m_patternEditor_selectedRowColor.getBlue() );
 	static const QColor lineColor( pStyle->m_patternEditor_lineColor.getRed(), pStyle->m_patternEditor_lineColor.getGreen(), pStyle->m_patternEditor_lineColor.getBlue() );
 
+	if ( m_pBackground->size() != size() ) {
+		delete m_pBackground;
+		delete m_pPatternPixmap;
+		m_pBackground = new QPixmap( width(), height() );
+		m_pPatternPixmap = new QPixmap( width(), height() );
+	}
+
 	int nNotes = MAX_NOTES;
 	if ( m_pPattern ) {
 		nNotes = m_pPattern->get_length();
 	}
 
+	int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
 	Song *pSong = Hydrogen::get_instance()->getSong();
 	int nInstruments = pSong->get_instrument_list()->size();
 
-	if ( m_nEditorHeight != (int)( m_nGridHeight * nInstruments ) ) {
-		// the number of instruments is changed...recreate all
-		m_nEditorHeight = m_nGridHeight * nInstruments;
-		resize( width(), m_nEditorHeight );
-	}
+	m_bBackgroundChanged = false;
+	m_nBackgroundSelectedInstrument = nSelectedInstrument;
+
+	m_pBackground->fill( backgroundColor );
 
-	p.fillRect(0, 0, 20 + nNotes * m_nGridWidth, height(), backgroundColor);
+	QPainter p( m_pBackground );
 	for ( uint i = 0; i < (uint)nInstruments; i++ ) {
 		uint y = m_nGridHeight * i;
 		if ( ( i % 2) != 0) {
@@ -773,21 +788,104 @@ void DrumPatternEditor::__create_background( QPainter& p)
 	}
 
 	p.drawLine( 0, m_nEditorHeight, (20 + nNotes * m_nGridWidth), m_nEditorHeight );
+
+	if ( m_pPattern == NULL ) {
+		return;
+	}
+
+	if ( nSelectedInstrument >= 0 && nSelectedInstrument < nInstruments ) {
+		uint y = m_nGridHeight * nSelectedInstrument;
+		p.fillRect( 0, y + 1, ( 20 + nNotes * m_nGridWidth ), m_nGridHeight - 1, selectedRowColor );
+	}
+
+	// draw the grid
+	__draw_grid( p );
 }
 
 
 
-void DrumPatternEditor::paintEvent( QPaintEvent* /*ev*/ )
+QRect DrumPatternEditor::__tick_rect( int nTick )
 {
-	//INFOLOG( "paint" );
-	//QWidget::paintEvent(ev);
+	int x = 20 + nTick * m_nGridWidth;
+	return QRect( x - 1, 0, 3, height() );
+}
 
-	QPainter painter( this );
-	__draw_pattern( painter );
+
+
+void DrumPatternEditor::setTickPosition( int nTick )
+{
+	if ( nTick == m_nTickPosition ) {
+		return;
+	}
+	if ( m_nTickPosition != -1 ) {
+		update( __tick_rect( m_nTickPosition ) );
+	}
+	m_nTickPosition = nTick;
+	if ( m_nTickPosition != -1 ) {
+		update( __tick_rect( m_nTickPosition ) );
+	}
 }
 
 
 
+void DrumPatternEditor::paintEvent( QPaintEvent *ev )
+{
+	static const UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
+	static const QColor tickColor( pStyle->m_patternEditor_textColor.getRed(), pStyle->m_patternEditor_textColor.getGreen(), pStyle->m_patternEditor_textColor.getBlue() );
+
+	/*
+		BUGFIX
+
+		if m_pPattern is not renewed every time we draw a note,
+		hydrogen will crash after you save a song and create a new one.
+		-smoors
+	*/
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	PatternList *pPatternList = pEngine->getSong()->get_pattern_list();
+	int nSelectedPatternNumber = pEngine->getSelectedPatternNumber();
+	if ( (nSelectedPatternNumber != -1) && ( (uint)nSelectedPatternNumber < pPatternList->size() ) ) {
+		m_pPattern = pPatternList->get( nSelectedPatternNumber );
+	}
+	else {
+		m_pPattern = NULL;
+	}
+	// ~ FIX
+
+	int nInstruments = pEngine->getSong()->get_instrument_list()->size();
+	if ( m_nEditorHeight != (int)( m_nGridHeight * nInstruments ) ) {
+		// the number of instruments is changed...recreate all
+		m_nEditorHeight = m_nGridHeight * nInstruments;
+		resize( width(), m_nEditorHeight );
+		m_bBackgroundChanged = true;
+	}
+
+	if ( m_bBackgroundChanged
+		 || m_pBackground->size() != size()
+		 || m_nBackgroundSelectedInstrument != pEngine->getSelectedInstrumentNumber() ) {
+		__create_background();
+		m_bPatternChanged = true;
+	}
+
+	if ( m_bPatternChanged ) {
+		__draw_pattern( m_pPatternPixmap->rect() );
+		m_bPatternChanged = false;
+		m_dirtyRect = QRect();
+	}
+	else if ( !m_dirtyRect.isNull() ) {
+		__draw_pattern( m_dirtyRect.intersected( m_pPatternPixmap->rect() ) );
+		m_dirtyRect = QRect();
+	}
+
+	QPainter painter( this );
+	painter.drawPixmap( ev->rect(), *m_pPatternPixmap, ev->rect() );
+
+	// the playhead is drawn over the cached notes, moving it never redraws them
+	if ( m_nTickPosition != -1 && ev->rect().intersects( __tick_rect( m_nTickPosition ) ) ) {
+		int x = 20 + m_nTickPosition * m_nGridWidth;
+		painter.setPen( QPen( tickColor, 1 ) );
+		painter.drawLine( x, 0, x, m_nEditorHeight );
+	}
+}
 
 
 
@@ -812,7 +910,7 @@ void DrumPatternEditor::setResolution(uint res, bool bUseTriplets)
 	this->m_bUseTriplets = bUseTriplets;
 
 	// redraw all
-	update( 0, 0, width(), height() );
+	__invalidate_background();
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 	m_pPatternEditorPanel->getPanEditor()->updateEditor();
 	m_pPatternEditorPanel->getLeadLagEditor()->updateEditor();
@@ -849,13 +947,14 @@ void DrumPatternEditor::zoom_out()
 
 void DrumPatternEditor::selectedInstrumentChangedEvent()
 {
-	update( 0, 0, width(), height() );
+	__invalidate_background();
 }
 
 
 /// This method is called from another thread (audio engine)
 void DrumPatternEditor::patternModifiedEvent()
 {
+	m_bPatternChanged = true;
 	update( 0, 0, width(), height() );
 }
 
@@ -983,7 +1082,7 @@ void DrumPatternEditor::functionPasteNotesUndoAction(std::list<H2Core::Pattern*>
 	Hydrogen * H = Hydrogen::get_instance();
 	PatternList *patternList = H->getSong()->get_pattern_list();
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
 
 	while (appliedList.size() > 0)
 	{
@@ -996,6 +1095,7 @@ void DrumPatternEditor::functionPasteNotesUndoAction(std::list<H2Core::Pattern*>
 
 		if (pat != NULL)
 		{
+			AudioEngine::get_instance()->mark_edited( pat );
 			// Remove all notes of applied pattern from destination pattern
 			const Pattern::notes_t* notes = pApplied->get_notes();
 			FOREACH_NOTE_CST_IT_BEGIN_END(notes, it)
@@ -1025,7 +1125,7 @@ void DrumPatternEditor::functionPasteNotesUndoAction(std::list<H2Core::Pattern*>
 		appliedList.pop_front();
 	}
 
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	AudioEngine::get_instance()->unlock_edit();	// publish the changes
 
 	// Update editors
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
@@ -1042,7 +1142,7 @@ void DrumPatternEditor::functionPasteNotesRedoAction(std::list<H2Core::Pattern*>
 	Hydrogen * H = Hydrogen::get_instance();
 	PatternList *patternList = H->getSong()->get_pattern_list();
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
 
 	// Add notes to pattern
 	std::list < H2Core::Pattern *>::iterator pos;
@@ -1055,6 +1155,7 @@ void DrumPatternEditor::functionPasteNotesRedoAction(std::list<H2Core::Pattern*>
 
 		if (pat != NULL)
 		{
+			AudioEngine::get_instance()->mark_edited( pat );
 			// Create applied pattern
 			Pattern *pApplied = new Pattern(
 					pat->get_name(),
@@ -1096,7 +1197,7 @@ void DrumPatternEditor::functionPasteNotesRedoAction(std::list<H2Core::Pattern*>
 			appliedList.push_back(pApplied);
 		}
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	AudioEngine::get_instance()->unlock_edit();	// publish the changes
 
 	// Update editors
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
@@ -1117,7 +1218,8 @@ void DrumPatternEditor::functionFillNotesUndoAction( QStringList noteList, int n
 	Pattern *pPattern = pPatternList->get( patternNumber );
 	Instrument *pSelectedInstrument = H->getSong()->get_instrument_list()->get( nSelectedInstrument );
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+	AudioEngine::get_instance()->mark_edited( pPattern );
 
 	for (int i = 0; i < noteList.size(); i++ ) {
 		int nColumn  = noteList.value(i).toInt();
@@ -1133,7 +1235,7 @@ void DrumPatternEditor::functionFillNotesUndoAction( QStringList noteList, int n
 			}
 		}
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	AudioEngine::get_instance()->unlock_edit();	// publish the changes
 
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 	updateEditor();
@@ -1158,7 +1260,8 @@ void DrumPatternEditor::functionFillNotesRedoAction( QStringList noteList, int n
 	const float fPitch = 0.0f;
 	const int nLength = -1;
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+	AudioEngine::get_instance()->mark_edited( pPattern );
 	for (int i = 0; i < noteList.size(); i++ ) {
 
 		// create the new note
@@ -1166,7 +1269,7 @@ void DrumPatternEditor::functionFillNotesRedoAction( QStringList noteList, int n
 		Note *pNote = new Note( pSelectedInstrument, position, velocity, pan_L, pan_R, nLength, fPitch );
 		pPattern->insert_note( pNote );
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	AudioEngine::get_instance()->unlock_edit();	// publish the changes
 
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 	updateEditor();
@@ -1186,7 +1289,8 @@ void DrumPatternEditor::functionRandomVelocityAction( QStringList noteVeloValue,
 	Instrument *pSelectedInstrument = H->getSong()->get_instrument_list()->get( nSelectedInstrument );
 
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+	AudioEngine::get_instance()->mark_edited( pPattern );
 
 	int nBase;
 	if ( isUsingTriplets() ) {
@@ -1209,7 +1313,7 @@ void DrumPatternEditor::functionRandomVelocityAction( QStringList noteVeloValue,
 			}
 		}
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	AudioEngine::get_instance()->unlock_edit();	// publish the changes
 
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 	updateEditor();
@@ -1443,7 +1547,7 @@ void DrumPatternEditor::functionDeleteInstrumentUndoAction( std::list< H2Core::N
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 
 	//restore all deleted instrument notes
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
 	if(noteList.size() > 0 ){
 		std::list < H2Core::Note *>::const_iterator pos;
 		for ( pos = noteList.begin(); pos != noteList.end(); ++pos){
@@ -1452,10 +1556,11 @@ void DrumPatternEditor::functionDeleteInstrumentUndoAction( std::list< H2Core::N
 			pPattern = pPatternList->get( pNote->get_pattern_idx() );
 			assert (pPattern);
 			pPattern->insert_note( pNote );
+			AudioEngine::get_instance()->mark_edited( pPattern );
 			//delete pNote;
 		}
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
+	AudioEngine::get_instance()->unlock_edit();	// publish the changes
 }
 
 void DrumPatternEditor::functionAddEmptyInstrumentUndo()
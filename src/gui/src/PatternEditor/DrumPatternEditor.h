@@ -62,6 +62,12 @@ class DrumPatternEditor : public QWidget, public EventListener, public H2Core::O
 
 		static QColor computeNoteColor( float );
 
+		/**
+		 * move the playhead, only the columns it leaves and enters are repainted
+		 * \param nTick the tick position, -1 hides the playhead
+		 */
+		void setTickPosition( int nTick );
+
 		// Implements EventListener interface
 		virtual void patternModifiedEvent();
 		virtual void patternChangedEvent();
@@ -126,10 +132,26 @@ class DrumPatternEditor : public QWidget, public EventListener, public H2Core::O
 
 		PatternEditorPanel *m_pPatternEditorPanel;
 
-		void __draw_note( H2Core::Note* note, QPainter& painter );
-		void __draw_pattern( QPainter& painter );
+		QPixmap *m_pBackground;				///< background, grid and selected row
+		QPixmap *m_pPatternPixmap;			///< background with the notes on top
+		bool m_bBackgroundChanged;			///< zoom or resolution changed, rebuild the background
+		bool m_bPatternChanged;				///< redraw all the notes
+		QRect m_dirtyRect;					///< notes to redraw on the next paint
+		int m_nBackgroundSelectedInstrument;	///< selected row the background was drawn with
+		int m_nTickPosition;				///< playhead, -1 if hidden
+
+		void __draw_note( H2Core::Note* note, int nRow, QPainter& painter );
+		void __draw_pattern( const QRect& rect );
 		void __draw_grid( QPainter& painter );
-		void __create_background( QPainter& pointer );
+		void __create_background();
+		/** area covered by a note, nRow is the row of its instrument */
+		QRect __note_rect( H2Core::Note* note, int nRow );
+		/** schedule a redraw of the area covered by a note */
+		void __invalidate_note( H2Core::Note* note );
+		/** schedule a rebuild of the background and a redraw of all the notes */
+		void __invalidate_background();
+		/** area covered by the playhead at a given tick */
+		QRect __tick_rect( int nTick );
 
 		virtual void mousePressEvent(QMouseEvent *ev);
 		virtual void mouseReleaseEvent(QMouseEvent *ev);
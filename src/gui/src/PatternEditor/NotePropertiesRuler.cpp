@@ -22,6 +22,7 @@
 
 #include <hydrogen/Preferences.h>
 #include <hydrogen/hydrogen.h>
+#include <hydrogen/audio_engine.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/pattern.h>
@@ -127,6 +128,8 @@ void NotePropertiesRuler::wheelEvent(QWheelEvent *ev )
 	int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
 	Song *pSong = (Hydrogen::get_instance())->getSong();
 
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( m_pPattern );
 	const Pattern::notes_t* notes = m_pPattern->get_notes();
 	FOREACH_NOTE_CST_IT_BOUND(notes,it,column) {
 		Note *pNote = it->second;
@@ -211,6 +214,7 @@ void NotePropertiesRuler::wheelEvent(QWheelEvent *ev )
 		updateEditor();
 		break;
 	}
+	AudioEngine::get_instance()->unlock_edit();
 }
 
 
@@ -349,6 +353,8 @@ void NotePropertiesRuler::pressAction( int x, int y)
 		int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
 		Song *pSong = (Hydrogen::get_instance())->getSong();
 
+		AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+		AudioEngine::get_instance()->mark_edited( m_pPattern );
 		const Pattern::notes_t* notes = m_pPattern->get_notes();
 		FOREACH_NOTE_CST_IT_BOUND(notes,it,column) {
 			Note *pNote = it->second;
@@ -450,6 +456,7 @@ void NotePropertiesRuler::pressAction( int x, int y)
 			if( columnChange ){
 				__columnCheckOnXmouseMouve = column;
 				startUndoAction();
+				AudioEngine::get_instance()->unlock_edit();
 				return;
 			}
 				
@@ -459,6 +466,7 @@ void NotePropertiesRuler::pressAction( int x, int y)
 			updateEditor();
 			break;
 		}
+		AudioEngine::get_instance()->unlock_edit();
 		m_pPatternEditorPanel->getPianoRollEditor()->updateEditor();
 		pPatternEditor->updateEditor();
 	}
@@ -807,7 +807,9 @@ void PatternEditorPanel::patternSizeChanged( int nSelected )
 		return;
 	}
 
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
 	m_pPattern->set_length( nEighth * ( nSelected + 1 ) );
+	AudioEngine::get_instance()->unlock_edit();
 
 	m_pPatternEditorRuler->updateEditor( true );	// redraw all
 	m_pNoteVelocityEditor->updateEditor();
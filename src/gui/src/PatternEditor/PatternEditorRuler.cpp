@@ -32,6 +32,7 @@ using namespace H2Core;
 
 #include "PatternEditorRuler.h"
 #include "PatternEditorPanel.h"
+#include "DrumPatternEditor.h"
 #include "../HydrogenApp.h"
 #include "../Skin.h"
 
@@ -146,6 +147,10 @@ void PatternEditorRuler::updateEditor( bool bRedrawAll )
 	if (oldNTicks != m_nTicks) {
 		// redraw all
 		bRedrawAll = true;
+		PatternEditorPanel *pPanel = HydrogenApp::get_instance()->getPatternEditorPanel();
+		if ( pPanel ) {
+			pPanel->getDrumPatternEditor()->setTickPosition( m_nTicks );
+		}
 	}
 	oldNTicks = m_nTicks;
 
@@ -647,7 +647,9 @@ void PianoRollEditor::addOrDeleteNoteAction( int nColumn,
 	m_bRightBtnPressed = false;
 
 	bool bNoteAlreadyExist = false;
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+	Note *pPreviewNote = NULL;
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+	AudioEngine::get_instance()->mark_edited( pPattern );
 	Note* note = m_pPattern->find_note( nColumn, -1, pSelectedInstrument, pressednotekey, pressedoctave );
 	if( note ) {
 		// the note exists...remove it!
@@ -683,13 +685,16 @@ void PianoRollEditor::addOrDeleteNoteAction( int nColumn,
 		// hear note
 		Preferences *pref = Preferences::get_instance();
 		if ( pref->getHearNewNotes() && !noteOff ) {
-			Note *pNote2 = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
-			pNote2->set_key_octave( pressednotekey, pressedoctave );
-			AudioEngine::get_instance()->get_sampler()->note_on(pNote2);
+			pPreviewNote = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
+			pPreviewNote->set_key_octave( pressednotekey, pressedoctave );
 		}
 	}
 	pSong->set_is_modified( true );
-	AudioEngine::get_instance()->unlock(); // unlock the audio engine
+	AudioEngine::get_instance()->unlock_edit(); // publish the changes
+
+	if ( pPreviewNote ) {
+		AudioEngine::get_instance()->get_sampler()->queue_note_on( pPreviewNote );
+	}
 
 	updateEditor();
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
@@ -718,7 +723,8 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 		if ( m_pDraggedNote->get_note_off() ) return;
 		int nTickColumn = getColumn( ev );
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+		AudioEngine::get_instance()->mark_edited( m_pPattern );
 		int nLen = nTickColumn - (int)m_pDraggedNote->get_position();
 
 		if (nLen <= 0) {
@@ -735,7 +741,7 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 		m_pDraggedNote->set_length( nLen * fStep);
 
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_edit(); // publish the changes
 
 		//__draw_pattern();
 		updateEditor();
@@ -751,7 +757,8 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 	if (m_bRightBtnPressed && m_pDraggedNote && selectedProperty == 0 ) { // Velocity
 		if ( m_pDraggedNote->get_note_off() ) return;
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+		AudioEngine::get_instance()->mark_edited( m_pPattern );
 
 		float val = m_pDraggedNote->get_velocity();
 
@@ -770,7 +777,7 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 		__velocity = val;
 
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_edit(); // publish the changes
 
 		//__draw_pattern();
 		updateEditor();
@@ -785,7 +792,8 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 	if (m_bRightBtnPressed && m_pDraggedNote && selectedProperty == 1 ) { // Pan
 		if ( m_pDraggedNote->get_note_off() ) return;
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+		AudioEngine::get_instance()->mark_edited( m_pPattern );
 
 		float pan_L, pan_R;
 		
@@ -811,7 +819,7 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 		__pan_R = pan_R;
 
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_edit(); // publish the changes
 
 		//__draw_pattern();
 		updateEditor();
@@ -826,7 +834,8 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 	if (m_bRightBtnPressed && m_pDraggedNote && selectedProperty ==  2 ) { // Lead and Lag
 		if ( m_pDraggedNote->get_note_off() ) return;
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
+		AudioEngine::get_instance()->lock_edit( RIGHT_HERE );	// lock the editors
+		AudioEngine::get_instance()->mark_edited( m_pPattern );
 
 		
 		float val = ( m_pDraggedNote->get_lead_lag() - 1.0 ) / -2.0 ;
@@ -857,7 +866,7 @@ void PianoRollEditor::mouseMoveEvent(QMouseEvent *ev)
 		}
 
 		Hydrogen::get_instance()->getSong()->set_is_modified( true );
-		AudioEngine::get_instance()->unlock(); // unlock the audio engine
+		AudioEngine::get_instance()->unlock_edit(); // publish the changes
 
 		//__draw_pattern();
 		updateEditor();
@@ -940,12 +949,13 @@ void PianoRollEditor::editNoteLengthAction( int nColumn,  int nRealColumn,  int
 	}
 
 	Note* pDraggedNote = 0;
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( m_pPattern );
 	pDraggedNote = m_pPattern->find_note( nColumn, nRealColumn, pSelectedInstrument, pressednotekey, pressedoctave, false );
 	if ( pDraggedNote ){
 		pDraggedNote->set_length( length );
 	}
-	AudioEngine::get_instance()->unlock();
+	AudioEngine::get_instance()->unlock_edit();
 	updateEditor();
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 	m_pPatternEditorPanel->getPanEditor()->updateEditor();
@@ -995,7 +1005,8 @@ void PianoRollEditor::editNotePropertiesAction( int nColumn,
 	Instrument *pSelectedInstrument = pSong->get_instrument_list()->get( selectedInstrumentnumber );
 
 	Note* pDraggedNote = 0;
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( m_pPattern );
 	pDraggedNote = m_pPattern->find_note( nColumn, nRealColumn, pSelectedInstrument, pressednotekey, pressedoctave, false );
 	if ( pDraggedNote ){
 		pDraggedNote->set_velocity( velocity );
@@ -1003,7 +1014,7 @@ void PianoRollEditor::editNotePropertiesAction( int nColumn,
 		pDraggedNote->set_pan_r( pan_R );
 		pDraggedNote->set_lead_lag( leadLag );
 	}
-	AudioEngine::get_instance()->unlock();
+	AudioEngine::get_instance()->unlock_edit();
 	updateEditor();
 	m_pPatternEditorPanel->getVelocityEditor()->updateEditor();
 	m_pPatternEditorPanel->getPanEditor()->updateEditor();
@@ -142,6 +142,8 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 
 
 	bufferSizeSpinBox->setValue( pPref->m_nBufferSize );
+	latencyModeComboBox->setCurrentIndex( pPref->m_nPulseAudioLatencyMode );
+	latencySpinBox->setValue( pPref->m_nPulseAudioLatency );
 	switch ( pPref->m_nSampleRate ) {
 	case 44100:
 		sampleRateComboBox->setCurrentIndex( 0 );
@@ -348,10 +350,12 @@ void PreferencesDialog::on_okBtn_clicked()
 	else if (driverComboBox->currentText() == "Alsa" ) {
 		pPref->m_sAudioDriver = "Alsa";
 		pPref->m_sAlsaAudioDevice = m_pAudioDeviceTxt->text();
+		pPref->m_nAlsaPeriods = periodsSpinBox->value();
 	}
 	else if (driverComboBox->currentText() == "Oss" ) {
 		pPref->m_sAudioDriver = "Oss";
 		pPref->m_sOSSDevice = m_pAudioDeviceTxt->text();
+		pPref->m_nOSSFragments = periodsSpinBox->value();
 	}
 	else if (driverComboBox->currentText() == "PortAudio" ) {
 		pPref->m_sAudioDriver = "PortAudio";
@@ -383,6 +387,8 @@ void PreferencesDialog::on_okBtn_clicked()
 	//~ JACK
 
 	pPref->m_nBufferSize = bufferSizeSpinBox->value();
+	pPref->m_nPulseAudioLatencyMode = latencyModeComboBox->currentIndex();
+	pPref->m_nPulseAudioLatency = latencySpinBox->value();
 	if ( sampleRateComboBox->currentText() == "44100" ) {
 		pPref->m_nSampleRate = 44100;
 	}
@@ -569,13 +575,14 @@ void PreferencesDialog::updateDriverInfo()
 		trackOutputComboBox->setEnabled( false );
 		connectDefaultsCheckBox->setEnabled( false );
 	}
-	else if ( driverComboBox->currentText() == "OSS" ) {	// OSS
+	else if ( driverComboBox->currentText() == "Oss" ) {	// OSS
 		info += trUtf8("<b>Open Sound System</b><br>Simple audio driver [/dev/dsp]");
 		if ( !bOss_support ) {
 			info += trUtf8("<br><b><font color=\"red\">Not compiled</font></b>");
 		}
 		m_pAudioDeviceTxt->setEnabled(true);
 		m_pAudioDeviceTxt->setText( pPref->m_sOSSDevice );
+		periodsSpinBox->setValue( pPref->m_nOSSFragments );
 		bufferSizeSpinBox->setEnabled(true);
 		sampleRateComboBox->setEnabled(true);
 		trackOutputComboBox->setEnabled( false );
@@ -602,6 +609,7 @@ void PreferencesDialog::updateDriverInfo()
 		}
 		m_pAudioDeviceTxt->setEnabled(true);
 		m_pAudioDeviceTxt->setText( pPref->m_sAlsaAudioDevice );
+		periodsSpinBox->setValue( pPref->m_nAlsaPeriods );
 		bufferSizeSpinBox->setEnabled(true);
 		sampleRateComboBox->setEnabled(true);
 		trackOutputComboBox->setEnabled( false );
@@ -653,6 +661,10 @@ void PreferencesDialog::updateDriverInfo()
 
 	metronomeVolumeSpinBox->setEnabled(true);
 	bufferSizeSpinBox->setValue( pPref->m_nBufferSize );
+	// the buffer size is the period size, ALSA and OSS let choose the number of periods
+	periodsSpinBox->setEnabled( driverComboBox->currentText() == "Alsa" || driverComboBox->currentText() == "Oss" );
+	latencyModeComboBox->setEnabled( driverComboBox->currentText() == "PulseAudio" );
+	latencySpinBox->setEnabled( driverComboBox->currentText() == "PulseAudio" );
 
 	driverInfoLbl->setText(info);
 }
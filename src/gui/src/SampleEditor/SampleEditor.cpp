@@ -522,7 +522,7 @@ void SampleEditor::on_PlayPushButton_clicked()
 
 	Note *pNote = new Note( pInstr, 0, pInstr->get_component( m_pSelectedComponent )->get_layer( selectedLayer )->get_end_velocity() - 0.01, pan_L, pan_R, nLength, fPitch);
 	pNote->set_specific_compo_id( m_pSelectedComponent );
-	AudioEngine::get_instance()->get_sampler()->note_on(pNote);
+	AudioEngine::get_instance()->get_sampler()->queue_note_on(pNote);
 
 	setSamplelengthFrames();
 	createPositionsRulerPath();
@@ -22,6 +22,7 @@
 
 #include <assert.h>
 #include <algorithm>
+#include <set>
 #include <memory>
 
 #include <hydrogen/basics/song.h>
@@ -68,11 +69,104 @@ using namespace std;
 const char* SongEditor::__class_name = "SongEditor";
 
 
-SongEditorGridRepresentationItem::SongEditorGridRepresentationItem(int x, int y, bool value)
+SongEditorGridModel::SongEditorGridModel()
+ : m_nRows( 0 )
 {
-	this->x = x;
-	this->y = y;
-	this->value = value;
+}
+
+
+
+void SongEditorGridModel::rebuild( Song *pSong )
+{
+	PatternList *pPatternList = pSong->get_pattern_list();
+	vector<PatternList*>* pColumns = pSong->get_pattern_group_vector();
+
+	m_nRows = pPatternList->size();
+	m_patternRows.clear();
+	for ( int nRow = 0; nRow < m_nRows; nRow++ ) {
+		m_patternRows.insert( pPatternList->get( nRow ), nRow );
+	}
+
+	m_columns.clear();
+	resize( pColumns->size() );
+	for ( uint nColumn = 0; nColumn < pColumns->size(); nColumn++ ) {
+		rebuildColumn( pSong, nColumn );
+	}
+}
+
+
+
+void SongEditorGridModel::rebuildColumn( Song *pSong, int nColumn )
+{
+	vector<PatternList*>* pColumns = pSong->get_pattern_group_vector();
+
+	resize( nColumn + 1 );
+	std::vector<unsigned char>& cells = m_columns[ nColumn ];
+	std::fill( cells.begin(), cells.end(), CELL_EMPTY );
+
+	if ( nColumn >= (int)pColumns->size() ) {
+		return;
+	}
+
+	PatternList *pColumn = ( *pColumns )[ nColumn ];
+	for ( uint nPat = 0; nPat < pColumn->size(); ++nPat ) {
+		H2Core::Pattern *pPattern = pColumn->get( nPat );
+		int nRow = m_patternRows.value( pPattern, -1 );
+		if ( nRow != -1 ) {
+			cells[ nRow ] |= CELL_PATTERN;
+		}
+
+		const Pattern::virtual_patterns_t* pVirtuals = pPattern->get_flattened_virtual_patterns();
+		for ( Pattern::virtual_patterns_cst_it_t it = pVirtuals->begin(); it != pVirtuals->end(); ++it ) {
+			int nVirtualRow = m_patternRows.value( *it, -1 );
+			if ( nVirtualRow != -1 ) {
+				cells[ nVirtualRow ] |= CELL_VIRTUAL;
+			}
+		}
+	}
+}
+
+
+
+bool SongEditorGridModel::setPattern( Song *pSong, int nColumn, int nRow, bool bActive )
+{
+	if ( nRow < 0 || nRow >= m_nRows || nColumn < 0 ) {
+		return false;
+	}
+
+	H2Core::Pattern *pPattern = pSong->get_pattern_list()->get( nRow );
+	if ( !pPattern->get_flattened_virtual_patterns()->empty() ) {
+		// the virtual patterns of the column depend on all its patterns
+		rebuildColumn( pSong, nColumn );
+		return true;
+	}
+
+	resize( nColumn + 1 );
+	if ( bActive ) {
+		m_columns[ nColumn ][ nRow ] |= CELL_PATTERN;
+	} else {
+		m_columns[ nColumn ][ nRow ] &= ~CELL_PATTERN;
+	}
+	return false;
+}
+
+
+
+int SongEditorGridModel::get( int nColumn, int nRow ) const
+{
+	if ( nColumn < 0 || nColumn >= (int)m_columns.size() || nRow < 0 || nRow >= m_nRows ) {
+		return CELL_EMPTY;
+	}
+	return m_columns[ nColumn ][ nRow ];
+}
+
+
+
+void SongEditorGridModel::resize( int nColumns )
+{
+	if ( nColumns > (int)m_columns.size() ) {
+		m_columns.resize( nColumns, std::vector<unsigned char>( m_nRows, CELL_EMPTY ) );
+	}
 }
 
 
@@ -134,18 +228,21 @@ void SongEditor::keyPressEvent ( QKeyEvent * ev )
 
 	if ( ev->key() == Qt::Key_Delete ) {
 		if ( m_selectedCells.size() != 0 ) {
-			AudioEngine::get_instance()->lock( RIGHT_HERE );
+			AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+			AudioEngine::get_instance()->mark_edited( NULL );	// only the sequence changes
 			// delete all selected cells
 			for ( uint i = 0; i < m_selectedCells.size(); i++ ) {
 				QPoint cell = m_selectedCells[ i ];
 				PatternList* pColumn = (*pColumns)[ cell.x() ];
 				pColumn->del(pPatternList->get( cell.y() ) );
 			}
-			AudioEngine::get_instance()->unlock();
+			AudioEngine::get_instance()->unlock_edit();
 
-			m_selectedCells.clear();
-			m_bSequenceChanged = true;
-			update();
+			std::vector<QPoint> deletedCells;
+			deletedCells.swap( m_selectedCells );
+			for ( uint i = 0; i < deletedCells.size(); i++ ) {
+				setPatternCell( deletedCells[ i ].x(), deletedCells[ i ].y(), false );
+			}
 		}
 		return;
 	}
@@ -183,7 +280,9 @@ void SongEditor::mousePressEvent( QMouseEvent *ev )
 
 	SongEditorActionMode actionMode = HydrogenApp::get_instance()->getSongEditorPanel()->getActionMode();
 	if ( actionMode == SELECT_ACTION ) {
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		updateCells( m_selectedCells );
+		AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+		AudioEngine::get_instance()->mark_edited( NULL );
 		bool bOverExistingPattern = false;
 		for ( uint i = 0; i < m_selectedCells.size(); i++ ) {
 			QPoint cell = m_selectedCells[ i ];
@@ -212,10 +311,10 @@ void SongEditor::mousePressEvent( QMouseEvent *ev )
 			m_selectedCells.clear();
 			m_selectedCells.push_back( QPoint( nColumn, nRow ) );
 		}
-		AudioEngine::get_instance()->unlock();
+		AudioEngine::get_instance()->unlock_edit();
 		// update
-		m_bSequenceChanged = true;
-		update();
+		updateCells( m_selectedCells );
+		updateCells( m_movingCells );
 	}
 	else if ( actionMode == DRAW_ACTION ) {
 		H2Core::Pattern *pPattern = pPatternList->get( nRow );
@@ -261,7 +360,10 @@ void SongEditor::addPattern( int nColumn , int nRow )
 	H2Core::Pattern *pPattern = pPatternList->get( nRow );
 	vector<PatternList*> *pColumns = pSong->get_pattern_group_vector();
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	updateCells( m_selectedCells );
+
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( NULL );	// only the sequence changes
 	if ( nColumn < (int)pColumns->size() ) {
 		PatternList *pColumn = ( *pColumns )[ nColumn ];
 		// ADD PATTERN
@@ -283,9 +385,8 @@ void SongEditor::addPattern( int nColumn , int nRow )
 		pColumn->add( pPattern );
 	}
 	pSong->set_is_modified( true );
-	AudioEngine::get_instance()->unlock();
-	m_bSequenceChanged = true;
-	update();
+	AudioEngine::get_instance()->unlock_edit();
+	setPatternCell( nColumn, nRow, true );
 }
 
 
@@ -297,7 +398,8 @@ void SongEditor::deletePattern( int nColumn , int nRow, unsigned nColumnIndex )
 	H2Core::Pattern *pPattern = pPatternList->get( nRow );
 	vector<PatternList*> *pColumns = pSong->get_pattern_group_vector();
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( NULL );	// only the sequence changes
 
 	PatternList *pColumn = ( *pColumns )[ nColumn ];
 	pColumn->del( nColumnIndex );
@@ -314,9 +416,8 @@ void SongEditor::deletePattern( int nColumn , int nRow, unsigned nColumnIndex )
 		}
 	}
 	pSong->set_is_modified( true );
-	AudioEngine::get_instance()->unlock();
-	m_bSequenceChanged = true;
-	update();
+	AudioEngine::get_instance()->unlock_edit();
+	setPatternCell( nColumn, nRow, false );
 }
 
 
@@ -335,14 +436,12 @@ void SongEditor::mouseMoveEvent(QMouseEvent *ev)
 //		INFOLOG( "[mouseMoveEvent] row diff: "+ to_string( nRowDiff ) );
 //		INFOLOG( "[mouseMoveEvent] col diff: "+ to_string( nColumnDiff ) );
 
+		updateCells( m_movingCells );
 		for ( int i = 0; i < (int)m_movingCells.size(); i++ ) {
-			QPoint cell = m_movingCells[ i ];
 			m_movingCells[ i ].setX( m_selectedCells[ i ].x() + nColumnDiff );
 			m_movingCells[ i ].setY( m_selectedCells[ i ].y() + nRowDiff );
 		}
-
-		m_bSequenceChanged = true;
-		update();
+		updateCells( m_movingCells );
 		return;
 	}
 
@@ -357,9 +456,12 @@ void SongEditor::mouseMoveEvent(QMouseEvent *ev)
 		if ( y < 0 ) {
 			y = 0;
 		}
+		update( m_lasso.normalized().adjusted( -1, -1, 1, 1 ) );
 		m_lasso.setBottomRight( QPoint( x, y ) );
+		update( m_lasso.normalized().adjusted( -1, -1, 1, 1 ) );
 
 		// aggiorno la lista di celle selezionate
+		updateCells( m_selectedCells );
 		m_selectedCells.clear();
 
 		int nStartColumn = (int)( ( m_lasso.left() - 10.0 ) / m_nGridWidth );
@@ -391,14 +493,12 @@ void SongEditor::mouseMoveEvent(QMouseEvent *ev)
 					for ( uint i = 0; i < pColumn->size(); i++) {
 						if ( pColumn->get(i) == pPattern ) { // esiste un pattern in questa posizione
 							m_selectedCells.push_back( QPoint( nCol, nRow ) );
+							updateCell( nCol, nRow );
 						}
 					}
 				}
 			}
 		}
-
-		m_bSequenceChanged = true;
-		update();
 	}
 
 }
@@ -424,21 +524,13 @@ void SongEditor::mouseReleaseEvent( QMouseEvent *ev )
 		 * before the first move operation.
 		 */
 
-		SongEditorGridRepresentationItem* item;
 		m_existingCells.clear();
 		for ( uint i = 0; i < m_movingCells.size(); i++ )
 		{
 			QPoint cell = m_movingCells[ i ];
 
-			//looking for cell identified with (cell.x/cell.y) in the gridRepresentation
-			bool found = false;
-			foreach(item, gridRepresentation)
-			{
-				if(item->x == cell.x() && item->y == cell.y())
-				{
-					found = true;
-				}
-			}
+			//looking for cell identified with (cell.x/cell.y) in the grid model
+			bool found = m_gridModel.get( cell.x(), cell.y() ) != SongEditorGridModel::CELL_EMPTY;
 
 			if( found ){
 				m_existingCells.push_back(cell);
@@ -451,10 +543,11 @@ void SongEditor::mouseReleaseEvent( QMouseEvent *ev )
 
 	setCursor( QCursor( Qt::ArrowCursor ) );
 
+	if ( m_bShowLasso ) {
+		update( m_lasso.normalized().adjusted( -1, -1, 1, 1 ) );
+	}
 	m_bShowLasso = false;
-	m_bSequenceChanged = true;
 	m_bIsCtrlPressed = false;
-	update();
 }
 
 /**
@@ -473,7 +566,8 @@ void SongEditor::movePatternCellAction( std::vector<QPoint> movingCells, std::ve
 	PatternList *pPatternList = pEngine->getSong()->get_pattern_list();
 	vector<PatternList*>* pColumns = pEngine->getSong()->get_pattern_group_vector();
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( NULL );	// only the sequence changes
 
 	//create the new patterns
 	for ( uint i = 0; i < movingCells.size(); i++ ) {
@@ -596,13 +690,33 @@ void SongEditor::movePatternCellAction( std::vector<QPoint> movingCells, std::ve
 	}
 
 	pEngine->getSong()->set_is_modified( true );
-	AudioEngine::get_instance()->unlock();
+	AudioEngine::get_instance()->unlock_edit();
+
+	// only the columns touched by the move change
+	std::set<int> columns;
+	for ( uint i = 0; i < movingCells.size(); i++ ) {
+		columns.insert( movingCells[ i ].x() );
+	}
+	for ( uint i = 0; i < selectedCells.size(); i++ ) {
+		columns.insert( selectedCells[ i ].x() );
+	}
+	for ( std::set<int>::iterator it = columns.begin(); it != columns.end(); ++it ) {
+		if ( *it < 0 ) {
+			continue;
+		}
+		if ( !m_bSequenceChanged ) {
+			m_gridModel.rebuildColumn( pEngine->getSong(), *it );
+		}
+		QRect rect = cellRect( *it, 0 ).united( cellRect( *it, m_gridModel.getRows() ) );
+		m_dirtyRegion += rect;
+		update( rect );
+	}
+	updateCells( m_movingCells );
+	updateCells( m_selectedCells );
 
 	m_bIsMoving = false;
 	m_movingCells.clear();
 	m_selectedCells.clear();
-	m_bSequenceChanged = true;
-	update();
 }
 
 
@@ -620,7 +734,15 @@ void SongEditor::paintEvent( QPaintEvent *ev )
 	// ridisegno tutto solo se sono cambiate le note
 	if (m_bSequenceChanged) {
 		m_bSequenceChanged = false;
-		drawSequence();
+		m_gridModel.rebuild( Hydrogen::get_instance()->getSong() );
+		m_dirtyRegion = QRegion( m_pSequencePixmap->rect() );
+	}
+
+	// only the stale part of the exposed area is drawn, the rest waits until it is scrolled into view
+	QRect dirtyRect = ( m_dirtyRegion & ev->rect() ).boundingRect();
+	if ( !dirtyRect.isEmpty() ) {
+		drawSequence( dirtyRect );
+		m_dirtyRegion -= dirtyRect;
 	}
 
 	QPainter painter(this);
@@ -722,75 +844,76 @@ void SongEditor::cleanUp(){
 	delete m_pSequencePixmap;
 }
 
-void SongEditor::drawSequence()
+QRect SongEditor::cellRect( int nColumn, int nRow )
 {
-	QPainter p;
-	p.begin( m_pSequencePixmap );
-	p.drawPixmap( rect(), *m_pBackgroundPixmap, rect() );
-	p.end();
-
-	Song* song = Hydrogen::get_instance()->getSong();
-	PatternList *patList = song->get_pattern_list();
-	vector<PatternList*>* pColumns = song->get_pattern_group_vector();
-	uint listLength = patList->size();
+	return QRect( 10 + m_nGridWidth * nColumn, m_nGridHeight * nRow, m_nGridWidth + 1, m_nGridHeight );
+}
 
-	//Drawing the pattern based on the gridRepresentation array
 
-	while (!gridRepresentation.isEmpty())
-		delete gridRepresentation.takeFirst();
 
+void SongEditor::updateCell( int nColumn, int nRow )
+{
+	QRect rect = cellRect( nColumn, nRow );
+	m_dirtyRegion += rect;
+	update( rect );
+}
 
 
-	for (uint i = 0; i < pColumns->size(); i++) {
-		PatternList* pColumn = (*pColumns)[ i ];
 
-		std::set<Pattern*> drawnAsVirtual;
+void SongEditor::updateCells( const std::vector<QPoint>& cells )
+{
+	for ( uint i = 0; i < cells.size(); i++ ) {
+		updateCell( cells[ i ].x(), cells[ i ].y() );
+	}
+}
 
-		for (uint nPat = 0; nPat < pColumn->size(); ++nPat) {
-			H2Core::Pattern *pat = pColumn->get( nPat );
 
-			if (drawnAsVirtual.find(pat) == drawnAsVirtual.end()) {
-				int position = -1;
-				// find the position in pattern list
-				for (uint j = 0; j < listLength; j++) {
-					H2Core::Pattern *pat2 = patList->get( j );
-					if (pat == pat2) {
-						position = j;
-						break;
-					}
-				}
-				if (position == -1) {
-					WARNINGLOG( QString("[drawSequence] position == -1, group = %1").arg( i ) );
-				}
-				//normal pattern
 
-				gridRepresentation.append(new SongEditorGridRepresentationItem(i,position,false));
-			}//if
+void SongEditor::setPatternCell( int nColumn, int nRow, bool bActive )
+{
+	if ( m_bSequenceChanged ) {
+		// the whole model is rebuilt on the next paint
+		return;
+	}
 
-			for ( Pattern::virtual_patterns_cst_it_t it = pat->get_flattened_virtual_patterns()->begin(); it != pat->get_flattened_virtual_patterns()->end(); ++it) {
-				if (drawnAsVirtual.find(*it) == drawnAsVirtual.end()) {
-					int position = patList->index(*it);
-					if (position == -1) {
-						WARNINGLOG( QString("[drawSequence] position == -1, group = %1").arg( i ) );
-					}
-					//virtual pattern
-					gridRepresentation.append(new SongEditorGridRepresentationItem(i,position,true));
-					drawnAsVirtual.insert(*it);
-				}
-			}
-		}
+	if ( m_gridModel.setPattern( Hydrogen::get_instance()->getSong(), nColumn, nRow, bActive ) ) {
+		QRect rect = cellRect( nColumn, 0 ).united( cellRect( nColumn, m_gridModel.getRows() ) );
+		m_dirtyRegion += rect;
+		update( rect );
+	}
+	else {
+		updateCell( nColumn, nRow );
 	}
+}
 
 
-	//Draw the patterns according to the gridRepresentation
-	SongEditorGridRepresentationItem* s;
-	foreach(s, gridRepresentation)
-	{
-		drawPattern( s->x, s->y, s->value);
+
+void SongEditor::drawSequence( const QRect& rect )
+{
+	QPainter p;
+	p.begin( m_pSequencePixmap );
+	p.drawPixmap( rect, *m_pBackgroundPixmap, rect );
+	p.setClipRect( rect );
+
+	int nStartColumn = std::max( ( rect.left() - 10 ) / (int)m_nGridWidth, 0 );
+	int nEndColumn = std::min( ( rect.right() - 10 ) / (int)m_nGridWidth, m_gridModel.getColumns() - 1 );
+	int nStartRow = std::max( rect.top() / (int)m_nGridHeight, 0 );
+	int nEndRow = std::min( rect.bottom() / (int)m_nGridHeight, m_gridModel.getRows() - 1 );
+
+	//Draw the patterns according to the grid model
+	for ( int nColumn = nStartColumn; nColumn <= nEndColumn; nColumn++ ) {
+		for ( int nRow = nStartRow; nRow <= nEndRow; nRow++ ) {
+			int nCell = m_gridModel.get( nColumn, nRow );
+			if ( nCell & SongEditorGridModel::CELL_VIRTUAL ) {
+				drawPattern( p, nColumn, nRow, true );
+			}
+			else if ( nCell & SongEditorGridModel::CELL_PATTERN ) {
+				drawPattern( p, nColumn, nRow, false );
+			}
+		}
 	}
 
 	// Moving cells
-	p.begin( m_pSequencePixmap );
 //	p.setRasterOp( Qt::XorROP );
 
 // comix: this composition mode seems to be not available on Mac
@@ -806,16 +929,15 @@ void SongEditor::drawSequence()
 		patternColor.setRgb( 255, 255, 255 );
 		p.fillRect( x + 2, y + 4, m_nGridWidth - 3, m_nGridHeight - 7, patternColor );
 	}
-
+	p.end();
 }
 
 
 
-void SongEditor::drawPattern( int pos, int number, bool invertColour )
+void SongEditor::drawPattern( QPainter& p, int pos, int number, bool invertColour )
 {
 	Preferences *pref = Preferences::get_instance();
 	UIStyle *pStyle = pref->getDefaultUIStyle();
-	QPainter p( m_pSequencePixmap );
 	QColor patternColor( pStyle->m_songEditor_pattern1Color.getRed(), pStyle->m_songEditor_pattern1Color.getGreen(), pStyle->m_songEditor_pattern1Color.getBlue() );
 
 	/*
@@ -896,18 +1018,15 @@ void SongEditor::drawPattern( int pos, int number, bool invertColour )
 }
 
 
-void SongEditor::clearThePatternSequenseVector( QString filename )
+void SongEditor::clearThePatternSequenseVector()
 {
 	Hydrogen *engine = Hydrogen::get_instance();
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( NULL );	// only the sequence changes
 
 	Song *song = engine->getSong();
 
-	//before delet the sequense, write a temp seqense file to disk
-	LocalFileMng fileMng;
-	bool success = song->writeTempPatternList( filename );
-
 	vector<PatternList*> *pPatternGroupsVect = song->get_pattern_group_vector();
 	for (uint i = 0; i < pPatternGroupsVect->size(); i++) {
 		PatternList *pPatternList = (*pPatternGroupsVect)[i];
@@ -917,7 +1036,7 @@ void SongEditor::clearThePatternSequenseVector( QString filename )
 	pPatternGroupsVect->clear();
 
 	song->set_is_modified( true );
-	AudioEngine::get_instance()->unlock();
+	AudioEngine::get_instance()->unlock_edit();
 	m_bSequenceChanged = true;
 	update();
 }
@@ -1286,19 +1405,7 @@ void SongEditorPatternList::patternPopup_load()
 	}
 	QString patternPath = fd.selectedFiles().first();
 
-	QString prevPatternPath = Files::savePatternTmp( pattern->get_name(), pattern, song, engine->getCurrentDrumkitname() );
-	if ( prevPatternPath.isEmpty() ) {
-		QMessageBox::warning( this, "Hydrogen", tr("Could not export pattern.") );
-		return;
-	}
-	LocalFileMng fileMng;
-	QString sequencePath = Filesystem::tmp_file_path( "SEQ.xml" );
-	if ( !song->writeTempPatternList( sequencePath ) ) {
-		QMessageBox::warning( this, "Hydrogen", tr("Could not export sequence.") );
-		return;
-	}
-
-	SE_loadPatternAction *action = new SE_loadPatternAction( patternPath, prevPatternPath, sequencePath, nSelectedPattern, false );
+	SE_loadPatternAction *action = new SE_loadPatternAction( patternPath, new PatternSnapshot( pattern ), new SequenceSnapshot( song ), nSelectedPattern, false );
 	HydrogenApp *hydrogenApp = HydrogenApp::get_instance();
 	hydrogenApp->m_pUndoStack->push( action );
 }
@@ -1426,26 +1533,14 @@ void SongEditorPatternList::patternPopup_delete()
 	int patternPosition = pEngine->getSelectedPatternNumber();
 	Pattern *pattern = song->get_pattern_list()->get( patternPosition );
 
-	QString patternPath = Files::savePatternTmp( pattern->get_name(), pattern, song, pEngine->getCurrentDrumkitname() );
-	if ( patternPath.isEmpty() ) {
-		QMessageBox::warning( this, "Hydrogen", tr("Could not export pattern.") );
-		return;
-	}
-	LocalFileMng fileMng;
-	QString sequencePath = Filesystem::tmp_file_path( "SEQ.xml" );
-	if ( !song->writeTempPatternList( sequencePath ) ) {
-		QMessageBox::warning( this, "Hydrogen", tr("Could not export sequence.") );
-		return;
-	}
-
-	SE_deletePatternFromListAction *action = new 	SE_deletePatternFromListAction( patternPath , sequencePath, patternPosition );
+	SE_deletePatternFromListAction *action = new 	SE_deletePatternFromListAction( new PatternSnapshot( pattern ), new SequenceSnapshot( song ), patternPosition );
 	HydrogenApp *hydrogenApp = HydrogenApp::get_instance();
 	hydrogenApp->m_pUndoStack->push( action );
 
 }
 
 
-void SongEditorPatternList::deletePatternFromList( QString patternFilename, QString sequenceFileName, int patternPosition )
+void SongEditorPatternList::deletePatternFromList( int patternPosition )
 {
 	Hydrogen *pEngine = Hydrogen::get_instance();
 
@@ -1516,16 +1611,13 @@ void SongEditorPatternList::deletePatternFromList( QString patternFilename, QStr
 
 }
 
-void SongEditorPatternList::restoreDeletedPatternsFromList( QString patternFilename, QString sequenceFileName, int patternPosition )
+void SongEditorPatternList::restoreDeletedPatternsFromList( PatternSnapshot* pPattern, int patternPosition )
 {
 	Hydrogen *engine = Hydrogen::get_instance();
 	Song *pSong = engine->getSong();
 	PatternList *pPatternList = pSong->get_pattern_list();
 
-	Pattern* pattern = Pattern::load_file( patternFilename, pSong->get_instrument_list() );
-	if ( pattern == 0 ) {
-		_ERRORLOG( "Error loading the pattern" );
-	}
+	Pattern* pattern = pPattern->restore( pSong->get_instrument_list() );
 
 	pPatternList->insert( patternPosition, pattern );
 
@@ -1549,12 +1641,7 @@ void SongEditorPatternList::patternPopup_copy()
 	PatternPropertiesDialog *dialog = new PatternPropertiesDialog( this, pNewPattern, nSelectedPattern, true );
 
 	if ( dialog->exec() == QDialog::Accepted ) {
-		QString filePath = Files::savePatternTmp( pNewPattern->get_name(), pNewPattern, pSong, pEngine->getCurrentDrumkitname() );
-		if ( filePath.isEmpty() ) {
-			QMessageBox::warning( this, "Hydrogen", tr("Could not export pattern.") );
-			return;
-		}
-		SE_copyPatternAction *action = new SE_copyPatternAction( filePath, nSelectedPattern + 1 );
+		SE_copyPatternAction *action = new SE_copyPatternAction( new PatternSnapshot( pNewPattern ), nSelectedPattern + 1 );
 		HydrogenApp *hydrogenApp = HydrogenApp::get_instance();
 		hydrogenApp->m_pUndoStack->push( action );
 	}
@@ -1566,17 +1653,13 @@ void SongEditorPatternList::patternPopup_copy()
 }
 
 
-void SongEditorPatternList::patternPopup_copyAction( QString patternFilename, int patternposition )
+void SongEditorPatternList::patternPopup_copyAction( PatternSnapshot* pPattern, int patternposition )
 {
 	Hydrogen *engine = Hydrogen::get_instance();
 	Song *pSong = engine->getSong();
 	PatternList *pPatternList = pSong->get_pattern_list();
 
-	Pattern* pattern = Pattern::load_file( patternFilename, pSong->get_instrument_list() );
-	if ( pattern == 0 ) {
-		_ERRORLOG( "Error loading the pattern" );
-		return;
-	}
+	Pattern* pattern = pPattern->restore( pSong->get_instrument_list() );
 
 	pPatternList->insert( patternposition, pattern );
 	engine->setSelectedPatternNumber( patternposition );
@@ -1608,7 +1691,8 @@ void SongEditorPatternList::patternPopup_fill()
 void SongEditorPatternList::fillRangeWithPattern( FillRange* pRange, int nPattern )
 {
 	Hydrogen *pEngine = Hydrogen::get_instance();
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( NULL );	// only the sequence changes
 
 
 	Song *pSong = pEngine->getSong();
@@ -1672,7 +1756,7 @@ void SongEditorPatternList::fillRangeWithPattern( FillRange* pRange, int nPatter
 				break;
 			}
 		}
-	AudioEngine::get_instance()->unlock();
+	AudioEngine::get_instance()->unlock_edit();
 
 
 	// Update
@@ -1761,16 +1845,13 @@ void SongEditorPatternList::dropEvent(QDropEvent *event)
 		QStringList tokens = sText.split( "::" );
 		QString sPatternName = tokens.at( 1 );
 
-		//create a unique sequencefilename
 		Pattern *pPattern = pSong->get_pattern_list()->get( nTargetPattern );
 		HydrogenApp *pHydrogenApp = HydrogenApp::get_instance();
 
-		QString oldPatternName = pPattern->get_name();
-
-		QString sequenceFilename = Filesystem::tmp_file_path( "SEQ.xml" );
 		bool drag = false;
 		if( QString( tokens.at(0) ).contains( "drag pattern" )) drag = true;
-		SE_loadPatternAction *pAction = new SE_loadPatternAction( sPatternName, oldPatternName, sequenceFilename, nTargetPattern, drag );
+		PatternSnapshot *pOldPattern = drag ? NULL : new PatternSnapshot( pPattern );
+		SE_loadPatternAction *pAction = new SE_loadPatternAction( sPatternName, pOldPattern, new SequenceSnapshot( pSong ), nTargetPattern, drag );
 
 		pHydrogenApp->m_pUndoStack->push( pAction );
 	}
@@ -36,8 +36,16 @@
 #include "../EventListener.h"
 #include "PatternFillDialog.h"
 
+namespace H2Core
+{
+	class Song;
+	class Pattern;
+}
+
 class Button;
 class ToggleButton;
+class PatternSnapshot;
+class SequenceSnapshot;
 class SongEditor;
 class SongEditorPatternList;
 class SongEditorPositionRuler;
@@ -47,13 +55,43 @@ static const uint SONG_EDITOR_MIN_GRID_WIDTH = 8;
 static const uint SONG_EDITOR_MAX_GRID_WIDTH = 16;
 
 
-class SongEditorGridRepresentationItem
+///
+/// Which patterns are played in each column of the song, as drawn by the song editor.
+/// A cell is addressed by its column and the row of the pattern in the pattern list.
+///
+class SongEditorGridModel
 {
-    public:
-            SongEditorGridRepresentationItem(int x, int y, bool value);
-            int x;
-            int y;
-            bool value;
+	public:
+		enum CellFlags {
+			CELL_EMPTY = 0,
+			CELL_PATTERN = 1,		///< the pattern is in the column
+			CELL_VIRTUAL = 2		///< the pattern is played as a virtual pattern of another one
+		};
+
+		SongEditorGridModel();
+
+		/// rebuild the whole model from the song
+		void rebuild( H2Core::Song *pSong );
+		/// rebuild a single column from the song
+		void rebuildColumn( H2Core::Song *pSong, int nColumn );
+		/**
+		 * add or remove a pattern of a column, once the song has been changed.
+		 * Constant time unless the pattern has virtual patterns, then the
+		 * column is rebuilt and true is returned.
+		 */
+		bool setPattern( H2Core::Song *pSong, int nColumn, int nRow, bool bActive );
+
+		/// the CellFlags of a cell, CELL_EMPTY out of range
+		int get( int nColumn, int nRow ) const;
+		int getColumns() const { return m_columns.size(); }
+		int getRows() const { return m_nRows; }
+
+	private:
+		int m_nRows;
+		std::vector< std::vector<unsigned char> > m_columns;
+		QHash<H2Core::Pattern*, int> m_patternRows;		///< row of each pattern of the pattern list
+
+		void resize( int nColumns );
 };
 
 ///
@@ -77,13 +115,13 @@ class SongEditor : public QWidget, public H2Core::Object
 
 		void addPattern( int nColumn, int nRow);
 		void deletePattern( int nColumn, int nRow, unsigned nColumnIndex);
-		void clearThePatternSequenseVector( QString filename );
+		void clearThePatternSequenseVector();
 		void updateEditorandSetTrue();
                 void movePatternCellAction( std::vector<QPoint> movingCells, std::vector<QPoint> selectedCells, std::vector<QPoint> m_existingCells, bool bIsCtrlPressed, bool undo);
 
 	private:
-                //holds a list for active patterns for each pattern
-                QList<SongEditorGridRepresentationItem*> gridRepresentation;
+		SongEditorGridModel m_gridModel;
+		QRegion m_dirtyRegion;	///< areas of m_pSequencePixmap to redraw before they are painted
 
 		unsigned m_nGridHeight;
 		unsigned m_nGridWidth;
@@ -109,8 +147,14 @@ class SongEditor : public QWidget, public H2Core::Object
 		virtual void keyPressEvent (QKeyEvent *ev);
 		virtual void paintEvent(QPaintEvent *ev);
 
-		void drawSequence();
-		void drawPattern( int pos, int number, bool invertColour );
+		void drawSequence( const QRect& rect );
+		void drawPattern( QPainter& p, int pos, int number, bool invertColour );
+		QRect cellRect( int nColumn, int nRow );
+		/// redraw a cell on the next paint
+		void updateCell( int nColumn, int nRow );
+		void updateCells( const std::vector<QPoint>& cells );
+		/// update the grid model and redraw a cell whose pattern has been added or removed
+		void setPatternCell( int nColumn, int nRow, bool bActive );
 };
 
 
@@ -131,13 +175,13 @@ class SongEditorPatternList : public QWidget, public H2Core::Object, public Even
 		void updateEditor();
 		void createBackground();
 		void movePatternLine( int, int );
-		void deletePatternFromList( QString patternFilename, QString sequenceFileName, int patternPosition );
-		void restoreDeletedPatternsFromList( QString patternFilename, QString sequenceFileName, int patternPosition );
+		void deletePatternFromList( int patternPosition );
+		void restoreDeletedPatternsFromList( PatternSnapshot* pPattern, int patternPosition );
 		void acceptPatternPropertiesDialogSettings( QString newPatternName, QString newPatternInfo, QString newPatternCategory, int patternNr );
 		void revertPatternPropertiesDialogSettings(QString oldPatternName, QString oldPatternInfo, QString oldPatternCategory, int patternNr);
 		void loadPatternAction( QString filename, int position);
 		void fillRangeWithPattern(FillRange* r, int nPattern);
-		void patternPopup_copyAction( QString patternFilename, int patternposition );
+		void patternPopup_copyAction( PatternSnapshot* pPattern, int patternposition );
 		int getGridHeight() { return m_nGridHeight; }
 
 	public slots:
@@ -37,7 +37,9 @@
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/audio_engine.h>
+#include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_component.h>
+#include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/pattern_list.h>
 #ifdef WIN32
 #include <time.h>
@@ -52,6 +54,7 @@ SongEditorPanel::SongEditorPanel(QWidget *pParent)
  : QWidget( pParent )
  , Object( __class_name )
  , m_actionMode( DRAW_ACTION )
+ , m_pMeterSnapshot( new MeterSnapshot() )
 {
 	m_nInitialWidth = 600;
 	m_nInitialHeight = 250;
@@ -337,7 +340,16 @@ SongEditorPanel::SongEditorPanel(QWidget *pParent)
 	m_pAutomationCombo = new LCDCombo( nullptr, 22 );
 	m_pAutomationCombo->setToolTip( trUtf8("Adjust parameter values in time") );
 	m_pAutomationCombo->addItem( trUtf8("Velocity") );
+	// the other paths belong to the selected instrument, in the order of H2Core::Instrument::AutomationTarget
+	m_pAutomationCombo->addItem( trUtf8("Volume") );
+	m_pAutomationCombo->addItem( trUtf8("Pan") );
+	m_pAutomationCombo->addItem( trUtf8("Filter cutoff") );
+	m_pAutomationCombo->addItem( trUtf8("Filter resonance") );
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		m_pAutomationCombo->addItem( trUtf8("FX %1 send").arg( nFX + 1 ) );
+	}
 	m_pAutomationCombo->select( 0 );
+	connect( m_pAutomationCombo, SIGNAL( valueChanged( int ) ), this, SLOT( automationTargetChanged( int ) ) );
 
 	m_pVScrollBar = new QScrollBar( Qt::Vertical, nullptr );
 	connect( m_pVScrollBar, SIGNAL(valueChanged(int)), this, SLOT( vScrollTo(int) ) );
@@ -390,6 +402,7 @@ SongEditorPanel::SongEditorPanel(QWidget *pParent)
 SongEditorPanel::~SongEditorPanel()
 {
 	m_pTimer->stop();
+	delete m_pMeterSnapshot;
 }
 
 
@@ -421,11 +434,8 @@ void SongEditorPanel::updatePlayHeadPosition()
 
 void SongEditorPanel::updatePlaybackFaderPeaks()
 {
-	Sampler*		pSampler = AudioEngine::get_instance()->get_sampler();
 	Preferences *	pPref = Preferences::get_instance();
-	Instrument*		pInstrument = pSampler->__playback_instrument;
 
-	
 	bool bShowPeaks = pPref->showInstrumentPeaks();
 	float fallOff = pPref->getMixerFalloffSpeed();
 	
@@ -433,11 +443,10 @@ void SongEditorPanel::updatePlaybackFaderPeaks()
 	float fOldPeak_L = m_pPlaybackTrackFader->getPeak_L();
 	float fOldPeak_R = m_pPlaybackTrackFader->getPeak_R();
 	
-	float fNewPeak_L = pInstrument->get_peak_l();
-	pInstrument->set_peak_l( 0.0f );	// reset instrument peak
-
-	float fNewPeak_R = pInstrument->get_peak_r();
-	pInstrument->set_peak_r( 0.0f );	// reset instrument peak
+	// the last levels are kept if the engine published nothing new
+	MeterBus::get_instance()->get_snapshot( *m_pMeterSnapshot );
+	float fNewPeak_L = m_pMeterSnapshot->playback_track.peak_l;
+	float fNewPeak_R = m_pMeterSnapshot->playback_track.peak_r;
 
 	if (!bShowPeaks) {
 		fNewPeak_L = 0.0f;
@@ -501,11 +510,37 @@ void SongEditorPanel::updateAll()
 	m_pSongEditor->createBackground();
 	m_pSongEditor->update();
 
+	updateAutomationPath();
+
+	resyncExternalScrollBar();
+}
+
+void SongEditorPanel::updateAutomationPath()
+{
 	Hydrogen *pEngine = Hydrogen::get_instance();
 	Song *pSong = pEngine->getSong();
-	m_pAutomationPathView->setAutomationPath (pSong->get_velocity_automation_path());
+	int nTarget = m_pAutomationCombo->selected();
+	if ( nTarget <= 0 ) {
+		m_pAutomationPathView->setAutomationPath( pSong->get_velocity_automation_path() );
+		return;
+	}
 
-	resyncExternalScrollBar();
+	Instrument *pInstr = NULL;
+	int nSelected = pEngine->getSelectedInstrumentNumber();
+	if ( nSelected >= 0 && nSelected < pSong->get_instrument_list()->size() ) {
+		pInstr = pSong->get_instrument_list()->get( nSelected );
+	}
+	m_pAutomationPathView->setAutomationPath( pInstr ? pInstr->get_automation_path( ( Instrument::AutomationTarget )( nTarget - 1 ) ) : NULL );
+}
+
+void SongEditorPanel::automationTargetChanged( int )
+{
+	updateAutomationPath();
+}
+
+void SongEditorPanel::selectedInstrumentChangedEvent()
+{
+	updateAutomationPath();
 }
 
 
@@ -611,27 +646,21 @@ void SongEditorPanel::clearSequence( Button* btn)
 	if ( res == 1 ) {
 		return;
 	}
-	
-	QString filename = Filesystem::tmp_file_path( "SEQ.xml" );
-	SE_deletePatternSequenceAction *pAction = new SE_deletePatternSequenceAction( filename );
+
+	SE_deletePatternSequenceAction *pAction = new SE_deletePatternSequenceAction();
 	HydrogenApp *pH2App = HydrogenApp::get_instance();
 
 	pH2App->m_pUndoStack->push( pAction );
 }
 
 
-void SongEditorPanel::restoreGroupVector( QString filename )
+void SongEditorPanel::restoreGroupVector( SequenceSnapshot* pSequence )
 {
-	//clear the old sequese
-	vector<PatternList*> *pPatternGroupsVect = Hydrogen::get_instance()->getSong()->get_pattern_group_vector();
-	for (uint i = 0; i < pPatternGroupsVect->size(); i++) {
-		PatternList *pPatternList = (*pPatternGroupsVect)[i];
-		pPatternList->clear();
-		delete pPatternList;
-	}
-	pPatternGroupsVect->clear();
+	AudioEngine::get_instance()->lock_edit( RIGHT_HERE );
+	AudioEngine::get_instance()->mark_edited( NULL );	// only the sequence changes
+	pSequence->restore( Hydrogen::get_instance()->getSong() );
+	AudioEngine::get_instance()->unlock_edit();
 
-	Hydrogen::get_instance()->getSong()->readTempPatternList( filename );
 	m_pSongEditor->updateEditorandSetTrue();
 	updateAll();
 }
@@ -27,6 +27,7 @@
 #include "../EventListener.h"
 #include <hydrogen/object.h>
 #include <hydrogen/basics/pattern.h>
+#include <hydrogen/meter_bus.h>
 #include "../InstrumentEditor/WaveDisplay.h"
 
 #include <QtGui>
@@ -35,6 +36,7 @@
 #endif
 
 class Button;
+class SequenceSnapshot;
 class SongEditor;
 class SongEditorPatternList;
 class SongEditorPositionRuler;
@@ -76,7 +78,8 @@ class SongEditorPanel : public QWidget, public EventListener, public H2Core::Obj
 		
 		// Implements EventListener interface
 		virtual void selectedPatternChangedEvent();
-		void restoreGroupVector( QString filename );
+		virtual void selectedInstrumentChangedEvent();
+		void restoreGroupVector( SequenceSnapshot* pSequence );
 		//~ Implements EventListener interface	
 		///< an empty new pattern will be added to pattern list at idx
 		void insertPattern( int idx, H2Core::Pattern* pPattern );
@@ -113,8 +116,12 @@ class SongEditorPanel : public QWidget, public EventListener, public H2Core::Obj
 		void automationPathPointAdded(float x, float y);
 		void automationPathPointRemoved(float x, float y);
 		void automationPathPointMoved(float ox, float oy, float tx, float ty);
+		void automationTargetChanged( int nTarget );
 
 	private:
+		/** show the path picked in the automation combo, of the selected instrument if not velocity */
+		void updateAutomationPath();
+
 		SongEditorActionMode	m_actionMode;
 
 		uint					m_nInitialWidth;
@@ -157,6 +164,7 @@ class SongEditorPanel : public QWidget, public EventListener, public H2Core::Obj
 		Button *				m_pEditPlaybackBtn;
 
 		QTimer*					m_pTimer;
+		H2Core::MeterSnapshot*	m_pMeterSnapshot;		///< levels published by the meter bus
 		
 		AutomationPathView *	m_pAutomationPathView;
 		LCDCombo*				m_pAutomationCombo;
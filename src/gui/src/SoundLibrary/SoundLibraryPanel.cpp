@@ -59,6 +59,7 @@
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/song.h>
 #include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/helpers/drumkit_index.h>
 
 using namespace H2Core;
 
@@ -138,15 +139,7 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent, bool bInItsOwnDialog )
 
 SoundLibraryPanel::~SoundLibraryPanel()
 {
-	for (uint i = 0; i < __system_drumkit_info_list.size(); ++i ) {
-		delete __system_drumkit_info_list[i];
-	}
-	__system_drumkit_info_list.clear();
-
-	for (uint i = 0; i < __user_drumkit_info_list.size(); ++i ) {
-		delete __user_drumkit_info_list[i];
-	}
-	__user_drumkit_info_list.clear();
+	clear_loaded_drumkits();
 
 }
 
@@ -172,57 +165,37 @@ void SoundLibraryPanel::updateDrumkitList()
 
 	
 
-	for (uint i = 0; i < __system_drumkit_info_list.size(); ++i ) {
-		delete __system_drumkit_info_list[i];
-	}
-	__system_drumkit_info_list.clear();
-
-	for (uint i = 0; i < __user_drumkit_info_list.size(); ++i ) {
-		delete __user_drumkit_info_list[i];
-	}
-	__user_drumkit_info_list.clear();
+	clear_loaded_drumkits();
 
 	//User drumkit list
-	QStringList usr_dks = Filesystem::usr_drumkit_list();
-	for (int i = 0; i < usr_dks.size(); ++i) {
-		QString absPath = Filesystem::usr_drumkits_dir() + usr_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			__user_drumkit_info_list.push_back( pInfo );
-			QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __user_drumkits_item );
-			pDrumkitItem->setText( 0, pInfo->get_name() );
-			if ( QString(pInfo->get_name() ) == currentSL ){
-				pDrumkitItem->setBackgroundColor( 0, QColor( 50, 50, 50) );
-			}
-			InstrumentList *pInstrList = pInfo->get_instruments();
-			for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-				Instrument *pInstr = pInstrList->get( nInstr );
-				QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
-				pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + pInstr->get_name() );
-				pInstrumentItem->setToolTip( 0, pInstr->get_name() );
-			}
+	__user_drumkit_info_list = DrumkitIndex::usr_drumkits();
+	for (uint i = 0; i < __user_drumkit_info_list.size(); ++i) {
+		const DrumkitIndex::Entry& info = __user_drumkit_info_list[i];
+		QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __user_drumkits_item );
+		pDrumkitItem->setText( 0, info.name );
+		if ( info.name == currentSL ){
+			pDrumkitItem->setBackgroundColor( 0, QColor( 50, 50, 50) );
+		}
+		for ( int nInstr = 0; nInstr < info.instruments.size(); ++nInstr ) {
+			QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
+			pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + info.instruments[ nInstr ] );
+			pInstrumentItem->setToolTip( 0, info.instruments[ nInstr ] );
 		}
 	}
 
 	//System drumkit list
-	QStringList sys_dks = Filesystem::sys_drumkit_list();
-	for (int i = 0; i < sys_dks.size(); ++i) {
-		QString absPath = Filesystem::sys_drumkits_dir() + sys_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			__system_drumkit_info_list.push_back( pInfo );
-			QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __system_drumkits_item );
-			pDrumkitItem->setText( 0, pInfo->get_name() );
-			if ( QString( pInfo->get_name() ) == currentSL ){
-				pDrumkitItem->setBackgroundColor( 0, QColor( 50, 50, 50) );
-			}
-			InstrumentList *pInstrList = pInfo->get_instruments();
-			for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-				Instrument *pInstr = pInstrList->get( nInstr );
-				QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
-				pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + pInstr->get_name() );
-				pInstrumentItem->setToolTip( 0, pInstr->get_name() );
-			}
+	__system_drumkit_info_list = DrumkitIndex::sys_drumkits();
+	for (uint i = 0; i < __system_drumkit_info_list.size(); ++i) {
+		const DrumkitIndex::Entry& info = __system_drumkit_info_list[i];
+		QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __system_drumkits_item );
+		pDrumkitItem->setText( 0, info.name );
+		if ( info.name == currentSL ){
+			pDrumkitItem->setBackgroundColor( 0, QColor( 50, 50, 50) );
+		}
+		for ( int nInstr = 0; nInstr < info.instruments.size(); ++nInstr ) {
+			QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
+			pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + info.instruments[ nInstr ] );
+			pInstrumentItem->setToolTip( 0, info.instruments[ nInstr ] );
 		}
 	}
 	
@@ -476,23 +449,9 @@ void SoundLibraryPanel::on_drumkitLoadAction()
 
 	QString sDrumkitName = __sound_library_tree->currentItem()->text(0);
 
-	Drumkit *drumkitInfo = NULL;
-
-	// find the drumkit in the list
-	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-		Drumkit *pInfo = __system_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
-	}
-	
-	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-		Drumkit *pInfo = __user_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
+	Drumkit *drumkitInfo = get_drumkit( sDrumkitName );
+	if ( drumkitInfo == NULL ) {
+		return;
 	}
 
 	InstrumentList *pSongInstrList = Hydrogen::get_instance()->getSong()->get_instrument_list();
@@ -579,6 +538,51 @@ void SoundLibraryPanel::on_drumkitLoadAction()
 
 
 
+Drumkit* SoundLibraryPanel::get_drumkit( const QString& sDrumkitName )
+{
+	for ( uint i = 0; i < __loaded_drumkits.size(); i++ ) {
+		if ( __loaded_drumkits[i]->get_name() == sDrumkitName ) {
+			return __loaded_drumkits[i];
+		}
+	}
+
+	// only the metadata is indexed, the drumkit itself is loaded when used
+	QString sPath;
+	for ( uint i = 0; i < __user_drumkit_info_list.size() && sPath.isEmpty(); i++ ) {
+		if ( __user_drumkit_info_list[i].name == sDrumkitName ) {
+			sPath = __user_drumkit_info_list[i].path;
+		}
+	}
+	for ( uint i = 0; i < __system_drumkit_info_list.size() && sPath.isEmpty(); i++ ) {
+		if ( __system_drumkit_info_list[i].name == sDrumkitName ) {
+			sPath = __system_drumkit_info_list[i].path;
+		}
+	}
+	if ( sPath.isEmpty() ) {
+		return NULL;
+	}
+
+	Drumkit *pDrumkit = Drumkit::load( sPath );
+	if ( pDrumkit ) {
+		__loaded_drumkits.push_back( pDrumkit );
+	} else {
+		ERRORLOG( QString( "Can't load drumkit %1" ).arg( sPath ) );
+	}
+	return pDrumkit;
+}
+
+
+
+void SoundLibraryPanel::clear_loaded_drumkits()
+{
+	for ( uint i = 0; i < __loaded_drumkits.size(); ++i ) {
+		delete __loaded_drumkits[i];
+	}
+	__loaded_drumkits.clear();
+}
+
+
+
 void SoundLibraryPanel::update_background_color()
 {
 	restore_background_color();
@@ -666,46 +670,14 @@ void SoundLibraryPanel::on_drumkitPropertiesAction()
 {
 	QString sDrumkitName = __sound_library_tree->currentItem()->text(0);
 
-	Drumkit *drumkitInfo = NULL;
-
-	// find the drumkit in the list
-	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-		Drumkit *pInfo = __system_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
-	}
-	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-		Drumkit*pInfo = __user_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
+	Drumkit *drumkitInfo = get_drumkit( sDrumkitName );
+	if ( drumkitInfo == NULL ) {
+		return;
 	}
 
-	assert( drumkitInfo );
-
 	QString sPreDrumkitName = Hydrogen::get_instance()->getCurrentDrumkitname();
 
-	Drumkit *preDrumkitInfo = NULL;
-	
-
-	// find the drumkit in the list
-	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-		Drumkit *prInfo = __system_drumkit_info_list[i];
-		if ( prInfo->get_name() == sPreDrumkitName ) {
-			preDrumkitInfo = prInfo;
-			break;
-		}
-	}
-	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-		Drumkit *prInfo = __user_drumkit_info_list[i];
-		if ( prInfo->get_name() == sPreDrumkitName ) {
-			preDrumkitInfo = prInfo;
-			break;
-		}
-	}
+	Drumkit *preDrumkitInfo = get_drumkit( sPreDrumkitName );
 
 	if ( preDrumkitInfo == NULL ){
 		QMessageBox::warning( this, "Hydrogen", QString( "The current loaded song missing his soundlibrary.\nPlease load a existing soundlibrary first") );
@@ -32,6 +32,7 @@
 #include <vector>
 
 #include <hydrogen/object.h>
+#include <hydrogen/helpers/drumkit_index.h>
 
 namespace H2Core
 {
@@ -93,12 +94,16 @@ private:
 	QTreeWidgetItem* __pattern_item;
 	QTreeWidgetItem* __pattern_item_list;
 
-	std::vector<H2Core::Drumkit*> __system_drumkit_info_list;
-	std::vector<H2Core::Drumkit*> __user_drumkit_info_list;
+	std::vector<H2Core::DrumkitIndex::Entry> __system_drumkit_info_list;
+	std::vector<H2Core::DrumkitIndex::Entry> __user_drumkit_info_list;
+	std::vector<H2Core::Drumkit*> __loaded_drumkits;	///< loaded on demand, deleted by updateDrumkitList
 	bool __expand_pattern_list;
 	bool __expand_songs_list;
 	void restore_background_color();
 	void change_background_color();
+	/** load a listed drumkit, the panel keeps ownership */
+	H2Core::Drumkit* get_drumkit( const QString& sDrumkitName );
+	void clear_loaded_drumkits();
 
 };
 
@@ -11,8 +11,11 @@
 #include <hydrogen/basics/note.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/automation_path.h>
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/audio_engine.h>
 
 #include "HydrogenApp.h"
+#include "UndoSnapshot.h"
 #include "SongEditor/SongEditor.h"
 #include "SongEditor/SongEditorPanel.h"
 #include "SongEditor/PatternFillDialog.h"
@@ -111,42 +114,53 @@ private:
 class SE_deletePatternSequenceAction : public QUndoCommand
 {
 public:
-	SE_deletePatternSequenceAction(  QString pFilename ){
+	SE_deletePatternSequenceAction(){
 		setText( QString( "Delete complete pattern-sequence" ) );
-		__pFilename = pFilename ;
+		__pSequence = NULL;
+	}
+	~SE_deletePatternSequenceAction()
+	{
+		delete __pSequence;
 	}
 	virtual void undo()
 	{
 		//qDebug() << "Delete complete pattern-sequence  undo";
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getSongEditorPanel()->restoreGroupVector( __pFilename );
+		h2app->getSongEditorPanel()->restoreGroupVector( __pSequence );
 	}
 
 	virtual void redo()
 	{
 		//qDebug() << "Delete complete pattern-sequence redo " ;
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getSongEditorPanel()->getSongEditor()->clearThePatternSequenseVector( __pFilename );
+		delete __pSequence;
+		__pSequence = new SequenceSnapshot( H2Core::Hydrogen::get_instance()->getSong() );
+		h2app->getSongEditorPanel()->getSongEditor()->clearThePatternSequenseVector();
 	}
 private:
-	QString __pFilename;
+	SequenceSnapshot* __pSequence;
 };
 
 class SE_deletePatternFromListAction : public QUndoCommand
 {
 public:
-	SE_deletePatternFromListAction(  QString patternFilename , QString sequenceFileName, int patternPosition ){
+	SE_deletePatternFromListAction( PatternSnapshot* pPattern, SequenceSnapshot* pSequence, int patternPosition ){
 		setText( QString( "Delete pattern from list" ) );
-		__patternFilename =  patternFilename;
-		__sequenceFileName = sequenceFileName;
+		__pPattern = pPattern;
+		__pSequence = pSequence;
 		__patternPosition = patternPosition;
 	}
+	~SE_deletePatternFromListAction()
+	{
+		delete __pPattern;
+		delete __pSequence;
+	}
 	virtual void undo()
 	{
 		//qDebug() << "Delete pattern from list undo";
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getSongEditorPanel()->getSongEditorPatternList()->restoreDeletedPatternsFromList( __patternFilename, __sequenceFileName, __patternPosition );
-		h2app->getSongEditorPanel()->restoreGroupVector( __sequenceFileName );
+		h2app->getSongEditorPanel()->getSongEditorPatternList()->restoreDeletedPatternsFromList( __pPattern, __patternPosition );
+		h2app->getSongEditorPanel()->restoreGroupVector( __pSequence );
 		h2app->getSongEditorPanel()->getSongEditor()->updateEditorandSetTrue();
 	}
 
@@ -154,11 +168,11 @@ public:
 	{
 		//qDebug() << "Delete pattern from list redo" ;
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getSongEditorPanel()->getSongEditorPatternList()->deletePatternFromList( __patternFilename, __sequenceFileName, __patternPosition );
+		h2app->getSongEditorPanel()->getSongEditorPatternList()->deletePatternFromList( __patternPosition );
 	}
 private:
-	QString __patternFilename;
-	QString __sequenceFileName;
+	PatternSnapshot* __pPattern;
+	SequenceSnapshot* __pSequence;
 	int __patternPosition;
 };
 
@@ -203,11 +217,15 @@ private:
 class SE_copyPatternAction : public QUndoCommand
 {
 public:
-	SE_copyPatternAction( QString patternFilename, int patternPosition ){
+	SE_copyPatternAction( PatternSnapshot* pPattern, int patternPosition ){
 		setText( QString( "Copy pattern" ) );
-		__patternFilename = patternFilename;
+		__pPattern = pPattern;
 		__patternPosition = patternPosition;
 	}
+	~SE_copyPatternAction()
+	{
+		delete __pPattern;
+	}
 	virtual void undo()
 	{
 		//qDebug() << "copy pattern undo";
@@ -219,10 +237,10 @@ public:
 	{
 		//qDebug() << "copy pattern redo" ;
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getSongEditorPanel()->getSongEditorPatternList()->patternPopup_copyAction( __patternFilename, __patternPosition );
+		h2app->getSongEditorPanel()->getSongEditorPatternList()->patternPopup_copyAction( __pPattern, __patternPosition );
 	}
 private:
-	QString __patternFilename;
+	PatternSnapshot* __pPattern;
 	int __patternPosition;
 };
 
@@ -260,26 +278,31 @@ private:
 class SE_loadPatternAction : public QUndoCommand
 {
 public:
-	SE_loadPatternAction(  QString patternName, QString oldPatternName, QString sequenceFileName, int patternPosition, bool dragFromList){
+	SE_loadPatternAction(  QString patternName, PatternSnapshot* pOldPattern, SequenceSnapshot* pSequence, int patternPosition, bool dragFromList){
 		setText( QString( "Load/drag pattern" ) );
 		__patternName =  patternName;
-		__oldPatternName = oldPatternName;
-		__sequenceFileName = sequenceFileName;
+		__pOldPattern = pOldPattern;
+		__pSequence = pSequence;
 		__patternPosition = patternPosition;
 		__dragFromList = dragFromList;
 	}
+	~SE_loadPatternAction()
+	{
+		delete __pOldPattern;
+		delete __pSequence;
+	}
 	virtual void undo()
 	{
 		//qDebug() << "Load/drag pattern undo" << __dragFromList;
 		HydrogenApp* h2app = HydrogenApp::get_instance();
 		if( __dragFromList ){
-			h2app->getSongEditorPanel()->getSongEditorPatternList()->deletePatternFromList( __oldPatternName, __sequenceFileName, __patternPosition );
+			h2app->getSongEditorPanel()->getSongEditorPatternList()->deletePatternFromList( __patternPosition );
 		}else
 		{
-			h2app->getSongEditorPanel()->getSongEditorPatternList()->restoreDeletedPatternsFromList( __oldPatternName, __sequenceFileName, __patternPosition );
+			h2app->getSongEditorPanel()->getSongEditorPatternList()->restoreDeletedPatternsFromList( __pOldPattern, __patternPosition );
 			h2app->getSongEditorPanel()->deletePattern( __patternPosition +1 );
 		}
-		h2app->getSongEditorPanel()->restoreGroupVector( __sequenceFileName );
+		h2app->getSongEditorPanel()->restoreGroupVector( __pSequence );
 		h2app->getSongEditorPanel()->getSongEditor()->updateEditorandSetTrue();
 	}
 
@@ -288,14 +311,14 @@ public:
 		//qDebug() <<  "Load/drag pattern redo" << __dragFromList << __patternPosition;
 		HydrogenApp* h2app = HydrogenApp::get_instance();
 		if(!__dragFromList){
-			h2app->getSongEditorPanel()->getSongEditorPatternList()->deletePatternFromList( __oldPatternName, __sequenceFileName, __patternPosition );
+			h2app->getSongEditorPanel()->getSongEditorPatternList()->deletePatternFromList( __patternPosition );
 		}
 		h2app->getSongEditorPanel()->getSongEditorPatternList()->loadPatternAction( __patternName, __patternPosition  );
 	}
 private:
 	QString __patternName;
-	QString __oldPatternName;
-	QString __sequenceFileName;
+	PatternSnapshot* __pOldPattern;		///< NULL when dragged from the list
+	SequenceSnapshot* __pSequence;
 	int __patternPosition;
 	bool __dragFromList;
 };
@@ -1277,7 +1300,9 @@ public:
 
 	virtual void undo()
 	{
+		H2Core::AudioEngine::get_instance()->lock( RIGHT_HERE );
 		__path->remove_point( __x );
+		H2Core::AudioEngine::get_instance()->unlock();
 
 		HydrogenApp* h2app = HydrogenApp::get_instance();
 		h2app->getSongEditorPanel()->getAutomationPathView()->update();
@@ -1285,7 +1310,9 @@ public:
 
 	virtual void redo()
 	{
+		H2Core::AudioEngine::get_instance()->lock( RIGHT_HERE );
 		__path->add_point( __x, __y );
+		H2Core::AudioEngine::get_instance()->unlock();
 
 		HydrogenApp* h2app = HydrogenApp::get_instance();
 		h2app->getSongEditorPanel()->getAutomationPathView()->update();
@@ -1310,7 +1337,9 @@ public:
 
 	virtual void redo()
 	{
+		H2Core::AudioEngine::get_instance()->lock( RIGHT_HERE );
 		__path->remove_point( __x );
+		H2Core::AudioEngine::get_instance()->unlock();
 
 		HydrogenApp* h2app = HydrogenApp::get_instance();
 		h2app->getSongEditorPanel()->getAutomationPathView()->update();
@@ -1318,7 +1347,9 @@ public:
 
 	virtual void undo()
 	{
+		H2Core::AudioEngine::get_instance()->lock( RIGHT_HERE );
 		__path->add_point( __x, __y );
+		H2Core::AudioEngine::get_instance()->unlock();
 
 		HydrogenApp* h2app = HydrogenApp::get_instance();
 		h2app->getSongEditorPanel()->getAutomationPathView()->update();
@@ -1345,8 +1376,10 @@ public:
 
 	virtual void redo()
 	{
+		H2Core::AudioEngine::get_instance()->lock( RIGHT_HERE );
 		__path->remove_point( __ox );
 		__path->add_point( __tx, __ty );
+		H2Core::AudioEngine::get_instance()->unlock();
 
 		HydrogenApp* h2app = HydrogenApp::get_instance();
 		h2app->getSongEditorPanel()->getAutomationPathView()->update();
@@ -1354,8 +1387,10 @@ public:
 
 	virtual void undo()
 	{
+		H2Core::AudioEngine::get_instance()->lock( RIGHT_HERE );
 		__path->remove_point( __tx );
 		__path->add_point( __ox, __oy );
+		H2Core::AudioEngine::get_instance()->unlock();
 
 		HydrogenApp* h2app = HydrogenApp::get_instance();
 		h2app->getSongEditorPanel()->getAutomationPathView()->update();
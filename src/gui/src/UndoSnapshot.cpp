@@ -0,0 +1,409 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "UndoSnapshot.h"
+
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/helpers/filesystem.h>
+
+#include <QFile>
+#include <algorithm>
+
+using namespace H2Core;
+
+std::list<UndoSnapshot*> UndoSnapshot::m_snapshots;
+size_t UndoSnapshot::m_nMemory = 0;
+size_t UndoSnapshot::m_nBudget = 16 * 1024 * 1024;
+
+
+UndoSnapshot::UndoSnapshot( const char* sClassName )
+ : Object( sClassName )
+ , m_nSize( 0 )
+{
+}
+
+
+
+UndoSnapshot::~UndoSnapshot()
+{
+	if ( !m_sSpillPath.isEmpty() ) {
+		QFile::remove( m_sSpillPath );
+		return;
+	}
+	std::list<UndoSnapshot*>::iterator it = std::find( m_snapshots.begin(), m_snapshots.end(), this );
+	if ( it != m_snapshots.end() ) {
+		m_snapshots.erase( it );
+		m_nMemory -= m_nSize;
+	}
+}
+
+
+
+void UndoSnapshot::setBudget( size_t nBytes )
+{
+	m_nBudget = nBytes;
+	enforceBudget( NULL );
+}
+
+
+
+void UndoSnapshot::registerSnapshot()
+{
+	m_nSize = getSize();
+	m_snapshots.push_back( this );
+	m_nMemory += m_nSize;
+	enforceBudget( this );
+}
+
+
+
+void UndoSnapshot::load()
+{
+	if ( m_sSpillPath.isEmpty() ) {
+		return;
+	}
+
+	QFile file( m_sSpillPath );
+	if ( !file.open( QIODevice::ReadOnly ) ) {
+		ERRORLOG( QString( "Unable to read undo data from %1" ).arg( m_sSpillPath ) );
+		return;
+	}
+	QDataStream stream( &file );
+	read( stream );
+	file.close();
+	file.remove();
+	m_sSpillPath.clear();
+
+	m_snapshots.push_back( this );
+	m_nMemory += m_nSize;
+	enforceBudget( this );
+}
+
+
+
+void UndoSnapshot::spill()
+{
+	QString sPath = H2Core::Filesystem::tmp_file_path( "undo.snapshot" );
+	QFile file( sPath );
+	if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+		ERRORLOG( QString( "Unable to write undo data to %1, keeping it in memory" ).arg( sPath ) );
+		return;
+	}
+	QDataStream stream( &file );
+	write( stream );
+	file.close();
+	if ( stream.status() != QDataStream::Ok ) {
+		ERRORLOG( QString( "Unable to write undo data to %1, keeping it in memory" ).arg( sPath ) );
+		file.remove();
+		return;
+	}
+
+	release();
+	m_sSpillPath = sPath;
+	m_snapshots.remove( this );
+	m_nMemory -= m_nSize;
+}
+
+
+
+void UndoSnapshot::enforceBudget( UndoSnapshot* pKeep )
+{
+	std::list<UndoSnapshot*>::iterator it = m_snapshots.begin();
+	while ( m_nMemory > m_nBudget && it != m_snapshots.end() ) {
+		UndoSnapshot* pSnapshot = *it;
+		++it;	// spill() removes the snapshot from the list
+		if ( pSnapshot != pKeep ) {
+			pSnapshot->spill();
+		}
+	}
+}
+
+
+
+const char* PatternSnapshot::__class_name = "PatternSnapshot";
+
+PatternSnapshot::PatternSnapshot( Pattern* pPattern )
+ : UndoSnapshot( __class_name )
+ , m_sName( pPattern->get_name() )
+ , m_sInfo( pPattern->get_info() )
+ , m_sCategory( pPattern->get_category() )
+ , m_nLength( pPattern->get_length() )
+{
+	const Pattern::notes_t* notes = pPattern->get_notes();
+	m_notes.reserve( notes->size() );
+	FOREACH_NOTE_CST_IT_BEGIN_END( notes, it ) {
+		Note* pNote = it->second;
+		NoteRecord note;
+		note.nPosition = pNote->get_position();
+		note.nLength = pNote->get_length();
+		note.nInstrument = pNote->get_instrument()->get_id();
+		note.fVelocity = pNote->get_velocity();
+		note.fPan_L = pNote->get_pan_l();
+		note.fPan_R = pNote->get_pan_r();
+		note.fPitch = pNote->get_pitch();
+		note.fLeadLag = pNote->get_lead_lag();
+		note.fProbability = pNote->get_probability();
+		note.nKey = pNote->get_key();
+		note.nOctave = pNote->get_octave();
+		note.bNoteOff = pNote->get_note_off();
+		m_notes.push_back( note );
+	}
+	registerSnapshot();
+}
+
+
+
+PatternSnapshot::~PatternSnapshot()
+{
+}
+
+
+
+Pattern* PatternSnapshot::restore( InstrumentList* pInstruments )
+{
+	load();
+
+	Pattern* pPattern = new Pattern( m_sName, m_sInfo, m_sCategory, m_nLength );
+	for ( unsigned i = 0; i < m_notes.size(); i++ ) {
+		const NoteRecord& note = m_notes[ i ];
+		Note* pNote = new Note( 0, note.nPosition, note.fVelocity, note.fPan_L, note.fPan_R, note.nLength, note.fPitch );
+		pNote->set_lead_lag( note.fLeadLag );
+		pNote->set_key_octave( ( Note::Key )note.nKey, ( Note::Octave )note.nOctave );
+		pNote->set_note_off( note.bNoteOff );
+		pNote->set_instrument_id( note.nInstrument );
+		pNote->map_instrument( pInstruments );
+		pNote->set_probability( note.fProbability );
+		pPattern->insert_note( pNote );
+	}
+	return pPattern;
+}
+
+
+
+size_t PatternSnapshot::getSize() const
+{
+	return sizeof( *this ) + m_notes.capacity() * sizeof( NoteRecord )
+			+ ( m_sName.size() + m_sInfo.size() + m_sCategory.size() ) * sizeof( QChar );
+}
+
+
+
+void PatternSnapshot::write( QDataStream& stream ) const
+{
+	stream << m_sName << m_sInfo << m_sCategory << ( qint32 )m_nLength;
+	stream << ( quint32 )m_notes.size();
+	for ( unsigned i = 0; i < m_notes.size(); i++ ) {
+		const NoteRecord& note = m_notes[ i ];
+		stream << ( qint32 )note.nPosition << ( qint32 )note.nLength << ( qint32 )note.nInstrument
+			   << note.fVelocity << note.fPan_L << note.fPan_R << note.fPitch << note.fLeadLag << note.fProbability
+			   << note.nKey << note.nOctave << note.bNoteOff;
+	}
+}
+
+
+
+void PatternSnapshot::read( QDataStream& stream )
+{
+	qint32 nLength;
+	quint32 nNotes;
+	stream >> m_sName >> m_sInfo >> m_sCategory >> nLength;
+	m_nLength = nLength;
+	stream >> nNotes;
+	m_notes.resize( nNotes );
+	for ( unsigned i = 0; i < m_notes.size(); i++ ) {
+		NoteRecord& note = m_notes[ i ];
+		qint32 nPosition, nNoteLength, nInstrument;
+		stream >> nPosition >> nNoteLength >> nInstrument
+			   >> note.fVelocity >> note.fPan_L >> note.fPan_R >> note.fPitch >> note.fLeadLag >> note.fProbability
+			   >> note.nKey >> note.nOctave >> note.bNoteOff;
+		note.nPosition = nPosition;
+		note.nLength = nNoteLength;
+		note.nInstrument = nInstrument;
+	}
+}
+
+
+
+void PatternSnapshot::release()
+{
+	std::vector<NoteRecord>().swap( m_notes );
+}
+
+
+
+const char* SequenceSnapshot::__class_name = "SequenceSnapshot";
+
+SequenceSnapshot::SequenceSnapshot( Song* pSong )
+ : UndoSnapshot( __class_name )
+{
+	PatternList* pPatternList = pSong->get_pattern_list();
+	std::vector<PatternList*>* pColumns = pSong->get_pattern_group_vector();
+
+	m_groups.resize( pColumns->size() );
+	for ( unsigned i = 0; i < pColumns->size(); i++ ) {
+		PatternList* pColumn = ( *pColumns )[ i ];
+		m_groups[ i ].reserve( pColumn->size() );
+		for ( unsigned j = 0; j < pColumn->size(); j++ ) {
+			m_groups[ i ].push_back( pPatternList->index( pColumn->get( j ) ) );
+		}
+	}
+
+	for ( unsigned i = 0; i < pPatternList->size(); i++ ) {
+		Pattern* pPattern = pPatternList->get( i );
+		if ( pPattern->get_virtual_patterns()->empty() ) {
+			continue;
+		}
+		std::vector<int> virtuals;
+		virtuals.push_back( i );
+		for ( Pattern::virtual_patterns_cst_it_t it = pPattern->get_virtual_patterns()->begin(); it != pPattern->get_virtual_patterns()->end(); ++it ) {
+			virtuals.push_back( pPatternList->index( *it ) );
+		}
+		m_virtuals.push_back( virtuals );
+	}
+	registerSnapshot();
+}
+
+
+
+SequenceSnapshot::~SequenceSnapshot()
+{
+}
+
+
+
+void SequenceSnapshot::restore( Song* pSong )
+{
+	load();
+
+	PatternList* pPatternList = pSong->get_pattern_list();
+	std::vector<PatternList*>* pColumns = pSong->get_pattern_group_vector();
+
+	for ( unsigned i = 0; i < pColumns->size(); i++ ) {
+		PatternList* pColumn = ( *pColumns )[ i ];
+		pColumn->clear();
+		delete pColumn;
+	}
+	pColumns->clear();
+
+	// virtual patterns added since the snapshot are dropped
+	for ( unsigned i = 0; i < pPatternList->size(); i++ ) {
+		pPatternList->get( i )->virtual_patterns_clear();
+	}
+	for ( unsigned i = 0; i < m_virtuals.size(); i++ ) {
+		Pattern* pPattern = pPatternList->get( m_virtuals[ i ][ 0 ] );
+		for ( unsigned j = 1; j < m_virtuals[ i ].size(); j++ ) {
+			int nVirtual = m_virtuals[ i ][ j ];
+			if ( pPattern && nVirtual >= 0 && nVirtual < ( int )pPatternList->size() ) {
+				pPattern->virtual_patterns_add( pPatternList->get( nVirtual ) );
+			}
+		}
+	}
+	pPatternList->flattened_virtual_patterns_compute();
+
+	for ( unsigned i = 0; i < m_groups.size(); i++ ) {
+		PatternList* pColumn = new PatternList();
+		for ( unsigned j = 0; j < m_groups[ i ].size(); j++ ) {
+			int nPattern = m_groups[ i ][ j ];
+			if ( nPattern >= 0 && nPattern < ( int )pPatternList->size() ) {
+				pColumn->add( pPatternList->get( nPattern ) );
+			} else {
+				ERRORLOG( QString( "Invalid pattern %1 in group %2" ).arg( nPattern ).arg( i ) );
+			}
+		}
+		pColumns->push_back( pColumn );
+	}
+}
+
+
+
+size_t SequenceSnapshot::getSize() const
+{
+	size_t nSize = sizeof( *this );
+	for ( unsigned i = 0; i < m_groups.size(); i++ ) {
+		nSize += sizeof( std::vector<int> ) + m_groups[ i ].capacity() * sizeof( int );
+	}
+	for ( unsigned i = 0; i < m_virtuals.size(); i++ ) {
+		nSize += sizeof( std::vector<int> ) + m_virtuals[ i ].capacity() * sizeof( int );
+	}
+	return nSize;
+}
+
+
+
+static void writeLists( QDataStream& stream, const std::vector< std::vector<int> >& lists )
+{
+	stream << ( quint32 )lists.size();
+	for ( unsigned i = 0; i < lists.size(); i++ ) {
+		stream << ( quint32 )lists[ i ].size();
+		for ( unsigned j = 0; j < lists[ i ].size(); j++ ) {
+			stream << ( qint32 )lists[ i ][ j ];
+		}
+	}
+}
+
+
+
+static void readLists( QDataStream& stream, std::vector< std::vector<int> >& lists )
+{
+	quint32 nLists;
+	stream >> nLists;
+	lists.resize( nLists );
+	for ( unsigned i = 0; i < lists.size(); i++ ) {
+		quint32 nSize;
+		stream >> nSize;
+		lists[ i ].resize( nSize );
+		for ( unsigned j = 0; j < lists[ i ].size(); j++ ) {
+			qint32 nValue;
+			stream >> nValue;
+			lists[ i ][ j ] = nValue;
+		}
+	}
+}
+
+
+
+void SequenceSnapshot::write( QDataStream& stream ) const
+{
+	writeLists( stream, m_groups );
+	writeLists( stream, m_virtuals );
+}
+
+
+
+void SequenceSnapshot::read( QDataStream& stream )
+{
+	readLists( stream, m_groups );
+	readLists( stream, m_virtuals );
+}
+
+
+
+void SequenceSnapshot::release()
+{
+	std::vector< std::vector<int> >().swap( m_groups );
+	std::vector< std::vector<int> >().swap( m_virtuals );
+}
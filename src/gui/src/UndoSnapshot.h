@@ -0,0 +1,152 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef UNDO_SNAPSHOT_H
+#define UNDO_SNAPSHOT_H
+
+#include <hydrogen/object.h>
+
+#include <list>
+#include <vector>
+#include <QString>
+#include <QDataStream>
+
+namespace H2Core
+{
+	class Song;
+	class Pattern;
+	class InstrumentList;
+}
+
+///
+/// Song data kept by an undo command to restore it later.
+///
+/// All the snapshots share a memory budget. Once it is exceeded the oldest
+/// ones are moved to a temporary file and read back when they are used.
+///
+class UndoSnapshot : public H2Core::Object
+{
+	public:
+		virtual ~UndoSnapshot();
+
+		/// set the memory shared by all the snapshots, in bytes
+		static void setBudget( size_t nBytes );
+		/// memory used by the snapshots currently in memory, in bytes
+		static size_t getMemoryUsage() { return m_nMemory; }
+
+	protected:
+		UndoSnapshot( const char* sClassName );
+
+		/// account for the captured data, to be called at the end of the constructor of the subclasses
+		void registerSnapshot();
+		/// make sure the data is in memory, to be called before using it
+		void load();
+
+		/// approximate memory used by the data, in bytes
+		virtual size_t getSize() const = 0;
+		virtual void write( QDataStream& stream ) const = 0;
+		virtual void read( QDataStream& stream ) = 0;
+		/// free the data once it has been written
+		virtual void release() = 0;
+
+	private:
+		QString m_sSpillPath;		///< empty while the data is in memory
+		size_t m_nSize;
+
+		void spill();
+		static void enforceBudget( UndoSnapshot* pKeep );
+
+		static std::list<UndoSnapshot*> m_snapshots;	///< in memory, oldest first
+		static size_t m_nMemory;
+		static size_t m_nBudget;
+};
+
+
+
+///
+/// A pattern and its notes, the notes refer to their instrument by ID.
+///
+class PatternSnapshot : public UndoSnapshot
+{
+	H2_OBJECT
+	public:
+		PatternSnapshot( H2Core::Pattern* pPattern );
+		~PatternSnapshot();
+
+		/// create a copy of the pattern, its notes mapped on the given instruments
+		H2Core::Pattern* restore( H2Core::InstrumentList* pInstruments );
+
+	private:
+		struct NoteRecord {
+			int nPosition;
+			int nLength;
+			int nInstrument;
+			float fVelocity;
+			float fPan_L;
+			float fPan_R;
+			float fPitch;
+			float fLeadLag;
+			float fProbability;
+			qint8 nKey;
+			qint8 nOctave;
+			bool bNoteOff;
+		};
+
+		QString m_sName;
+		QString m_sInfo;
+		QString m_sCategory;
+		int m_nLength;
+		std::vector<NoteRecord> m_notes;
+
+		virtual size_t getSize() const;
+		virtual void write( QDataStream& stream ) const;
+		virtual void read( QDataStream& stream );
+		virtual void release();
+};
+
+
+
+///
+/// The pattern sequence of a song and the virtual patterns, patterns are
+/// referred to by their position in the pattern list.
+///
+class SequenceSnapshot : public UndoSnapshot
+{
+	H2_OBJECT
+	public:
+		SequenceSnapshot( H2Core::Song* pSong );
+		~SequenceSnapshot();
+
+		/// replace the sequence and the virtual patterns of the song, the pattern list must be the one of the capture
+		void restore( H2Core::Song* pSong );
+
+	private:
+		std::vector< std::vector<int> > m_groups;		///< patterns of each column
+		std::vector< std::vector<int> > m_virtuals;		///< pattern followed by its virtual patterns
+
+		virtual size_t getSize() const;
+		virtual void write( QDataStream& stream ) const;
+		virtual void read( QDataStream& stream );
+		virtual void release();
+};
+
+#endif // UNDO_SNAPSHOT_H
@@ -21,6 +21,7 @@
  */
 #include "AutomationPathView.h"
 #include <hydrogen/Preferences.h>
+#include <hydrogen/audio_engine.h>
 #include "../SongEditor/SongEditor.h"
 
 const char* AutomationPathView::__class_name = "AutomationPathView";
@@ -204,6 +205,8 @@ void AutomationPathView::mousePressEvent(QMouseEvent *event)
 	float x = p.first;
 	float y = p.second;
 
+	// the sampler reads the paths at every block
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	_selectedPoint = _path->find(x);
 	if (_selectedPoint == _path->end()) {
 		_path->add_point(x, y);	
@@ -216,6 +219,7 @@ void AutomationPathView::mousePressEvent(QMouseEvent *event)
 		m_fOriginY = y;
 		m_bPointAdded = false;
 	}
+	AudioEngine::get_instance()->unlock();
 
 	update();
 
@@ -264,7 +268,9 @@ void AutomationPathView::mouseMoveEvent(QMouseEvent *event)
 	float y = p.second;
 
 	if(m_bIsHolding) {
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		_selectedPoint = _path->move(_selectedPoint, x, y);
+		AudioEngine::get_instance()->unlock();
 	}
 
 	update();
@@ -282,7 +288,9 @@ void AutomationPathView::keyPressEvent(QKeyEvent *event)
 		if ( _path && _selectedPoint != _path->end() ) {
 			float x = _selectedPoint->first;
 			float y = _selectedPoint->second;
+			AudioEngine::get_instance()->lock( RIGHT_HERE );
 			_path->remove_point(_selectedPoint->first);
+			AudioEngine::get_instance()->unlock();
 			_selectedPoint = _path->end();
 
 			emit pointRemoved( x, y );
@@ -47,6 +47,8 @@
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/globals.h>
 #include <hydrogen/event_queue.h>
+#include <hydrogen/meter_bus.h>
+#include <hydrogen/engine_profiler.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/h2_exception.h>
 #include <hydrogen/basics/playlist.h>
@@ -408,6 +410,8 @@ int main(int argc, char *argv[])
 		delete pPref;
 		delete H2Core::EventQueue::get_instance();
 		delete H2Core::AudioEngine::get_instance();
+		delete H2Core::MeterBus::get_instance();
+		delete H2Core::EngineProfiler::get_instance();
 
 		delete MidiMap::get_instance();
 		delete MidiActionManager::get_instance();
@@ -29,6 +29,8 @@
 #include <hydrogen/Preferences.h>
 #include <hydrogen/fx/Effects.h>
 #include <hydrogen/event_queue.h>
+#include <hydrogen/meter_bus.h>
+#include <hydrogen/engine_profiler.h>
 #include <hydrogen/audio_engine.h>
 #include <hydrogen/helpers/filesystem.h>
 #include <hydrogen/midi_map.h>
@@ -97,6 +99,8 @@ int main(int argc, char** argv){
 				delete pSong;
 				delete H2Core::EventQueue::get_instance();
 				delete H2Core::AudioEngine::get_instance();
+				delete H2Core::MeterBus::get_instance();
+				delete H2Core::EngineProfiler::get_instance();
 				delete preferences;
 				delete H2Core::Logger::get_instance();
 
@@ -22,8 +22,12 @@
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <QDomDocument>
+#include <QXmlStreamWriter>
 
 #include <hydrogen/basics/automation_path.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/song.h>
 #include <hydrogen/automation_path_serializer.h>
 
 using namespace H2Core;
@@ -34,6 +38,7 @@ class AutomationPathSerializerTest : public CppUnit::TestCase {
 	CPPUNIT_TEST(testRead);
 	CPPUNIT_TEST(testWrite);
 	CPPUNIT_TEST(testRoundtripReadWrite);
+	CPPUNIT_TEST(testRoundtripInstrumentPaths);
 	CPPUNIT_TEST_SUITE_END();
 
 	public:
@@ -104,6 +109,59 @@ class AutomationPathSerializerTest : public CppUnit::TestCase {
 
 		CPPUNIT_ASSERT_EQUAL(p1, p2);
 	}
+
+
+	Song* createSong()
+	{
+		Song* song = new Song("automation", "test", 120, 0.5);
+		InstrumentList* instruments = new InstrumentList();
+		instruments->add(new Instrument(3, "Kick"));
+		instruments->add(new Instrument(7, "Snare"));
+		song->set_instrument_list(instruments);
+		return song;
+	}
+
+
+	void testRoundtripInstrumentPaths()
+	{
+		Song* s1 = createSong();
+		s1->get_velocity_automation_path()->add_point(1.0f, 0.5f);
+		Instrument* snare = s1->get_instrument_list()->get(1);
+		snare->get_automation_path(Instrument::AUTOMATION_VOLUME)->add_point(0.0f, 0.25f);
+		snare->get_automation_path(Instrument::AUTOMATION_PAN)->add_point(2.0f, 1.0f);
+		snare->get_automation_path(Instrument::AUTOMATION_FILTER_CUTOFF)->add_point(1.5f, 0.5f);
+		snare->get_automation_path((Instrument::AutomationTarget)(Instrument::AUTOMATION_FX_LEVEL + 1))->add_point(3.0f, 0.75f);
+
+		QString xml;
+		QXmlStreamWriter writer(&xml);
+		writer.writeStartElement("automationPaths");
+		AutomationPathSerializer serializer;
+		serializer.write_automation_paths(writer, s1);
+		writer.writeEndElement();
+
+		QDomDocument doc;
+		CPPUNIT_ASSERT(doc.setContent(xml, false));
+		Song* s2 = createSong();
+		serializer.read_automation_paths(doc.documentElement(), s2);
+
+		CPPUNIT_ASSERT_EQUAL(*s1->get_velocity_automation_path(), *s2->get_velocity_automation_path());
+		for (int i = 0; i < 2; ++i) {
+			Instrument* i1 = s1->get_instrument_list()->get(i);
+			Instrument* i2 = s2->get_instrument_list()->get(i);
+			for (int target = 0; target < Instrument::AUTOMATION_TARGETS; ++target) {
+				CPPUNIT_ASSERT_EQUAL(*i1->get_automation_path((Instrument::AutomationTarget)target),
+									 *i2->get_automation_path((Instrument::AutomationTarget)target));
+			}
+		}
+		// the fx level path went to its send
+		AutomationPath expect(0.0f, 1.0f, 0.0f);
+		expect.add_point(3.0f, 0.75f);
+		CPPUNIT_ASSERT_EQUAL(expect, *s2->get_instrument_list()->get(1)->get_automation_path((Instrument::AutomationTarget)(Instrument::AUTOMATION_FX_LEVEL + 1)));
+		CPPUNIT_ASSERT(s2->get_instrument_list()->get(1)->get_automation_path(Instrument::AUTOMATION_FX_LEVEL)->empty());
+
+		delete s1;
+		delete s2;
+	}
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( AutomationPathSerializerTest );
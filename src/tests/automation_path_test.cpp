@@ -60,6 +60,7 @@ class AutomationPathTest : public CppUnit::TestCase {
 	CPPUNIT_TEST(testFindNotFound);
 	CPPUNIT_TEST(testMovePoint);
 	CPPUNIT_TEST(testRemovePoint);
+	CPPUNIT_TEST(testValueAfterMove);
 	CPPUNIT_TEST_SUITE_END();
 
 	const double delta = 0.0001;
@@ -335,6 +336,27 @@ class AutomationPathTest : public CppUnit::TestCase {
 				delta);
 
 	}
+
+
+	void testValueAfterMove()
+	{
+		AutomationPath p(0.0f, 1.0f, 1.0f);
+		p.add_point(0.0f, 0.0f);
+		p.add_point(2.0f, 1.0f);
+		p.add_point(4.0f, 0.0f);
+
+		auto in = p.find(2.0f);
+		p.move(in, 3.0f, 0.5f);
+
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(
+				0.25,
+				static_cast<double>(p.get_value(1.5f)),
+				delta);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(
+				0.25,
+				static_cast<double>(p.get_value(3.5f)),
+				delta);
+	}
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( AutomationPathTest );
@@ -0,0 +1,101 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/helpers/denormals.h>
+
+#include <cmath>
+#include <pthread.h>
+
+using namespace H2Core;
+
+/**
+ * \brief Enable flush to zero and compute a denormal product, in a thread
+ * of its own so that the mode doesn't leak into the other tests
+ **/
+void* flushToZeroThread( void* param )
+{
+	float* pResult = static_cast<float*>( param );
+	if ( !enable_flush_to_zero() ) {
+		*pResult = -1.0f;
+		return NULL;
+	}
+	volatile float fValue = 1e-30f;
+	*pResult = fValue * 1e-10f;
+	return NULL;
+}
+
+class DenormalsTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( DenormalsTest );
+	CPPUNIT_TEST( testFlushDenormal );
+	CPPUNIT_TEST( testFilterTail );
+	CPPUNIT_TEST( testFlushToZero );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+
+	void testFlushDenormal()
+	{
+		volatile float fDenormal = 1e-39f;
+		CPPUNIT_ASSERT( std::fpclassify( fDenormal ) == FP_SUBNORMAL );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, flush_denormal( fDenormal ) );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, flush_denormal( 1e-26f ) );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, flush_denormal( -1e-26f ) );
+		// audible values are unchanged
+		CPPUNIT_ASSERT_EQUAL( 0.1f, flush_denormal( 0.1f ) );
+		CPPUNIT_ASSERT_EQUAL( -0.5f, flush_denormal( -0.5f ) );
+		CPPUNIT_ASSERT_EQUAL( 1e-6f, flush_denormal( 1e-6f ) );
+	}
+
+	void testFilterTail()
+	{
+		// this thread keeps the default mode, denormal results are not flushed by the CPU
+		Instrument instr( 1, "Tail" );
+		Note note( &instr, 0, 1.0f, 0.5f, 0.5f, -1, 0.0f );
+		for ( int i = 0; i < 48000; i++ ) {
+			// a loud note then silence, the resonant filter rings down
+			float fL = i < 2000 ? 0.1f * sin( 0.02 * i ) : 0.0f;
+			float fR = fL;
+			note.compute_lr_values( &fL, &fR, 0.3f, 0.95f );
+			CPPUNIT_ASSERT( std::fpclassify( fL ) != FP_SUBNORMAL );
+			CPPUNIT_ASSERT( std::fpclassify( fR ) != FP_SUBNORMAL );
+		}
+	}
+
+	void testFlushToZero()
+	{
+		float fResult = 0.0f;
+		pthread_t thread;
+		CPPUNIT_ASSERT_EQUAL( 0, pthread_create( &thread, NULL, flushToZeroThread, &fResult ) );
+		pthread_join( thread, NULL );
+		if ( fResult < 0.0f ) {
+			// no flush to zero mode on this platform
+			return;
+		}
+		CPPUNIT_ASSERT_EQUAL( 0.0f, fResult );
+	}
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION( DenormalsTest );
@@ -0,0 +1,89 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/engine_profiler.h>
+
+using namespace H2Core;
+
+class EngineProfilerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( EngineProfilerTest );
+	CPPUNIT_TEST( testPercentiles );
+	CPPUNIT_TEST( testXRuns );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+
+	void setUp()
+	{
+		EngineProfiler::create_instance();
+		EngineProfiler::get_instance()->reset();
+		EngineProfiler::get_instance()->begin_cycle();
+	}
+
+	void testPercentiles()
+	{
+		EngineProfiler* pProfiler = EngineProfiler::get_instance();
+		for ( int i = 0; i < 1000; i++ ) {
+			pProfiler->add( EngineProfiler::SAMPLER, 10000 );
+		}
+		for ( int i = 0; i < 5; i++ ) {
+			pProfiler->add( EngineProfiler::SAMPLER, 2000000 );
+		}
+
+		ProfileSnapshot snapshot;
+		pProfiler->get_snapshot( snapshot );
+		const StageStats& stats = snapshot.stage[ EngineProfiler::SAMPLER ];
+		CPPUNIT_ASSERT_EQUAL( (uint64_t)1005, stats.count );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 2000.0, stats.max, 0.01 );
+		// a quarter of octave is the resolution of the percentiles
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 10.0, stats.p50, 1.5 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 10.0, stats.p99, 1.5 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( ( 10000.0 * 1000 + 2000000.0 * 5 ) / 1005 / 1000, stats.mean, 0.01 );
+		CPPUNIT_ASSERT_EQUAL( (uint64_t)0, snapshot.stage[ EngineProfiler::SYNTH ].count );
+	}
+
+	void testXRuns()
+	{
+		EngineProfiler* pProfiler = EngineProfiler::get_instance();
+		CPPUNIT_ASSERT( !pProfiler->end_cycle( 1000000, 5000000 ) );
+		CPPUNIT_ASSERT( pProfiler->end_cycle( 6000000, 5000000 ) );
+		pProfiler->report_xrun();
+
+		ProfileSnapshot snapshot;
+		pProfiler->get_snapshot( snapshot );
+		CPPUNIT_ASSERT_EQUAL( (uint64_t)2, snapshot.cycles );
+		CPPUNIT_ASSERT_EQUAL( (uint64_t)1, snapshot.xruns );
+		CPPUNIT_ASSERT_EQUAL( (uint64_t)1, snapshot.driver_xruns );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 6000.0, snapshot.worst_us, 0.01 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 5000.0, snapshot.budget_us, 0.01 );
+
+		pProfiler->reset();
+		pProfiler->begin_cycle();
+		pProfiler->get_snapshot( snapshot );
+		CPPUNIT_ASSERT_EQUAL( (uint64_t)0, snapshot.cycles );
+		CPPUNIT_ASSERT_EQUAL( (uint64_t)0, snapshot.xruns );
+	}
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION( EngineProfilerTest );
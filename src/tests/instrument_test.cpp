@@ -0,0 +1,102 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/automation_path.h>
+
+using namespace H2Core;
+
+class InstrumentTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( InstrumentTest );
+	CPPUNIT_TEST( testBlockParamsWithoutAutomation );
+	CPPUNIT_TEST( testBlockParamsFollowAutomation );
+	CPPUNIT_TEST( testBlockParamsGlide );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+
+	void testBlockParamsWithoutAutomation()
+	{
+		Instrument instr( 1, "Kick" );
+		instr.set_volume( 0.7f );
+		instr.set_fx_level( 0.3f, 0 );
+
+		// outside song playback the paths are ignored
+		instr.get_automation_path( Instrument::AUTOMATION_VOLUME )->add_point( 0.0f, 0.1f );
+		instr.update_block_params( 3, -1.0f, -1.0f, 1.0f );
+
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.7, instr.get_block_params( false ).volume, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.7, instr.get_block_params( true ).volume, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.3, instr.get_block_params( true ).fx_level[0], 1e-6 );
+	}
+
+	void testBlockParamsFollowAutomation()
+	{
+		Instrument instr( 1, "Kick" );
+		instr.set_volume( 0.7f );
+		AutomationPath* pVolume = instr.get_automation_path( Instrument::AUTOMATION_VOLUME );
+		pVolume->add_point( 0.0f, 0.2f );
+		pVolume->add_point( 2.0f, 1.0f );
+		instr.get_automation_path( Instrument::AUTOMATION_PAN )->add_point( 0.0f, 0.0f );
+
+		instr.update_block_params( 5, 0.0f, 1.0f, 1.0f );
+		const Instrument::BlockParams& start = instr.get_block_params( false );
+		const Instrument::BlockParams& end = instr.get_block_params( true );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.2, start.volume, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.6, end.volume, 1e-6 );
+		// panned hard left
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, end.pan_l, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, end.pan_r, 1e-6 );
+		// the parameters without automation keep their value
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( instr.get_filter_cutoff(), end.filter_cutoff, 1e-6 );
+
+		// the block is evaluated once
+		instr.update_block_params( 5, 1.0f, 2.0f, 1.0f );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.6, instr.get_block_params( true ).volume, 1e-6 );
+	}
+
+	void testBlockParamsGlide()
+	{
+		Instrument instr( 1, "Kick" );
+		AutomationPath* pVolume = instr.get_automation_path( Instrument::AUTOMATION_VOLUME );
+		pVolume->add_point( 0.0f, 0.2f );
+		pVolume->add_point( 2.0f, 1.0f );
+
+		// a block not following the previous one jumps to the values
+		instr.update_block_params( 3, 0.0f, 1.0f, 0.5f );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.6, instr.get_block_params( true ).volume, 1e-6 );
+
+		// the next block starts where the previous ended and covers half of the way
+		instr.update_block_params( 4, 1.0f, 2.0f, 0.5f );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.6, instr.get_block_params( false ).volume, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.8, instr.get_block_params( true ).volume, 1e-6 );
+
+		// and after a gap as well
+		instr.update_block_params( 10, 0.0f, 1.0f, 0.5f );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.2, instr.get_block_params( false ).volume, 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.6, instr.get_block_params( true ).volume, 1e-6 );
+	}
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION( InstrumentTest );
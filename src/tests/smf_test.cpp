@@ -0,0 +1,211 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <QFile>
+#include <QString>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/smf/SMF.h>
+#include "test_helper.h"
+
+#include <memory>
+
+using namespace H2Core;
+
+/**
+ * \brief Count the notes played by the columns of the sequence
+ * \param pSong The song
+ * \param nFirstColumn The first column to count
+ **/
+int countSequenceNotes( Song *pSong, unsigned nFirstColumn )
+{
+	int nNotes = 0;
+	std::vector<PatternList*> *pColumns = pSong->get_pattern_group_vector();
+	for ( unsigned i = nFirstColumn; i < pColumns->size(); i++ ) {
+		PatternList *pColumn = ( *pColumns )[ i ];
+		for ( int j = 0; j < pColumn->size(); j++ ) {
+			nNotes += pColumn->get( j )->get_notes()->size();
+		}
+	}
+	return nNotes;
+}
+
+/**
+ * \brief Write raw bytes to a file
+ * \param sFilename The file to write
+ * \param pData The bytes
+ * \param nSize Their number
+ **/
+void writeBytes( const QString& sFilename, const unsigned char* pData, size_t nSize )
+{
+	QFile file( sFilename );
+	CPPUNIT_ASSERT( file.open( QIODevice::WriteOnly ) );
+	CPPUNIT_ASSERT_EQUAL( (qint64)nSize, file.write( ( const char* )pData, nSize ) );
+}
+
+/**
+ * \brief Write a type 0 file playing one kick note in a given time signature
+ * \param sFilename The file to write
+ * \param nBeats The numerator of the time signature
+ * \param nExponent The denominator of the time signature, as a power of two
+ **/
+void writeTimeSignatureFile( const QString& sFilename, unsigned char nBeats, unsigned char nExponent )
+{
+	const unsigned char data[] = {
+		'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 48,
+		'M', 'T', 'r', 'k', 0, 0, 0, 20,
+		0, 0xFF, 0x58, 4, nBeats, nExponent, 24, 8,
+		0, 0x90, 36, 100,
+		24, 0x80, 36, 0,
+		0, 0xFF, 0x2F, 0
+	};
+	writeBytes( sFilename, data, sizeof( data ) );
+}
+
+
+class SMFTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SMFTest );
+	CPPUNIT_TEST( testImportType1 );
+	CPPUNIT_TEST( testImportType0 );
+	CPPUNIT_TEST( testImportReference );
+	CPPUNIT_TEST( testTimeSignature );
+	CPPUNIT_TEST( testHeaderLength );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+
+	/**
+	 * \brief Export a song, import it back into the song and compare the
+	 * notes of the new columns with the notes of the original ones
+	 **/
+	void checkRoundTrip( int nFormat )
+	{
+		auto songFile = H2TEST_FILE("functional/test.h2song");
+		auto outFile = Filesystem::tmp_file_path("roundtrip.mid");
+
+		std::unique_ptr<Song> pSong { Song::load( songFile ) };
+		CPPUNIT_ASSERT( pSong != NULL );
+		unsigned nColumns = pSong->get_pattern_group_vector()->size();
+		int nNotes = countSequenceNotes( pSong.get(), 0 );
+
+		SMFWriter writer;
+		CPPUNIT_ASSERT( writer.save( outFile, pSong.get(), nFormat ) );
+
+		pSong->set_is_modified( false );
+		SMFReader reader;
+		CPPUNIT_ASSERT( reader.load( outFile, pSong.get() ) );
+		CPPUNIT_ASSERT( pSong->get_is_modified() );
+		CPPUNIT_ASSERT( pSong->get_pattern_group_vector()->size() > nColumns );
+		CPPUNIT_ASSERT_EQUAL( nNotes, countSequenceNotes( pSong.get(), nColumns ) );
+
+		Filesystem::rm( outFile );
+	}
+
+	void testImportType1()
+	{
+		checkRoundTrip( 1 );
+	}
+
+	void testImportType0()
+	{
+		checkRoundTrip( 0 );
+	}
+
+	void testImportReference()
+	{
+		auto songFile = H2TEST_FILE("functional/test.h2song");
+		auto midiFile = H2TEST_FILE("functional/test.ref.mid");
+
+		std::unique_ptr<Song> pSong { Song::load( songFile ) };
+		CPPUNIT_ASSERT( pSong != NULL );
+		unsigned nColumns = pSong->get_pattern_group_vector()->size();
+		int nNotes = countSequenceNotes( pSong.get(), 0 );
+
+		SMFReader reader;
+		CPPUNIT_ASSERT( reader.load( midiFile, pSong.get() ) );
+		CPPUNIT_ASSERT_EQUAL( nNotes, countSequenceNotes( pSong.get(), nColumns ) );
+	}
+
+	void testTimeSignature()
+	{
+		auto songFile = H2TEST_FILE("functional/test.h2song");
+		auto midiFile = Filesystem::tmp_file_path("signature.mid");
+
+		std::unique_ptr<Song> pSong { Song::load( songFile ) };
+		CPPUNIT_ASSERT( pSong != NULL );
+		PatternList *pPatterns = pSong->get_pattern_list();
+		SMFReader reader;
+
+		// 3/8
+		writeTimeSignatureFile( midiFile, 3, 3 );
+		CPPUNIT_ASSERT( reader.load( midiFile, pSong.get() ) );
+		CPPUNIT_ASSERT_EQUAL( 3 * MAX_NOTES / 8, pPatterns->get( pPatterns->size() - 1 )->get_length() );
+
+		// a bar longer than a pattern can be
+		writeTimeSignatureFile( midiFile, 255, 2 );
+		CPPUNIT_ASSERT( reader.load( midiFile, pSong.get() ) );
+		CPPUNIT_ASSERT_EQUAL( MAX_NOTES, pPatterns->get( pPatterns->size() - 1 )->get_length() );
+
+		// a denominator out of range is ignored
+		writeTimeSignatureFile( midiFile, 3, 40 );
+		CPPUNIT_ASSERT( reader.load( midiFile, pSong.get() ) );
+		CPPUNIT_ASSERT_EQUAL( MAX_NOTES, pPatterns->get( pPatterns->size() - 1 )->get_length() );
+
+		Filesystem::rm( midiFile );
+	}
+
+	void testHeaderLength()
+	{
+		auto songFile = H2TEST_FILE("functional/test.h2song");
+		auto midiFile = Filesystem::tmp_file_path("header.mid");
+
+		std::unique_ptr<Song> pSong { Song::load( songFile ) };
+		CPPUNIT_ASSERT( pSong != NULL );
+		unsigned nColumns = pSong->get_pattern_group_vector()->size();
+		SMFReader reader;
+
+		// past the end of the file, and negative once added to the position in 32 bits
+		const unsigned char huge[] = {
+			'M', 'T', 'h', 'd', 0xFF, 0xFF, 0xFF, 0xF0, 0, 0, 0, 1, 0, 48,
+			'M', 'T', 'r', 'k', 0, 0, 0, 0
+		};
+		writeBytes( midiFile, huge, sizeof( huge ) );
+		CPPUNIT_ASSERT( !reader.load( midiFile, pSong.get() ) );
+
+		// shorter than the fields read
+		const unsigned char shortHeader[] = {
+			'M', 'T', 'h', 'd', 0, 0, 0, 2, 0, 0, 0, 1, 0, 48,
+			'M', 'T', 'r', 'k', 0, 0, 0, 0
+		};
+		writeBytes( midiFile, shortHeader, sizeof( shortHeader ) );
+		CPPUNIT_ASSERT( !reader.load( midiFile, pSong.get() ) );
+		CPPUNIT_ASSERT_EQUAL( nColumns, (unsigned)pSong->get_pattern_group_vector()->size() );
+
+		Filesystem::rm( midiFile );
+	}
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION( SMFTest );
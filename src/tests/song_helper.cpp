@@ -0,0 +1,78 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "song_helper.h"
+
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/drumkit_component.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+
+using namespace H2Core;
+
+Song* H2Test::createBigSong( int nPatterns, int nInstruments )
+{
+	Song* pSong = new Song( "big", "hydrogen", 120, 0.5 );
+
+	pSong->get_components()->push_back( new DrumkitComponent( 0, "Main" ) );
+
+	InstrumentList* pInstruments = new InstrumentList();
+	for ( int i = 0; i < nInstruments; i++ ) {
+		pInstruments->add( new Instrument( i, QString( "Instrument %1" ).arg( i ) ) );
+	}
+	pSong->set_instrument_list( pInstruments );
+
+	PatternList* pPatterns = new PatternList();
+	std::vector<PatternList*>* pGroups = new std::vector<PatternList*>;
+	for ( int p = 0; p < nPatterns; p++ ) {
+		Pattern* pPattern = new Pattern( QString( "Pattern %1" ).arg( p ), "", "not_categorized", MAX_NOTES );
+		for ( int i = 0; i < nInstruments; i++ ) {
+			for ( int nPosition = ( i + p ) % 6; nPosition < MAX_NOTES; nPosition += 6 ) {
+				Note* pNote = new Note( pInstruments->get( i ), nPosition, 0.5f + 0.01f * ( nPosition % 50 ), 0.5f, 0.5f, -1, 0.0f );
+				pNote->set_lead_lag( 0.1f );
+				pPattern->insert_note( pNote );
+			}
+		}
+		pPatterns->add( pPattern );
+
+		PatternList* pGroup = new PatternList();
+		pGroup->add( pPattern );
+		pGroups->push_back( pGroup );
+	}
+	pSong->set_pattern_list( pPatterns );
+	pSong->set_pattern_group_vector( pGroups );
+
+	return pSong;
+}
+
+int H2Test::countNotes( Song* pSong )
+{
+	int nNotes = 0;
+	PatternList* pPatterns = pSong->get_pattern_list();
+	for ( int i = 0; i < pPatterns->size(); i++ ) {
+		nNotes += pPatterns->get( i )->get_notes()->size();
+	}
+	return nNotes;
+}
@@ -0,0 +1,47 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SONG_HELPER_H
+#define SONG_HELPER_H
+
+namespace H2Core {
+	class Song;
+}
+
+namespace H2Test {
+
+	/**
+	 * \brief Create a song with many patterns and notes
+	 * \param nPatterns Number of patterns, each one is played in its own group
+	 * \param nInstruments Number of instruments, they have no samples
+	 **/
+	H2Core::Song* createBigSong( int nPatterns, int nInstruments );
+
+	/**
+	 * \brief Count the notes of all the patterns of a song
+	 * \param pSong The song
+	 **/
+	int countNotes( H2Core::Song* pSong );
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/event_queue.h>
+#include <hydrogen/song_preloader.h>
+#include <hydrogen/timeline.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/helpers/filesystem.h>
+#include "test_helper.h"
+
+#include <memory>
+
+using namespace H2Core;
+
+class SongPreloaderTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SongPreloaderTest );
+	CPPUNIT_TEST( testTakeLeavesGlobals );
+	CPPUNIT_TEST( testSupersededSwitch );
+	CPPUNIT_TEST( testSwitchAfterSuperseded );
+	CPPUNIT_TEST_SUITE_END();
+
+	QString m_sSongFile;
+
+	/** wait for EVENT_PLAYLIST_LOADSONG to be raised for an entry */
+	bool waitForSwitch( int nSongNumber )
+	{
+		EventQueue* pQueue = EventQueue::get_instance();
+		for ( int i = 0; i < 100; i++ ) {
+			Event event = pQueue->pop_event();
+			if ( event.type == EVENT_NONE ) {
+				pQueue->wait_event( 100 );
+			} else if ( event.type == EVENT_PLAYLIST_LOADSONG && event.value == nSongNumber ) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	public:
+
+	void setUp()
+	{
+		// a song with its own tempo and timeline
+		m_sSongFile = Filesystem::tmp_file_path( "preload.h2song" );
+		Hydrogen* pHydrogen = Hydrogen::get_instance();
+		Timeline* pTimeline = pHydrogen->getTimeline();
+		Timeline::HTimelineVector tlvector;
+		tlvector.m_htimelinebeat = 4;
+		tlvector.m_htimelinebpm = 90.0f;
+		pTimeline->m_timelinevector.push_back( tlvector );
+
+		std::unique_ptr<Song> pSong { Song::load( H2TEST_FILE( "functional/test.h2song" ) ) };
+		CPPUNIT_ASSERT( pSong != NULL );
+		pSong->__bpm = 137.0f;
+		CPPUNIT_ASSERT( pSong->save( m_sSongFile ) );
+
+		pTimeline->m_timelinevector.clear();
+		pHydrogen->setNewBpmJTM( 100.0f );
+	}
+
+	void tearDown()
+	{
+		Hydrogen::get_instance()->getTimeline()->m_timelinevector.clear();
+		Filesystem::rm( m_sSongFile );
+	}
+
+	void testTakeLeavesGlobals()
+	{
+		Hydrogen* pHydrogen = Hydrogen::get_instance();
+		SongPreloader* pPreloader = SongPreloader::get_instance();
+
+		// take doesn't wait for the reading, the switch is raised once it is done
+		pPreloader->preload( 7, m_sSongFile, true );
+		CPPUNIT_ASSERT( waitForSwitch( 7 ) );
+		SongReader::Globals* pGlobals = NULL;
+		bool bPending;
+		std::unique_ptr<Song> pSong { pPreloader->take( 7, m_sSongFile, &pGlobals, &bPending ) };
+		CPPUNIT_ASSERT( !bPending );
+		CPPUNIT_ASSERT( pSong != NULL );
+		CPPUNIT_ASSERT( pGlobals != NULL );
+
+		// reading the song in the background left the engine alone
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 137.0, pGlobals->fBpm, 1e-3 );
+		CPPUNIT_ASSERT_EQUAL( (size_t)1, pGlobals->timeline.size() );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, pHydrogen->getNewBpmJTM(), 1e-3 );
+		CPPUNIT_ASSERT( pHydrogen->getTimeline()->m_timelinevector.empty() );
+
+		SongReader::applyGlobals( pGlobals );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 137.0, pHydrogen->getNewBpmJTM(), 1e-3 );
+		CPPUNIT_ASSERT_EQUAL( (size_t)1, pHydrogen->getTimeline()->m_timelinevector.size() );
+		CPPUNIT_ASSERT_EQUAL( 4, pHydrogen->getTimeline()->m_timelinevector[0].m_htimelinebeat );
+		delete pGlobals;
+	}
+
+	void testSupersededSwitch()
+	{
+		SongPreloader* pPreloader = SongPreloader::get_instance();
+
+		// the transport is stopped, the switch is raised once the song is read
+		pPreloader->preload( 1, m_sSongFile, true );
+		CPPUNIT_ASSERT( waitForSwitch( 1 ) );
+
+		// another entry is asked for before the event is handled
+		pPreloader->preload( 2, m_sSongFile, false );
+
+		SongReader::Globals* pGlobals = NULL;
+		bool bPending;
+		Song* pSong = pPreloader->take( 1, m_sSongFile, &pGlobals, &bPending );
+		CPPUNIT_ASSERT( bPending );
+		CPPUNIT_ASSERT( pSong == NULL );
+
+		// only once, entry 1 may be loaded again later
+		pSong = pPreloader->take( 1, m_sSongFile, &pGlobals, &bPending );
+		CPPUNIT_ASSERT( !bPending );
+		CPPUNIT_ASSERT( pSong == NULL );
+
+		// entry 2 may still be read, then its switch follows the reading
+		pSong = pPreloader->take( 2, m_sSongFile, &pGlobals, &bPending );
+		if ( pSong == NULL ) {
+			CPPUNIT_ASSERT( bPending );
+			CPPUNIT_ASSERT( waitForSwitch( 2 ) );
+			pSong = pPreloader->take( 2, m_sSongFile, &pGlobals, &bPending );
+		}
+		std::unique_ptr<Song> pPreloaded { pSong };
+		CPPUNIT_ASSERT( pPreloaded != NULL );
+		delete pGlobals;
+	}
+
+	void testSwitchAfterSuperseded()
+	{
+		SongPreloader* pPreloader = SongPreloader::get_instance();
+
+		// the switch to entry 3 is raised, the user picks entry 4 before it is handled
+		pPreloader->preload( 3, m_sSongFile, true );
+		CPPUNIT_ASSERT( waitForSwitch( 3 ) );
+		pPreloader->preload( 4, m_sSongFile, true );
+
+		// the playlist drops entry 3 and lets the sequencer play on
+		SongReader::Globals* pGlobals = NULL;
+		bool bPending;
+		Song* pSong = pPreloader->take( 3, m_sSongFile, &pGlobals, &bPending );
+		CPPUNIT_ASSERT( bPending );
+		CPPUNIT_ASSERT( pSong == NULL );
+
+		// the switch to entry 4 is raised on its own
+		CPPUNIT_ASSERT( waitForSwitch( 4 ) );
+		std::unique_ptr<Song> pSwitched { pPreloader->take( 4, m_sSongFile, &pGlobals, &bPending ) };
+		CPPUNIT_ASSERT( !bPending );
+		CPPUNIT_ASSERT( pSwitched != NULL );
+		delete pGlobals;
+	}
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION( SongPreloaderTest );
@@ -0,0 +1,120 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_snapshot.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+
+#include "song_helper.h"
+
+#include <memory>
+#include <vector>
+
+using namespace H2Core;
+
+class SongSnapshotTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SongSnapshotTest );
+	CPPUNIT_TEST( testSequence );
+	CPPUNIT_TEST( testSharedPatterns );
+	CPPUNIT_TEST( testEditedPatterns );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+
+	void testSequence()
+	{
+		std::unique_ptr<Song> pSong { H2Test::createBigSong( 4, 2 ) };
+		SongSnapshot snapshot( pSong.get(), NULL );
+
+		CPPUNIT_ASSERT( snapshot.has_changes() );
+		CPPUNIT_ASSERT_EQUAL( 4, snapshot.get_columns_count() );
+		CPPUNIT_ASSERT_EQUAL( 4 * 192, snapshot.get_length() );
+
+		int nStart = -1;
+		CPPUNIT_ASSERT_EQUAL( 2, snapshot.find_column( 2 * 192 + 10, &nStart ) );
+		CPPUNIT_ASSERT_EQUAL( 2 * 192, nStart );
+		CPPUNIT_ASSERT_EQUAL( -1, snapshot.find_column( 4 * 192, &nStart ) );
+
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.5, snapshot.get_column_position( 1.5 * 192, false ), 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( -1.0, snapshot.get_column_position( 4.5 * 192, false ), 1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, snapshot.get_column_position( 4.5 * 192, true ), 1e-6 );
+
+		// the notes of a tick follow each other
+		const SongSnapshot::PatternData* pData = snapshot.get_pattern( 1 );
+		unsigned nFirst = SongSnapshot::first_note_at( pData, 7 );
+		CPPUNIT_ASSERT( nFirst < pData->notes.size() );
+		CPPUNIT_ASSERT_EQUAL( 7, pData->notes[ nFirst ]->get_position() );
+		CPPUNIT_ASSERT( nFirst == 0 || pData->notes[ nFirst - 1 ]->get_position() < 7 );
+	}
+
+	void testSharedPatterns()
+	{
+		std::unique_ptr<Song> pSong { H2Test::createBigSong( 4, 2 ) };
+		std::unique_ptr<SongSnapshot> pFirst { new SongSnapshot( pSong.get(), NULL ) };
+
+		std::unique_ptr<SongSnapshot> pSame { new SongSnapshot( pSong.get(), pFirst.get() ) };
+		CPPUNIT_ASSERT( !pSame->has_changes() );
+
+		Pattern* pPattern = pSong->get_pattern_list()->get( 2 );
+		Note* pNote = pPattern->get_notes()->begin()->second;
+		pNote->set_velocity( 0.1f );
+
+		std::unique_ptr<SongSnapshot> pEdited { new SongSnapshot( pSong.get(), pFirst.get() ) };
+		CPPUNIT_ASSERT( pEdited->has_changes() );
+		CPPUNIT_ASSERT( pEdited->get_pattern( 0 ) == pFirst->get_pattern( 0 ) );
+		CPPUNIT_ASSERT( pEdited->get_pattern( 2 ) != pFirst->get_pattern( 2 ) );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1, pEdited->get_pattern( 2 )->notes[0]->get_velocity(), 1e-6 );
+
+		// the previous snapshot keeps playing the note as it was
+		CPPUNIT_ASSERT( pFirst->get_pattern( 2 )->notes[0]->get_velocity() > 0.1f );
+	}
+
+	void testEditedPatterns()
+	{
+		std::unique_ptr<Song> pSong { H2Test::createBigSong( 4, 2 ) };
+		std::unique_ptr<SongSnapshot> pFirst { new SongSnapshot( pSong.get(), NULL ) };
+
+		Pattern* pEditedPattern = pSong->get_pattern_list()->get( 1 );
+		Pattern* pOtherPattern = pSong->get_pattern_list()->get( 3 );
+		pEditedPattern->get_notes()->begin()->second->set_velocity( 0.1f );
+		pOtherPattern->get_notes()->begin()->second->set_velocity( 0.2f );
+
+		// only the marked pattern is compared and copied again
+		std::vector<const Pattern*> edited( 1, pEditedPattern );
+		std::unique_ptr<SongSnapshot> pEdited { new SongSnapshot( pSong.get(), pFirst.get(), &edited ) };
+		CPPUNIT_ASSERT( pEdited->has_changes() );
+		CPPUNIT_ASSERT( pEdited->get_pattern( 1 ) != pFirst->get_pattern( 1 ) );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1, pEdited->get_pattern( 1 )->notes[0]->get_velocity(), 1e-6 );
+		CPPUNIT_ASSERT( pEdited->get_pattern( 3 ) == pFirst->get_pattern( 3 ) );
+
+		// a full comparison catches the other change
+		std::unique_ptr<SongSnapshot> pFull { new SongSnapshot( pSong.get(), pEdited.get() ) };
+		CPPUNIT_ASSERT( pFull->get_pattern( 1 ) == pEdited->get_pattern( 1 ) );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.2, pFull->get_pattern( 3 )->notes[0]->get_velocity(), 1e-6 );
+	}
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION( SongSnapshotTest );
@@ -0,0 +1,115 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2018 by the Hydrogen Team
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <QFile>
+#include <QRegExp>
+#include <QString>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/helpers/filesystem.h>
+#include "test_helper.h"
+#include "song_helper.h"
+#include "assertions/file.h"
+
+#include <memory>
+
+using namespace H2Core;
+
+/**
+ * \brief Copy a song file without its version, which depends on the build
+ * \param sFile Song file to copy
+ * \param sCopy Where to write the copy
+ **/
+static void copyWithoutVersion( const QString& sFile, const QString& sCopy )
+{
+	QFile in( sFile );
+	CPPUNIT_ASSERT( in.open( QIODevice::ReadOnly ) );
+	QString sContent = QString::fromUtf8( in.readAll() );
+	sContent.remove( QRegExp( " <version>[^<]*</version>\n" ) );
+
+	QFile out( sCopy );
+	CPPUNIT_ASSERT( out.open( QIODevice::WriteOnly ) );
+	out.write( sContent.toUtf8() );
+}
+
+
+class SongTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SongTest );
+	CPPUNIT_TEST( testSaveLoadRoundTrip );
+	CPPUNIT_TEST( testBigSongRoundTrip );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+
+	void testSaveLoadRoundTrip()
+	{
+		auto songFile = H2TEST_FILE("functional/test.h2song");
+		auto outFile1 = Filesystem::tmp_file_path("test-1.h2song");
+		auto outFile2 = Filesystem::tmp_file_path("test-2.h2song");
+
+		std::unique_ptr<Song> pSong { Song::load( songFile ) };
+		CPPUNIT_ASSERT( pSong != NULL );
+		CPPUNIT_ASSERT( pSong->save( outFile1 ) );
+
+		std::unique_ptr<Song> pSong1 { Song::load( outFile1 ) };
+		CPPUNIT_ASSERT( pSong1 != NULL );
+		CPPUNIT_ASSERT( pSong1->save( outFile2 ) );
+
+		CPPUNIT_ASSERT_EQUAL( pSong->get_pattern_list()->size(), pSong1->get_pattern_list()->size() );
+		CPPUNIT_ASSERT_EQUAL( H2Test::countNotes( pSong.get() ), H2Test::countNotes( pSong1.get() ) );
+		H2TEST_ASSERT_FILES_EQUAL( outFile1, outFile2 );
+
+		// the song written by the DOM writer, the stream writer gives the same bytes
+		auto expectedFile = Filesystem::tmp_file_path("test-dom.h2song");
+		auto actualFile = Filesystem::tmp_file_path("test-stream.h2song");
+		copyWithoutVersion( H2TEST_FILE("song/test_song_dom_writer.h2song"), expectedFile );
+		copyWithoutVersion( outFile1, actualFile );
+		H2TEST_ASSERT_FILES_EQUAL( expectedFile, actualFile );
+
+		Filesystem::rm( outFile1 );
+		Filesystem::rm( outFile2 );
+		Filesystem::rm( expectedFile );
+		Filesystem::rm( actualFile );
+	}
+
+	void testBigSongRoundTrip()
+	{
+		auto outFile = Filesystem::tmp_file_path("big.h2song");
+
+		std::unique_ptr<Song> pSong { H2Test::createBigSong( 32, 16 ) };
+		CPPUNIT_ASSERT( pSong->save( outFile ) );
+
+		std::unique_ptr<Song> pLoaded { Song::load( outFile ) };
+		CPPUNIT_ASSERT( pLoaded != NULL );
+		CPPUNIT_ASSERT_EQUAL( 32, pLoaded->get_pattern_list()->size() );
+		CPPUNIT_ASSERT_EQUAL( H2Test::countNotes( pSong.get() ), H2Test::countNotes( pLoaded.get() ) );
+		CPPUNIT_ASSERT_EQUAL( pSong->get_pattern_group_vector()->size(), pLoaded->get_pattern_group_vector()->size() );
+		CPPUNIT_ASSERT( pLoaded->get_pattern_group_vector()->at( 31 )->get( 0 ) == pLoaded->get_pattern_list()->get( 31 ) );
+
+		Filesystem::rm( outFile );
+	}
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION( SongTest );